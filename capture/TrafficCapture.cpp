@@ -0,0 +1,192 @@
+/*****************************************************************
+ *  @file       TrafficCapture.cpp
+ *  @brief      Recorder of inbound client traffic implementation
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+
+#include "TrafficCapture.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include <boost/format.hpp>
+
+#include "../log/Logger.h"
+
+std::shared_ptr<TrafficCapture> TrafficCapture::tc_ = nullptr;
+
+TrafficCapture::TrafficCapture() {
+    ConsoleLogger::Debug("Construct TrafficCapture class");
+}
+
+TrafficCapture::~TrafficCapture() {
+    Close();
+    ConsoleLogger::Debug("Destruct TrafficCapture class");
+}
+
+void TrafficCapture::Open(const std::string& captureFile) {
+
+    std::unique_lock lk(mutex_);
+    if (active_) {
+        throw std::runtime_error("Traffic capture is already active");
+    }
+
+    file_.open(captureFile, std::ios::binary | std::ios::trunc);
+    if (!file_) {
+        throw std::runtime_error("Capture file can't be opened");
+    }
+
+    const auto now = std::chrono::system_clock::now().time_since_epoch();
+    uint64_t epochUs = std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+
+    std::string header{ magic, sizeof(magic) - 1 };
+    for (std::size_t i = 0; i < sizeof(version); ++i) {
+        header.push_back(static_cast<char>((version >> (8 * i)) & 0xff));
+    }
+    for (std::size_t i = 0; i < sizeof(epochUs); ++i) {
+        header.push_back(static_cast<char>((epochUs >> (8 * i)) & 0xff));
+    }
+    file_.write(header.data(), header.size());
+
+    pending_.reserve(flush_threshold * 2);
+    start_ = std::chrono::steady_clock::now();
+    lastOffsetUs_ = 0;
+    stop_ = false;
+    active_ = true;
+
+    writer_ = std::thread{ [&]() { WriteLoop(); } };
+
+    ConsoleLogger::Info(boost::str(boost::format("Traffic capture started: %1%") % captureFile));
+}
+
+void TrafficCapture::Close() noexcept {
+    {
+        std::unique_lock lk(mutex_);
+        if (!active_) {
+            return;
+        }
+        active_ = false;
+        stop_ = true;
+    }
+    cv_.notify_one();
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+    file_.close();
+    ConsoleLogger::Info("Traffic capture stopped");
+}
+
+void TrafficCapture::Record(const id_t& connId, const char* data, std::size_t size) noexcept {
+
+    if (!IsActive()) {
+        return;
+    }
+
+    try {
+        std::unique_lock lk(mutex_);
+        if (!active_) {
+            return;
+        }
+        /* timestamp is taken under the lock so deltas are never negative */
+        uint64_t offsetUs = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start_).count();
+
+        PutVarint(pending_, offsetUs - lastOffsetUs_);
+        PutVarint(pending_, connId);
+        PutVarint(pending_, size);
+        pending_.append(data, size);
+        lastOffsetUs_ = offsetUs;
+
+        if (pending_.size() >= flush_threshold) {
+            lk.unlock();
+            cv_.notify_one();
+        }
+    }
+    catch (std::exception& ex) {
+        ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
+    }
+}
+
+void TrafficCapture::WriteLoop() {
+
+    std::string chunk;
+    chunk.reserve(flush_threshold * 2);
+
+    for (bool last = false; !last; ) {
+        {
+            std::unique_lock lk(mutex_);
+            cv_.wait_for(lk, std::chrono::milliseconds(flush_period), [&]() {
+                return stop_ || pending_.size() >= flush_threshold;
+            });
+            last = stop_;
+            /* io threads continue to append into the swapped buffer while we write */
+            chunk.swap(pending_);
+        }
+        if (!chunk.empty()) {
+            file_.write(chunk.data(), chunk.size());
+            chunk.clear();
+        }
+    }
+    file_.flush();
+}
+
+void TrafficCapture::PutVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+bool TrafficCapture::GetVarint(std::istream& in, uint64_t& value) {
+    value = 0;
+    for (uint32_t shift = 0; shift < 64; shift += 7) {
+        int c = in.get();
+        if (c == std::char_traits<char>::eof()) {
+            return false;
+        }
+        value |= static_cast<uint64_t>(c & 0x7f) << shift;
+        if ((c & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<TrafficCapture::frame_t> TrafficCapture::Load(const std::string& captureFile) {
+
+    std::ifstream in(captureFile, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Capture file can't be opened");
+    }
+
+    char header[sizeof(magic) - 1 + sizeof(version) + sizeof(uint64_t)];
+    if (!in.read(header, sizeof(header)) || std::memcmp(header, magic, sizeof(magic) - 1) != 0) {
+        throw std::runtime_error("Invalid capture file header");
+    }
+    uint16_t fileVersion = static_cast<uint8_t>(header[sizeof(magic) - 1]) |
+        static_cast<uint16_t>(static_cast<uint8_t>(header[sizeof(magic)]) << 8);
+    if (fileVersion != version) {
+        throw std::runtime_error("Unsupported capture file version");
+    }
+
+    std::vector<frame_t> frames;
+    uint64_t offsetUs = 0;
+
+    for (uint64_t delta; GetVarint(in, delta); ) {
+        uint64_t connId = 0, size = 0;
+        if (!GetVarint(in, connId) || !GetVarint(in, size)) {
+            throw std::runtime_error("Truncated capture frame header");
+        }
+        offsetUs += delta;
+
+        frame_t frame{ offsetUs, static_cast<id_t>(connId), std::string(size, '\0') };
+        if (!in.read(frame.payload.data(), size)) {
+            throw std::runtime_error("Truncated capture frame payload");
+        }
+        frames.push_back(std::move(frame));
+    }
+    return frames;
+}
@@ -0,0 +1,94 @@
+/*****************************************************************
+ *  @file       TrafficCapture.h
+ *  @brief      Recorder of inbound client traffic into compact
+ *              binary capture file
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+#pragma once
+
+/* std C++ lib headers */
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <cstdint>
+#include <condition_variable>
+
+/* capture file layout:
+ *   file header  : "AWSCAP" magic, uint16 version, uint64 capture start (unix epoch, us)
+ *   each frame   : varint delta of time since previous frame (us)
+ *                  varint connection ID
+ *                  varint payload length
+ *                  payload bytes
+ * all fixed width fields are little-endian
+ */
+class TrafficCapture {
+
+public:
+
+    using id_t = uint32_t;
+
+    struct frame_t {
+        uint64_t offsetUs;  // time since capture start
+        id_t connId;
+        std::string payload;
+    };
+
+    static constexpr char magic[] = "AWSCAP";
+    static constexpr uint16_t version = 1;
+
+    TrafficCapture(const TrafficCapture&) = delete;
+    TrafficCapture& operator=(const TrafficCapture&) = delete;
+
+    TrafficCapture();
+    ~TrafficCapture();
+
+    static const std::shared_ptr<TrafficCapture>& GetInstance() {
+        static std::once_flag once;
+        std::call_once(once, []() { tc_ = std::make_shared<TrafficCapture>(); });
+        return tc_;
+    }
+
+    void Open(const std::string& captureFile);
+    void Close() noexcept;
+
+    bool IsActive() const noexcept {
+        return active_.load(std::memory_order_relaxed);
+    }
+
+    /* called from io threads, only appends frame to in-memory buffer */
+    void Record(const id_t& connId, const char* data, std::size_t size) noexcept;
+
+    /* read whole capture file into memory, throws on malformed file */
+    static std::vector<frame_t> Load(const std::string& captureFile);
+
+private:
+
+    static constexpr std::size_t flush_threshold = 64 * 1024;
+    const uint32_t flush_period = 100; // ms
+
+    std::ofstream file_;
+    std::atomic_bool active_{ false };
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::string pending_;
+    std::chrono::steady_clock::time_point start_;
+    uint64_t lastOffsetUs_ = 0;
+    bool stop_ = false;
+
+    std::thread writer_;
+
+    static std::shared_ptr<TrafficCapture> tc_;
+
+    void WriteLoop();
+
+    static void PutVarint(std::string& out, uint64_t value);
+    static bool GetVarint(std::istream& in, uint64_t& value);
+};
@@ -0,0 +1,170 @@
+/*****************************************************************
+ *  @file       TrafficReplay.cpp
+ *  @brief      Deterministic replay of captured traffic implementation
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+
+#include "TrafficReplay.h"
+
+#include <algorithm>
+
+#include <boost/format.hpp>
+
+#include "../log/Logger.h"
+
+TrafficReplay::TrafficReplay(const std::string& captureFile, double speed) :
+    speed_(speed),
+    frames_(TrafficCapture::Load(captureFile)),
+    ctx_(boost::asio::ssl::context::tls_client),
+    timer_(ioc_)
+{
+    ConsoleLogger::Debug("Construct TrafficReplay class");
+    /* replay client only generates load, server certificate is not verified */
+    ctx_.set_verify_mode(boost::asio::ssl::verify_none);
+
+    if (!frames_.empty()) {
+        stats_.captured = std::chrono::microseconds(frames_.back().offsetUs);
+    }
+}
+
+TrafficReplay::~TrafficReplay() {
+    ConsoleLogger::Debug("Destruct TrafficReplay class");
+}
+
+void TrafficReplay::Connect(const std::string& host, uint16_t port) {
+
+    boost::asio::ip::tcp::resolver resolver(ioc_);
+    auto endpoints = resolver.resolve(host, std::to_string(port));
+
+    /* connections are set up before the clock starts, so handshakes
+     * are not part of the replayed workload */
+    for (const auto& frame : frames_) {
+        if (conns_.contains(frame.connId)) {
+            continue;
+        }
+        auto conn = std::make_unique<replay_conn_t>(ioc_, ctx_);
+        boost::asio::connect(conn->socket.lowest_layer(), endpoints);
+        conn->socket.lowest_layer().set_option(boost::asio::ip::tcp::no_delay(true));
+        conn->socket.handshake(boost::asio::ssl::stream_base::client);
+        conns_.emplace(frame.connId, std::move(conn));
+    }
+    stats_.connections = conns_.size();
+}
+
+TrafficReplay::stats_t TrafficReplay::Run(const std::string& host, uint16_t port) {
+
+    Connect(host, port);
+    ConsoleLogger::Info(boost::str(boost::format("Replay %1% frames over %2% connections, speed %3%") %
+        frames_.size() % conns_.size() % (speed_ > 0 ? std::to_string(speed_) + "x" : std::string{ "max" })));
+
+    for (auto& [id, conn] : conns_) {
+        StartDrain(*conn);
+    }
+
+    start_ = std::chrono::steady_clock::now();
+    boost::asio::post(ioc_, [&]() { ScheduleNext(); });
+    ioc_.run();
+
+    ConsoleLogger::Info(boost::str(boost::format(
+        "Replay finished: %1% frames, %2% bytes in %3% ms (captured %4% ms), max lag %5% us, %6% frames/s") %
+        stats_.frames % stats_.bytes %
+        (stats_.elapsed.count() / 1000) % (stats_.captured.count() / 1000) % stats_.maxLag.count() %
+        (stats_.elapsed.count() ? stats_.frames * 1000000 / stats_.elapsed.count() : 0)));
+    return stats_;
+}
+
+std::chrono::steady_clock::time_point TrafficReplay::Deadline(const TrafficCapture::frame_t& frame) const {
+    if (speed_ <= 0) {
+        return start_;
+    }
+    auto offset = std::chrono::microseconds(static_cast<int64_t>(frame.offsetUs / speed_));
+    return start_ + offset;
+}
+
+void TrafficReplay::ScheduleNext() {
+
+    /* limit frames sent per handler, so reads and write completions are not starved */
+    const std::size_t batch = 256;
+
+    for (std::size_t sent = 0; next_ < frames_.size(); ++sent) {
+        const auto& frame = frames_[next_];
+        auto now = std::chrono::steady_clock::now();
+        auto deadline = Deadline(frame);
+
+        if (deadline > now) {
+            timer_.expires_at(deadline);
+            timer_.async_wait([&](const boost::system::error_code& error) {
+                if (!error) {
+                    ScheduleNext();
+                }
+            });
+            return;
+        }
+        if (sent == batch) {
+            boost::asio::post(ioc_, [&]() { ScheduleNext(); });
+            return;
+        }
+
+        stats_.maxLag = std::max(stats_.maxLag,
+            std::chrono::duration_cast<std::chrono::microseconds>(now - deadline));
+        SendFrame(frame);
+        next_++;
+    }
+}
+
+void TrafficReplay::SendFrame(const TrafficCapture::frame_t& frame) {
+
+    auto& conn = *conns_.at(frame.connId);
+    conn.outq.push_back(&frame.payload);
+    inflight_++;
+    stats_.frames++;
+    stats_.bytes += frame.payload.size();
+
+    if (!conn.writing) {
+        StartWrite(conn);
+    }
+}
+
+void TrafficReplay::StartWrite(replay_conn_t& conn) {
+
+    conn.writing = true;
+    boost::asio::async_write(conn.socket, boost::asio::buffer(*conn.outq.front()),
+        [&](const boost::system::error_code& error, std::size_t) {
+            if (error) {
+                ConsoleLogger::Error(boost::str(boost::format("Replay write error: %1%") % error.message()));
+            }
+            conn.outq.pop_front();
+            inflight_--;
+
+            if (!error && !conn.outq.empty()) {
+                StartWrite(conn);
+                return;
+            }
+            inflight_ -= conn.outq.size();
+            conn.outq.clear();
+            conn.writing = false;
+
+            if (next_ == frames_.size() && inflight_ == 0) {
+                stats_.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start_);
+                /* closing sockets aborts pending reads and lets io_context run out of work */
+                for (auto& [id, c] : conns_) {
+                    boost::system::error_code ec;
+                    c->socket.lowest_layer().close(ec);
+                }
+            }
+        });
+}
+
+void TrafficReplay::StartDrain(replay_conn_t& conn) {
+
+    /* server responses are discarded, reading only keeps socket buffers from filling up */
+    conn.socket.async_read_some(boost::asio::buffer(conn.rbuf),
+        [&](const boost::system::error_code& error, std::size_t) {
+            if (!error) {
+                StartDrain(conn);
+            }
+        });
+}
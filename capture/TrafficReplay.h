@@ -0,0 +1,86 @@
+/*****************************************************************
+ *  @file       TrafficReplay.h
+ *  @brief      Deterministic replay of captured traffic against
+ *              running server
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+#pragma once
+
+/* std C++ lib headers */
+#include <string>
+#include <vector>
+#include <deque>
+#include <array>
+#include <memory>
+#include <chrono>
+#include <unordered_map>
+#include <utility>
+#include <cstdint>
+
+/* boost C++ lib headers */
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+
+/* local C++ headers */
+#include "TrafficCapture.h"
+
+class TrafficReplay {
+
+public:
+
+    struct stats_t {
+        std::size_t connections = 0;
+        std::size_t frames = 0;
+        std::size_t bytes = 0;
+        std::chrono::microseconds captured{ 0 };  // duration of original capture
+        std::chrono::microseconds elapsed{ 0 };   // wall time of replay
+        std::chrono::microseconds maxLag{ 0 };    // worst lateness against schedule
+    };
+
+    TrafficReplay() = delete;
+    TrafficReplay(const TrafficReplay&) = delete;
+    TrafficReplay& operator=(const TrafficReplay&) = delete;
+
+    /* speed: 1.0 keeps original inter-arrival times, N plays N times faster,
+     * 0 or negative sends frames back to back as fast as possible */
+    TrafficReplay(const std::string& captureFile, double speed);
+    ~TrafficReplay();
+
+    stats_t Run(const std::string& host, uint16_t port);
+
+private:
+
+    using ssl_socket = boost::asio::ssl::stream<boost::asio::ip::tcp::socket>;
+
+    struct replay_conn_t {
+        explicit replay_conn_t(boost::asio::io_context& ioc, boost::asio::ssl::context& ctx)
+            : socket(ioc, ctx) {}
+
+        ssl_socket socket;
+        std::deque<const std::string*> outq;
+        std::array<char, 1024> rbuf;
+        bool writing = false;
+    };
+
+    const double speed_;
+    std::vector<TrafficCapture::frame_t> frames_;
+
+    boost::asio::io_context ioc_;
+    boost::asio::ssl::context ctx_;
+    boost::asio::steady_timer timer_;
+    std::unordered_map<TrafficCapture::id_t, std::unique_ptr<replay_conn_t>> conns_;
+
+    std::size_t next_ = 0;
+    std::size_t inflight_ = 0;
+    std::chrono::steady_clock::time_point start_;
+    stats_t stats_;
+
+    void Connect(const std::string& host, uint16_t port);
+    void ScheduleNext();
+    void SendFrame(const TrafficCapture::frame_t& frame);
+    void StartWrite(replay_conn_t& conn);
+    void StartDrain(replay_conn_t& conn);
+    std::chrono::steady_clock::time_point Deadline(const TrafficCapture::frame_t& frame) const;
+};
@@ -0,0 +1,58 @@
+/*****************************************************************
+ *  @file       ClusterFrame.h
+ *  @brief      Frames exchanged between cluster nodes
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+#pragma once
+
+/* std C++ lib headers */
+#include <string>
+#include <cstring>
+#include <cstdint>
+
+namespace ClusterFrame {
+
+    enum class type_t : uint16_t {
+        hello = 1,      // node: sender of link
+        reg,            // node now hosts user, sent to directory owner, payload: session epoch
+        unreg,          // node doesn't host user anymore, payload: session epoch
+        route,          // message for user sent to directory owner, node: origin
+        deliver,        // message for user sent to hosting node, node: origin
+        location,       // user is hosted by node, answer of owner to origin of route
+        evict,          // user connected to another node, payload: epoch of session to close
+    };
+
+    /* little-endian hosts only, all nodes run the same build */
+    struct header_t {
+        uint32_t size;      // payload bytes after header
+        uint16_t type;
+        uint8_t hops;
+        uint8_t reserved;
+        uint32_t user;
+        uint32_t node;
+    };
+    static_assert(sizeof(header_t) == 16, "frame header must be packed");
+
+    /* frames are appended to one buffer, so batch goes out in one write */
+    inline void Append(std::string& out, type_t type, uint32_t user, uint32_t node,
+        const std::string& payload = {}, uint8_t hops = 0) {
+        header_t header{ static_cast<uint32_t>(payload.size()), static_cast<uint16_t>(type), hops, 0, user, node };
+        out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.append(payload);
+    }
+
+    /* session epoch travels as 8 byte payload */
+    inline std::string EncodeEpoch(uint64_t epoch) {
+        return std::string(reinterpret_cast<const char*>(&epoch), sizeof(epoch));
+    }
+
+    inline uint64_t DecodeEpoch(const std::string& payload) {
+        uint64_t epoch = 0;
+        if (payload.size() >= sizeof(epoch)) {
+            std::memcpy(&epoch, payload.data(), sizeof(epoch));
+        }
+        return epoch;
+    }
+}
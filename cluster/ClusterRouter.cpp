@@ -0,0 +1,522 @@
+/*****************************************************************
+ *  @file       ClusterRouter.cpp
+ *  @brief      Routing of messages between cluster nodes implementation
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+
+#include "ClusterRouter.h"
+
+#include <array>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+
+#include <boost/format.hpp>
+
+#include "../log/Logger.h"
+#include "../log/Metrics.h"
+
+namespace {
+    Metrics::Counter& framesReceived = Metrics::GetInstance()->GetCounter("cluster_frames_received_total");
+    Metrics::Counter& routed = Metrics::GetInstance()->GetCounter("cluster_routed_total");
+    Metrics::Counter& delivered = Metrics::GetInstance()->GetCounter("cluster_delivered_total");
+    Metrics::Counter& stored = Metrics::GetInstance()->GetCounter("cluster_stored_total");
+    Metrics::Counter& dropped = Metrics::GetInstance()->GetCounter("cluster_frames_dropped_total");
+    Metrics::Gauge& directoryUsers = Metrics::GetInstance()->GetGauge("cluster_directory_users");
+
+    constexpr std::size_t max_frame_size = 16 * 1024 * 1024;
+}
+
+/* incoming link of peer, frames are parsed from whatever one read returned */
+class ClusterRouter::PeerSession {
+
+public:
+
+    PeerSession(ClusterRouter& router, boost::asio::ip::tcp::socket&& socket) :
+        router_(router),
+        socket_(std::move(socket))
+    {
+    }
+
+    void Start() {
+        socket_.set_option(boost::asio::ip::tcp::no_delay(true));
+        Read();
+    }
+
+    void Close() noexcept {
+        boost::system::error_code ec;
+        socket_.close(ec);
+    }
+
+private:
+
+    ClusterRouter& router_;
+    boost::asio::ip::tcp::socket socket_;
+    std::array<char, 64 * 1024> chunk_;
+    std::string rx_;
+
+    void Read() {
+        socket_.async_read_some(boost::asio::buffer(chunk_),
+            [this](const boost::system::error_code& error, std::size_t bytes) {
+            if (error || !Parse(bytes)) {
+                /* session is destroyed here, nothing may touch it after */
+                router_.sessions_.erase(this);
+                return;
+            }
+            Read();
+        });
+    }
+
+    bool Parse(std::size_t bytes) {
+        rx_.append(chunk_.data(), bytes);
+        std::size_t offset = 0;
+        while (rx_.size() - offset >= sizeof(ClusterFrame::header_t)) {
+            ClusterFrame::header_t header;
+            std::memcpy(&header, rx_.data() + offset, sizeof(header));
+            if (header.size > max_frame_size) {
+                ConsoleLogger::Error("Cluster frame is too large, peer link is dropped");
+                return false;
+            }
+            if (rx_.size() - offset - sizeof(header) < header.size) {
+                break;
+            }
+            std::string payload = rx_.substr(offset + sizeof(header), header.size);
+            offset += sizeof(header) + header.size;
+            framesReceived.Inc();
+            router_.OnFrame(header, std::move(payload));
+        }
+        rx_.erase(0, offset);
+        return true;
+    }
+};
+
+std::shared_ptr<ClusterRouter> ClusterRouter::cr_ = nullptr;
+
+ClusterRouter::ClusterRouter() {
+    ConsoleLogger::Debug("Construct ClusterRouter class");
+}
+
+ClusterRouter::~ClusterRouter() {
+    Close();
+    ConsoleLogger::Debug("Destruct ClusterRouter class");
+}
+
+std::vector<ClusterRouter::node_t> ClusterRouter::ParseNodes(const std::string& nodes) {
+
+    std::vector<node_t> result;
+    std::istringstream is(nodes);
+    std::string item;
+    while (std::getline(is, item, ',')) {
+        item.erase(std::remove_if(item.begin(), item.end(), ::isspace), item.end());
+        auto at = item.find('@');
+        auto colon = item.rfind(':');
+        if (at == std::string::npos || colon == std::string::npos || colon < at) {
+            throw std::invalid_argument("Cluster node must be given as id@host:port: " + item);
+        }
+        result.push_back(node_t{ static_cast<node_id_t>(std::stoul(item.substr(0, at))),
+            item.substr(at + 1, colon - at - 1), static_cast<uint16_t>(std::stoul(item.substr(colon + 1))) });
+    }
+    return result;
+}
+
+void ClusterRouter::Open(const config_t& config, handlers_t&& handlers) {
+
+    std::unique_lock lk(mutex_);
+    if (open_) {
+        throw std::runtime_error("Cluster router is already open");
+    }
+
+    auto self = std::find_if(config.nodes.begin(), config.nodes.end(),
+        [&](const node_t& node) { return node.id == config.nodeId; });
+    if (config.nodeId == 0 || self == config.nodes.end()) {
+        throw std::invalid_argument("Cluster membership doesn't contain this node");
+    }
+
+    config_ = config;
+    handlers_ = std::move(handlers);
+    std::vector<node_id_t> ids;
+    for (const auto& node : config_.nodes) {
+        ids.push_back(node.id);
+    }
+    ring_ = std::make_unique<HashRing>(ids, config_.virtualNodes);
+
+    io_.restart();
+    acceptor_ = std::make_unique<boost::asio::ip::tcp::acceptor>(io_,
+        boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), self->port));
+    refreshTimer_ = std::make_unique<boost::asio::steady_timer>(io_);
+    for (const auto& node : config_.nodes) {
+        if (node.id != config_.nodeId) {
+            auto link = std::make_unique<NodeLink>(io_, config_.nodeId, node.id, node.host, node.port,
+                config_.maxLinkQueueBytes, [this](const std::string& frames) { OnReturned(frames); });
+            link->Start();
+            links_.emplace(node.id, std::move(link));
+        }
+    }
+    Accept();
+    Refresh();
+
+    work_ = std::make_unique<boost::asio::io_context::work>(io_);
+    thread_ = std::thread([this]() { io_.run(); });
+    open_ = true;
+
+    ConsoleLogger::Info(boost::str(boost::format("Cluster node #%1% of %2% is listening to %3% port") %
+        config_.nodeId % config_.nodes.size() % self->port));
+}
+
+void ClusterRouter::Close() noexcept {
+
+    {
+        std::unique_lock lk(mutex_);
+        if (!open_) {
+            return;
+        }
+        open_ = false;
+    }
+
+    /* every pending operation completes as aborted, then the thread runs out of work */
+    boost::asio::post(io_, [this]() {
+        boost::system::error_code ec;
+        acceptor_->close(ec);
+        refreshTimer_->cancel();
+        for (auto& [id, link] : links_) {
+            link->Close();
+        }
+        for (auto& [ptr, session] : sessions_) {
+            session->Close();
+        }
+    });
+    work_.reset();
+    thread_.join();
+
+    sessions_.clear();
+    links_.clear();
+    acceptor_.reset();
+    refreshTimer_.reset();
+    directory_.clear();
+    local_.clear();
+    cache_.clear();
+    parked_.clear();
+    directoryUsers.Set(0);
+}
+
+bool ClusterRouter::IsOpen() const noexcept {
+    std::unique_lock lk(mutex_);
+    return open_;
+}
+
+void ClusterRouter::Accept() {
+
+    acceptor_->async_accept([this](const boost::system::error_code& error, boost::asio::ip::tcp::socket socket) {
+        if (error) {
+            if (error != boost::asio::error::operation_aborted) {
+                ConsoleLogger::Error(boost::str(boost::format("Cluster accept error: %1%") % error.message()));
+                Accept();
+            }
+            return;
+        }
+        auto session = std::make_unique<PeerSession>(*this, std::move(socket));
+        auto ptr = session.get();
+        sessions_.emplace(ptr, std::move(session));
+        ptr->Start();
+        Accept();
+    });
+}
+
+/* registrations lost with restarted owner or broken link are repeated periodically */
+void ClusterRouter::Refresh() {
+
+    std::unordered_map<node_id_t, std::pair<std::string, std::size_t>> frames;
+    for (auto [user, epoch] : local_) {
+        auto owner = ring_->Owner(user);
+        if (owner == config_.nodeId) {
+            OnRegister(user, owner, epoch);
+            continue;
+        }
+        auto& [batch, count] = frames[owner];
+        ClusterFrame::Append(batch, ClusterFrame::type_t::reg, user, config_.nodeId, ClusterFrame::EncodeEpoch(epoch));
+        count++;
+    }
+    for (auto& [node, batch] : frames) {
+        links_.at(node)->Send(batch.first, batch.second);
+    }
+
+    /* messages stored while owner was unreachable go to it again, failed ones are parked anew */
+    auto parked = std::move(parked_);
+    parked_.clear();
+    for (auto user : parked) {
+        auto owner = ring_->Owner(user);
+        if (!links_.at(owner)->IsConnected()) {
+            parked_.insert(user);
+            continue;
+        }
+        handlers_.drain(user, [&](std::string&& msg) {
+            Send(owner, ClusterFrame::type_t::route, user, config_.nodeId, msg);
+        });
+    }
+
+    refreshTimer_->expires_after(config_.refreshInterval);
+    refreshTimer_->async_wait([this](const boost::system::error_code& error) {
+        if (!error) {
+            Refresh();
+        }
+    });
+}
+
+/* microseconds of wall clock */
+ClusterRouter::epoch_t ClusterRouter::NewEpoch() noexcept {
+    epoch_t now = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    epoch_t last = lastEpoch_.load();
+    epoch_t epoch;
+    do {
+        epoch = std::max(now, last + 1);
+    } while (!lastEpoch_.compare_exchange_weak(last, epoch));
+    return epoch;
+}
+
+void ClusterRouter::Register(user_id_t user, epoch_t epoch) {
+    if (!IsOpen()) {
+        return;
+    }
+    boost::asio::post(io_, [this, user, epoch]() {
+        /* sessions bound on different threads may be posted out of order */
+        auto& current = local_[user];
+        if (epoch < current) {
+            return;
+        }
+        current = epoch;
+        auto owner = ring_->Owner(user);
+        if (owner == config_.nodeId) {
+            OnRegister(user, owner, epoch);
+        }
+        else {
+            Send(owner, ClusterFrame::type_t::reg, user, config_.nodeId, ClusterFrame::EncodeEpoch(epoch));
+        }
+    });
+}
+
+void ClusterRouter::Unregister(user_id_t user, epoch_t epoch) {
+    if (!IsOpen()) {
+        return;
+    }
+    boost::asio::post(io_, [this, user, epoch]() {
+        /* newer local session of the same user stays registered */
+        auto it = local_.find(user);
+        if (it != local_.end() && it->second == epoch) {
+            local_.erase(it);
+        }
+        auto owner = ring_->Owner(user);
+        if (owner == config_.nodeId) {
+            OnUnregister(user, owner, epoch);
+        }
+        else {
+            Send(owner, ClusterFrame::type_t::unreg, user, config_.nodeId, ClusterFrame::EncodeEpoch(epoch));
+        }
+    });
+}
+
+void ClusterRouter::Route(user_id_t user, std::string&& msg) {
+    if (!IsOpen()) {
+        return;
+    }
+    boost::asio::post(io_, [this, user, msg = std::move(msg)]() mutable {
+        auto it = cache_.find(user);
+        if (it != cache_.end()) {
+            if (it->second.expires > std::chrono::steady_clock::now()) {
+                DeliverAt(it->second.node, user, config_.nodeId, std::move(msg), 0);
+                return;
+            }
+            cache_.erase(it);
+        }
+        auto owner = ring_->Owner(user);
+        if (owner == config_.nodeId) {
+            OnRoute(user, owner, std::move(msg), 0);
+        }
+        else {
+            Send(owner, ClusterFrame::type_t::route, user, config_.nodeId, msg);
+        }
+    });
+}
+
+void ClusterRouter::Send(node_id_t node, ClusterFrame::type_t type, user_id_t user, node_id_t arg,
+    const std::string& payload, uint8_t hops) {
+
+    auto it = links_.find(node);
+    /* message waits in mailbox while node is unreachable, control frames are queued or repeated by refresh */
+    bool message = type == ClusterFrame::type_t::route || type == ClusterFrame::type_t::deliver;
+    if (message && (it == links_.end() || !it->second->IsConnected())) {
+        Keep(user, payload);
+        return;
+    }
+    if (it == links_.end()) {
+        dropped.Inc();
+        return;
+    }
+    std::string frame;
+    ClusterFrame::Append(frame, type, user, arg, payload, hops);
+    it->second->Send(frame, 1);
+}
+
+void ClusterRouter::OnFrame(const ClusterFrame::header_t& header, std::string&& payload) {
+
+    switch (static_cast<ClusterFrame::type_t>(header.type)) {
+        case ClusterFrame::type_t::hello:
+            ConsoleLogger::Info(boost::str(boost::format("Node #%1% connected to cluster node #%2%") %
+                header.node % config_.nodeId));
+            break;
+        case ClusterFrame::type_t::reg:
+            OnRegister(header.user, header.node, ClusterFrame::DecodeEpoch(payload));
+            break;
+        case ClusterFrame::type_t::unreg:
+            OnUnregister(header.user, header.node, ClusterFrame::DecodeEpoch(payload));
+            break;
+        case ClusterFrame::type_t::route:
+            OnRoute(header.user, header.node, std::move(payload), header.hops);
+            break;
+        case ClusterFrame::type_t::deliver:
+            OnDeliver(header.user, header.node, std::move(payload), header.hops);
+            break;
+        case ClusterFrame::type_t::location:
+            cache_[header.user] = location_t{ header.node, std::chrono::steady_clock::now() + config_.locationTtl };
+            break;
+        case ClusterFrame::type_t::evict:
+            OnEvict(header.user, ClusterFrame::DecodeEpoch(payload));
+            break;
+        default:
+            ConsoleLogger::Error(boost::str(boost::format("Unknown cluster frame %1%") % header.type));
+            break;
+    }
+}
+
+/* frames are encoded by this node, so they are complete and well-formed */
+void ClusterRouter::OnReturned(const std::string& frames) {
+
+    std::size_t offset = 0;
+    while (frames.size() - offset >= sizeof(ClusterFrame::header_t)) {
+        ClusterFrame::header_t header;
+        std::memcpy(&header, frames.data() + offset, sizeof(header));
+        offset += sizeof(header);
+        auto type = static_cast<ClusterFrame::type_t>(header.type);
+        if (type == ClusterFrame::type_t::route || type == ClusterFrame::type_t::deliver) {
+            Keep(header.user, frames.substr(offset, header.size));
+        }
+        else {
+            dropped.Inc();
+        }
+        offset += header.size;
+    }
+}
+
+void ClusterRouter::Keep(user_id_t user, const std::string& msg) {
+    stored.Inc();
+    handlers_.store(user, msg);
+    if (ring_->Owner(user) != config_.nodeId) {
+        parked_.insert(user);
+    }
+}
+
+void ClusterRouter::OnRegister(user_id_t user, node_id_t node, epoch_t epoch) {
+
+    auto [it, inserted] = directory_.try_emplace(user, session_t{ node, epoch });
+    if (!inserted) {
+        auto previous = it->second;
+        if (epoch < previous.epoch) {
+            /* repeated registration of replaced session, its node may have missed the evict */
+            if (node != previous.node) {
+                EvictAt(node, user, previous.node, epoch);
+            }
+            return;
+        }
+        it->second = session_t{ node, epoch };
+        /* the latest session wins, previous node closes its one */
+        if (previous.node != node) {
+            EvictAt(previous.node, user, node, previous.epoch);
+        }
+    }
+    directoryUsers.Set(static_cast<int64_t>(directory_.size()));
+
+    /* every kept message is its own frame, client can't split glued ones */
+    handlers_.drain(user, [&](std::string&& msg) {
+        DeliverAt(node, user, config_.nodeId, std::move(msg), 0);
+    });
+}
+
+void ClusterRouter::OnUnregister(user_id_t user, node_id_t node, epoch_t epoch) {
+    /* late unregister of replaced session must not remove the new one */
+    auto it = directory_.find(user);
+    if (it != directory_.end() && it->second.node == node && it->second.epoch == epoch) {
+        directory_.erase(it);
+        directoryUsers.Set(static_cast<int64_t>(directory_.size()));
+    }
+}
+
+void ClusterRouter::OnEvict(user_id_t user, epoch_t epoch) {
+    /* evict of older session must not close the one user opened here since */
+    auto it = local_.find(user);
+    if (it == local_.end() || it->second > epoch) {
+        return;
+    }
+    local_.erase(it);
+    handlers_.evict(user, epoch);
+}
+
+void ClusterRouter::EvictAt(node_id_t node, user_id_t user, node_id_t winner, epoch_t epoch) {
+    if (node == config_.nodeId) {
+        OnEvict(user, epoch);
+    }
+    else {
+        Send(node, ClusterFrame::type_t::evict, user, winner, ClusterFrame::EncodeEpoch(epoch));
+    }
+}
+
+void ClusterRouter::OnRoute(user_id_t user, node_id_t origin, std::string&& msg, uint8_t hops) {
+
+    routed.Inc();
+    auto it = directory_.find(user);
+    if (it == directory_.end()) {
+        Keep(user, msg);
+        return;
+    }
+    auto node = it->second.node;
+    if (origin != config_.nodeId && origin != node) {
+        Send(origin, ClusterFrame::type_t::location, user, node);
+    }
+    if (node != config_.nodeId && hops >= max_hops) {
+        Keep(user, msg);
+        return;
+    }
+    DeliverAt(node, user, origin, std::move(msg), hops);
+}
+
+void ClusterRouter::OnDeliver(user_id_t user, node_id_t origin, std::string&& msg, uint8_t hops) {
+
+    if (handlers_.deliver(user, msg)) {
+        delivered.Inc();
+        return;
+    }
+
+    /* user has left this node, location known to sender was stale */
+    auto owner = ring_->Owner(user);
+    if (owner != config_.nodeId) {
+        Send(owner, ClusterFrame::type_t::route, user, origin, msg, static_cast<uint8_t>(hops + 1));
+        return;
+    }
+    auto it = directory_.find(user);
+    if (it == directory_.end() || it->second.node == config_.nodeId || hops >= max_hops) {
+        Keep(user, msg);
+        return;
+    }
+    OnRoute(user, origin, std::move(msg), static_cast<uint8_t>(hops + 1));
+}
+
+void ClusterRouter::DeliverAt(node_id_t node, user_id_t user, node_id_t origin, std::string&& msg, uint8_t hops) {
+    if (node == config_.nodeId) {
+        OnDeliver(user, origin, std::move(msg), hops);
+    }
+    else {
+        Send(node, ClusterFrame::type_t::deliver, user, origin, msg, hops);
+    }
+}
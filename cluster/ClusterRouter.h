@@ -0,0 +1,159 @@
+/*****************************************************************
+ *  @file       ClusterRouter.h
+ *  @brief      Routing of messages to users connected to other
+ *              nodes of the cluster
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+#pragma once
+
+/* std C++ lib headers */
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <chrono>
+#include <atomic>
+#include <cstdint>
+
+/* boost C++ lib headers */
+#include <boost/asio.hpp>
+
+#include "HashRing.h"
+#include "NodeLink.h"
+#include "ClusterFrame.h"
+
+/* Directory of hosted users is spread over nodes: location of user is kept
+ * by the node owning user ID on hash ring. Node registers its users at
+ * their owners, message for user which isn't connected locally goes to the
+ * owner, which forwards it to hosting node and tells sender the location,
+ * so next messages go to hosting node directly until cached location
+ * expires. Owner also keeps messages of offline users and hands them over
+ * when user registers. Message which can't reach its node, because link
+ * is down or its queue is full, is stored here instead; owner hands it
+ * over again on next registration of user, other node sends it to owner
+ * on refresh once link is up. Every session of user gets an epoch, the newest one
+ * wins, so registration repeated by node whose session was replaced
+ * meanwhile can't take the user back. Epochs come from wall clock, clocks
+ * of nodes are expected to be synchronized. All state is touched only by
+ * router thread. */
+class ClusterRouter {
+
+public:
+
+    using node_id_t = HashRing::node_id_t;
+    using user_id_t = uint32_t;
+    using epoch_t = uint64_t;
+
+    struct node_t {
+        node_id_t id;
+        std::string host;
+        uint16_t port;
+    };
+
+    struct config_t {
+        node_id_t nodeId = 0;
+        std::vector<node_t> nodes;      // whole membership, this node included
+        uint32_t virtualNodes = 64;
+        std::size_t maxLinkQueueBytes = 16 * 1024 * 1024;
+        std::chrono::milliseconds locationTtl{ 5000 };
+        std::chrono::milliseconds refreshInterval{ 10000 };
+    };
+
+    /* local side of routing, invoked from router thread */
+    struct handlers_t {
+        std::function<bool(user_id_t user, const std::string& msg)> deliver;   // false when user isn't here
+        std::function<void(user_id_t user, const std::string& msg)> store;     // keep for offline user
+        /* kept messages of user, one by one, each is acknowledged once forwarded,
+         * forwarded message which doesn't reach its node is stored again */
+        std::function<void(user_id_t user, const std::function<void(std::string&& msg)>& forward)> drain;
+        /* user connected elsewhere, session not newer than epoch is closed */
+        std::function<void(user_id_t user, epoch_t epoch)> evict;
+    };
+
+    ClusterRouter(const ClusterRouter&) = delete;
+    ClusterRouter& operator=(const ClusterRouter&) = delete;
+
+    ClusterRouter();
+    ~ClusterRouter();
+
+    static const std::shared_ptr<ClusterRouter>& GetInstance() {
+        static std::once_flag once;
+        std::call_once(once, []() { cr_ = std::make_shared<ClusterRouter>(); });
+        return cr_;
+    }
+
+    /* "1@host:port,2@host:port" */
+    static std::vector<node_t> ParseNodes(const std::string& nodes);
+
+    void Open(const config_t& config, handlers_t&& handlers);
+    void Close() noexcept;
+    bool IsOpen() const noexcept;
+
+    /* epoch for new session, strictly increasing on one node */
+    epoch_t NewEpoch() noexcept;
+
+    /* non-blocking, work is done on router thread */
+    void Register(user_id_t user, epoch_t epoch);
+    void Unregister(user_id_t user, epoch_t epoch);
+    void Route(user_id_t user, std::string&& msg);
+
+private:
+
+    class PeerSession;
+
+    const uint8_t max_hops = 2;
+
+    config_t config_;
+    handlers_t handlers_;
+    std::unique_ptr<HashRing> ring_;
+
+    boost::asio::io_context io_;
+    std::unique_ptr<boost::asio::io_context::work> work_;
+    std::unique_ptr<boost::asio::ip::tcp::acceptor> acceptor_;
+    std::unique_ptr<boost::asio::steady_timer> refreshTimer_;
+    std::unordered_map<node_id_t, std::unique_ptr<NodeLink>> links_;
+    std::unordered_map<PeerSession*, std::unique_ptr<PeerSession>> sessions_;
+    std::thread thread_;
+    bool open_ = false;
+    mutable std::mutex mutex_;
+    std::atomic<epoch_t> lastEpoch_{ 0 };
+
+    struct session_t {
+        node_id_t node;
+        epoch_t epoch;
+    };
+    /* users owned by this node on the ring and their latest sessions */
+    std::unordered_map<user_id_t, session_t> directory_;
+    /* users connected to this node and epochs of their sessions */
+    std::unordered_map<user_id_t, epoch_t> local_;
+    struct location_t {
+        node_id_t node;
+        std::chrono::steady_clock::time_point expires;
+    };
+    std::unordered_map<user_id_t, location_t> cache_;
+    /* users owned by other nodes with messages stored here */
+    std::unordered_set<user_id_t> parked_;
+
+    static std::shared_ptr<ClusterRouter> cr_;
+
+    void Accept();
+    void Refresh();
+    void Send(node_id_t node, ClusterFrame::type_t type, user_id_t user, node_id_t arg,
+        const std::string& payload = {}, uint8_t hops = 0);
+    void OnFrame(const ClusterFrame::header_t& header, std::string&& payload);
+    void OnReturned(const std::string& frames);
+    void Keep(user_id_t user, const std::string& msg);
+    void OnRegister(user_id_t user, node_id_t node, epoch_t epoch);
+    void OnUnregister(user_id_t user, node_id_t node, epoch_t epoch);
+    void OnEvict(user_id_t user, epoch_t epoch);
+    void EvictAt(node_id_t node, user_id_t user, node_id_t winner, epoch_t epoch);
+    void OnRoute(user_id_t user, node_id_t origin, std::string&& msg, uint8_t hops);
+    void OnDeliver(user_id_t user, node_id_t origin, std::string&& msg, uint8_t hops);
+    void DeliverAt(node_id_t node, user_id_t user, node_id_t origin, std::string&& msg, uint8_t hops);
+};
@@ -0,0 +1,41 @@
+/*****************************************************************
+ *  @file       HashRing.cpp
+ *  @brief      Consistent hashing implementation
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+
+#include "HashRing.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+HashRing::HashRing(const std::vector<node_id_t>& nodes, uint32_t virtualNodes) {
+
+    if (nodes.empty()) {
+        throw std::invalid_argument("Hash ring needs at least one node");
+    }
+    virtualNodes = std::max<uint32_t>(virtualNodes, 1);
+    points_.reserve(nodes.size() * virtualNodes);
+    for (auto node : nodes) {
+        for (uint32_t i = 0; i < virtualNodes; ++i) {
+            points_.emplace_back(Hash((static_cast<uint64_t>(node) << 32) | i), node);
+        }
+    }
+    std::sort(points_.begin(), points_.end());
+}
+
+/* splitmix64 finalizer, stable across builds unlike std::hash */
+uint64_t HashRing::Hash(uint64_t value) noexcept {
+    value += 0x9e3779b97f4a7c15ull;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+    return value ^ (value >> 31);
+}
+
+HashRing::node_id_t HashRing::Owner(uint32_t key) const noexcept {
+    auto hash = Hash(key);
+    auto it = std::lower_bound(points_.begin(), points_.end(), std::make_pair(hash, node_id_t{ 0 }));
+    return it == points_.end() ? points_.front().second : it->second;
+}
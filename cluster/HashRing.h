@@ -0,0 +1,35 @@
+/*****************************************************************
+ *  @file       HashRing.h
+ *  @brief      Consistent hashing of user IDs to cluster nodes
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+#pragma once
+
+/* std C++ lib headers */
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+/* Every node is placed on the ring at several pseudo-random points, user
+ * belongs to the first point clockwise from the user hash. Hash doesn't
+ * depend on process, so all nodes agree on owners of the same membership,
+ * and adding a node moves only users of the ring arcs it takes over. */
+class HashRing {
+
+public:
+
+    using node_id_t = uint32_t;
+
+    HashRing() = delete;
+    HashRing(const std::vector<node_id_t>& nodes, uint32_t virtualNodes);
+
+    node_id_t Owner(uint32_t key) const noexcept;
+
+    static uint64_t Hash(uint64_t value) noexcept;
+
+private:
+
+    std::vector<std::pair<uint64_t, node_id_t>> points_;   // sorted by hash
+};
@@ -0,0 +1,195 @@
+/*****************************************************************
+ *  @file       NodeLink.cpp
+ *  @brief      Persistent outgoing connection to cluster peer implementation
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+
+#include "NodeLink.h"
+
+#include <algorithm>
+
+#include <boost/format.hpp>
+
+#include "ClusterFrame.h"
+#include "../log/Logger.h"
+#include "../log/Metrics.h"
+
+namespace {
+    Metrics::Counter& framesSent = Metrics::GetInstance()->GetCounter("cluster_frames_sent_total");
+    Metrics::Counter& batchesSent = Metrics::GetInstance()->GetCounter("cluster_batches_sent_total");
+    Metrics::Counter& framesDropped = Metrics::GetInstance()->GetCounter("cluster_frames_dropped_total");
+}
+
+NodeLink::NodeLink(boost::asio::io_context& io, node_id_t self, node_id_t peer,
+    const std::string& host, uint16_t port, std::size_t maxQueueBytes, returned_t&& returned) :
+    self_(self),
+    peer_(peer),
+    host_(host),
+    port_(port),
+    maxQueueBytes_(maxQueueBytes),
+    returned_(std::move(returned)),
+    socket_(io),
+    resolver_(io),
+    timer_(io),
+    backoff_(min_backoff)
+{
+    ConsoleLogger::Debug(boost::str(boost::format("Construct NodeLink class to node #%1%") % peer_));
+}
+
+NodeLink::~NodeLink() {
+    ConsoleLogger::Debug(boost::str(boost::format("Destruct NodeLink class to node #%1%") % peer_));
+}
+
+void NodeLink::Start() {
+    Connect();
+}
+
+void NodeLink::Close() noexcept {
+    if (closed_) {
+        return;
+    }
+    closed_ = true;
+    boost::system::error_code ec;
+    timer_.cancel();
+    resolver_.cancel();
+    socket_.close(ec);
+
+    /* batch stays in writing_ until its write completes, completion sees link closed */
+    try {
+        Return(writing_, writingFrames_);
+        Return(pending_, pendingFrames_);
+    }
+    catch (std::exception& ex) {
+        ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%") % __FUNCTION__ % ex.what()));
+    }
+    pending_.clear();
+    pendingFrames_ = 0;
+}
+
+void NodeLink::Connect() {
+
+    resolver_.async_resolve(host_, std::to_string(port_),
+        [this](const boost::system::error_code& error, boost::asio::ip::tcp::resolver::results_type results) {
+        if (closed_) {
+            return;
+        }
+        if (error) {
+            Reconnect();
+            return;
+        }
+        boost::asio::async_connect(socket_, results,
+            [this](const boost::system::error_code& error, const boost::asio::ip::tcp::endpoint&) {
+            if (closed_) {
+                return;
+            }
+            if (error) {
+                Reconnect();
+                return;
+            }
+            ConsoleLogger::Info(boost::str(boost::format("Link to node #%1% is connected") % peer_));
+            socket_.set_option(boost::asio::ip::tcp::no_delay(true));
+            connected_ = true;
+            backoff_ = min_backoff;
+
+            /* hello goes ahead of frames queued while link was down */
+            std::string hello;
+            ClusterFrame::Append(hello, ClusterFrame::type_t::hello, 0, self_);
+            pending_.insert(0, hello);
+            pendingFrames_++;
+            WatchPeer();
+            Flush();
+        });
+    });
+}
+
+void NodeLink::Reconnect() {
+
+    boost::system::error_code ec;
+    socket_.close(ec);
+    connected_ = false;
+    writing_active_ = false;
+
+    timer_.expires_after(backoff_);
+    backoff_ = std::min(backoff_ * 2, max_backoff);
+    timer_.async_wait([this](const boost::system::error_code& error) {
+        if (!error && !closed_) {
+            Connect();
+        }
+    });
+}
+
+/* peer never writes to this direction, read completes only when link breaks */
+void NodeLink::WatchPeer() {
+    socket_.async_read_some(boost::asio::buffer(&probe_, 1),
+        [this](const boost::system::error_code& error, std::size_t) {
+        if (closed_ || !connected_) {
+            return;
+        }
+        if (error) {
+            ConsoleLogger::Error(boost::str(boost::format("Link to node #%1% is broken: %2%") % peer_ % error.message()));
+            Reconnect();
+            return;
+        }
+        WatchPeer();
+    });
+}
+
+void NodeLink::Send(const std::string& frames, std::size_t count) {
+
+    if (pending_.size() + frames.size() > maxQueueBytes_) {
+        Return(frames, count);
+        return;
+    }
+    pending_.append(frames);
+    pendingFrames_ += count;
+    if (connected_ && !writing_active_) {
+        Flush();
+    }
+}
+
+void NodeLink::Flush() {
+
+    if (pending_.empty()) {
+        return;
+    }
+    writing_.swap(pending_);
+    writingFrames_ = pendingFrames_;
+    pending_.clear();
+    pendingFrames_ = 0;
+    writing_active_ = true;
+
+    boost::asio::async_write(socket_, boost::asio::buffer(writing_),
+        [this](const boost::system::error_code& error, std::size_t) {
+        if (closed_) {
+            return;
+        }
+        writing_active_ = false;
+        if (error) {
+            /* part of batch may be received, owner decides whether to send it again */
+            Return(writing_, writingFrames_);
+            writing_.clear();
+            if (connected_) {
+                ConsoleLogger::Error(boost::str(boost::format("Write to node #%1% failed: %2%") % peer_ % error.message()));
+                Reconnect();
+            }
+            return;
+        }
+        framesSent.Inc(writingFrames_);
+        batchesSent.Inc();
+        writing_.clear();
+        Flush();
+    });
+}
+
+void NodeLink::Return(const std::string& frames, std::size_t count) {
+
+    if (frames.empty()) {
+        return;
+    }
+    framesDropped.Inc(count);
+    if (returned_) {
+        returned_(frames);
+    }
+}
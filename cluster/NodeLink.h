@@ -0,0 +1,81 @@
+/*****************************************************************
+ *  @file       NodeLink.h
+ *  @brief      Persistent outgoing connection to cluster peer
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+#pragma once
+
+/* std C++ lib headers */
+#include <string>
+#include <chrono>
+#include <functional>
+#include <cstdint>
+
+/* boost C++ lib headers */
+#include <boost/asio.hpp>
+
+/* Link is used only from thread of its io_context. Frames sent while
+ * previous write is in flight are collected in one buffer and written
+ * together, so batch size follows load without extra delay. Link is
+ * reconnected with backoff, frames over queue limit, frames of failed
+ * write and frames left at close are handed back to owner of the link.
+ * Part of failed batch may be received, so handed back message can come
+ * twice, but it isn't lost. */
+class NodeLink {
+
+public:
+
+    using node_id_t = uint32_t;
+    /* frames which didn't go out, invoked from thread of io_context */
+    using returned_t = std::function<void(const std::string& frames)>;
+
+    NodeLink() = delete;
+    NodeLink(const NodeLink&) = delete;
+    NodeLink& operator=(const NodeLink&) = delete;
+
+    NodeLink(boost::asio::io_context& io, node_id_t self, node_id_t peer,
+        const std::string& host, uint16_t port, std::size_t maxQueueBytes, returned_t&& returned = nullptr);
+    ~NodeLink();
+
+    void Start();
+    void Close() noexcept;
+
+    /* frames encoded with ClusterFrame::Append */
+    void Send(const std::string& frames, std::size_t count);
+
+    bool IsConnected() const noexcept { return connected_; }
+
+private:
+
+    const std::chrono::milliseconds min_backoff{ 50 };
+    const std::chrono::milliseconds max_backoff{ 2000 };
+
+    const node_id_t self_;
+    const node_id_t peer_;
+    const std::string host_;
+    const uint16_t port_;
+    const std::size_t maxQueueBytes_;
+    const returned_t returned_;
+
+    boost::asio::ip::tcp::socket socket_;
+    boost::asio::ip::tcp::resolver resolver_;
+    boost::asio::steady_timer timer_;
+    std::chrono::milliseconds backoff_;
+
+    std::string pending_;
+    std::size_t pendingFrames_ = 0;
+    std::string writing_;
+    std::size_t writingFrames_ = 0;
+    bool connected_ = false;
+    bool writing_active_ = false;
+    bool closed_ = false;
+    char probe_ = 0;
+
+    void Connect();
+    void Reconnect();
+    void Flush();
+    void WatchPeer();
+    void Return(const std::string& frames, std::size_t count);
+};
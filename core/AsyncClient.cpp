@@ -11,18 +11,48 @@ std::shared_ptr<ConnectionManager> ConnectionManager::cm_ = nullptr;
 std::shared_ptr<MessageBroker> MessageBroker::mb_ = nullptr;
 
 void AsyncClient::HandleAccept() const noexcept {
-    conn->StartAuth();
+    conn.StartAuth();
 }
 
 void AsyncClient::DisconnectClient() const noexcept  {
-    conn->socket().close();
-    ConnectionManager::GetInstance()->RemoveConnection(id_);
+    boost::system::error_code ec;
+    conn.socket().close(ec);
+    ConnectionManager::GetInstance()->RemoveConnection(GetClientId(), &conn);
 }
 
 void AsyncClient::ResendMessage(const std::string & msg) const noexcept {
-    conn->StartWriteMessage(msg);
+    conn.StartWriteMessage(msg);
+}
+
+void AsyncClient::Drain() const noexcept {
+    conn.Drain();
+}
+
+bool AsyncClient::IsDraining() const noexcept {
+    return conn.IsDraining();
+}
+
+void AsyncClient::Abort() const noexcept {
+    conn.Abort();
 }
 
 const AsyncClient::T AsyncClient::GetClientId() const noexcept  {
-    return id_;
+    return id_.load();
+}
+
+void AsyncClient::SetClientId(const T& id) noexcept {
+    id_.store(id);
+    conn.SetId(static_cast<AsyncTcpConnection::id_t>(id));
+}
+
+uint64_t AsyncClient::GetEpoch() const noexcept {
+    return epoch_.load();
+}
+
+void AsyncClient::SetEpoch(uint64_t epoch) noexcept {
+    epoch_.store(epoch);
+}
+
+const AsyncTcpConnection* AsyncClient::GetConnection() const noexcept {
+    return &conn;
 }
\ No newline at end of file
@@ -19,15 +19,23 @@ public:
      *  @return Reference to tcp connection socket
      */
     decltype(auto) socket() const noexcept {
-        return conn->socket();
+        return conn.socket();
     }
 
     AsyncClient(boost::asio::io_service& io_service,
         boost::asio::ssl::context& context, const T& connId)
-        : id_(connId)
+        : conn(io_service, context, static_cast<AsyncTcpConnection::id_t>(connId)), id_(connId)
     {
         std::cout << "New client constructor\n";
-        conn = AsyncTcpConnection::create(io_service, context, id_);
+    }
+
+    /* connection holds the client through its pending operations */
+    static client_ptr Create(boost::asio::io_service& io_service,
+        boost::asio::ssl::context& context, const T& connId)
+    {
+        auto client = std::make_shared<AsyncClient>(io_service, context, connId);
+        client->conn.SetOwner(client);
+        return client;
     }
 
     ~AsyncClient() {
@@ -37,9 +45,21 @@ public:
     void HandleAccept() const noexcept;
     void DisconnectClient() const noexcept;
     const T GetClientId() const noexcept;
+    void SetClientId(const T& id) noexcept;
+    const AsyncTcpConnection* GetConnection() const noexcept;
     void ResendMessage(const std::string & msg) const noexcept;
+    /* hot upgrade: queued messages are flushed, then client is let go */
+    void Drain() const noexcept;
+    bool IsDraining() const noexcept;
+    /* pending operations fail and connection closes itself on its strand */
+    void Abort() const noexcept;
+    /* cluster session epoch of authenticated user */
+    uint64_t GetEpoch() const noexcept;
+    void SetEpoch(uint64_t epoch) noexcept;
 private:
 
-    AsyncTcpConnection::connection_ptr conn;
-    T id_;
+    /* in place, client is one allocation together with its control block */
+    mutable AsyncTcpConnection conn;
+    std::atomic<T> id_;
+    std::atomic<uint64_t> epoch_{ 0 };
 };
\ No newline at end of file
@@ -11,6 +11,8 @@
 #include <algorithm>
 #include <mutex>
 #include <shared_mutex>
+#include <sstream>
+#include <optional>
 
 /* boost C++ lib headers */
 #include <boost/format.hpp>
@@ -19,107 +21,423 @@
 #include <boost/bind/bind.hpp>
 #include <boost/bind/placeholders.hpp>
 #include <boost/date_time.hpp>
+#include <boost/property_tree/json_parser.hpp>
 
 /* local C++ headers */
 #include "AsyncTcpConnection.h"
 #include "../log/Logger.h"
 #include "../core/ConnectionManager.h"
 #include "../data/DataProcess.h"
+#include "../capture/TrafficCapture.h"
+#include "../crypto/SessionToken.h"
+#include "../log/Metrics.h"
+#include "ConnectionTimers.h"
+#include "TaskScheduler.h"
+
+namespace {
+    Metrics::Counter& handshakeTimeouts = Metrics::GetInstance()->GetCounter("connection_timeouts_total{reason=\"handshake\"}");
+    Metrics::Counter& authTimeouts = Metrics::GetInstance()->GetCounter("connection_timeouts_total{reason=\"auth\"}");
+    Metrics::Counter& idleTimeouts = Metrics::GetInstance()->GetCounter("connection_timeouts_total{reason=\"idle\"}");
+    Metrics::Counter& stallTimeouts = Metrics::GetInstance()->GetCounter("connection_timeouts_total{reason=\"write_stall\"}");
+    Metrics::Counter& heartbeats = Metrics::GetInstance()->GetCounter("heartbeats_sent_total");
+    Metrics::Counter& oversizeFrames = Metrics::GetInstance()->GetCounter("frames_oversize_total");
+    Metrics::Counter& readPauses = Metrics::GetInstance()->GetCounter("read_pauses_total");
+    Metrics::Histogram& readPauseTime = Metrics::GetInstance()->GetHistogram("read_pause_us");
+
+    const std::string& HeartbeatMessage() {
+        static const std::string msg = boost::str(boost::format("{\"%1%\":\"%2%\"}") %
+            JsonHandler::msg_identificator_token % static_cast<uint32_t>(JsonHandler::json_req_t::heartbeat_message));
+        return msg;
+    }
+}
 
 AsyncTcpConnection::ssl_socket::lowest_layer_type& AsyncTcpConnection::socket() {
     return socket_.lowest_layer();
 }
 
+int64_t AsyncTcpConnection::NowMs() noexcept {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 void AsyncTcpConnection::StartAuth() {
 
+    const auto& timers = ConnectionTimers::GetInstance();
+    phase_ = phase_t::handshake;
+    lastReadMs_ = NowMs();
+    if (timers->GetConfig().handshakeTimeout.count() > 0) {
+        timers->Schedule(timer_, timers->GetConfig().handshakeTimeout);
+    }
+
     socket_.async_handshake(boost::asio::ssl::stream_base::server,
-        [&](const boost::system::error_code& error) {
+        [this, self = Self()](const boost::system::error_code& error) {
             HandleHandshake(error);
         });
 }
 
 void AsyncTcpConnection::HandleHandshake(const boost::system::error_code& error) {
 
-    std::cout << buf.data() << std::endl;
-
     if (!error) {
-        socket_.async_read_some(boost::asio::buffer(buf),
-            [&](const boost::system::error_code& error,
-                std::size_t recvBytes) {
-                    HandleAuth(error, recvBytes);
-            });
+        const auto& timers = ConnectionTimers::GetInstance();
+        auto now = NowMs();
+        lastReadMs_ = now;
+        if (timers->GetConfig().authTimeout.count() > 0) {
+            phase_ = phase_t::auth;
+            timers->Schedule(timer_, timers->GetConfig().authTimeout);
+        }
+        else {
+            phase_ = phase_t::established;
+            if (auto next = NextCheck(now); next.count() > 0) {
+                timers->Schedule(timer_, next);
+            }
+        }
+
+        ReadFrame(&AsyncTcpConnection::HandleAuth);
     } else {
         ConsoleLogger::Info(boost::str(boost::format(
-            "HandleHandshake error user: %1% \"%2%\"\n") % id_ % error.message()));
+            "HandleHandshake error user: %1% \"%2%\"\n") % GetId() % error.message()));
         Shutdown();
     }
 }
 
 void AsyncTcpConnection::HandleAuth(const boost::system::error_code& error,
-    std::size_t recvBytes)
+    const char* data, std::size_t recvBytes)
 {
     if (!error)
     {
-        std::string auth_message{ buf.data(), recvBytes };
-        ConsoleLogger::Info(boost::str(boost::format("<< \"%1%\" [%2%]\n") % std::string{ buf.data(), recvBytes } % recvBytes));
+        lastReadMs_ = NowMs();
+        if (IsOversize(recvBytes)) {
+            return;
+        }
+        TrafficCapture::GetInstance()->Record(GetId(), data, recvBytes);
 
-        DataProcess::GetInstance()->PushNewMessage(std::cref(id_), std::move(auth_message));
-        StartRead();
+        std::string auth_message{ data, recvBytes };
+        ConsoleLogger::Info(boost::str(boost::format("<< \"%1%\" [%2%]\n") % std::string{ data, recvBytes } % recvBytes));
+
+        /* reconnect with session token is served right here, without dispatcher and DB */
+        if (auth_message.find(JsonHandler::session_token_token) != std::string::npos) {
+            ResumeSession(std::move(auth_message), recvBytes);
+            return;
+        }
+        DataProcess::GetInstance()->PushNewMessage(GetId(), std::move(auth_message));
+        ContinueRead(recvBytes);
     }
     else {
         ConsoleLogger::Info(boost::str(boost::format(
-            "Handle authentication error user: %1% \"%2%\"\n") % id_ % error.message()));
+            "Handle authentication error user: %1% \"%2%\"\n") % GetId() % error.message()));
         Shutdown();
     }
 }
 
+/* parsing and token signature check run on scheduler threads, strand only binds the user;
+ * socket isn't read meanwhile, so the next frame is handled after the session is resumed */
+void AsyncTcpConnection::ResumeSession(std::string&& auth_message, std::size_t recvBytes)
+{
+    using claims_t = std::optional<SessionToken::claims_t>;
+    TaskScheduler::GetInstance()->Offload(socket_.get_executor(),
+        [auth_message = std::move(auth_message)]() mutable {
+            claims_t claims;
+            try {
+                namespace pt = boost::property_tree;
+                pt::ptree tree;
+                std::istringstream is(auth_message);
+                pt::read_json(is, tree);
+                if (auto token = tree.get_optional<std::string>(JsonHandler::session_token_token)) {
+                    claims = SessionToken::GetInstance()->Verify(*token);
+                }
+            }
+            catch (std::exception& ex) {
+                ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
+            }
+            return std::make_pair(std::move(auth_message), std::move(claims));
+        },
+        [this, connId = GetId(), recvBytes](std::pair<std::string, claims_t>&& result) {
+            auto client = ConnectionManager::GetInstance()->FindClient(connId, this);
+            if (!client) {
+                return;
+            }
+            auto& [message, claims] = result;
+            if (!claims || !BindSession(*claims)) {
+                if (!claims) {
+                    ConsoleLogger::Info(boost::str(boost::format("Session token of user %1% is rejected\n") % GetId()));
+                }
+                /* client may have sent credentials too, let full authentication decide */
+                DataProcess::GetInstance()->PushNewMessage(GetId(), std::move(message));
+            }
+            ContinueRead(recvBytes);
+        });
+}
+
+bool AsyncTcpConnection::BindSession(const SessionToken::claims_t& claims)
+{
+    try {
+        auto userId = ConnectionManager::GetInstance()->BindUser(GetId(), claims.userId);
+        if (userId == ConnectionManager::INVALID_ID) {
+            return false;
+        }
+        StartWriteMessage(DataProcess::GetInstance()->ConstructAuthResponse(userId,
+            PostgresProcessor::auth_status_t::approved, SessionToken::GetInstance()->Issue(userId, claims.login)));
+        ConnectionManager::GetInstance()->DeliverOfflineMessages(userId);
+        return true;
+    }
+    catch (std::exception& ex) {
+        ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
+    }
+    return false;
+}
+
 void AsyncTcpConnection::StartRead()
 {
-    socket_.async_read_some(boost::asio::buffer(buf),
-        [&](const boost::system::error_code& error,
-            std::size_t recvBytes) {
-                HandleRead(error, recvBytes);
+    ReadFrame(&AsyncTcpConnection::HandleRead);
+}
+
+/* one record is one frame as before: the first byte tells data has arrived, SSL_read
+ * returns no more than one record, so the second read takes just what is left of it
+ * and is served from OpenSSL without a syscall */
+void AsyncTcpConnection::ReadFrame(frame_handler_t handler)
+{
+    socket_.async_read_some(boost::asio::buffer(&first_, sizeof(first_)),
+        [this, self = Self(), handler](const boost::system::error_code& error, std::size_t recvBytes) {
+            if (error) {
+                (this->*handler)(error, nullptr, 0);
+                return;
+            }
+            /* one byte over max frame size tells oversize frame from the largest allowed */
+            auto frame = BufferPool::GetInstance()->Acquire(RateLimiter::GetInstance()->GetConfig().maxFrameSize + 1);
+            frame.data()[0] = first_;
+            if (::SSL_pending(socket_.native_handle()) == 0) {
+                (this->*handler)(error, frame.data(), recvBytes);
+                return;
+            }
+            auto rest = boost::asio::buffer(frame.data() + recvBytes, frame.size() - recvBytes);
+            socket_.async_read_some(rest, [this, self, handler, frame = std::move(frame), recvBytes](
+                const boost::system::error_code& error, std::size_t moreBytes) mutable {
+                    (this->*handler)(error, frame.data(), recvBytes + moreBytes);
+                });
         });
 }
 
 void AsyncTcpConnection::HandleRead(const boost::system::error_code& error,
-    std::size_t recvBytes)
+    const char* data, std::size_t recvBytes)
 {
     if (!error)
     {
-        std::string in_msg{ buf.data(), recvBytes };
-        ConsoleLogger::Info(boost::str(boost::format("<< \"%1%\" [%2%]\n") % std::string{ buf.data(), recvBytes } % recvBytes));
+        lastReadMs_ = NowMs();
+        if (IsOversize(recvBytes)) {
+            return;
+        }
+        TrafficCapture::GetInstance()->Record(GetId(), data, recvBytes);
+
+        std::string in_msg{ data, recvBytes };
+        ConsoleLogger::Info(boost::str(boost::format("<< \"%1%\" [%2%]\n") % std::string{ data, recvBytes } % recvBytes));
 
         to_lower(std::move(in_msg.data()));
 
-        DataProcess::GetInstance()->PushNewMessage(std::cref(id_), std::move(in_msg));
-        StartRead();
+        DataProcess::GetInstance()->PushNewMessage(GetId(), std::move(in_msg));
+        ContinueRead(recvBytes);
     }
     else {
         ConsoleLogger::Info(boost::str(boost::format(
-            "HandleRead error user: %1% \"%2%\"\n") % id_ % error.message()));
+            "HandleRead error user: %1% \"%2%\"\n") % GetId() % error.message()));
         Shutdown();
     }
 }
 
+/* frame filling the whole buffer is over the limit, client is cut off before anything is queued */
+bool AsyncTcpConnection::IsOversize(std::size_t recvBytes)
+{
+    auto limit = RateLimiter::GetInstance()->GetConfig().maxFrameSize;
+    if (recvBytes <= limit) {
+        return false;
+    }
+    oversizeFrames.Inc();
+    ConsoleLogger::Info(boost::str(boost::format("Frame of user %1% exceeds %2% bytes\n") % GetId() % limit));
+    Shutdown();
+    return true;
+}
+
+/* charges the frame and either reads on or leaves socket unread until limits refill,
+ * so sender is held back by TCP window instead of the dispatcher queue */
+void AsyncTcpConnection::ContinueRead(std::size_t recvBytes)
+{
+    auto id = GetId();
+    auto pause = RateLimiter::GetInstance()->Charge(limits_,
+        id < ConnectionManager::FIRST_GUEST_ID ? id : 0, recvBytes);
+    if (pause.count() == 0) {
+        StartRead();
+        return;
+    }
+
+    readPauses.Inc();
+    readPauseTime.Observe(pause);
+    readPause_.expires_after(pause);
+    readPause_.async_wait([this, self = Self()](const boost::system::error_code& error) {
+        /* cancelled by destruction of connection */
+        if (!error) {
+            StartRead();
+        }
+    });
+}
+
 void AsyncTcpConnection::StartWriteMessage(const std::string& msg)
 {
-    socket_.async_write_some(boost::asio::buffer(msg),
-        [&](const boost::system::error_code& error,
+    /* called from dispatcher and DB threads, queue is owned by socket strand */
+    boost::asio::post(socket_.get_executor(), [this, self = Self(), msg]() mutable {
+        outq_.push_back(std::move(msg));
+        if (outq_.size() == 1) {
+            WriteNextMessage();
+        }
+    });
+}
+
+void AsyncTcpConnection::WriteNextMessage()
+{
+    writeStartedMs_ = NowMs();
+    boost::asio::async_write(socket_, boost::asio::buffer(outq_.front()),
+        [this, self = Self()](const boost::system::error_code& error,
             std::size_t bytes_transferred) {
+                outq_.pop_front();
+                writeStartedMs_ = 0;
+                if (error) {
+                    ConsoleLogger::Info(boost::str(boost::format(
+                        "Write error user: %1% \"%2%\"\n") % GetId() % error.message()));
+                    outq_.clear();
+                    return;
+                }
                 std::cout << "Message sended\n";
+                if (!outq_.empty()) {
+                    WriteNextMessage();
+                }
+                else if (draining_) {
+                    FinishDrain();
+                }
         });
 }
 
+void AsyncTcpConnection::Drain()
+{
+    /* new messages for the user are routed elsewhere from now on */
+    draining_ = true;
+    boost::asio::post(socket_.get_executor(), [this, self = Self()]() {
+        if (outq_.empty()) {
+            FinishDrain();
+        }
+    });
+}
+
+void AsyncTcpConnection::Abort()
+{
+    boost::asio::post(socket_.get_executor(), [this, self = Self()]() {
+        boost::system::error_code ec;
+        socket().shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
+    });
+}
+
+void AsyncTcpConnection::FinishDrain() noexcept {
+    ConsoleLogger::Info(boost::str(boost::format("Connection #%1% is drained") % GetId()));
+    boost::system::error_code ec;
+    socket().shutdown(boost::asio::ip::tcp::socket::shutdown_send, ec);
+}
+
 void AsyncTcpConnection::Shutdown() {
     socket_.async_shutdown(
-        [&](const boost::system::error_code& error) {
+        [this, self = Self()](const boost::system::error_code& error) {
             Close(error);
         });
 }
 
 void AsyncTcpConnection::Close(const boost::system::error_code& error) {
-    ConsoleLogger::Info(boost::str(boost::format("Close connection user: %1% \n") % id_));
+    ConsoleLogger::Info(boost::str(boost::format("Close connection user: %1% \n") % GetId()));
     socket_.next_layer().close();
-    ConnectionManager::GetInstance()->RemoveConnection(id_);
-}
\ No newline at end of file
+    ConnectionManager::GetInstance()->RemoveConnection(GetId(), this);
+}
+std::chrono::milliseconds AsyncTcpConnection::NextCheck(int64_t nowMs) const noexcept {
+
+    const auto& config = ConnectionTimers::GetInstance()->GetConfig();
+    int64_t next = INT64_MAX;
+    if (config.writeStallTimeout.count() > 0) {
+        auto started = writeStartedMs_.load();
+        next = std::min<int64_t>(next, started ? started + config.writeStallTimeout.count() - nowMs :
+            config.writeStallTimeout.count());
+    }
+    if (config.idleTimeout.count() > 0) {
+        next = std::min<int64_t>(next, lastReadMs_ + config.idleTimeout.count() - nowMs);
+    }
+    if (config.heartbeatInterval.count() > 0) {
+        next = std::min<int64_t>(next, std::max(lastReadMs_.load(), lastHeartbeatMs_.load()) +
+            config.heartbeatInterval.count() - nowMs);
+    }
+    if (next == INT64_MAX) {
+        return std::chrono::milliseconds(0);
+    }
+    return std::max(std::chrono::milliseconds(next), config.tick);
+}
+
+/* runs on wheel thread under wheel lock, which doesn't own the socket: the check is
+ * handed over to the strand and re-arms the timer from there */
+std::chrono::milliseconds AsyncTcpConnection::OnTimer() noexcept {
+
+    /* no owner means connection is being destroyed, its timer is unlinked right after */
+    auto self = Self();
+    if (!self) {
+        return std::chrono::milliseconds(0);
+    }
+    try {
+        boost::asio::post(socket_.get_executor(), [this, self = std::move(self)]() { CheckDeadlines(); });
+    }
+    catch (std::exception& ex) {
+        ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
+    }
+    return std::chrono::milliseconds(0);
+}
+
+/* strand handler: socket is shut down only, pending operation fails and closes connection as usual */
+void AsyncTcpConnection::CheckDeadlines() noexcept {
+
+    const auto& timers = ConnectionTimers::GetInstance();
+    const auto& config = timers->GetConfig();
+    auto now = NowMs();
+    switch (phase_.load()) {
+        case phase_t::handshake:
+            handshakeTimeouts.Inc();
+            Expire("handshake");
+            return;
+        case phase_t::auth:
+            if (GetId() >= ConnectionManager::FIRST_GUEST_ID) {
+                authTimeouts.Inc();
+                Expire("authentication");
+                return;
+            }
+            phase_ = phase_t::established;
+            break;
+        default:
+            break;
+    }
+
+    auto started = writeStartedMs_.load();
+    if (config.writeStallTimeout.count() > 0 && started && now - started >= config.writeStallTimeout.count()) {
+        stallTimeouts.Inc();
+        Expire("write stall");
+        return;
+    }
+    if (config.idleTimeout.count() > 0 && now - lastReadMs_ >= config.idleTimeout.count()) {
+        idleTimeouts.Inc();
+        Expire("idle");
+        return;
+    }
+    if (config.heartbeatInterval.count() > 0 &&
+        now - std::max(lastReadMs_.load(), lastHeartbeatMs_.load()) >= config.heartbeatInterval.count()) {
+        lastHeartbeatMs_ = now;
+        heartbeats.Inc();
+        StartWriteMessage(HeartbeatMessage());
+    }
+    if (auto next = NextCheck(now); next.count() > 0) {
+        timers->Schedule(timer_, next);
+    }
+}
+
+void AsyncTcpConnection::Expire(const char* reason) noexcept {
+    ConsoleLogger::Info(boost::str(boost::format("Connection #%1% timed out: %2%\n") % GetId() % reason));
+    boost::system::error_code ec;
+    socket().shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
+}
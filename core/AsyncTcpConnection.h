@@ -11,6 +11,9 @@
 #include <utility>
 #include <algorithm>
 #include <cstdint>
+#include <atomic>
+#include <deque>
+#include <vector>
 
 #include <boost/format.hpp>
 #include <boost/asio.hpp> 
@@ -28,6 +31,10 @@
 #include <boost/asio/write.hpp>
 
 #include "../log/Logger.h"
+#include "TimerWheel.h"
+#include "RateLimiter.h"
+#include "BufferPool.h"
+#include "../crypto/SessionToken.h"
 
 class AsyncTcpSession {
     
@@ -39,20 +46,17 @@ public:
 
     using id_t = uint32_t;
     using ssl_socket = boost::asio::ssl::stream<boost::asio::ip::tcp::socket>;
-    using connection_ptr = std::unique_ptr<AsyncTcpConnection>;
-
-    static connection_ptr create(boost::asio::io_service& io_service,
-        boost::asio::ssl::context& context, const id_t& id)
-    {
-        return std::make_unique<AsyncTcpConnection>(io_service, context, id);
-    }
-
 
     ssl_socket::lowest_layer_type& socket();
     void StartAuth();
 
     const id_t GetId() const noexcept {
-        return id_;
+        return id_.load();
+    }
+
+    /* connection changes temporary ID to user ID after authentication */
+    void SetId(const id_t& id) noexcept {
+        id_.store(id);
     }
 
     AsyncTcpConnection() = delete;
@@ -63,38 +67,95 @@ public:
 
     AsyncTcpConnection(boost::asio::io_service& io_service,
         boost::asio::ssl::context& context_, const id_t& id)
-        : socket_(io_service, context_), id_(id)
+        : socket_(boost::asio::make_strand(io_service), context_), id_(id),
+        limits_(RateLimiter::GetInstance()->CreateState()),
+        readPause_(socket_.get_executor()),
+        timer_([this]() { return OnTimer(); })
     {
         ConsoleLogger::Debug(boost::str(boost::format("%1%%2%") % 
-                "Construct AsyncTcpConnection class for user ID = " % id_));
+                "Construct AsyncTcpConnection class for user ID = " % id));
     }
 
     ~AsyncTcpConnection() {
         ConsoleLogger::Debug(boost::str(boost::format("%1%%2%") % 
-                "Destruct AsyncTcpConnection class for user ID = " % id_ ));
+                "Destruct AsyncTcpConnection class for user ID = " % GetId()));
+    }
+
+    /* set once by the owning client before connection is shared, handlers hold the
+     * owner so that connection outlives its pending operations and posted work */
+    void SetOwner(std::weak_ptr<void> owner) noexcept {
+        owner_ = std::move(owner);
     }
 
     void StartWriteMessage(const std::string& msg);
 
+    /* sending side is shut down once queued messages are written, client
+     * resumes its session elsewhere and the pending read closes connection */
+    void Drain();
+    bool IsDraining() const noexcept { return draining_; }
+    /* socket is shut down both ways, pending operation fails and closes connection */
+    void Abort();
+
 private:
 
     void Close(const boost::system::error_code& error);
     void Shutdown();
     void HandleHandshake(const boost::system::error_code& error);
-    void HandleAuth(const boost::system::error_code& error,  std::size_t recvBytes);
+    void HandleAuth(const boost::system::error_code& error, const char* data, std::size_t recvBytes);
+    void ResumeSession(std::string&& auth_message, std::size_t recvBytes);
+    bool BindSession(const SessionToken::claims_t& claims);
     void StartRead();
-    void HandleRead(const boost::system::error_code& error, std::size_t recvBytes);
+    void HandleRead(const boost::system::error_code& error, const char* data, std::size_t recvBytes);
+
+    /* frame is valid during the handler only, its buffer goes back to pool afterwards */
+    using frame_handler_t = void (AsyncTcpConnection::*)(const boost::system::error_code&, const char*, std::size_t);
+    void ReadFrame(frame_handler_t handler);
+    bool IsOversize(std::size_t recvBytes);
+    void ContinueRead(std::size_t recvBytes);
+    void WriteNextMessage();
+    void FinishDrain() noexcept;
+
+    /* one wheel timer per connection serves every deadline of current phase */
+    std::chrono::milliseconds OnTimer() noexcept;
+    void CheckDeadlines() noexcept;
+    std::chrono::milliseconds NextCheck(int64_t nowMs) const noexcept;
+    void Expire(const char* reason) noexcept;
+    static int64_t NowMs() noexcept;
+
+    std::shared_ptr<void> Self() const noexcept {
+        return owner_.lock();
+    }
         
     void to_lower(std::string&& str) {
         std::transform(str.begin(), str.end(), str.begin(), ::tolower);
     }
 
-    const std::string hello_msg{ "hello user id=" };
-    const std::string hello_msg_header{ "hello server" };
+    std::weak_ptr<void> owner_;
 
+    /* socket is bound to a strand, so all its completion handlers are serialized */
     ssl_socket socket_;
-    id_t id_;
-
-    enum { max_length = 1024 };
-    std::array<char, max_length> buf = { { 0 } };
+    std::atomic<id_t> id_;
+    std::deque<std::string> outq_;
+
+    /* idle connection waits for a record in it, see BufferPool */
+    char first_ = 0;
+
+    /* touched by strand handlers only */
+    RateLimiter::state_t limits_;
+    boost::asio::steady_timer readPause_;
+
+    enum class phase_t : uint8_t {
+        handshake,
+        auth,           // guest connection must be bound to user by deadline
+        established,
+    };
+
+    std::atomic<phase_t> phase_{ phase_t::handshake };
+    std::atomic<int64_t> lastReadMs_{ 0 };
+    std::atomic<int64_t> lastHeartbeatMs_{ 0 };
+    std::atomic<int64_t> writeStartedMs_{ 0 };     // 0 when nothing is being written
+    std::atomic_bool draining_{ false };
+
+    /* the last member, unlinked from wheel before anything else is destroyed */
+    TimerWheel::timer_t timer_;
 };
@@ -13,6 +13,8 @@
 #include <algorithm>
 #include <cstdint>
 #include <thread>
+#include <csignal>
+#include <optional>
 
 #include <boost/format.hpp>
 #include <boost/asio.hpp> 
@@ -24,13 +26,37 @@
 #include "AsyncTcpServer.h"
 #include "ConnectionManager.h"
 #include "AsyncClient.h"
+#include "ConnectionTimers.h"
+#include "RateLimiter.h"
+#include "TaskScheduler.h"
+#include "HotUpgrade.h"
+#include "Readiness.h"
 
 #include "../log/Logger.h"
+#include "../capture/TrafficCapture.h"
+#include "../log/Metrics.h"
+#include "../crypto/SessionToken.h"
+#include "../data/OfflineMailbox.h"
+#include "../data/MessageWal.h"
+#include "../data/DataProcess.h"
+#include "../data/AdmissionControl.h"
+#include "../db/KafkaProcess.h"
+#include "../cluster/ClusterRouter.h"
+
+std::atomic<AsyncTcpServer*> AsyncTcpServer::server_ = nullptr;
+std::chrono::seconds AsyncTcpServer::shutdownTimeout_{ 5 };
 
 void AsyncTcpServer::HandleAccept(AsyncClient::client_ptr& client,
     const boost::system::error_code& error)
 {
-    if (!error) {
+    if (!error && !AdmissionControl::GetInstance()->AdmitConnection()) {
+        /* refused before TLS handshake, the cheapest point to turn client away */
+        ConsoleLogger::Info("Dispatcher is overloaded, new connection refused.\n");
+        boost::system::error_code ec;
+        client->socket().close(ec);
+        StartAccept();
+    }
+    else if (!error) {
         ConsoleLogger::Info("New connection accepted. Start reading data.\n");
         ConnectionManager::GetInstance()->AddConnection(std::ref(client));
         client->HandleAccept();
@@ -52,23 +78,68 @@ void AsyncTcpServer::StartAccept() {
             std::placeholders::_1));
 }
 
-AsyncTcpServer::AsyncTcpServer(boost::asio::io_service&& io_service, uint16_t port) :
-    io_service(std::ref(io_service)),
-    acceptor_(io_service, boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), port)),
-    context_(boost::asio::ssl::context::tlsv13)
-{
-    ConsoleLogger::Debug("Construct AsyncTcpServer class");
+void AsyncTcpServer::StopAccept() {
+    boost::asio::post(acceptor_.get_executor(), [this]() {
+        boost::system::error_code ec;
+        acceptor_.close(ec);
+    });
+}
 
-    ConsoleLogger::Info(boost::str(boost::format("Start listening to %1% port") % port));
+boost::asio::ssl::context AsyncTcpServer::CreateTlsContext() {
 
-    context_.set_options(boost::asio::ssl::context::default_workarounds |
+    boost::asio::ssl::context context(boost::asio::ssl::context::tlsv13);
+    context.set_options(boost::asio::ssl::context::default_workarounds |
         boost::asio::ssl::context::no_sslv2|
         boost::asio::ssl::context::no_sslv3);
+    /* OpenSSL frees record buffers of idle connections */
+    SSL_CTX_set_mode(context.native_handle(), SSL_MODE_RELEASE_BUFFERS);
 
-    context_.use_certificate_chain_file("user.crt");
-    context_.use_private_key_file("user.key", boost::asio::ssl::context::pem);
+    context.use_certificate_chain_file("user.crt");
+    context.use_private_key_file("user.key", boost::asio::ssl::context::pem);
+    return context;
+}
 
+AsyncTcpServer::AsyncTcpServer(boost::asio::io_service&& io_service, uint16_t port,
+    boost::asio::ssl::context&& context, int listener) :
+    io_service(std::ref(io_service)),
+    /* strand serializes accept handler with closing acceptor at upgrade */
+    acceptor_(boost::asio::make_strand(io_service)),
+    context_(std::move(context))
+{
+    ConsoleLogger::Debug("Construct AsyncTcpServer class");
+
+    if (listener >= 0) {
+        acceptor_.assign(boost::asio::ip::tcp::v4(), listener);
+        ConsoleLogger::Info(boost::str(boost::format("Continue listening to %1% port") % port));
+    }
+    else {
+        boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::tcp::v4(), port);
+        acceptor_.open(endpoint.protocol());
+        acceptor_.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+        acceptor_.bind(endpoint);
+        acceptor_.listen();
+        ConsoleLogger::Info(boost::str(boost::format("Start listening to %1% port") % port));
+    }
+
+    HotUpgrade::handlers_t upgrade;
+    upgrade.release = [this]() {
+        StopAccept();
+        /* successor opens them as soon as it is acknowledged; meanwhile messages
+         * here are delivered without WAL and the rest is forwarded to successor */
+        ClusterRouter::GetInstance()->Close();
+        MessageWal::GetInstance()->Close();
+        OfflineMailbox::GetInstance()->Close();
+        TrafficCapture::GetInstance()->Close();
+    };
+    /* the same shutdown as on SIGTERM, it doesn't run on io thread */
+    upgrade.exit = []() {
+        std::raise(SIGTERM);
+    };
+    HotUpgrade::GetInstance()->Listen(io_service, acceptor_.native_handle(), std::move(upgrade));
+
+    server_ = this;
     StartAccept();
+    Readiness::GetInstance()->SetState(Readiness::state_t::ready);
     io_service.run();
 }
 
@@ -80,9 +151,227 @@ void AsyncTcpServer::StartTcpServer(boost::asio::io_service &ios) {
         scfg->Open("server.ini");
         auto sport = scfg->GetConfigValueByKey("port");
         uint16_t port = std::atoi(sport.c_str());
+
+        /* new build takes listening socket over from running process, the first thing
+         * it does, since running process releases stores opened below on handover */
+        HotUpgrade::config_t upgrade;
+        upgrade.socketPath = scfg->GetConfigValueByKey("upgrade_socket");
+        if (auto v = scfg->GetConfigValueByKey("upgrade_drain_sec"); !v.empty()) {
+            upgrade.drainWindow = std::chrono::seconds(std::stoul(v));
+        }
+        HotUpgrade::GetInstance()->Configure(upgrade);
+        int listener = HotUpgrade::GetInstance()->TakeOver([](uint32_t user, std::string&& msg) {
+            MessageBroker::GetInstance()->PushMessage(user, std::move(msg));
+        });
+
+        /* components which don't depend on each other start concurrently before acceptor opens */
+        Readiness::tasks_t backends;
+        std::optional<boost::asio::ssl::context> tls;
+        backends.emplace_back("tls", [&tls]() { tls.emplace(CreateTlsContext()); });
+
+        /* optional recording of inbound traffic for later replay */
+        auto capture = scfg->GetConfigValueByKey("capture_file");
+        if (!capture.empty()) {
+            backends.emplace_back("capture", [capture]() { TrafficCapture::GetInstance()->Open(capture); });
+        }
+
+        /* shared hex key lets tokens survive restarts and work on every node */
+        auto sessionTtl = scfg->GetConfigValueByKey("session_ttl");
+        SessionToken::GetInstance()->Configure(scfg->GetConfigValueByKey("session_key"),
+            std::chrono::seconds(std::atoi(sessionTtl.c_str())));
+
+        /* messages for offline users are kept on disk until they reconnect */
+        auto mailboxDir = scfg->GetConfigValueByKey("mailbox_dir");
+        if (!mailboxDir.empty()) {
+            OfflineMailbox::config_t mailbox;
+            mailbox.directory = mailboxDir;
+            if (auto v = scfg->GetConfigValueByKey("mailbox_segment_mb"); !v.empty()) {
+                mailbox.segmentSize = std::stoull(v) * 1024 * 1024;
+            }
+            if (auto v = scfg->GetConfigValueByKey("mailbox_max_disk_mb"); !v.empty()) {
+                mailbox.maxDiskSize = std::stoull(v) * 1024 * 1024;
+            }
+            if (auto v = scfg->GetConfigValueByKey("mailbox_retention_hours"); !v.empty()) {
+                mailbox.retention = std::chrono::hours(std::stoul(v));
+            }
+            backends.emplace_back("mailbox", [mailbox]() { OfflineMailbox::GetInstance()->Open(mailbox); });
+        }
+
+        /* delivered messages and presence changes are exported for other services */
+        auto kafkaBrokers = scfg->GetConfigValueByKey("kafka_brokers");
+        if (!kafkaBrokers.empty()) {
+            KafkaProcess::config_t kafka;
+            kafka.brokers = kafkaBrokers;
+            if (auto v = scfg->GetConfigValueByKey("kafka_messages_topic"); !v.empty()) {
+                kafka.messagesTopic = v;
+            }
+            if (auto v = scfg->GetConfigValueByKey("kafka_presence_topic"); !v.empty()) {
+                kafka.presenceTopic = v;
+            }
+            if (auto v = scfg->GetConfigValueByKey("kafka_partitions"); !v.empty()) {
+                kafka.partitions = std::stoul(v);
+            }
+            if (auto v = scfg->GetConfigValueByKey("kafka_batch_size"); !v.empty()) {
+                kafka.batchSize = std::stoul(v);
+            }
+            if (auto v = scfg->GetConfigValueByKey("kafka_linger_ms"); !v.empty()) {
+                kafka.linger = std::chrono::milliseconds(std::stoul(v));
+            }
+            if (auto v = scfg->GetConfigValueByKey("kafka_compression"); !v.empty()) {
+                kafka.compression = v;
+            }
+            if (auto v = scfg->GetConfigValueByKey("kafka_buffer_mb"); !v.empty()) {
+                kafka.maxBufferBytes = std::stoull(v) * 1024 * 1024;
+            }
+            backends.emplace_back("kafka", [kafka]() {
+                /* chat works without export when broker client can't be created */
+                try {
+                    KafkaProcess::GetInstance()->Open(kafka);
+                }
+                catch (std::exception& ex) {
+                    ConsoleLogger::Error(boost::str(boost::format("Kafka export is disabled: %1%") % ex.what()));
+                }
+            });
+        }
+
+        /* users of one cluster may be connected to different nodes, offline ones are stored to mailbox */
+        Readiness::tasks_t routing;
+        auto clusterNodes = scfg->GetConfigValueByKey("cluster_nodes");
+        if (!clusterNodes.empty()) {
+            ClusterRouter::config_t cluster;
+            cluster.nodeId = std::stoul(scfg->GetConfigValueByKey("cluster_node_id"));
+            cluster.nodes = ClusterRouter::ParseNodes(clusterNodes);
+            if (auto v = scfg->GetConfigValueByKey("cluster_virtual_nodes"); !v.empty()) {
+                cluster.virtualNodes = std::stoul(v);
+            }
+            if (auto v = scfg->GetConfigValueByKey("cluster_location_ttl_ms"); !v.empty()) {
+                cluster.locationTtl = std::chrono::milliseconds(std::stoul(v));
+            }
+            ClusterRouter::handlers_t handlers;
+            handlers.deliver = [](uint32_t user, const std::string& msg) {
+                return ConnectionManager::GetInstance()->DeliverLocal(user, msg);
+            };
+            handlers.store = [](uint32_t user, const std::string& msg) {
+                if (!OfflineMailbox::GetInstance()->Append(user, msg)) {
+                    ConsoleLogger::Error(boost::str(boost::format("Message for offline user #%1% is dropped") % user));
+                }
+            };
+            handlers.drain = [](uint32_t user, const std::function<void(std::string&& msg)>& forward) {
+                /* router stores again message which doesn't reach hosting node */
+                for (auto& [seq, msg] : OfflineMailbox::GetInstance()->Take(user)) {
+                    forward(std::move(msg));
+                    OfflineMailbox::GetInstance()->Complete(user, seq);
+                }
+            };
+            handlers.evict = [](uint32_t user, uint64_t epoch) {
+                ConnectionManager::GetInstance()->DisconnectUser(user, epoch);
+            };
+            routing.emplace_back("cluster", [cluster, handlers]() mutable {
+                ClusterRouter::GetInstance()->Open(cluster, std::move(handlers));
+            });
+        }
+
+        /* dispatcher, delivery and CPU work handed off by io threads share scheduler threads, 0 is one per core */
+        if (auto v = scfg->GetConfigValueByKey("dispatch_threads"); !v.empty()) {
+            TaskScheduler::SetThreads(std::stoul(v));
+        }
+
+        /* dispatcher sheds low priority requests and acceptor refuses clients on standing queue delay */
+        AdmissionControl::config_t admission;
+        if (auto v = scfg->GetConfigValueByKey("dispatch_target_delay_ms"); !v.empty()) {
+            admission.target = std::chrono::milliseconds(std::stoul(v));
+        }
+        if (auto v = scfg->GetConfigValueByKey("dispatch_delay_interval_ms"); !v.empty()) {
+            admission.interval = std::chrono::milliseconds(std::stoul(v));
+        }
+        if (auto v = scfg->GetConfigValueByKey("dispatch_reject_after_ms"); !v.empty()) {
+            admission.rejectAfter = std::chrono::milliseconds(std::stoul(v));
+        }
+        if (auto v = scfg->GetConfigValueByKey("dispatch_max_queue"); !v.empty()) {
+            admission.maxQueue = std::stoul(v);
+        }
+        AdmissionControl::GetInstance()->Configure(admission);
+
+        /* storage backends and their pools, the first clients don't wait for them */
+        backends.emplace_back("dispatcher", []() { DataProcess::GetInstance(); });
+        Readiness::GetInstance()->RunStage(std::move(backends));
+        Readiness::GetInstance()->RunStage(std::move(routing));
+
+        /* accepted messages survive restart until handed over, replay needs delivery paths above */
+        auto walDir = scfg->GetConfigValueByKey("wal_dir");
+        if (!walDir.empty()) {
+            MessageWal::config_t wal;
+            wal.directory = walDir;
+            if (auto v = scfg->GetConfigValueByKey("wal_segment_mb"); !v.empty()) {
+                wal.segmentSize = std::stoull(v) * 1024 * 1024;
+            }
+            if (auto v = scfg->GetConfigValueByKey("wal_sync_interval_ms"); !v.empty()) {
+                wal.syncInterval = std::chrono::milliseconds(std::stoul(v));
+            }
+            Readiness::GetInstance()->RunStage({ { "wal", [&wal]() {
+                MessageWal::GetInstance()->Open(wal, [](uint64_t seq, uint32_t dst, std::string&& msg) {
+                    MessageBroker::GetInstance()->PushMessage(dst, std::move(msg), message_lane_t::interactive, seq);
+                });
+            } } });
+        }
+
+        /* deadlines of every connection are served by one timer wheel per io thread */
+        ConnectionTimers::config_t timers;
+        if (auto v = scfg->GetConfigValueByKey("timer_tick_ms"); !v.empty()) {
+            timers.tick = std::chrono::milliseconds(std::stoul(v));
+        }
+        if (auto v = scfg->GetConfigValueByKey("handshake_timeout_sec"); !v.empty()) {
+            timers.handshakeTimeout = std::chrono::seconds(std::stoul(v));
+        }
+        if (auto v = scfg->GetConfigValueByKey("auth_timeout_sec"); !v.empty()) {
+            timers.authTimeout = std::chrono::seconds(std::stoul(v));
+        }
+        if (auto v = scfg->GetConfigValueByKey("idle_timeout_sec"); !v.empty()) {
+            timers.idleTimeout = std::chrono::seconds(std::stoul(v));
+        }
+        if (auto v = scfg->GetConfigValueByKey("heartbeat_interval_sec"); !v.empty()) {
+            timers.heartbeatInterval = std::chrono::seconds(std::stoul(v));
+        }
+        if (auto v = scfg->GetConfigValueByKey("write_stall_timeout_sec"); !v.empty()) {
+            timers.writeStallTimeout = std::chrono::seconds(std::stoul(v));
+        }
+        ConnectionTimers::GetInstance()->Start(ios, std::max(std::thread::hardware_concurrency(), 1u), timers);
+
+        /* abusive senders are throttled at the socket, limits are off unless configured */
+        RateLimiter::config_t limits;
+        if (auto v = scfg->GetConfigValueByKey("max_frame_size"); !v.empty()) {
+            limits.maxFrameSize = std::stoul(v);
+        }
+        if (auto v = scfg->GetConfigValueByKey("conn_messages_per_sec"); !v.empty()) {
+            limits.connMessagesPerSec = std::stod(v);
+        }
+        if (auto v = scfg->GetConfigValueByKey("conn_bytes_per_sec"); !v.empty()) {
+            limits.connBytesPerSec = std::stod(v);
+        }
+        if (auto v = scfg->GetConfigValueByKey("user_messages_per_sec"); !v.empty()) {
+            limits.userMessagesPerSec = std::stod(v);
+        }
+        if (auto v = scfg->GetConfigValueByKey("user_bytes_per_sec"); !v.empty()) {
+            limits.userBytesPerSec = std::stod(v);
+        }
+        if (auto v = scfg->GetConfigValueByKey("rate_burst_sec"); !v.empty()) {
+            limits.burstSec = std::stod(v);
+        }
+        RateLimiter::GetInstance()->Configure(limits);
+
+        /* shutdown flushes queued messages and lets clients go within this time, then closes the rest */
+        if (auto v = scfg->GetConfigValueByKey("shutdown_timeout_sec"); !v.empty()) {
+            shutdownTimeout_ = std::chrono::seconds(std::stoul(v));
+        }
+
+        /* periodic dump of counters and latency histograms, seconds */
+        auto metricsPeriod = scfg->GetConfigValueByKey("metrics_period");
+        if (!metricsPeriod.empty()) {
+            Metrics::GetInstance()->StartReporter(std::atoi(metricsPeriod.c_str()));
+        }
         ConsoleLogger::Info("Start TCP server...");
         
-        std::make_unique<AsyncTcpServer>(std::move(ios), port);
+        std::make_unique<AsyncTcpServer>(std::move(ios), port, std::move(*tls), listener);
     }
     catch (std::exception& ex) {
         ConsoleLogger::Error(boost::str(boost::format("StartTcpServer exception: %1%\n") % ex.what()));
@@ -90,6 +379,33 @@ void AsyncTcpServer::StartTcpServer(boost::asio::io_service &ios) {
 }
 
 void AsyncTcpServer::StopTcpServer(boost::asio::io_service& ios) {
+
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + shutdownTimeout_;
+    Readiness::GetInstance()->SetState(Readiness::state_t::stopping);
+
+    /* no new clients, then what is queued for the connected ones reaches their sockets */
+    if (auto server = server_.load()) {
+        server->StopAccept();
+    }
     ConnectionManager::GetInstance()->DeactivateManager();
-    ConnectionManager::GetInstance()->CloseAllConnections();
+    if (!DataProcess::GetInstance()->FlushDataProcessor(deadline)) {
+        ConsoleLogger::Error("Dispatcher is not flushed in time");
+    }
+    auto left = ConnectionManager::GetInstance()->DrainAllConnections(deadline);
+
+    /* nothing produces work any more, workers are joined */
+    ConnectionTimers::GetInstance()->Stop();
+    DataProcess::GetInstance()->StopDataProcessor();
+    TaskScheduler::GetInstance()->Stop();
+    HotUpgrade::GetInstance()->Close();
+    ClusterRouter::GetInstance()->Close();
+    MessageWal::GetInstance()->Close();
+    TrafficCapture::GetInstance()->Close();
+    OfflineMailbox::GetInstance()->Close();
+    KafkaProcess::GetInstance()->Close();
+    Metrics::GetInstance()->StopReporter();
+
+    ConsoleLogger::Info(boost::str(boost::format("Server stopped in %1% ms, %2% connections aborted") %
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() % left));
 }
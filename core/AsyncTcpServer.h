@@ -16,6 +16,8 @@
 #include <utility>
 #include <algorithm>
 #include <cstdint>
+#include <atomic>
+#include <chrono>
 
 /* boost C++ lib headers */
 #include <boost/format.hpp>
@@ -38,9 +40,14 @@ private:
     boost::asio::ip::tcp::acceptor acceptor_;
     boost::asio::ssl::context context_;
 
+    /* server running now, StopTcpServer closes its acceptor first */
+    static std::atomic<AsyncTcpServer*> server_;
+    static std::chrono::seconds shutdownTimeout_;
+
     void HandleAccept(AsyncClient::client_ptr& client,
         const boost::system::error_code& error);
     void StartAccept();
+    void StopAccept();
 
 public:
 
@@ -49,10 +56,19 @@ public:
     AsyncTcpServer(const AsyncTcpServer&&) = delete;
     AsyncTcpServer& operator=(const AsyncTcpServer&) = delete;
     AsyncTcpServer&& operator=(const AsyncTcpServer&&) = delete;
-    AsyncTcpServer(boost::asio::io_service&& io_service, uint16_t port);
+    /* listener is socket taken over from previous process, -1 binds the port */
+    AsyncTcpServer(boost::asio::io_service&& io_service, uint16_t port,
+        boost::asio::ssl::context&& context, int listener = -1);
+
+    /* loads server certificate and key */
+    static boost::asio::ssl::context CreateTlsContext();
 
-    ~AsyncTcpServer() { std::cout << "Destruct AsyncTcpServer class\n"; }
+    ~AsyncTcpServer() {
+        server_ = nullptr;
+        std::cout << "Destruct AsyncTcpServer class\n";
+    }
 
     static void StartTcpServer(boost::asio::io_service& ios);
+    /* waits for io threads to flush connections, must not be called from one of them */
     static void StopTcpServer(boost::asio::io_service& ios);
 };
\ No newline at end of file
@@ -0,0 +1,61 @@
+/*****************************************************************
+ *  @file       BufferPool.cpp
+ *  @brief      Read buffers shared by connections implementation
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+
+#include "BufferPool.h"
+
+#include "../log/Logger.h"
+#include "../log/Metrics.h"
+
+namespace {
+    /* stays flat once pool covers frames in flight */
+    Metrics::Counter& buffersAllocated = Metrics::GetInstance()->GetCounter("read_buffers_allocated_total");
+    Metrics::Gauge& buffersCached = Metrics::GetInstance()->GetGauge("read_buffers_cached");
+}
+
+std::shared_ptr<BufferPool> BufferPool::bp_ = nullptr;
+
+BufferPool::BufferPool() {
+    /* returning buffer doesn't allocate */
+    free_.reserve(max_cached);
+    ConsoleLogger::Debug("Construct BufferPool class");
+}
+
+BufferPool::~BufferPool() {
+    ConsoleLogger::Debug("Destruct BufferPool class");
+}
+
+BufferPool::lease_t BufferPool::Acquire(std::size_t size) {
+
+    buffer_t buffer;
+    {
+        std::unique_lock lk(mutex_);
+        if (!free_.empty()) {
+            buffer = std::move(free_.back());
+            free_.pop_back();
+            buffersCached.Set(free_.size());
+        }
+    }
+    if (buffer.capacity() == 0) {
+        buffersAllocated.Inc();
+    }
+    buffer.resize(size);
+    return lease_t(*this, std::move(buffer));
+}
+
+void BufferPool::Release(buffer_t&& buffer) noexcept {
+    std::unique_lock lk(mutex_);
+    if (free_.size() < max_cached) {
+        free_.push_back(std::move(buffer));
+        buffersCached.Set(free_.size());
+    }
+}
+
+std::size_t BufferPool::GetCached() const {
+    std::unique_lock lk(mutex_);
+    return free_.size();
+}
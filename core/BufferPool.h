@@ -0,0 +1,80 @@
+/*****************************************************************
+ *  @file       BufferPool.h
+ *  @brief      Read buffers shared by connections, lent only
+ *              while a frame is being read
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+#pragma once
+
+/* std C++ lib headers */
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <cstddef>
+
+/* Mostly idle clients don't need a read buffer of their own: connection waits
+ * for the first byte of a TLS record in one byte it owns, the rest of the
+ * record is already decrypted and is read into a buffer borrowed here, the
+ * frame is copied out and buffer goes back. Memory of read buffers follows
+ * frames in flight rather than connected clients. */
+class BufferPool {
+
+public:
+
+    using buffer_t = std::vector<char>;
+
+    /* buffers above it are freed on return */
+    static constexpr std::size_t max_cached = 1024;
+
+    /* borrowed buffer, returned to pool on destruction */
+    class lease_t {
+    public:
+        lease_t(BufferPool& pool, buffer_t&& buffer) noexcept : pool_(&pool), buffer_(std::move(buffer)) {}
+        lease_t(lease_t&& other) noexcept : pool_(other.pool_), buffer_(std::move(other.buffer_)) {
+            other.pool_ = nullptr;
+        }
+        lease_t(const lease_t&) = delete;
+        lease_t& operator=(const lease_t&) = delete;
+        lease_t& operator=(lease_t&&) = delete;
+        ~lease_t() {
+            if (pool_) {
+                pool_->Release(std::move(buffer_));
+            }
+        }
+
+        char* data() noexcept { return buffer_.data(); }
+        std::size_t size() const noexcept { return buffer_.size(); }
+
+    private:
+        BufferPool* pool_;
+        buffer_t buffer_;
+    };
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    BufferPool();
+    ~BufferPool();
+
+    static const std::shared_ptr<BufferPool>& GetInstance() {
+        static std::once_flag once;
+        std::call_once(once, []() { bp_ = std::make_shared<BufferPool>(); });
+        return bp_;
+    }
+
+    /* buffer of exactly the size, frame limit may change between configurations */
+    lease_t Acquire(std::size_t size);
+
+    std::size_t GetCached() const;
+
+private:
+
+    mutable std::mutex mutex_;
+    std::vector<buffer_t> free_;
+
+    static std::shared_ptr<BufferPool> bp_;
+
+    void Release(buffer_t&& buffer) noexcept;
+};
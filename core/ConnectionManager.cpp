@@ -0,0 +1,48 @@
+/*********************************************
+ *
+ *
+ */
+
+ /* std C++ lib headers */
+#include <thread>
+
+ /* local C++ headers */
+#include "ConnectionManager.h"
+#include "../data/MessageBroker.h"
+
+std::size_t ConnectionManager::DrainAllConnections(std::chrono::steady_clock::time_point deadline) {
+
+    auto wait = [this](std::chrono::steady_clock::time_point until) {
+        while (GetConnectionsAmount() > 0 && std::chrono::steady_clock::now() < until) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    };
+
+    for (auto& client : GetClients()) {
+        client->Drain();
+    }
+    wait(deadline);
+
+    auto left = GetConnectionsAmount();
+    if (left > 0) {
+        ConsoleLogger::Info(boost::str(boost::format("%1% connections are not drained in time, abort them") % left));
+        for (auto& client : GetClients()) {
+            client->Abort();
+        }
+        wait(std::chrono::steady_clock::now() + abort_timeout);
+        CloseAllConnections();
+    }
+    return left;
+}
+
+void ConnectionManager::DeliverOfflineMessages(const T& userId) const {
+    try {
+        /* the same lane as auth response, so they follow it; each is acknowledged on hand-over */
+        for (auto& [seq, msg] : OfflineMailbox::GetInstance()->Take(userId)) {
+            MessageBroker::GetInstance()->PushMessage(userId, std::move(msg), message_lane_t::control, 0, seq);
+        }
+    }
+    catch (std::exception& ex) {
+        ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%") % __FUNCTION__ % ex.what()));
+    }
+}
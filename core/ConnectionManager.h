@@ -11,6 +11,8 @@
 #include <limits>
 #include <queue>
 #include <set>
+#include <chrono>
+#include <vector>
 
 #include <boost/bind/placeholders.hpp>
 #include <boost/thread.hpp>
@@ -19,10 +21,14 @@
 
 #include "AsyncTcpConnection.h"
 #include "AsyncClient.h"
+#include "HotUpgrade.h"
 
 #include "../log/Logger.h"
 #include "../data/MessageBroker.h"
 #include "../data/UsersPool.h"
+#include "../data/OfflineMailbox.h"
+#include "../db/KafkaProcess.h"
+#include "../cluster/ClusterRouter.h"
 
 #define DATA_PROCESS
 
@@ -69,7 +75,6 @@ private:
 
     mutable std::shared_mutex mutex_;
 
-    const T INVALID_ID = 0;
     const uint32_t RESERVED_USERS_POOL_SIZE = 100;
 
     const T GetFreeId() noexcept {
@@ -97,13 +102,18 @@ private:
 
 public:
 
+    static constexpr T INVALID_ID = 0;
+    /* IDs below are user IDs from users table, unauthenticated
+     * connections get temporary IDs from upper half of range */
+    static constexpr T FIRST_GUEST_ID = 0x80000000;
+
     // to avoid copying and creating any one instance
     ConnectionManager(const ConnectionManager& mb) = delete;
     ConnectionManager& operator=(const ConnectionManager& md) = delete;
 
     ConnectionManager() {
         ConsoleLogger::Debug("Construct connection manager");
-        randEngine = std::make_unique<CustomRandomGen>(1, UsersPool::BROADCAST_ID-1);
+        randEngine = std::make_unique<CustomRandomGen>(FIRST_GUEST_ID, UsersPool::BROADCAST_ID-1);
         users = std::make_unique<UsersPool>(RESERVED_USERS_POOL_SIZE);
     }
 
@@ -112,9 +122,8 @@ public:
     }
 
     static const std::shared_ptr<ConnectionManager>& GetInstance() {
-        if(!cm_) {
-            cm_ = std::make_shared<ConnectionManager>();
-        }
+        static std::once_flag once;
+        std::call_once(once, []() { cm_ = std::make_shared<ConnectionManager>(); });
         return cm_;
     }
 
@@ -130,7 +139,7 @@ public:
     {
         std::unique_lock lk(mutex_);
         T freeId = GetFreeId();
-        auto pnewClient = std::make_shared<AsyncClient>(io_service, context, freeId);
+        auto pnewClient = AsyncClient::Create(io_service, context, freeId);
         return pnewClient;
     }
 
@@ -138,41 +147,155 @@ public:
         users->StoreNewClient(pnewClient->GetClientId(), pnewClient);
     }
 
-    void RemoveConnection(const T& connId)
+    void RemoveConnection(const T& connId, const AsyncTcpConnection* conn)
     {
         try {
-            vacatedIds_.push(connId);
-            users->RemoveExistedClient(connId);
+            auto client = FindClient(connId, conn);
+            /* connection may be already replaced by newer session of the same user */
+            if (!users->RemoveExistedClient(connId, conn)) {
+                return;
+            }
+            if (connId >= FIRST_GUEST_ID) {
+                std::unique_lock lk(mutex_);
+                vacatedIds_.push(connId);
+            }
+            else {
+                KafkaProcess::GetInstance()->PublishPresence(connId, false);
+                ClusterRouter::GetInstance()->Unregister(connId, client ? client->GetEpoch() : 0);
+            }
         }
         catch (std::exception& ex) {
             ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%") % __FUNCTION__ % ex.what()));
         }
     }
 
+    /* move authenticated connection from temporary ID to user ID,
+     * previous session of the same user is closed */
+    T BindUser(const T& connId, const T& userId)
+    {
+        try {
+            if (userId == INVALID_ID || userId >= FIRST_GUEST_ID) {
+                return INVALID_ID;
+            }
+            auto client = users->GetClient(connId);
+            if (!client) {
+                return INVALID_ID;
+            }
+            if (connId == userId) {
+                return userId;
+            }
+            /* previous session is aborted on its own strand, its pending read closes it
+             * later and finds itself replaced in the pool */
+            if (auto previous = users->GetClient(userId)) {
+                ConsoleLogger::Info(boost::str(boost::format("User #%1% reconnected, close previous session") % userId));
+                previous->Abort();
+            }
+            RemoveConnection(connId, client->GetConnection());
+            client->SetClientId(userId);
+            /* epoch is set before the client is visible, evict of older session can't close it */
+            auto epoch = ClusterRouter::GetInstance()->NewEpoch();
+            client->SetEpoch(epoch);
+            users->ReplaceClient(userId, client);
+            KafkaProcess::GetInstance()->PublishPresence(userId, true);
+            ClusterRouter::GetInstance()->Register(userId, epoch);
+            return userId;
+        }
+        catch (std::exception& ex) {
+            ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%") % __FUNCTION__ % ex.what()));
+        }
+        return INVALID_ID;
+    }
+
     bool Contains(const T& connId) const noexcept
     {
         return users->IsThereSuchClient(connId);
     }
 
+    /* client which still owns the connection, holding it keeps connection alive */
+    AsyncClient::client_ptr FindClient(const T& connId, const AsyncTcpConnection* conn) const
+    {
+        auto client = users->GetClient(connId);
+        return client && client->GetConnection() == conn ? client : nullptr;
+    }
+
+    /* delivery of message routed from other cluster node */
+    bool DeliverLocal(const T& connId, const std::string& user_msg) const
+    {
+        auto client = users->GetClient(connId);
+        if (!client) {
+            return false;
+        }
+        client->ResendMessage(user_msg);
+        return true;
+    }
+
+    /* user connected to other cluster node, local session not newer than epoch
+     * is aborted on its own strand, its pending read closes and removes it */
+    void DisconnectUser(const T& connId, uint64_t epoch)
+    {
+        if (auto client = users->GetClient(connId); client && client->GetEpoch() <= epoch) {
+            ConsoleLogger::Info(boost::str(boost::format("User #%1% connected to other node, close session") % connId));
+            client->Abort();
+        }
+    }
+
+    /* snapshot, holding clients keeps their connections alive */
+    std::vector<AsyncClient::client_ptr> GetClients() const
+    {
+        return users->GetClients();
+    }
+
+    std::size_t GetConnectionsAmount() const noexcept
+    {
+        return users->GetUsersAmount();
+    }
+
     void CloseAllConnections()
     {
         users->DisconnectAllClients();
         ConsoleLogger::Debug("All connections are closed");
     }
 
+    /* connections left when shutdown deadline passes are aborted, then closed if still there */
+    static constexpr std::chrono::milliseconds abort_timeout{ 500 };
+
+    /* shutdown: every connection flushes its queue and closes on its own strand,
+     * so io threads close them in parallel; returns connections left at deadline */
+    std::size_t DrainAllConnections(std::chrono::steady_clock::time_point deadline);
+
     void SendUsersListToUser(const T& id) 
     {
         users->SendUsersListToUser(id);
     }
 
+    /* queue messages stored while user was offline, must be called after auth response is queued */
+    void DeliverOfflineMessages(const T& userId) const;
+
 protected:
 
     void ResendUserMessage(const T& connId, const std::string& user_msg) const {
         try {
-            if (Contains(connId)) {
-                users->GetClient(connId)->ResendMessage(user_msg);
+            auto client = Contains(connId) ? users->GetClient(connId) : nullptr;
+            if ((!client || client->IsDraining()) && connId < FIRST_GUEST_ID &&
+                HotUpgrade::GetInstance()->Forward(connId, user_msg)) {
+                /* process is being replaced, user is or will be served by successor */
+                ConsoleLogger::Debug(boost::str(boost::format("%1%%2%%3%") % "Message for user #" % connId % " forwarded"));
+            }
+            else if (client) {
+                client->ResendMessage(user_msg);
                 ConsoleLogger::Debug(boost::str(boost::format("%1%%2%%3%") % "Message for user #" % connId % " sended"));
             }
+            else if (connId < FIRST_GUEST_ID && ClusterRouter::GetInstance()->IsOpen()) {
+                /* user may be connected to other node, offline messages are kept by directory owner */
+                ClusterRouter::GetInstance()->Route(connId, std::string(user_msg));
+            }
+            else if (connId < FIRST_GUEST_ID && OfflineMailbox::GetInstance()->Append(connId, user_msg)) {
+                ConsoleLogger::Debug(boost::str(boost::format("%1%%2%%3%") % "User #" % connId % " is offline, message stored"));
+                /* user could authenticate between the check and the append */
+                if (Contains(connId)) {
+                    DeliverOfflineMessages(connId);
+                }
+            }
             else {
                 std::cout << "User #" << connId << " not found\n";
             }
@@ -0,0 +1,102 @@
+/*****************************************************************
+ *  @file       ConnectionTimers.cpp
+ *  @brief      Deadlines and heartbeats of client connections
+ *              implementation
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+
+#include "ConnectionTimers.h"
+
+#include <stdexcept>
+#include <algorithm>
+
+#include <boost/format.hpp>
+
+#include "../log/Logger.h"
+#include "../log/Metrics.h"
+
+namespace {
+    Metrics::Counter& fired = Metrics::GetInstance()->GetCounter("connection_timers_fired_total");
+    Metrics::Gauge& scheduled = Metrics::GetInstance()->GetGauge("connection_timers_scheduled");
+}
+
+std::shared_ptr<ConnectionTimers> ConnectionTimers::ct_ = nullptr;
+
+ConnectionTimers::ConnectionTimers() {
+    ConsoleLogger::Debug("Construct ConnectionTimers class");
+}
+
+ConnectionTimers::~ConnectionTimers() {
+    ConsoleLogger::Debug("Destruct ConnectionTimers class");
+}
+
+void ConnectionTimers::Start(boost::asio::io_context& io, std::size_t shards, const config_t& config) {
+
+    std::unique_lock lk(mutex_);
+    if (!shards_.empty()) {
+        throw std::runtime_error("Connection timers are already started");
+    }
+    config_ = config;
+    auto start = std::chrono::steady_clock::now();
+    shards_.resize(std::max<std::size_t>(shards, 1));
+    for (auto& shard : shards_) {
+        shard.wheel = std::make_unique<TimerWheel>(config_.tick, start);
+        shard.ticker = std::make_unique<boost::asio::steady_timer>(io);
+    }
+    started_ = true;
+    for (auto& shard : shards_) {
+        Tick(shard);
+    }
+
+    ConsoleLogger::Info(boost::str(boost::format("Connection timers: %1% wheels, tick %2% ms") %
+        shards_.size() % config_.tick.count()));
+}
+
+/* wheels stay, connections still unlink their timers from them */
+void ConnectionTimers::Stop() noexcept {
+    std::unique_lock lk(mutex_);
+    if (!started_) {
+        return;
+    }
+    started_ = false;
+    for (auto& shard : shards_) {
+        boost::asio::post(shard.ticker->get_executor(), [&shard]() { shard.ticker->cancel(); });
+    }
+}
+
+bool ConnectionTimers::IsStarted() const noexcept {
+    return started_;
+}
+
+void ConnectionTimers::Tick(shard_t& shard) {
+    shard.ticker->expires_after(config_.tick);
+    shard.ticker->async_wait([this, &shard](const boost::system::error_code& error) {
+        if (error || !started_) {
+            return;
+        }
+        fired.Inc(shard.wheel->Advance(std::chrono::steady_clock::now()));
+        scheduled.Set(static_cast<int64_t>(GetScheduled()));
+        Tick(shard);
+    });
+}
+
+void ConnectionTimers::Schedule(TimerWheel::timer_t& timer, std::chrono::milliseconds delay) noexcept {
+    if (!started_) {
+        return;
+    }
+    auto wheel = timer.GetWheel();
+    if (!wheel) {
+        wheel = shards_[next_++ % shards_.size()].wheel.get();
+    }
+    wheel->Schedule(timer, delay);
+}
+
+std::size_t ConnectionTimers::GetScheduled() const noexcept {
+    std::size_t size = 0;
+    for (const auto& shard : shards_) {
+        size += shard.wheel->GetSize();
+    }
+    return size;
+}
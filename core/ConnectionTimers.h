@@ -0,0 +1,79 @@
+/*****************************************************************
+ *  @file       ConnectionTimers.h
+ *  @brief      Deadlines and heartbeats of client connections
+ *              served by sharded timer wheels
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+#pragma once
+
+/* std C++ lib headers */
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+/* boost C++ lib headers */
+#include <boost/asio.hpp>
+
+#include "TimerWheel.h"
+
+/* One wheel per io thread, each driven by single steady_timer ticking on
+ * the io context, so a million connections cost one asio timer per thread.
+ * Connections are spread over wheels round robin, wheel lock is contended
+ * only by connections of the same shard. */
+class ConnectionTimers {
+
+public:
+
+    struct config_t {
+        std::chrono::milliseconds tick{ 100 };
+        std::chrono::milliseconds handshakeTimeout{ 10000 };
+        std::chrono::milliseconds authTimeout{ 30000 };     // 0 keeps guest connections
+        std::chrono::milliseconds idleTimeout{ 0 };         // 0 never closes silent client
+        std::chrono::milliseconds heartbeatInterval{ 30000 };
+        std::chrono::milliseconds writeStallTimeout{ 30000 };
+    };
+
+    ConnectionTimers(const ConnectionTimers&) = delete;
+    ConnectionTimers& operator=(const ConnectionTimers&) = delete;
+
+    ConnectionTimers();
+    ~ConnectionTimers();
+
+    static const std::shared_ptr<ConnectionTimers>& GetInstance() {
+        static std::once_flag once;
+        std::call_once(once, []() { ct_ = std::make_shared<ConnectionTimers>(); });
+        return ct_;
+    }
+
+    void Start(boost::asio::io_context& io, std::size_t shards, const config_t& config);
+    void Stop() noexcept;
+
+    bool IsStarted() const noexcept;
+    const config_t& GetConfig() const noexcept { return config_; }
+
+    /* no-op until started, timer keeps its wheel once scheduled */
+    void Schedule(TimerWheel::timer_t& timer, std::chrono::milliseconds delay) noexcept;
+
+    std::size_t GetScheduled() const noexcept;
+
+private:
+
+    struct shard_t {
+        std::unique_ptr<TimerWheel> wheel;
+        std::unique_ptr<boost::asio::steady_timer> ticker;
+    };
+
+    config_t config_;
+    std::vector<shard_t> shards_;
+    std::atomic_size_t next_{ 0 };
+    std::atomic_bool started_{ false };
+    mutable std::mutex mutex_;
+
+    static std::shared_ptr<ConnectionTimers> ct_;
+
+    void Tick(shard_t& shard);
+};
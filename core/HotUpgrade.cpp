@@ -0,0 +1,357 @@
+/*****************************************************************
+ *  @file       HotUpgrade.cpp
+ *  @brief      Handover of listening socket implementation
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+
+#include "HotUpgrade.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <boost/format.hpp>
+
+#include "ConnectionManager.h"
+#include "Readiness.h"
+
+#include "../log/Logger.h"
+#include "../log/Metrics.h"
+
+namespace {
+    Metrics::Counter& forwardedMessages = Metrics::GetInstance()->GetCounter("upgrade_forwarded_total");
+    Metrics::Counter& drainedConnections = Metrics::GetInstance()->GetCounter("upgrade_drained_total");
+}
+
+std::shared_ptr<HotUpgrade> HotUpgrade::hu_ = nullptr;
+
+HotUpgrade::HotUpgrade() {
+    ConsoleLogger::Debug("Construct HotUpgrade class");
+}
+
+HotUpgrade::~HotUpgrade() {
+    Close();
+    ConsoleLogger::Debug("Destruct HotUpgrade class");
+}
+
+void HotUpgrade::Configure(const config_t& config) {
+    config_ = config;
+}
+
+int HotUpgrade::TakeOver(deliver_t&& deliver) {
+
+    if (config_.socketPath.empty()) {
+        return -1;
+    }
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (config_.socketPath.size() >= sizeof(addr.sun_path)) {
+        ConsoleLogger::Error(boost::str(boost::format("Upgrade socket path %1% is too long") % config_.socketPath));
+        return -1;
+    }
+    std::memcpy(addr.sun_path, config_.socketPath.c_str(), config_.socketPath.size());
+
+    int sock = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock < 0) {
+        return -1;
+    }
+    if (::connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        /* the first start, nobody listens */
+        ::close(sock);
+        return -1;
+    }
+
+    /* predecessor closes its stores before acknowledgement, WAL flushes pending batch */
+    timeval timeout{ 30, 0 };
+    ::setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    int listener = ReceiveFd(sock);
+    char ack = 0;
+    if (listener < 0 || !ReadAll(sock, &ack, sizeof(ack))) {
+        ConsoleLogger::Error("Running process didn't hand listening socket over");
+        if (listener >= 0) {
+            ::close(listener);
+        }
+        ::close(sock);
+        return -1;
+    }
+    timeval none{};
+    ::setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &none, sizeof(none));
+
+    predecessor_ = sock;
+    reader_ = std::thread([this, deliver = std::move(deliver)]() { Read(deliver); });
+    ConsoleLogger::Info("Listening socket is taken over from running process");
+    return listener;
+}
+
+void HotUpgrade::Listen(boost::asio::io_context& io, int listener, handlers_t&& handlers) {
+
+    if (config_.socketPath.empty()) {
+        return;
+    }
+    io_ = &io;
+    handlers_ = std::move(handlers);
+    try {
+        /* path is left by predecessor; whoever connects gets the listening socket,
+         * so the path is created accessible to the owner only */
+        ::unlink(config_.socketPath.c_str());
+        auto mask = ::umask(0177);
+        try {
+            acceptor_ = std::make_unique<boost::asio::local::stream_protocol::acceptor>(io,
+                boost::asio::local::stream_protocol::endpoint(config_.socketPath));
+        }
+        catch (...) {
+            ::umask(mask);
+            throw;
+        }
+        ::umask(mask);
+        Accept(listener);
+        ConsoleLogger::Info(boost::str(boost::format("Waiting for upgrade on %1%") % config_.socketPath));
+    }
+    catch (std::exception& ex) {
+        ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
+    }
+}
+
+void HotUpgrade::Accept(int listener) {
+    auto peer = std::make_shared<boost::asio::local::stream_protocol::socket>(*io_);
+    acceptor_->async_accept(*peer, [this, peer, listener](const boost::system::error_code& error) {
+        /* closed */
+        if (error) {
+            return;
+        }
+        /* only the same user may take the server over */
+        ucred cred{};
+        socklen_t len = sizeof(cred);
+        if (::getsockopt(peer->native_handle(), SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0 || cred.uid != ::geteuid()) {
+            ConsoleLogger::Error(boost::str(boost::format("Upgrade request of process %1% (uid %2%) is refused") %
+                cred.pid % cred.uid));
+            boost::system::error_code ec;
+            peer->close(ec);
+            Accept(listener);
+            return;
+        }
+        if (!Handover(peer->native_handle(), listener)) {
+            Accept(listener);
+        }
+    });
+}
+
+bool HotUpgrade::Handover(int peer, int listener) {
+
+    ConsoleLogger::Info("New process asks for listening socket");
+    /* nothing is released yet, so failed handover leaves this process as it was */
+    if (!SendFd(peer, listener)) {
+        ConsoleLogger::Error(boost::str(boost::format("Listening socket handover failed: %1%") % std::strerror(errno)));
+        return false;
+    }
+    handlers_.release();
+    char ack = 1;
+    if (!WriteAll(peer, &ack, sizeof(ack))) {
+        ConsoleLogger::Error("New process is gone after handover, clients are drained anyway");
+    }
+    {
+        std::unique_lock lk(mutex_);
+        successor_ = ::dup(peer);
+    }
+    draining_ = true;
+    Readiness::GetInstance()->SetState(Readiness::state_t::draining);
+    boost::system::error_code ec;
+    acceptor_->close(ec);
+
+    auto clients = std::make_shared<std::vector<AsyncClient::client_ptr>>(ConnectionManager::GetInstance()->GetClients());
+    ConsoleLogger::Info(boost::str(boost::format("Listening socket is handed over, drain %1% connections over %2% s") %
+        clients->size() % config_.drainWindow.count()));
+    drainTimer_ = std::make_unique<boost::asio::steady_timer>(*io_);
+    DrainStep(std::move(clients), clock_t::now(), 0);
+    return true;
+}
+
+void HotUpgrade::DrainStep(std::shared_ptr<std::vector<AsyncClient::client_ptr>> clients, clock_t::time_point start,
+    std::size_t closed)
+{
+    /* share of clients closed follows share of window passed, reconnects reach successor evenly */
+    auto elapsed = clock_t::now() - start;
+    auto window = std::chrono::duration<double>(config_.drainWindow);
+    std::size_t due = elapsed >= window ? clients->size() :
+        static_cast<std::size_t>(clients->size() * (std::chrono::duration<double>(elapsed) / window));
+    for (; closed < due; ++closed) {
+        (*clients)[closed]->Drain();
+        (*clients)[closed].reset();
+        drainedConnections.Inc();
+    }
+
+    if (closed == clients->size() && (ConnectionManager::GetInstance()->GetConnectionsAmount() == 0 ||
+        elapsed >= window + config_.drainGrace)) {
+        ConsoleLogger::Info("Connections are drained, stop server");
+        handlers_.exit();
+        return;
+    }
+    drainTimer_->expires_after(drain_tick);
+    drainTimer_->async_wait([this, clients, start, closed](const boost::system::error_code& error) {
+        if (!error) {
+            DrainStep(clients, start, closed);
+        }
+    });
+}
+
+bool HotUpgrade::Forward(uint32_t user, const std::string& msg) noexcept {
+
+    if (!draining_) {
+        return false;
+    }
+    frame_t frame{ user, static_cast<uint32_t>(msg.size()) };
+    std::unique_lock lk(mutex_);
+    if (successor_ < 0) {
+        return false;
+    }
+    if (!WriteAll(successor_, &frame, sizeof(frame)) || !WriteAll(successor_, msg.data(), msg.size())) {
+        ConsoleLogger::Error("New process is gone, messages are not forwarded any more");
+        ::close(successor_);
+        successor_ = -1;
+        return false;
+    }
+    forwardedMessages.Inc();
+    return true;
+}
+
+void HotUpgrade::Read(deliver_t deliver) noexcept {
+
+    for (;;) {
+        frame_t frame{};
+        if (!ReadAll(predecessor_, &frame, sizeof(frame))) {
+            break;
+        }
+        try {
+            std::string msg(frame.size, '\0');
+            if (!ReadAll(predecessor_, msg.data(), msg.size())) {
+                break;
+            }
+            deliver(frame.user, std::move(msg));
+        }
+        catch (std::exception& ex) {
+            ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
+        }
+    }
+    ConsoleLogger::Info("Previous process has exited");
+}
+
+void HotUpgrade::Close() noexcept {
+
+    draining_ = false;
+    {
+        std::unique_lock lk(mutex_);
+        if (successor_ >= 0) {
+            ::close(successor_);
+            successor_ = -1;
+        }
+    }
+    if (predecessor_ >= 0) {
+        ::shutdown(predecessor_, SHUT_RDWR);
+    }
+    if (reader_.joinable()) {
+        reader_.join();
+    }
+    if (predecessor_ >= 0) {
+        ::close(predecessor_);
+        predecessor_ = -1;
+    }
+    /* socket path is not unlinked, it may belong to successor already */
+    boost::system::error_code ec;
+    if (acceptor_) {
+        acceptor_->close(ec);
+    }
+    if (drainTimer_) {
+        drainTimer_->cancel();
+    }
+}
+
+bool HotUpgrade::SendFd(int sock, int fd) noexcept {
+
+    char byte = 0;
+    iovec iov{ &byte, sizeof(byte) };
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    auto cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    std::memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+    ssize_t sent;
+    do {
+        sent = ::sendmsg(sock, &msg, MSG_NOSIGNAL);
+    } while (sent < 0 && errno == EINTR);
+    return sent == sizeof(byte);
+}
+
+int HotUpgrade::ReceiveFd(int sock) noexcept {
+
+    char byte = 0;
+    iovec iov{ &byte, sizeof(byte) };
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t received;
+    do {
+        received = ::recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+    } while (received < 0 && errno == EINTR);
+    if (received != sizeof(byte)) {
+        return -1;
+    }
+    for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            int fd;
+            std::memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+            return fd;
+        }
+    }
+    return -1;
+}
+
+bool HotUpgrade::WriteAll(int sock, const void* data, std::size_t size) noexcept {
+    auto ptr = static_cast<const char*>(data);
+    while (size > 0) {
+        auto sent = ::send(sock, ptr, size, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            return false;
+        }
+        ptr += sent;
+        size -= sent;
+    }
+    return true;
+}
+
+bool HotUpgrade::ReadAll(int sock, void* data, std::size_t size) noexcept {
+    auto ptr = static_cast<char*>(data);
+    while (size > 0) {
+        auto received = ::recv(sock, ptr, size, 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            return false;
+        }
+        ptr += received;
+        size -= received;
+    }
+    return true;
+}
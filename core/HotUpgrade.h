@@ -0,0 +1,124 @@
+/*****************************************************************
+ *  @file       HotUpgrade.h
+ *  @brief      Handover of listening socket to new build of
+ *              server without dropping connected clients
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+#pragma once
+
+/* std C++ lib headers */
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <utility>
+
+/* boost C++ lib headers */
+#include <boost/asio.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+
+/* local C++ headers */
+#include "AsyncClient.h"
+
+/* New process started with the same upgrade socket path connects to the
+ * running one before it opens anything. Running process passes its listening
+ * socket over the Unix socket (SCM_RIGHTS), closes the stores both of them
+ * would write to (WAL, mailbox, capture, cluster port), acknowledges, and
+ * stops accepting; successor opens the stores and accepts on the same socket,
+ * so no connection is refused meanwhile. Predecessor then closes its clients
+ * evenly over drain window: each one gets queued messages flushed and resumes
+ * its session on successor, there is no reconnect storm. During the drain
+ * messages predecessor can't deliver itself go to successor over the same
+ * Unix connection, then predecessor stops as on SIGTERM. */
+class HotUpgrade {
+
+public:
+
+    using clock_t = std::chrono::steady_clock;
+
+    struct config_t {
+        std::string socketPath;                         // empty disables upgrades
+        std::chrono::seconds drainWindow{ 30 };         // clients are closed evenly over it
+        std::chrono::seconds drainGrace{ 5 };           // closed clients may still flush after the window
+    };
+
+    struct handlers_t {
+        std::function<void()> release;                  // stop accepting, close what successor opens
+        std::function<void()> exit;                     // drain is over
+    };
+
+    /* message forwarded by predecessor */
+    using deliver_t = std::function<void(uint32_t user, std::string&& msg)>;
+
+    static constexpr std::chrono::milliseconds drain_tick{ 100 };
+
+    HotUpgrade(const HotUpgrade&) = delete;
+    HotUpgrade& operator=(const HotUpgrade&) = delete;
+
+    HotUpgrade();
+    ~HotUpgrade();
+
+    static const std::shared_ptr<HotUpgrade>& GetInstance() {
+        static std::once_flag once;
+        std::call_once(once, []() { hu_ = std::make_shared<HotUpgrade>(); });
+        return hu_;
+    }
+
+    void Configure(const config_t& config);
+    const config_t& GetConfig() const noexcept { return config_; }
+
+    /* new process, before any store is opened: listening socket of running
+     * process, -1 if there is none and server binds the port itself */
+    int TakeOver(deliver_t&& deliver);
+
+    /* waits for successor on upgrade socket */
+    void Listen(boost::asio::io_context& io, int listener, handlers_t&& handlers);
+
+    /* predecessor during drain: message for user who isn't served here any more goes to successor */
+    bool Forward(uint32_t user, const std::string& msg) noexcept;
+    bool IsDraining() const noexcept { return draining_; }
+
+    void Close() noexcept;
+
+    /* one descriptor over connected Unix socket */
+    static bool SendFd(int sock, int fd) noexcept;
+    static int ReceiveFd(int sock) noexcept;
+
+private:
+
+    struct frame_t {
+        uint32_t user;
+        uint32_t size;
+    };
+
+    config_t config_;
+    handlers_t handlers_;
+    boost::asio::io_context* io_ = nullptr;
+    std::unique_ptr<boost::asio::local::stream_protocol::acceptor> acceptor_;
+    std::unique_ptr<boost::asio::steady_timer> drainTimer_;
+
+    std::mutex mutex_;                  // writes to successor
+    int successor_ = -1;
+    std::atomic_bool draining_{ false };
+
+    int predecessor_ = -1;
+    std::thread reader_;
+
+    static std::shared_ptr<HotUpgrade> hu_;
+
+    void Accept(int listener);
+    bool Handover(int peer, int listener);
+    void DrainStep(std::shared_ptr<std::vector<AsyncClient::client_ptr>> clients, clock_t::time_point start,
+        std::size_t closed);
+    void Read(deliver_t deliver) noexcept;
+
+    static bool WriteAll(int sock, const void* data, std::size_t size) noexcept;
+    static bool ReadAll(int sock, void* data, std::size_t size) noexcept;
+};
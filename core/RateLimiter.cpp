@@ -0,0 +1,105 @@
+/*****************************************************************
+ *  @file       RateLimiter.cpp
+ *  @brief      Token bucket limits of inbound messages implementation
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+
+#include "RateLimiter.h"
+
+#include <algorithm>
+
+#include <boost/format.hpp>
+
+#include "../log/Logger.h"
+
+std::shared_ptr<RateLimiter> RateLimiter::rl_ = nullptr;
+
+std::chrono::nanoseconds RateLimiter::TokenBucket::Take(double cost, clock_t::time_point now) noexcept {
+
+    if (rate_ <= 0) {
+        return std::chrono::nanoseconds(0);
+    }
+    if (now > last_) {
+        tokens_ = std::min(burst_, tokens_ + std::chrono::duration<double>(now - last_).count() * rate_);
+        last_ = now;
+    }
+    tokens_ -= cost;
+    if (tokens_ >= 0) {
+        return std::chrono::nanoseconds(0);
+    }
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(-tokens_ / rate_));
+}
+
+bool RateLimiter::TokenBucket::IsFull(clock_t::time_point now) const noexcept {
+    return rate_ <= 0 || tokens_ + std::chrono::duration<double>(now - last_).count() * rate_ >= burst_;
+}
+
+RateLimiter::RateLimiter() {
+    ConsoleLogger::Debug("Construct RateLimiter class");
+}
+
+RateLimiter::~RateLimiter() {
+    ConsoleLogger::Debug("Destruct RateLimiter class");
+}
+
+void RateLimiter::Configure(const config_t& config) {
+    std::unique_lock lk(mutex_);
+    config_ = config;
+    config_.maxFrameSize = std::max<std::size_t>(config_.maxFrameSize, 1);
+    users_.clear();
+
+    ConsoleLogger::Info(boost::str(boost::format("Rate limits: frame %1% bytes, connection %2% msg/s %3% B/s, "
+        "user %4% msg/s %5% B/s") % config_.maxFrameSize % config_.connMessagesPerSec % config_.connBytesPerSec %
+        config_.userMessagesPerSec % config_.userBytesPerSec));
+}
+
+RateLimiter::state_t RateLimiter::CreateState(clock_t::time_point now) const {
+    state_t state;
+    state.messages = TokenBucket(config_.connMessagesPerSec, std::max(1.0, config_.connMessagesPerSec * config_.burstSec), now);
+    state.bytes = TokenBucket(config_.connBytesPerSec,
+        std::max<double>(config_.maxFrameSize, config_.connBytesPerSec * config_.burstSec), now);
+    return state;
+}
+
+std::shared_ptr<RateLimiter::user_t> RateLimiter::GetUser(id_t userId, clock_t::time_point now) {
+
+    std::unique_lock lk(mutex_);
+    /* refilled buckets of users without connections are the same as new ones */
+    if (++lookups_ % prune_period == 0) {
+        for (auto it = users_.begin(); it != users_.end(); ) {
+            bool idle = false;
+            if (it->second.use_count() == 1) {
+                std::unique_lock ulk(it->second->mutex);
+                idle = it->second->messages.IsFull(now) && it->second->bytes.IsFull(now);
+            }
+            it = idle ? users_.erase(it) : std::next(it);
+        }
+    }
+
+    auto& user = users_[userId];
+    if (!user) {
+        user = std::make_shared<user_t>();
+        user->messages = TokenBucket(config_.userMessagesPerSec, std::max(1.0, config_.userMessagesPerSec * config_.burstSec), now);
+        user->bytes = TokenBucket(config_.userBytesPerSec,
+            std::max<double>(config_.maxFrameSize, config_.userBytesPerSec * config_.burstSec), now);
+    }
+    return user;
+}
+
+std::chrono::nanoseconds RateLimiter::Charge(state_t& state, id_t userId, std::size_t bytes, clock_t::time_point now) {
+
+    auto pause = std::max(state.messages.Take(1, now), state.bytes.Take(static_cast<double>(bytes), now));
+
+    if (userId != state.userId) {
+        state.userId = userId;
+        state.user = userId ? GetUser(userId, now) : nullptr;
+    }
+    if (state.user) {
+        std::unique_lock lk(state.user->mutex);
+        pause = std::max({ pause, state.user->messages.Take(1, now),
+            state.user->bytes.Take(static_cast<double>(bytes), now) });
+    }
+    return pause;
+}
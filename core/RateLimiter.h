@@ -0,0 +1,109 @@
+/*****************************************************************
+ *  @file       RateLimiter.h
+ *  @brief      Token bucket limits of inbound messages per
+ *              connection and per user
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+#pragma once
+
+/* std C++ lib headers */
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <unordered_map>
+#include <cstdint>
+
+/* Frame which was already read is always accepted, its cost may take the
+ * bucket below zero, and the connection doesn't read again until the debt
+ * is refilled. Abusive sender is held by TCP flow control then, its frames
+ * never reach the dispatcher queue faster than the limit. User buckets are
+ * shared by connections of the same user and outlive them until refilled,
+ * so reconnecting doesn't reset the limit. */
+class RateLimiter {
+
+public:
+
+    using id_t = uint32_t;
+    using clock_t = std::chrono::steady_clock;
+
+    /* rates are off unless set in server.ini, 0 disables a limit */
+    struct config_t {
+        std::size_t maxFrameSize = 1024;
+        double connMessagesPerSec = 0;
+        double connBytesPerSec = 0;
+        double userMessagesPerSec = 0;
+        double userBytesPerSec = 0;
+        double burstSec = 2;                // bucket size in seconds of rate
+    };
+
+    class TokenBucket {
+
+    public:
+
+        TokenBucket() = default;
+        TokenBucket(double rate, double burst, clock_t::time_point now) :
+            rate_(rate), burst_(burst), tokens_(burst), last_(now) {}
+
+        /* takes cost even beyond zero, returns time until balance is positive again */
+        std::chrono::nanoseconds Take(double cost, clock_t::time_point now) noexcept;
+        bool IsFull(clock_t::time_point now) const noexcept;
+
+    private:
+
+        double rate_ = 0;
+        double burst_ = 0;
+        double tokens_ = 0;
+        clock_t::time_point last_;
+    };
+
+    struct user_t {
+        std::mutex mutex;
+        TokenBucket messages;
+        TokenBucket bytes;
+    };
+
+    /* kept by connection, touched only by its strand */
+    struct state_t {
+        TokenBucket messages;
+        TokenBucket bytes;
+        id_t userId = 0;
+        std::shared_ptr<user_t> user;
+    };
+
+    RateLimiter(const RateLimiter&) = delete;
+    RateLimiter& operator=(const RateLimiter&) = delete;
+
+    RateLimiter();
+    ~RateLimiter();
+
+    static const std::shared_ptr<RateLimiter>& GetInstance() {
+        static std::once_flag once;
+        std::call_once(once, []() { rl_ = std::make_shared<RateLimiter>(); });
+        return rl_;
+    }
+
+    /* applies to connections created afterwards */
+    void Configure(const config_t& config);
+    const config_t& GetConfig() const noexcept { return config_; }
+
+    state_t CreateState(clock_t::time_point now = clock_t::now()) const;
+
+    /* charges one frame, userId is 0 for guest; returns how long reading must pause */
+    std::chrono::nanoseconds Charge(state_t& state, id_t userId, std::size_t bytes,
+        clock_t::time_point now = clock_t::now());
+
+private:
+
+    const std::size_t prune_period = 4096;      // user lookups between prunes
+
+    config_t config_;
+    std::unordered_map<id_t, std::shared_ptr<user_t>> users_;
+    std::size_t lookups_ = 0;
+    std::mutex mutex_;
+
+    static std::shared_ptr<RateLimiter> rl_;
+
+    std::shared_ptr<user_t> GetUser(id_t userId, clock_t::time_point now);
+};
@@ -0,0 +1,114 @@
+/*****************************************************************
+ *  @file       Readiness.cpp
+ *  @brief      Concurrent startup of server components implementation
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+
+#include "Readiness.h"
+
+#include <future>
+#include <exception>
+
+#include <boost/format.hpp>
+
+#include "../log/Logger.h"
+#include "../log/Metrics.h"
+
+namespace {
+    /* value of state_t */
+    Metrics::Gauge& serverState = Metrics::GetInstance()->GetGauge("server_state");
+    Metrics::Gauge& startupTime = Metrics::GetInstance()->GetGauge("startup_ms");
+}
+
+std::shared_ptr<Readiness> Readiness::rd_ = nullptr;
+
+Readiness::Readiness() {
+    serverState.Set(static_cast<int64_t>(state_t::starting));
+    ConsoleLogger::Debug("Construct Readiness class");
+}
+
+Readiness::~Readiness() {
+    ConsoleLogger::Debug("Destruct Readiness class");
+}
+
+void Readiness::RunStage(tasks_t&& tasks) {
+
+    auto run = [this](const std::string& component, const task_t& task) {
+        auto start = clock_t::now();
+        task();
+        Record(component, clock_t::now() - start);
+    };
+
+    std::vector<std::pair<std::string, std::future<void>>> running;
+    for (std::size_t i = 1; i < tasks.size(); ++i) {
+        running.emplace_back(tasks[i].first, std::async(std::launch::async, run,
+            std::cref(tasks[i].first), std::cref(tasks[i].second)));
+    }
+
+    std::exception_ptr failure;
+    if (!tasks.empty()) {
+        try {
+            run(tasks[0].first, tasks[0].second);
+        }
+        catch (std::exception& ex) {
+            ConsoleLogger::Error(boost::str(boost::format("%1% failed to start: %2%") % tasks[0].first % ex.what()));
+            failure = std::current_exception();
+        }
+    }
+    /* nothing is left running against a half started server */
+    for (auto& [component, future] : running) {
+        try {
+            future.get();
+        }
+        catch (std::exception& ex) {
+            ConsoleLogger::Error(boost::str(boost::format("%1% failed to start: %2%") % component % ex.what()));
+            if (!failure) {
+                failure = std::current_exception();
+            }
+        }
+    }
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+}
+
+void Readiness::Record(const std::string& component, clock_t::duration elapsed) {
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed);
+    Metrics::GetInstance()->GetGauge(boost::str(boost::format("startup_ms{component=\"%1%\"}") % component)).Set(ms.count());
+    ConsoleLogger::Info(boost::str(boost::format("%1% started in %2% ms") % component % ms.count()));
+    std::unique_lock lk(mutex_);
+    timings_.emplace_back(component, ms);
+}
+
+void Readiness::SetState(state_t state) noexcept {
+
+    if (state_.exchange(state) == state) {
+        return;
+    }
+    serverState.Set(static_cast<int64_t>(state));
+    if (state == state_t::ready) {
+        auto total = std::chrono::duration_cast<std::chrono::milliseconds>(clock_t::now() - started_).count();
+        startupTime.Set(total);
+        ConsoleLogger::Info(boost::str(boost::format("Server is ready in %1% ms") % total));
+    }
+    else {
+        ConsoleLogger::Info(boost::str(boost::format("Server is %1%") % ToString(state)));
+    }
+}
+
+Readiness::timings_t Readiness::GetTimings() const {
+    std::unique_lock lk(mutex_);
+    return timings_;
+}
+
+const char* Readiness::ToString(state_t state) noexcept {
+    switch (state) {
+        case state_t::starting: return "starting";
+        case state_t::ready: return "ready";
+        case state_t::draining: return "draining";
+        case state_t::stopping: return "stopping";
+    }
+    return "unknown";
+}
@@ -0,0 +1,79 @@
+/*****************************************************************
+ *  @file       Readiness.h
+ *  @brief      Concurrent startup of server components and state
+ *              of the server from start to stop
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+#pragma once
+
+/* std C++ lib headers */
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <utility>
+#include <cstdint>
+
+/* Components which don't depend on each other, e.g. TLS context, storage
+ * backends and disk stores, are started by one stage concurrently, so
+ * restart takes as long as the slowest of them rather than their sum;
+ * stages run one after another. Acceptor opens once every stage is done,
+ * the first client doesn't pay for lazy initialization. Time every
+ * component took is kept and exported, so slow ones are easy to spot. */
+class Readiness {
+
+public:
+
+    using clock_t = std::chrono::steady_clock;
+    using task_t = std::function<void()>;
+    using tasks_t = std::vector<std::pair<std::string, task_t>>;
+    using timings_t = std::vector<std::pair<std::string, std::chrono::milliseconds>>;
+
+    enum class state_t : uint8_t {
+        starting,
+        ready,          // accepting clients
+        draining,       // listening socket is handed over to new process
+        stopping,
+    };
+
+    Readiness(const Readiness&) = delete;
+    Readiness& operator=(const Readiness&) = delete;
+
+    Readiness();
+    ~Readiness();
+
+    static const std::shared_ptr<Readiness>& GetInstance() {
+        static std::once_flag once;
+        std::call_once(once, []() { rd_ = std::make_shared<Readiness>(); });
+        return rd_;
+    }
+
+    /* every task runs on its own thread, the first failure is rethrown when all are done */
+    void RunStage(tasks_t&& tasks);
+
+    void SetState(state_t state) noexcept;
+    state_t GetState() const noexcept { return state_; }
+    bool IsReady() const noexcept { return state_ == state_t::ready; }
+
+    /* in order of completion */
+    timings_t GetTimings() const;
+
+    static const char* ToString(state_t state) noexcept;
+
+private:
+
+    std::atomic<state_t> state_{ state_t::starting };
+    const clock_t::time_point started_ = clock_t::now();
+
+    mutable std::mutex mutex_;
+    timings_t timings_;
+
+    static std::shared_ptr<Readiness> rd_;
+
+    void Record(const std::string& component, clock_t::duration elapsed);
+};
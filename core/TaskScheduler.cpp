@@ -0,0 +1,174 @@
+/*****************************************************************
+ *  @file       TaskScheduler.cpp
+ *  @brief      Work-stealing pool of CPU threads implementation
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include <boost/format.hpp>
+
+#include "../log/Logger.h"
+#include "../log/Metrics.h"
+
+namespace {
+    Metrics::Counter& tasksRun = Metrics::GetInstance()->GetCounter("scheduler_tasks_total");
+    Metrics::Counter& tasksStolen = Metrics::GetInstance()->GetCounter("scheduler_steals_total");
+    /* rate divided by threads is utilization of the pool */
+    Metrics::Counter& busyTime = Metrics::GetInstance()->GetCounter("scheduler_busy_us_total");
+    Metrics::Counter& tasksRejected = Metrics::GetInstance()->GetCounter("scheduler_rejected_total");
+
+    /* worker of which scheduler the current thread is, submits from it stay local */
+    thread_local const TaskScheduler* currentScheduler = nullptr;
+    thread_local std::size_t currentWorker = 0;
+}
+
+std::size_t TaskScheduler::threads_ = 0;
+std::shared_ptr<TaskScheduler> TaskScheduler::ts_ = nullptr;
+
+TaskScheduler::TaskScheduler(std::size_t threads) {
+
+    if (threads == 0) {
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    for (std::size_t i = 0; i < threads; ++i) {
+        workers_.push_back(std::make_unique<worker_t>());
+    }
+    for (std::size_t i = 0; i < threads; ++i) {
+        workers_[i]->thread = std::thread([this, i]() { Run(i); });
+    }
+    ConsoleLogger::Debug(boost::str(boost::format("Construct TaskScheduler class, %1% workers") % threads));
+}
+
+TaskScheduler::~TaskScheduler() {
+    Stop();
+    ConsoleLogger::Debug("Destruct TaskScheduler class");
+}
+
+bool TaskScheduler::Submit(task_t&& task) {
+
+    if (stop_) {
+        /* not run in place: a task requeueing itself would recurse on the caller's stack */
+        std::unique_lock lk(mutex_);
+        if (drained_) {
+            tasksRejected.Inc();
+            ConsoleLogger::Error("Task is submitted to stopped scheduler and dropped");
+            return false;
+        }
+        {
+            std::unique_lock wl(workers_[0]->mutex);
+            workers_[0]->tasks.push_back(std::move(task));
+        }
+        queued_++;
+        return true;
+    }
+
+    auto index = currentScheduler == this ? currentWorker : next_++ % workers_.size();
+    {
+        std::unique_lock lk(workers_[index]->mutex);
+        workers_[index]->tasks.push_back(std::move(task));
+    }
+    /* pairs with parking worker: either it sees the task or it is woken */
+    queued_++;
+    if (sleeping_ > 0) {
+        std::unique_lock lk(mutex_);
+        cv_.notify_one();
+    }
+    return true;
+}
+
+void TaskScheduler::Stop() noexcept {
+
+    {
+        std::unique_lock lk(mutex_);
+        if (stop_.exchange(true)) {
+            return;
+        }
+    }
+    cv_.notify_all();
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable() && worker->thread.get_id() != std::this_thread::get_id()) {
+            worker->thread.join();
+        }
+    }
+    /* submitted while workers were exiting, including tasks queued by these ones */
+    for (;;) {
+        task_t task;
+        while (TryPop(0, task)) {
+            try {
+                task();
+            }
+            catch (std::exception& ex) {
+                ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
+            }
+        }
+        std::unique_lock lk(mutex_);
+        if (queued_ == 0) {
+            drained_ = true;
+            break;
+        }
+    }
+}
+
+/* own deque from the front, others from the back */
+bool TaskScheduler::TryPop(std::size_t index, task_t& task) {
+
+    {
+        auto& own = *workers_[index];
+        std::unique_lock lk(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.front());
+            own.tasks.pop_front();
+            queued_--;
+            return true;
+        }
+    }
+    for (std::size_t i = 1; i < workers_.size(); ++i) {
+        auto& victim = *workers_[(index + i) % workers_.size()];
+        std::unique_lock lk(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+            queued_--;
+            tasksStolen.Inc();
+            return true;
+        }
+    }
+    return false;
+}
+
+void TaskScheduler::Run(std::size_t index) noexcept {
+
+    currentScheduler = this;
+    currentWorker = index;
+    for (;;) {
+        task_t task;
+        if (TryPop(index, task)) {
+            auto start = std::chrono::steady_clock::now();
+            try {
+                task();
+            }
+            catch (std::exception& ex) {
+                ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
+            }
+            tasksRun.Inc();
+            busyTime.Inc(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count());
+            continue;
+        }
+
+        std::unique_lock lk(mutex_);
+        sleeping_++;
+        cv_.wait(lk, [this]() { return queued_ > 0 || stop_; });
+        sleeping_--;
+        if (stop_ && queued_ == 0) {
+            break;
+        }
+    }
+    currentScheduler = nullptr;
+}
@@ -0,0 +1,98 @@
+/*****************************************************************
+ *  @file       TaskScheduler.h
+ *  @brief      Work-stealing pool of CPU threads shared by
+ *              dispatcher, delivery and io threads
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+#pragma once
+
+/* std C++ lib headers */
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <utility>
+
+/* boost C++ lib headers */
+#include <boost/asio/post.hpp>
+
+/* Every worker owns a deque: tasks submitted by a worker go to its own
+ * deque, tasks from other threads are spread round robin. Worker takes
+ * its tasks oldest first, so a task requeueing itself goes behind the
+ * rest and nothing starves behind newer work. Idle worker steals from
+ * the other end before it parks, so the newest task, e.g. a busy shard
+ * which has just yielded, is picked up by a free thread at once instead
+ * of waiting behind the whole deque. Tasks must not block for long,
+ * waiting on I/O belongs to asio and DB pools. */
+class TaskScheduler {
+
+public:
+
+    using task_t = std::function<void()>;
+
+    TaskScheduler() = delete;
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    /* 0 is one per core */
+    explicit TaskScheduler(std::size_t threads);
+    ~TaskScheduler();
+
+    /* must be set before the first GetInstance() */
+    static void SetThreads(std::size_t threads) noexcept { threads_ = threads; }
+
+    static const std::shared_ptr<TaskScheduler>& GetInstance() {
+        static std::once_flag once;
+        std::call_once(once, []() { ts_ = std::make_shared<TaskScheduler>(threads_); });
+        return ts_;
+    }
+
+    std::size_t GetThreads() const noexcept { return workers_.size(); }
+
+    /* while Stop() drains, task is queued and run by it; once it has returned
+     * task is rejected, false then and task is dropped */
+    bool Submit(task_t&& task);
+
+    /* io thread hands CPU heavy work over and gets result back on its executor,
+     * e.g. strand of the socket, without blocking other handlers meanwhile */
+    template <typename Executor, typename Work, typename Then>
+    void Offload(const Executor& executor, Work&& work, Then&& then) {
+        Submit([executor, work = std::forward<Work>(work), then = std::forward<Then>(then)]() mutable {
+            boost::asio::post(executor, [result = work(), then = std::move(then)]() mutable {
+                then(std::move(result));
+            });
+        });
+    }
+
+    /* runs what is queued, including tasks submitted meanwhile, then joins workers */
+    void Stop() noexcept;
+
+private:
+
+    struct worker_t {
+        std::mutex mutex;
+        std::deque<task_t> tasks;
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<worker_t>> workers_;
+    std::atomic_size_t queued_{ 0 };
+    std::atomic_size_t sleeping_{ 0 };
+    std::atomic_size_t next_{ 0 };      // round robin of foreign submits
+    std::atomic_bool stop_{ false };
+    bool drained_ = false;              // Stop() has run the last queued task
+    std::mutex mutex_;                  // parking and stopping
+    std::condition_variable cv_;
+
+    static std::size_t threads_;
+    static std::shared_ptr<TaskScheduler> ts_;
+
+    bool TryPop(std::size_t index, task_t& task);
+    void Run(std::size_t index) noexcept;
+};
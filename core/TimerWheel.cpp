@@ -0,0 +1,156 @@
+/*****************************************************************
+ *  @file       TimerWheel.cpp
+ *  @brief      Hashed hierarchical timer wheel implementation
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+
+#include "TimerWheel.h"
+
+#include <algorithm>
+
+#include <boost/format.hpp>
+
+#include "../log/Logger.h"
+
+TimerWheel::TimerWheel(std::chrono::milliseconds tick, std::chrono::steady_clock::time_point start) :
+    tick_(std::max(tick, std::chrono::milliseconds(1))),
+    start_(start)
+{
+}
+
+TimerWheel::~TimerWheel() {
+    /* owners outliving the wheel must not unlink from it later */
+    std::unique_lock lk(mutex_);
+    for (auto& level : wheel_) {
+        for (auto& slot : level) {
+            while (slot.head.next_ != &slot.head) {
+                auto timer = slot.head.next_;
+                Unlink(*timer);
+                timer->wheel_ = nullptr;
+            }
+        }
+    }
+}
+
+void TimerWheel::Unlink(timer_t& timer) noexcept {
+    timer.prev_->next_ = timer.next_;
+    timer.next_->prev_ = timer.prev_;
+    timer.prev_ = timer.next_ = nullptr;
+}
+
+void TimerWheel::Link(timer_t& timer) noexcept {
+
+    uint64_t expires = std::max(timer.expires_, now_);
+    uint64_t distance = expires - now_;
+    slot_t* slot;
+    if (distance < slots) {
+        slot = &wheel_[0][expires & (slots - 1)];
+    }
+    else {
+        uint32_t level = 1;
+        while (level < levels - 1 && distance >= (1ull << (slot_bits * (level + 1)))) {
+            level++;
+        }
+        slot = &wheel_[level][(expires >> (slot_bits * level)) & (slots - 1)];
+    }
+
+    timer.next_ = &slot->head;
+    timer.prev_ = slot->head.prev_;
+    slot->head.prev_->next_ = &timer;
+    slot->head.prev_ = &timer;
+}
+
+void TimerWheel::Schedule(timer_t& timer, std::chrono::milliseconds delay) noexcept {
+
+    std::unique_lock lk(mutex_);
+    if (timer.next_) {
+        Unlink(timer);
+        size_--;
+    }
+    uint64_t ticks = static_cast<uint64_t>((std::max(delay.count(), int64_t(0)) + tick_.count() - 1) / tick_.count());
+    timer.expires_ = now_ + std::min<uint64_t>(std::max<uint64_t>(ticks, 1), max_ticks);
+    timer.wheel_ = this;
+    Link(timer);
+    size_++;
+}
+
+void TimerWheel::Cancel(timer_t& timer) noexcept {
+    std::unique_lock lk(mutex_);
+    if (timer.next_) {
+        Unlink(timer);
+        size_--;
+    }
+}
+
+/* timers of upper level slot are spread over lower levels */
+void TimerWheel::Cascade(uint32_t level) noexcept {
+    auto& head = wheel_[level][(now_ >> (slot_bits * level)) & (slots - 1)].head;
+    timer_t list;
+    if (head.next_ == &head) {
+        return;
+    }
+    /* slot is detached first, Link may put timers back into the same slot only on upper wrap */
+    list.next_ = head.next_;
+    list.prev_ = head.prev_;
+    list.next_->prev_ = &list;
+    list.prev_->next_ = &list;
+    head.next_ = head.prev_ = &head;
+    while (list.next_ != &list) {
+        auto timer = list.next_;
+        Unlink(*timer);
+        Link(*timer);
+    }
+    list.next_ = list.prev_ = nullptr;
+}
+
+std::size_t TimerWheel::Advance(std::chrono::steady_clock::time_point now) noexcept {
+
+    std::unique_lock lk(mutex_);
+    if (now < start_) {
+        return 0;
+    }
+    uint64_t target = static_cast<uint64_t>((now - start_) / tick_);
+    if (size_ == 0) {
+        now_ = std::max(now_, target + 1);
+        return 0;
+    }
+
+    std::size_t fired = 0;
+    while (now_ <= target) {
+        uint32_t index = now_ & (slots - 1);
+        for (uint32_t level = 1; level < levels && index == 0; ++level) {
+            Cascade(level);
+            index = (now_ >> (slot_bits * level)) & (slots - 1);
+        }
+
+        auto& head = wheel_[0][now_ & (slots - 1)].head;
+        now_++;
+        while (head.next_ != &head) {
+            auto timer = head.next_;
+            Unlink(*timer);
+            size_--;
+            fired++;
+            std::chrono::milliseconds next{ 0 };
+            try {
+                next = timer->cb_();
+            }
+            catch (std::exception& ex) {
+                ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
+            }
+            if (next.count() > 0) {
+                uint64_t ticks = static_cast<uint64_t>((next.count() + tick_.count() - 1) / tick_.count());
+                timer->expires_ = now_ - 1 + std::min<uint64_t>(std::max<uint64_t>(ticks, 1), max_ticks);
+                Link(*timer);
+                size_++;
+            }
+        }
+    }
+    return fired;
+}
+
+std::size_t TimerWheel::GetSize() const noexcept {
+    std::unique_lock lk(mutex_);
+    return size_;
+}
@@ -0,0 +1,102 @@
+/*****************************************************************
+ *  @file       TimerWheel.h
+ *  @brief      Hashed hierarchical timer wheel for per-connection
+ *              deadlines
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+#pragma once
+
+/* std C++ lib headers */
+#include <array>
+#include <mutex>
+#include <chrono>
+#include <functional>
+#include <cstdint>
+
+/* Four levels of 256 slots, level N slot spans 256^N ticks. Timer is put
+ * into the level its distance fits, when lower level wraps around the next
+ * slot of upper level is cascaded down, so every timer is moved at most
+ * three times and scheduling, cancel and expiry are O(1). Timers are
+ * intrusive, owner keeps timer_t as a member and no allocation happens
+ * per schedule. Callbacks run under wheel lock and must not touch the
+ * wheel, timer is re-armed by returning the next delay instead. */
+class TimerWheel {
+
+public:
+
+    /* delay until the next expiry, zero leaves timer stopped */
+    using callback_t = std::function<std::chrono::milliseconds()>;
+
+    class timer_t {
+
+        friend class TimerWheel;
+
+    public:
+
+        timer_t() = default;
+        explicit timer_t(callback_t&& cb) : cb_(std::move(cb)) {}
+        timer_t(const timer_t&) = delete;
+        timer_t& operator=(const timer_t&) = delete;
+
+        /* waits for running callback of this timer, so owner may go right after */
+        ~timer_t() {
+            if (wheel_) {
+                wheel_->Cancel(*this);
+            }
+        }
+
+        void SetCallback(callback_t&& cb) { cb_ = std::move(cb); }
+        TimerWheel* GetWheel() const noexcept { return wheel_; }
+
+    private:
+
+        timer_t* prev_ = nullptr;
+        timer_t* next_ = nullptr;
+        uint64_t expires_ = 0;
+        TimerWheel* wheel_ = nullptr;
+        callback_t cb_;
+    };
+
+    TimerWheel() = delete;
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    TimerWheel(std::chrono::milliseconds tick, std::chrono::steady_clock::time_point start);
+    ~TimerWheel();
+
+    /* rounds delay up to whole ticks, scheduled timer is moved */
+    void Schedule(timer_t& timer, std::chrono::milliseconds delay) noexcept;
+    void Cancel(timer_t& timer) noexcept;
+
+    /* fires every timer due up to now, returns number of fired timers */
+    std::size_t Advance(std::chrono::steady_clock::time_point now) noexcept;
+
+    std::size_t GetSize() const noexcept;
+    std::chrono::milliseconds GetTick() const noexcept { return tick_; }
+
+private:
+
+    static constexpr uint32_t slot_bits = 8;
+    static constexpr uint32_t slots = 1u << slot_bits;
+    static constexpr uint32_t levels = 4;
+    static constexpr uint64_t max_ticks = (1ull << (slot_bits * levels)) - 1;
+
+    /* slot is circular list around sentinel */
+    struct slot_t {
+        timer_t head;
+        slot_t() { head.prev_ = head.next_ = &head; }
+    };
+
+    const std::chrono::milliseconds tick_;
+    const std::chrono::steady_clock::time_point start_;
+    uint64_t now_ = 0;          // next tick to be processed
+    std::size_t size_ = 0;
+    std::array<std::array<slot_t, slots>, levels> wheel_;
+    mutable std::mutex mutex_;
+
+    void Link(timer_t& timer) noexcept;
+    static void Unlink(timer_t& timer) noexcept;
+    void Cascade(uint32_t level) noexcept;
+};
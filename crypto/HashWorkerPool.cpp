@@ -0,0 +1,118 @@
+/*****************************************************************
+ *  @file       HashWorkerPool.cpp
+ *  @brief      Bounded pool of CPU threads dedicated to credential
+ *              verification implementation
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+
+#include "HashWorkerPool.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include <boost/format.hpp>
+
+#include "../log/Logger.h"
+#include "../log/Metrics.h"
+
+namespace {
+    Metrics::Gauge& queueDepth = Metrics::GetInstance()->GetGauge("hash_queue_depth");
+    Metrics::Counter& rejectedQueue = Metrics::GetInstance()->GetCounter("hash_rejected_total{reason=\"queue_full\"}");
+    Metrics::Counter& rejectedUser = Metrics::GetInstance()->GetCounter("hash_rejected_total{reason=\"user_limit\"}");
+    Metrics::Histogram& waitLatency = Metrics::GetInstance()->GetHistogram("hash_queue_wait_us");
+    Metrics::Histogram& jobLatency = Metrics::GetInstance()->GetHistogram("hash_job_latency_us");
+}
+
+HashWorkerPool::HashWorkerPool(uint32_t workers, uint32_t maxQueueSize, uint32_t perUserLimit) :
+    maxQueueSize_(maxQueueSize),
+    perUserLimit_(std::max<uint32_t>(perUserLimit, 1))
+{
+    ConsoleLogger::Debug(boost::str(boost::format("Construct HashWorkerPool class, %1% workers") % workers));
+
+    for (uint32_t i = 0; i < std::max<uint32_t>(workers, 1); ++i) {
+        workers_.emplace_back([&]() { Worker(); });
+    }
+}
+
+HashWorkerPool::~HashWorkerPool() {
+    {
+        std::unique_lock lk(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+    ConsoleLogger::Debug("Destruct HashWorkerPool class");
+}
+
+HashWorkerPool::submit_t HashWorkerPool::Submit(const std::string& user, job_t&& job) noexcept {
+
+    try {
+        {
+            std::unique_lock lk(mutex_);
+            if (stop_ || queue_.size() >= maxQueueSize_) {
+                rejectedQueue.Inc();
+                return submit_t::queue_full;
+            }
+            auto& count = inflight_[user];
+            if (count >= perUserLimit_) {
+                rejectedUser.Inc();
+                return submit_t::user_limit;
+            }
+            count++;
+
+            auto enqueued = std::chrono::steady_clock::now();
+            queue_.push_back(task_t{ user, [job = std::move(job), enqueued]() {
+                waitLatency.Observe(std::chrono::steady_clock::now() - enqueued);
+                job();
+            }});
+            queueDepth.Set(static_cast<int64_t>(queue_.size()));
+        }
+        cv_.notify_one();
+        return submit_t::accepted;
+    }
+    catch (std::exception& ex) {
+        ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
+    }
+    return submit_t::queue_full;
+}
+
+std::size_t HashWorkerPool::GetQueueSize() const noexcept {
+    std::unique_lock lk(mutex_);
+    return queue_.size();
+}
+
+void HashWorkerPool::Worker() noexcept {
+
+    for (;;) {
+        task_t task;
+        {
+            std::unique_lock lk(mutex_);
+            cv_.wait(lk, [&]() { return stop_ || !queue_.empty(); });
+            /* queued jobs are drained before exit, their callers wait for an answer */
+            if (queue_.empty()) {
+                break;
+            }
+            task = std::move(queue_.front());
+            queue_.pop_front();
+            queueDepth.Set(static_cast<int64_t>(queue_.size()));
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        try {
+            task.job();
+        }
+        catch (std::exception& ex) {
+            ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
+        }
+        jobLatency.Observe(std::chrono::steady_clock::now() - start);
+
+        std::unique_lock lk(mutex_);
+        if (auto it = inflight_.find(task.user); it != inflight_.end() && --it->second == 0) {
+            inflight_.erase(it);
+        }
+    }
+}
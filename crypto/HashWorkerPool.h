@@ -0,0 +1,68 @@
+/*****************************************************************
+ *  @file       HashWorkerPool.h
+ *  @brief      Bounded pool of CPU threads dedicated to credential
+ *              verification
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+#pragma once
+
+/* std C++ lib headers */
+#include <string>
+#include <deque>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <cstdint>
+
+/* separate from asio io threads and DataProcess dispatcher, so a login
+ * flood can only saturate these threads and never message delivery */
+class HashWorkerPool {
+
+public:
+
+    using job_t = std::function<void()>;
+
+    enum class submit_t {
+        accepted,
+        queue_full,
+        user_limit, // too many verifications in flight for the same user
+    };
+
+    HashWorkerPool() = delete;
+    HashWorkerPool(const HashWorkerPool&) = delete;
+    HashWorkerPool& operator=(const HashWorkerPool&) = delete;
+
+    HashWorkerPool(uint32_t workers, uint32_t maxQueueSize, uint32_t perUserLimit);
+    ~HashWorkerPool();
+
+    /* never blocks, rejected jobs are not executed */
+    submit_t Submit(const std::string& user, job_t&& job) noexcept;
+
+    std::size_t GetQueueSize() const noexcept;
+
+private:
+
+    struct task_t {
+        std::string user;
+        job_t job;
+    };
+
+    const uint32_t maxQueueSize_;
+    const uint32_t perUserLimit_;
+
+    std::deque<task_t> queue_;
+    /* queued and running jobs per user */
+    std::unordered_map<std::string, uint32_t> inflight_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+
+    std::vector<std::thread> workers_;
+
+    void Worker() noexcept;
+};
@@ -0,0 +1,90 @@
+/*****************************************************************
+ *  @file       PasswordHash.cpp
+ *  @brief      Salted PBKDF2 password hashing implementation
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+
+#include "PasswordHash.h"
+
+#include <stdexcept>
+#include <vector>
+
+#include <boost/algorithm/string.hpp>
+
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <openssl/crypto.h>
+
+const std::string PasswordHash::scheme{ "pbkdf2-sha256" };
+
+std::string PasswordHash::Derive(const std::string& password, const std::string& salt, uint32_t iterations) {
+
+    std::string out(hash_size, '\0');
+    if (PKCS5_PBKDF2_HMAC(password.data(), static_cast<int>(password.size()),
+        reinterpret_cast<const unsigned char*>(salt.data()), static_cast<int>(salt.size()),
+        static_cast<int>(iterations), EVP_sha256(),
+        static_cast<int>(out.size()), reinterpret_cast<unsigned char*>(out.data())) != 1) {
+        throw std::runtime_error("PBKDF2 derivation failed");
+    }
+    return out;
+}
+
+std::string PasswordHash::Hash(const std::string& password, uint32_t iterations) {
+
+    std::string salt(salt_size, '\0');
+    if (RAND_bytes(reinterpret_cast<unsigned char*>(salt.data()), static_cast<int>(salt.size())) != 1) {
+        throw std::runtime_error("Random salt generation failed");
+    }
+    return scheme + "$" + std::to_string(iterations) + "$" + ToHex(salt) + "$" +
+        ToHex(Derive(password, salt, iterations));
+}
+
+bool PasswordHash::IsHashed(const std::string& stored) noexcept {
+    return stored.compare(0, scheme.size() + 1, scheme + "$") == 0;
+}
+
+bool PasswordHash::Verify(const std::string& password, const std::string& stored) {
+
+    if (!IsHashed(stored)) {
+        return stored.size() == password.size() &&
+            CRYPTO_memcmp(stored.data(), password.data(), password.size()) == 0;
+    }
+
+    std::vector<std::string> parts;
+    boost::split(parts, stored, boost::is_any_of("$"));
+    if (parts.size() != 4) {
+        return false;
+    }
+
+    uint32_t iterations = static_cast<uint32_t>(std::stoul(parts[1]));
+    std::string expected = FromHex(parts[3]);
+    std::string actual = Derive(password, FromHex(parts[2]), iterations);
+
+    return expected.size() == actual.size() &&
+        CRYPTO_memcmp(expected.data(), actual.data(), actual.size()) == 0;
+}
+
+std::string PasswordHash::ToHex(const std::string& data) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(data.size() * 2);
+    for (unsigned char c : data) {
+        hex.push_back(digits[c >> 4]);
+        hex.push_back(digits[c & 0x0f]);
+    }
+    return hex;
+}
+
+std::string PasswordHash::FromHex(const std::string& hex) {
+    if (hex.size() % 2) {
+        throw std::invalid_argument("Odd length of hex string");
+    }
+    std::string data;
+    data.reserve(hex.size() / 2);
+    for (std::size_t i = 0; i < hex.size(); i += 2) {
+        data.push_back(static_cast<char>(std::stoi(hex.substr(i, 2), nullptr, 16)));
+    }
+    return data;
+}
@@ -0,0 +1,38 @@
+/*****************************************************************
+ *  @file       PasswordHash.h
+ *  @brief      Salted PBKDF2 password hashing through OpenSSL
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+#pragma once
+
+/* std C++ lib headers */
+#include <string>
+#include <cstdint>
+
+/* stored format: pbkdf2-sha256$<iterations>$<salt hex>$<hash hex> */
+class PasswordHash {
+
+public:
+
+    static constexpr uint32_t default_iterations = 100000;
+
+    static std::string Hash(const std::string& password, uint32_t iterations = default_iterations);
+
+    /* CPU heavy, must not be called from io or dispatcher threads.
+     * Records without scheme prefix are legacy plain text passwords */
+    static bool Verify(const std::string& password, const std::string& stored);
+
+    static bool IsHashed(const std::string& stored) noexcept;
+
+private:
+
+    static constexpr std::size_t salt_size = 16;
+    static constexpr std::size_t hash_size = 32;
+    static const std::string scheme;
+
+    static std::string Derive(const std::string& password, const std::string& salt, uint32_t iterations);
+    static std::string ToHex(const std::string& data);
+    static std::string FromHex(const std::string& hex);
+};
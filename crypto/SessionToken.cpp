@@ -0,0 +1,106 @@
+/*****************************************************************
+ *  @file       SessionToken.cpp
+ *  @brief      Signed expiring session tokens implementation
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+
+#include "SessionToken.h"
+
+#include <stdexcept>
+#include <iterator>
+
+#include <boost/algorithm/hex.hpp>
+#include <boost/format.hpp>
+
+#include <openssl/hmac.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <openssl/crypto.h>
+
+#include "../log/Logger.h"
+
+std::shared_ptr<SessionToken> SessionToken::st_ = nullptr;
+
+SessionToken::SessionToken() : key_(key_size, '\0'), ttl_(default_ttl) {
+    ConsoleLogger::Debug("Construct SessionToken class");
+    if (RAND_bytes(reinterpret_cast<unsigned char*>(key_.data()), static_cast<int>(key_.size())) != 1) {
+        throw std::runtime_error("Session key generation failed");
+    }
+}
+
+SessionToken::~SessionToken() {
+    ConsoleLogger::Debug("Destruct SessionToken class");
+}
+
+void SessionToken::Configure(const std::string& hexKey, std::chrono::seconds ttl) {
+    if (!hexKey.empty()) {
+        std::string key;
+        boost::algorithm::unhex(hexKey, std::back_inserter(key));
+        if (key.size() < 16) {
+            throw std::invalid_argument("Session key is shorter than 128 bits");
+        }
+        key_ = std::move(key);
+    }
+    if (ttl.count() > 0) {
+        ttl_ = ttl;
+    }
+}
+
+std::string SessionToken::Sign(const std::string& payload) const {
+    unsigned char mac[EVP_MAX_MD_SIZE];
+    unsigned int macSize = 0;
+    HMAC(EVP_sha256(), key_.data(), static_cast<int>(key_.size()),
+        reinterpret_cast<const unsigned char*>(payload.data()), payload.size(), mac, &macSize);
+    return std::string{ reinterpret_cast<char*>(mac), macSize };
+}
+
+std::string SessionToken::Issue(uint32_t userId, const std::string& login) const {
+
+    auto expiresAt = std::chrono::duration_cast<std::chrono::seconds>(
+        (std::chrono::system_clock::now() + ttl_).time_since_epoch()).count();
+    std::string payload = boost::str(boost::format("v1:%1%:%2%:%3%") % userId % expiresAt % login);
+
+    return boost::algorithm::hex_lower(payload) + "." + boost::algorithm::hex_lower(Sign(payload));
+}
+
+std::optional<SessionToken::claims_t> SessionToken::Verify(const std::string& token) const {
+
+    try {
+        auto dot = token.find('.');
+        if (dot == std::string::npos) {
+            return std::nullopt;
+        }
+        std::string payload, mac;
+        boost::algorithm::unhex(token.begin(), token.begin() + dot, std::back_inserter(payload));
+        boost::algorithm::unhex(token.begin() + dot + 1, token.end(), std::back_inserter(mac));
+
+        std::string expected = Sign(payload);
+        if (mac.size() != expected.size() || CRYPTO_memcmp(mac.data(), expected.data(), mac.size()) != 0) {
+            return std::nullopt;
+        }
+
+        /* v1:<user id>:<expiration>:<login>, login may contain ':' */
+        auto first = payload.find(':'), second = payload.find(':', first + 1), third = payload.find(':', second + 1);
+        if (payload.compare(0, first, "v1") != 0 || third == std::string::npos) {
+            return std::nullopt;
+        }
+        claims_t claims{
+            static_cast<uint32_t>(std::stoul(payload.substr(first + 1, second - first - 1))),
+            payload.substr(third + 1),
+            std::stoull(payload.substr(second + 1, third - second - 1))
+        };
+
+        auto now = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        if (claims.expiresAt <= static_cast<uint64_t>(now)) {
+            return std::nullopt;
+        }
+        return claims;
+    }
+    catch (std::exception& ex) {
+        /* malformed hex or numbers */
+        return std::nullopt;
+    }
+}
@@ -0,0 +1,62 @@
+/*****************************************************************
+ *  @file       SessionToken.h
+ *  @brief      Signed expiring session tokens for reconnect
+ *              without database access
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+#pragma once
+
+/* std C++ lib headers */
+#include <string>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <optional>
+#include <cstdint>
+
+/* token: hex(payload) "." hex(HMAC-SHA256(key, payload)),
+ * payload: "v1:<user id>:<expiration unix time>:<login>" */
+class SessionToken {
+
+public:
+
+    struct claims_t {
+        uint32_t userId;
+        std::string login;
+        uint64_t expiresAt; // unix time, s
+    };
+
+    SessionToken(const SessionToken&) = delete;
+    SessionToken& operator=(const SessionToken&) = delete;
+
+    SessionToken();
+    ~SessionToken();
+
+    static const std::shared_ptr<SessionToken>& GetInstance() {
+        static std::once_flag once;
+        std::call_once(once, []() { st_ = std::make_shared<SessionToken>(); });
+        return st_;
+    }
+
+    /* hex key shared by all server instances; without it a random key is
+     * generated and tokens don't survive restart */
+    void Configure(const std::string& hexKey, std::chrono::seconds ttl);
+
+    std::string Issue(uint32_t userId, const std::string& login) const;
+    /* checks signature and expiration, no database access */
+    std::optional<claims_t> Verify(const std::string& token) const;
+
+private:
+
+    static constexpr std::size_t key_size = 32;
+    const std::chrono::seconds default_ttl{ 24 * 60 * 60 };
+
+    std::string key_;
+    std::chrono::seconds ttl_;
+
+    static std::shared_ptr<SessionToken> st_;
+
+    std::string Sign(const std::string& payload) const;
+};
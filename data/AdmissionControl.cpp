@@ -0,0 +1,146 @@
+/*****************************************************************
+ *  @file       AdmissionControl.cpp
+ *  @brief      Queue delay based overload control implementation
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+
+#include "AdmissionControl.h"
+
+#include <algorithm>
+
+#include <boost/format.hpp>
+
+#include "../log/Logger.h"
+#include "../log/Metrics.h"
+
+namespace {
+    Metrics::Histogram& sojournTime = Metrics::GetInstance()->GetHistogram("dispatch_sojourn_us");
+    Metrics::Gauge& sheddingState = Metrics::GetInstance()->GetGauge("dispatch_shedding");
+    Metrics::Gauge& overloadState = Metrics::GetInstance()->GetGauge("dispatch_overloaded");
+    Metrics::Counter& sheddingEpisodes = Metrics::GetInstance()->GetCounter("dispatch_shedding_episodes_total");
+    Metrics::Counter& rejectedMessages = Metrics::GetInstance()->GetCounter("dispatch_rejected_total{reason=\"queue_full\"}");
+    Metrics::Counter& rejectedConnections = Metrics::GetInstance()->GetCounter("connections_rejected_total{reason=\"overload\"}");
+}
+
+std::shared_ptr<AdmissionControl> AdmissionControl::ac_ = nullptr;
+
+AdmissionControl::AdmissionControl() :
+    shards_(1)
+{
+    ConsoleLogger::Debug("Construct AdmissionControl class");
+}
+
+AdmissionControl::~AdmissionControl() {
+    ConsoleLogger::Debug("Destruct AdmissionControl class");
+}
+
+void AdmissionControl::Configure(const config_t& config) {
+    config_ = config;
+    Reset();
+    ConsoleLogger::Info(boost::str(boost::format("Admission control: target delay %1% ms, interval %2% ms, "
+        "reject after %3% ms, queue limit %4%") % config_.target.count() % config_.interval.count() %
+        config_.rejectAfter.count() % config_.maxQueue));
+}
+
+void AdmissionControl::SetShards(std::size_t shards) {
+    shards_.resize(std::max<std::size_t>(shards, 1));
+    Reset();
+}
+
+void AdmissionControl::Reset() noexcept {
+    for (auto& shard : shards_) {
+        shard = shard_t{};
+    }
+    sheddingShards_ = overloadedShards_ = 0;
+    overloadShed_ = 0;
+    sheddingState.Set(0);
+    overloadState.Set(0);
+}
+
+/* pause between shedding episodes which ends overload */
+AdmissionControl::clock_t::duration AdmissionControl::Calm() const noexcept {
+    return config_.rejectAfter.count() > 0 ? clock_t::duration(config_.rejectAfter) : clock_t::duration(config_.interval * 10);
+}
+
+/* delay is below target */
+void AdmissionControl::Relax(shard_t& shard, clock_t::time_point now) noexcept {
+    shard.firstAbove = clock_t::time_point{};
+    if (shard.shedding) {
+        shard.shedding = false;
+        sheddingState.Set(--sheddingShards_);
+    }
+    if (shard.lastShed != clock_t::time_point{} && now - shard.lastShed >= Calm()) {
+        shard.lastShed = clock_t::time_point{};
+        if (shard.overloaded) {
+            shard.overloaded = false;
+            overloadState.Set(--overloadedShards_);
+        }
+        ConsoleLogger::Info("Dispatcher delay is back below target, shedding stopped");
+    }
+}
+
+bool AdmissionControl::OnDequeue(std::size_t index, clock_t::duration sojourn, clock_t::time_point now) noexcept {
+
+    auto& shard = shards_[index % shards_.size()];
+    sojournTime.Observe(sojourn);
+    /* shard got no work for a reject period since it shed, that overload is over whatever delay is now */
+    if (shard.lastShed != clock_t::time_point{} && now - shard.lastShed >= Calm()) {
+        Relax(shard, now);
+    }
+    if (sojourn < config_.target) {
+        Relax(shard, now);
+        return false;
+    }
+
+    if (shard.firstAbove == clock_t::time_point{}) {
+        shard.firstAbove = now + config_.interval;
+        return shard.shedding;
+    }
+    if (!shard.shedding && now >= shard.firstAbove) {
+        shard.shedding = true;
+        sheddingState.Set(++sheddingShards_);
+        sheddingEpisodes.Inc();
+        if (shard.lastShed == clock_t::time_point{}) {
+            shard.overloadSince = now;
+            ConsoleLogger::Info(boost::str(boost::format("Dispatcher delay %1% ms stays above target, "
+                "shedding low priority requests") % std::chrono::duration_cast<std::chrono::milliseconds>(sojourn).count()));
+        }
+    }
+    if (shard.shedding) {
+        shard.lastShed = now;
+        if (!shard.overloaded && config_.rejectAfter.count() > 0 && now - shard.overloadSince >= config_.rejectAfter) {
+            shard.overloaded = true;
+            overloadState.Set(++overloadedShards_);
+            ConsoleLogger::Info("Dispatcher is overloaded, new connections are refused");
+        }
+        if (shard.overloaded) {
+            overloadShed_.store(now.time_since_epoch().count(), std::memory_order_relaxed);
+        }
+    }
+    return shard.shedding;
+}
+
+void AdmissionControl::OnIdle(std::size_t index, clock_t::time_point now) noexcept {
+    auto& shard = shards_[index % shards_.size()];
+    if (shard.firstAbove != clock_t::time_point{} || shard.lastShed != clock_t::time_point{}) {
+        Relax(shard, now);
+    }
+}
+
+bool AdmissionControl::AdmitMessage(std::size_t queued) noexcept {
+    if (config_.maxQueue && queued >= config_.maxQueue) {
+        rejectedMessages.Inc();
+        return false;
+    }
+    return true;
+}
+
+bool AdmissionControl::AdmitConnection(clock_t::time_point now) noexcept {
+    if (IsOverloaded(now)) {
+        rejectedConnections.Inc();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,99 @@
+/*****************************************************************
+ *  @file       AdmissionControl.h
+ *  @brief      Queue delay based overload control of dispatcher
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+#pragma once
+
+/* std C++ lib headers */
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+/* CoDel style detection: queue length says nothing about how long messages
+ * wait, so dispatcher reports sojourn time of every dequeued message. Delay
+ * staying above target for a whole interval means standing queue rather
+ * than a burst, dispatcher sheds low priority requests until delay falls
+ * below target again. Shedding drains the queue quickly, so under overload
+ * it comes and goes; episodes closer than reject period belong to the same
+ * overload, and overload lasting the whole reject period makes acceptor
+ * refuse new connections until a reject period passes without shedding.
+ * Every dispatcher shard is judged by its own queue, acceptor refuses
+ * connections while any shard is overloaded. Shard learns about calm only
+ * from its own dequeues, and a shard which got no work since shedding
+ * never does, so overload also expires by time: a reject period after the
+ * last shedding of an overloaded shard. Queue limit is the last resort
+ * against memory exhaustion. */
+class AdmissionControl {
+
+public:
+
+    using clock_t = std::chrono::steady_clock;
+
+    struct config_t {
+        std::chrono::milliseconds target{ 5 };          // acceptable standing queue delay
+        std::chrono::milliseconds interval{ 100 };      // delay above target this long starts shedding
+        std::chrono::milliseconds rejectAfter{ 1000 };  // shedding this long refuses connections, 0 never
+        std::size_t maxQueue = 100000;                  // 0 unlimited
+    };
+
+    AdmissionControl(const AdmissionControl&) = delete;
+    AdmissionControl& operator=(const AdmissionControl&) = delete;
+
+    AdmissionControl();
+    ~AdmissionControl();
+
+    static const std::shared_ptr<AdmissionControl>& GetInstance() {
+        static std::once_flag once;
+        std::call_once(once, []() { ac_ = std::make_shared<AdmissionControl>(); });
+        return ac_;
+    }
+
+    /* before dispatcher starts */
+    void Configure(const config_t& config);
+    void SetShards(std::size_t shards);
+    const config_t& GetConfig() const noexcept { return config_; }
+
+    /* owner thread of dispatcher shard only; returns whether low priority work must be shed */
+    bool OnDequeue(std::size_t shard, clock_t::duration sojourn, clock_t::time_point now = clock_t::now()) noexcept;
+    /* dispatcher shard found its queue empty */
+    void OnIdle(std::size_t shard, clock_t::time_point now = clock_t::now()) noexcept;
+
+    /* producers, false rejects the message */
+    bool AdmitMessage(std::size_t queued) noexcept;
+    /* acceptor, false closes accepted socket */
+    bool AdmitConnection(clock_t::time_point now = clock_t::now()) noexcept;
+
+    bool IsShedding() const noexcept { return sheddingShards_.load(std::memory_order_relaxed) > 0; }
+    bool IsOverloaded(clock_t::time_point now = clock_t::now()) const noexcept {
+        return overloadedShards_.load(std::memory_order_relaxed) > 0 &&
+            now - clock_t::time_point(clock_t::duration(overloadShed_.load(std::memory_order_relaxed))) < Calm();
+    }
+
+private:
+
+    /* shards are keyed by conversation, each one measures its own queue */
+    struct shard_t {
+        clock_t::time_point firstAbove{};       // when delay above target turns into shedding, epoch if below
+        clock_t::time_point overloadSince{};    // first shedding episode of current overload
+        clock_t::time_point lastShed{};         // epoch if no overload
+        bool shedding = false;
+        bool overloaded = false;
+    };
+
+    config_t config_;
+    std::vector<shard_t> shards_;
+    std::atomic_size_t sheddingShards_{ 0 };
+    std::atomic_size_t overloadedShards_{ 0 };
+    std::atomic<clock_t::rep> overloadShed_{ 0 };   // last shedding of an overloaded shard
+
+    static std::shared_ptr<AdmissionControl> ac_;
+
+    clock_t::duration Calm() const noexcept;
+    void Relax(shard_t& shard, clock_t::time_point now) noexcept;
+    void Reset() noexcept;
+};
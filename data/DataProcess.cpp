@@ -10,32 +10,145 @@
 #include "DataProcess.h"
 #include "string.h"
 
+#include <algorithm>
+
 #include <boost/lexical_cast.hpp>
 #include <boost/property_tree/json_parser.hpp>
 
 #include "MessageBroker.h"
+#include "MessageWal.h"
+#include "AdmissionControl.h"
 #include "../core/ConnectionManager.h"
 #include "../core/AsyncClient.h"
 #include "../format/json.h"
+#include "../crypto/SessionToken.h"
+#include "../db/KafkaProcess.h"
+#include "../log/Metrics.h"
+
+namespace {
+    Metrics::Counter& shedUsersList = Metrics::GetInstance()->GetCounter("dispatch_shed_total{type=\"users_list\"}");
+    Metrics::Counter& shedHistory = Metrics::GetInstance()->GetCounter("dispatch_shed_total{type=\"history\"}");
+    Metrics::Counter& rejectedGuest = Metrics::GetInstance()->GetCounter("dispatch_rejected_total{reason=\"guest\"}");
+    Metrics::Histogram* laneSojourn[PriorityLanes<DataProcess::record_t>::lanes_count] = {
+        &Metrics::GetInstance()->GetHistogram("dispatch_lane_sojourn_us{lane=\"control\"}"),
+        &Metrics::GetInstance()->GetHistogram("dispatch_lane_sojourn_us{lane=\"interactive\"}"),
+        &Metrics::GetInstance()->GetHistogram("dispatch_lane_sojourn_us{lane=\"bulk\"}"),
+    };
+
+    message_lane_t LaneOf(JsonHandler::json_req_t type) {
+        switch (type) {
+            case JsonHandler::json_req_t::authentication_message:
+            case JsonHandler::json_req_t::heartbeat_message:
+                return message_lane_t::control;
+            case JsonHandler::json_req_t::users_list_message:
+            case JsonHandler::json_req_t::history_message:
+                return message_lane_t::bulk;
+            default:
+                return message_lane_t::interactive;
+        }
+    }
+}
 
 void DataProcess::StartDataProcessor() {
-    std::thread{ [&]() {
-        HandleInOutMessages();
-    }}.detach();
+
+    auto& scheduler = *TaskScheduler::GetInstance();
+    auto shards = scheduler.GetThreads() * shards_per_thread;
+    AdmissionControl::GetInstance()->SetShards(shards);
+    ioq_ = std::make_unique<DispatchShards<record_t>>(scheduler, shards,
+        [this](std::size_t shard, record_t&& record) { ProcessNewMessage(shard, std::move(record)); },
+        [](std::size_t shard) { AdmissionControl::GetInstance()->OnIdle(shard); });
+    /* replies go out by recipient, so a reply never overtakes earlier one to the same client */
+    MessageBroker::GetInstance()->Start(scheduler, shards, [this](MessageBroker::record_t&& record) {
+        SendLastMessage(std::move(record));
+    });
+    ConsoleLogger::Info(boost::str(boost::format("Dispatcher started with %1% shards on %2% threads") %
+        shards % scheduler.GetThreads()));
+}
+
+void DataProcess::StopDataProcessor() noexcept {
+    if (ioq_) {
+        ioq_->Stop();
+    }
+    MessageBroker::GetInstance()->Stop();
+}
+
+bool DataProcess::FlushDataProcessor(std::chrono::steady_clock::time_point deadline) noexcept {
+    if (ioq_ && !ioq_->Flush(deadline)) {
+        return false;
+    }
+    return MessageBroker::GetInstance()->Flush(deadline);
 }
 
 void DataProcess::PushNewMessage(const MessageBroker::T id, std::string&& msg) const noexcept {
 
     try {
-        std::unique_lock lk(mutex_);
-        ioq_.push(std::make_pair<const MessageBroker::T, std::string>(std::move(id), std::move(msg)));
+        auto parsed = Message::Parse(msg);
+        if (!parsed) {
+            return;
+        }
+        if (!parsed->SetSender(id, id >= ConnectionManager::FIRST_GUEST_ID)) {
+            rejectedGuest.Inc();
+            MessageBroker::GetInstance()->PushMessage(id,
+                ConstructRejectedMessage(id, *parsed, "not authenticated"), message_lane_t::control);
+            return;
+        }
+        if (!AdmissionControl::GetInstance()->AdmitMessage(msgInQueue)) {
+            RejectMessage(id, *parsed);
+            return;
+        }
+        auto lane = LaneOf(parsed->type);
+        /* both directions of conversation share a shard, requests without peer go by connection */
+        uint64_t key = id;
+        if (parsed->type == JsonHandler::json_req_t::user_message) {
+            key = IMessageStorage::ConversationKey(parsed->src, parsed->dst);
+        }
         msgInQueue++;
+        ioq_->Push(key, lane, record_t{ id, std::move(*parsed), std::chrono::steady_clock::now(), lane });
+    }
+    catch (std::exception& ex) {
+        ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
+    }
+}
+
+/* queue is full: requests waiting for an answer get it from io thread, without dispatcher */
+void DataProcess::RejectMessage(const MessageBroker::T& id, const Message& msg) const noexcept {
+
+    try {
+        switch (msg.type) {
+            case JsonHandler::json_req_t::authentication_message:
+                MessageBroker::GetInstance()->PushMessage(id,
+                    ConstructAuthResponse(id, PostgresProcessor::auth_status_t::throttled, ""), message_lane_t::control);
+                break;
+            case JsonHandler::json_req_t::user_message:
+                MessageBroker::GetInstance()->PushMessage(id,
+                    ConstructRejectedMessage(id, msg, "service unavailable"), message_lane_t::control);
+                break;
+            case JsonHandler::json_req_t::history_message:
+                ProcessHistoryRequest(id, msg, true);
+                break;
+            default:
+                /* users list and heartbeat are repeated by client anyway */
+                break;
+        }
     }
     catch (std::exception& ex) {
         ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
     }
 }
 
+/* chat message comes back to its sender marked as not delivered, src is the intended recipient */
+std::string DataProcess::ConstructRejectedMessage(const MessageBroker::T& id, const Message& msg, const std::string& reason) const {
+
+    namespace pt = boost::property_tree;
+    pt::ptree response;
+    response.put(JsonHandler::msg_identificator_token, static_cast<uint32_t>(msg.type));
+    response.put(JsonHandler::dst_user_msg_token, id);
+    response.put(JsonHandler::src_user_msg_token, msg.dst);
+    response.put(JsonHandler::msg_status_token, "rejected");
+    response.put(JsonHandler::user_msg_token, reason);
+    return jsonHandler->ConvertToString(response);
+}
+
 std::string DataProcess::ConstructMessage(const MessageBroker::T& id, const std::string& message, JsonHandler::json_req_t&& json_msg_type) {
 
     namespace pt = boost::property_tree;
@@ -60,6 +173,35 @@ std::string DataProcess::ConstructMessage(const MessageBroker::T& id, std::strin
     return res;
 }
 
+std::string DataProcess::ConstructAuthResponse(const MessageBroker::T& id, PostgresProcessor::auth_status_t status,
+    const std::string& sessionToken) const {
+
+    namespace pt = boost::property_tree;
+    pt::ptree ptree;
+
+    ptree.put(JsonHandler::msg_identificator_token, static_cast<uint32_t>(JsonHandler::json_req_t::authentication_message));
+    ptree.put(JsonHandler::dst_user_msg_token, id);
+    ptree.put(JsonHandler::auth_status_token,
+        status == PostgresProcessor::auth_status_t::approved ? "approved" : "denied");
+
+    switch (status) {
+        case PostgresProcessor::auth_status_t::approved:
+            ptree.put(JsonHandler::session_token_token, sessionToken);
+            ptree.put(JsonHandler::user_msg_token, "");
+            break;
+        case PostgresProcessor::auth_status_t::unavailable:
+            ptree.put(JsonHandler::user_msg_token, "service unavailable");
+            break;
+        case PostgresProcessor::auth_status_t::throttled:
+            ptree.put(JsonHandler::user_msg_token, "too many attempts, try later");
+            break;
+        default:
+            ptree.put(JsonHandler::user_msg_token, "");
+            break;
+    }
+    return jsonHandler->ConvertToString(ptree);
+}
+
 std::string DataProcess::GetUsersListInJson(std::string& usersList, const size_t usersCount) {
 
     namespace pt = boost::property_tree;
@@ -74,57 +216,63 @@ std::string DataProcess::GetUsersListInJson(std::string& usersList, const size_t
     return res;
 }
 
-void DataProcess::HandleInOutMessages() const noexcept {
-    
-    while (ConnectionManager::GetInstance()->ManagerIsActive()) {
-        if (msgInQueue > 0) {
-            ProcessNewMessage();
-        }
-        if (!MessageBroker::GetInstance()->IsQueueEmpty()) {
-            SendLastMessage();
-        }
-        std::this_thread::sleep_for(std::chrono::milliseconds(delay));
-    }
-}
-
 // @brief correct logic, need to retransmit received message to another user (also keep in db)
-void DataProcess::ProcessUserMessage(const boost::property_tree::ptree& tree) const noexcept {
+void DataProcess::ProcessUserMessage(Message&& msg) const noexcept {
 
     try {
-        mongoUserMessagesStorage->InsertNewMessage(tree);
-
-        std::string userId = jsonHandler->ParseTreeParam<std::string>(tree, const_cast<const std::string&>(JsonHandler::dst_user_msg_token));
-        std::string userMsg = jsonHandler->ParseTreeParam<std::string>(tree, JsonHandler::user_msg_token);
-        uint32_t id = boost::lexical_cast<MessageBroker::T>(userId);
-        MessageBroker::GetInstance()->PushMessage(id, std::move(userMsg));
+        auto nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        IMessageStorage::message_t record{ msg.src, msg.dst, static_cast<uint64_t>(nowMs), msg.payload };
+        historyCache->Append(record);
+        KafkaProcess::GetInstance()->PublishMessage(record);
+        messageStorage->Store(std::move(record));
+
+        /* logged message goes to delivery once it is synced */
+        if (!MessageWal::GetInstance()->Append(msg.dst, std::move(msg.payload))) {
+            MessageBroker::GetInstance()->PushMessage(msg.dst, std::move(msg.payload));
+        }
     }
     catch (std::exception& ex) {
         ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
     }
 }
 
-void DataProcess::ProcessGroupMessage(const boost::property_tree::ptree& tree) const noexcept {
+void DataProcess::ProcessGroupMessage(const Message& msg) const noexcept {
     // TODO:
-    (void)tree;
+    (void)msg;
 }
 
-// @brief correct logic, need to implement processing and validating user personal data 
-void DataProcess::ProcessAuthMessage(const MessageBroker::T& id, const boost::property_tree::ptree& tree) const noexcept {
+// @brief validate "${login}+${password}" payload in DB, the answer is sent from DB pool thread
+void DataProcess::ProcessAuthMessage(const MessageBroker::T& id, Message&& msg) const noexcept {
 
     try
     {
-        // here must send request to DB service to validate user data
-        namespace pt = boost::property_tree;
-        pt::ptree ptree;
+        std::string login, password;
+        if (!PostgresProcessor::ParseCredentials(msg.payload, login, password)) {
+            MessageBroker::GetInstance()->PushMessage(id, ConstructAuthResponse(id, PostgresProcessor::auth_status_t::denied, ""),
+                message_lane_t::control);
+            return;
+        }
 
-        ptree.put(JsonHandler::msg_identificator_token, static_cast<uint32_t>(JsonHandler::json_req_t::authentication_message));
-        ptree.put(JsonHandler::dst_user_msg_token, id);
-        ptree.put(JsonHandler::auth_status_token, std::move("approved"));
-        ptree.put(JsonHandler::user_msg_token, std::move(""));
-        
-        std::string outmsg = jsonHandler->ConvertToString(ptree);
+        auto respond = [id, login](PostgresProcessor::auth_status_t status, uint32_t userId) {
+            const auto& dp = DataProcess::GetInstance();
+            if (status != PostgresProcessor::auth_status_t::approved) {
+                MessageBroker::GetInstance()->PushMessage(id, dp->ConstructAuthResponse(id, status, ""), message_lane_t::control);
+                return;
+            }
+            /* from now on connection is addressed by user ID */
+            auto boundId = ConnectionManager::GetInstance()->BindUser(id, userId);
+            if (boundId == ConnectionManager::INVALID_ID) {
+                ConsoleLogger::Info(boost::str(boost::format("Connection #%1% closed before authentication completed") % id));
+                return;
+            }
+            MessageBroker::GetInstance()->PushMessage(boundId,
+                dp->ConstructAuthResponse(boundId, status, SessionToken::GetInstance()->Issue(boundId, login)),
+                message_lane_t::control);
+            ConnectionManager::GetInstance()->DeliverOfflineMessages(boundId);
+        };
 
-        MessageBroker::GetInstance()->PushMessage(id, std::move(outmsg));
+        postgresConnectionManager->AuthenticateUser(std::move(login), std::move(password), std::move(respond));
     }
     catch (std::exception &ex)
     {
@@ -133,48 +281,123 @@ void DataProcess::ProcessAuthMessage(const MessageBroker::T& id, const boost::pr
 }
 
 // @brief need to process request and transmit the user list
-void DataProcess::ProcessUsersListRequest(const boost::property_tree::ptree& tree) const noexcept {
+void DataProcess::ProcessUsersListRequest(const Message& msg) const noexcept {
 
     try {
-        mongoUserMessagesStorage->InsertNewMessage(tree);
-
-        std::string userId = jsonHandler->ParseTreeParam<std::string>(tree, JsonHandler::src_user_msg_token);
-        std::string datetime = jsonHandler->ParseTreeParam<std::string>(tree, JsonHandler::msg_timestamp_token);
-        std::string hash = jsonHandler->ParseTreeParam<std::string>(tree, JsonHandler::msg_hash_token);
-        uint32_t id = boost::lexical_cast<MessageBroker::T>(userId);
-        ConnectionManager::GetInstance()->SendUsersListToUser(id); 
+        ConnectionManager::GetInstance()->SendUsersListToUser(msg.src);
 
     } catch (std::exception& ex) {
         ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
     }
 }
 
-void DataProcess::ProcessNewMessage() const noexcept {
+// @brief page of conversation between requester connection and peer, recent pages are served from memory
+void DataProcess::ProcessHistoryRequest(const MessageBroker::T& id, const Message& msg, bool shed) const noexcept {
 
-    try {
-        auto [id, msg] { PullNewMessage() };
+    static auto& cacheLatency = Metrics::GetInstance()->GetHistogram("history_read_latency_us{source=\"cache\"}");
+    static auto& storageLatency = Metrics::GetInstance()->GetHistogram("history_read_latency_us{source=\"storage\"}");
 
+    try {
         namespace pt = boost::property_tree;
-        pt::ptree tree = jsonHandler->ConstructTree(msg);
+        auto peer = msg.dst;
+        const auto& before = msg.before;
+        const auto& after = msg.after;
+        auto limit = std::clamp<std::size_t>(msg.limit.value_or(history_default_limit), 1, history_max_limit);
+
+        uint64_t fromMs = after ? *after + 1 : 0;
+        uint64_t toMs = before ? *before - 1 : UINT64_MAX;
+        bool latest = before || !after;
+
+        pt::ptree response;
+        response.put(JsonHandler::msg_identificator_token, static_cast<uint32_t>(JsonHandler::json_req_t::history_message));
+        response.put(JsonHandler::dst_user_msg_token, id);
+        response.put(JsonHandler::src_user_msg_token, peer);
+        response.put(JsonHandler::user_msg_token, "");
+
+        std::vector<IMessageStorage::message_t> page;
+        /* overloaded dispatcher answers at once, client retries later */
+        if (shed) {
+            response.put(JsonHandler::user_msg_token, "service unavailable");
+        }
+        /* guests have no stored conversations */
+        else if (id < ConnectionManager::FIRST_GUEST_ID && (!before || *before > 0) && fromMs <= toMs) {
+            uint64_t conversation = IMessageStorage::ConversationKey(id, peer);
+            auto start = std::chrono::steady_clock::now();
+            if (auto hot = historyCache->Read(conversation, fromMs, toMs, limit, latest)) {
+                page = std::move(*hot);
+                cacheLatency.Observe(std::chrono::steady_clock::now() - start);
+            }
+            else {
+                try {
+                    page = messageStorage->Read(conversation, fromMs, toMs, limit, latest);
+                }
+                catch (std::exception& ex) {
+                    ConsoleLogger::Error(boost::str(boost::format("History read failed: %1%") % ex.what()));
+                    response.put(JsonHandler::user_msg_token, "service unavailable");
+                }
+                storageLatency.Observe(std::chrono::steady_clock::now() - start);
+            }
+        }
+
+        pt::ptree history;
+        for (const auto& stored : page) {
+            pt::ptree item;
+            item.put(JsonHandler::src_user_msg_token, stored.src);
+            item.put(JsonHandler::dst_user_msg_token, stored.dst);
+            item.put(JsonHandler::user_msg_token, stored.text);
+            item.put(JsonHandler::msg_timestamp_token, stored.timestampMs);
+            history.push_back(std::make_pair("", item));
+        }
+        response.add_child(JsonHandler::history_token, history);
+
+        MessageBroker::GetInstance()->PushMessage(id, jsonHandler->ConvertToString(response), message_lane_t::bulk);
+    }
+    catch (std::exception& ex) {
+        ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
+    }
+}
 
-        auto identifer = boost::lexical_cast<uint32_t>(jsonHandler->ParseTreeParam<std::string>(tree, 
-                                                                JsonHandler::msg_identificator_token));
+void DataProcess::ProcessNewMessage(std::size_t shard, record_t&& record) const noexcept {
 
-        switch(static_cast<JsonHandler::json_req_t>(identifer)) {
+    try {
+        auto& [id, msg, enqueued, lane] = record;
+        msgInQueue--;
+        auto sojourn = std::chrono::steady_clock::now() - enqueued;
+        laneSojourn[static_cast<std::size_t>(lane)]->Observe(sojourn);
+        bool shed = AdmissionControl::GetInstance()->OnDequeue(shard, sojourn);
+
+        /* parsed and validated by io thread, only routing is left */
+        switch (msg.type) {
             case JsonHandler::json_req_t::users_list_message: {
-                ProcessUsersListRequest(tree);
+                /* list is sent again on next request, nothing is lost by shedding it */
+                if (shed) {
+                    shedUsersList.Inc();
+                    break;
+                }
+                ProcessUsersListRequest(msg);
                 break;
             }
             case JsonHandler::json_req_t::authentication_message: {
-                ProcessAuthMessage(id, tree);
+                ProcessAuthMessage(id, std::move(msg));
                 break;
             }
             case JsonHandler::json_req_t::user_message: {
-                ProcessUserMessage(tree);
+                ProcessUserMessage(std::move(msg));
                 break;
             }
             case JsonHandler::json_req_t::group_users_message: {
-                ProcessGroupMessage(tree);
+                ProcessGroupMessage(msg);
+                break;
+            }
+            case JsonHandler::json_req_t::history_message: {
+                if (shed) {
+                    shedHistory.Inc();
+                }
+                ProcessHistoryRequest(id, msg, shed);
+                break;
+            }
+            case JsonHandler::json_req_t::heartbeat_message: {
+                /* reading it already refreshed connection activity */
                 break;
             }
             default: {
@@ -188,22 +411,20 @@ void DataProcess::ProcessNewMessage() const noexcept {
     }
 }
 
-void DataProcess::SendLastMessage() const noexcept {
+void DataProcess::SendLastMessage(MessageBroker::record_t&& record) const noexcept {
     try {
-        auto [id, msg] = MessageBroker::GetInstance()->PullMessage();
+        auto& [id, msg, walSeq, mailboxSeq] = record;
         ConnectionManager::GetInstance()->ResendUserMessage(id, msg);
+        if (walSeq) {
+            MessageWal::GetInstance()->Complete(walSeq);
+        }
+        if (mailboxSeq) {
+            OfflineMailbox::GetInstance()->Complete(id, mailboxSeq);
+        }
     }
     catch (std::exception& ex) {
         ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
     }
 }
 
-std::pair<const MessageBroker::T, const std::string> DataProcess::PullNewMessage() const {
-    std::unique_lock lk(mutex_);
-    auto[id, msg] {ioq_.front()};
-    ioq_.pop();
-    msgInQueue--;
-    return {std::move(id), std::move(msg)};
-}
-
 std::shared_ptr<DataProcess> DataProcess::dp_ = nullptr;
\ No newline at end of file
@@ -24,8 +24,13 @@
 #include <boost/asio.hpp> 
 
 #include "MessageBroker.h"
-#include "../db/MongoProcess.h"
+#include "PriorityLanes.h"
+#include "DispatchShards.h"
+#include "Message.h"
+#include "../db/IMessageStorage.h"
+#include "../db/HistoryCache.h"
 #include "../db/PostgresProcessor.h"
+#include "../core/Readiness.h"
 
 #include "../format/json.h"
 #include "../log/Logger.h"
@@ -34,9 +39,19 @@ class DataProcess {
 
 public:
 
-    using record_t = std::pair<const MessageBroker::T, const std::string>;
+    struct record_t {
+        MessageBroker::T id = 0;
+        Message msg;
+        std::chrono::steady_clock::time_point enqueued;   // sojourn in queue drives admission control
+        message_lane_t lane = message_lane_t::interactive;
+    };
 
     void StartDataProcessor();
+    /* handles what is queued already, scheduler threads stay for other users */
+    void StopDataProcessor() noexcept;
+    /* shutdown: queued requests and the deliveries they produce reach sockets, dispatcher keeps running */
+    bool FlushDataProcessor(std::chrono::steady_clock::time_point deadline) noexcept;
+    /* io thread parses and validates the frame, malformed one is dropped here */
     void PushNewMessage(const MessageBroker::T id, std::string&& msg) const noexcept;
 
 
@@ -44,6 +59,8 @@ public:
     
     std::string ConstructMessage(const MessageBroker::T& id, const std::string& message, JsonHandler::json_req_t&& json_msg_type);
     std::string ConstructMessage(const MessageBroker::T& id, std::string&& message, JsonHandler::json_req_t&& json_msg_type);
+    std::string ConstructAuthResponse(const MessageBroker::T& id, PostgresProcessor::auth_status_t status,
+        const std::string& sessionToken) const;
     
     DataProcess(const DataProcess& dp) = delete;
     DataProcess& operator=(const DataProcess& dp) = delete;
@@ -52,8 +69,12 @@ public:
     {
         std::cout << "Construct DataProcess class\n";
         jsonHandler = std::make_shared<JsonHandler>();
-        mongoUserMessagesStorage = std::make_unique<MongoProcessor>("mongo.ini");
-        postgresConnectionManager = std::make_unique<PostgresProcessor>();
+        historyCache = std::make_unique<HistoryCache>(history_cache_conversations, history_cache_depth);
+        /* connections, DDL and pools of both databases are set up at once */
+        Readiness::GetInstance()->RunStage({
+            { "message storage", [this]() { messageStorage = IMessageStorage::Create(); } },
+            { "postgres", [this]() { postgresConnectionManager = std::make_unique<PostgresProcessor>(); } },
+        });
         StartDataProcessor();
     }
 
@@ -61,35 +82,42 @@ public:
         std::cout << "Destruct DataProcess class\n";
     }
 
+    /* io threads, scheduler and startup tasks may be the first to ask */
     static const std::shared_ptr<DataProcess>& GetInstance() {
-        if(!dp_) {
-            dp_ = std::make_shared<DataProcess>(); 
-        }
+        static std::once_flag once;
+        std::call_once(once, []() { dp_ = std::make_shared<DataProcess>(); });
         return dp_;
-    } 
+    }
     
 private:
 
-    const uint32_t delay = 10; // ms
-    mutable std::queue<record_t> ioq_; // in and out queue for messages
-    mutable std::shared_mutex mutex_;
-    mutable std::atomic_int16_t msgInQueue;
+    const std::size_t history_cache_conversations = 10000;
+    const std::size_t history_cache_depth = 128;   // messages per conversation
+    const std::size_t history_default_limit = 50;
+    const std::size_t history_max_limit = 200;
+    /* few quiet conversations share a shard with a hot one */
+    const std::size_t shards_per_thread = 64;
+    /* inbound messages sharded by conversation, one conversation is handled in order by one thread */
+    std::unique_ptr<DispatchShards<record_t>> ioq_;
+    mutable std::atomic_size_t msgInQueue{ 0 };
 
     std::shared_ptr<JsonHandler> jsonHandler;
 
-    std::unique_ptr<MongoProcessor> mongoUserMessagesStorage;
+    std::unique_ptr<IMessageStorage> messageStorage;
+    std::unique_ptr<HistoryCache> historyCache;
     std::unique_ptr<PostgresProcessor> postgresConnectionManager;
 
     static std::shared_ptr<DataProcess> dp_;
 
 
-    void ProcessUserMessage(const boost::property_tree::ptree& tree) const noexcept;
-    void ProcessAuthMessage(const MessageBroker::T& id, const boost::property_tree::ptree& tree) const noexcept;
-    void ProcessGroupMessage(const boost::property_tree::ptree& tree) const noexcept;
-    void ProcessUsersListRequest(const boost::property_tree::ptree& tree) const noexcept;
+    void ProcessUserMessage(Message&& msg) const noexcept;
+    void ProcessAuthMessage(const MessageBroker::T& id, Message&& msg) const noexcept;
+    void ProcessGroupMessage(const Message& msg) const noexcept;
+    void ProcessUsersListRequest(const Message& msg) const noexcept;
+    void ProcessHistoryRequest(const MessageBroker::T& id, const Message& msg, bool shed = false) const noexcept;
+    void RejectMessage(const MessageBroker::T& id, const Message& msg) const noexcept;
+    std::string ConstructRejectedMessage(const MessageBroker::T& id, const Message& msg, const std::string& reason) const;
   
-    void SendLastMessage() const noexcept;
-    void ProcessNewMessage() const noexcept;
-    void HandleInOutMessages() const noexcept;
-    std::pair<const MessageBroker::T, const std::string> PullNewMessage() const;
+    void SendLastMessage(MessageBroker::record_t&& record) const noexcept;
+    void ProcessNewMessage(std::size_t shard, record_t&& record) const noexcept;
 };
\ No newline at end of file
@@ -0,0 +1,176 @@
+/*****************************************************************
+ *  @file       DispatchShards.h
+ *  @brief      Serial queues on task scheduler, items of one key
+ *              are handled one at a time in order
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+#pragma once
+
+/* std C++ lib headers */
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+
+#include <boost/format.hpp>
+
+#include "PriorityLanes.h"
+#include "../core/TaskScheduler.h"
+#include "../log/Logger.h"
+#include "../log/Metrics.h"
+
+/* Key picks the shard, so items of one conversation never run concurrently
+ * and keep their order within a lane, while unrelated keys are handled in
+ * parallel. Shards are serial queues run on work-stealing scheduler rather
+ * than threads of their own: there are many more shards than threads, so
+ * only few quiet keys share a shard with a hot one, and a shard with work
+ * is picked up by whichever thread is free. Each shard has its own lock,
+ * there is no shared queue producers contend on. */
+template <typename T>
+class DispatchShards {
+
+public:
+
+    using handler_t = std::function<void(std::size_t shard, T&& item)>;
+    /* shard has drained its queue */
+    using idle_t = std::function<void(std::size_t shard)>;
+
+    /* items handled in a row before shard yields its thread to other shards */
+    static constexpr std::size_t batch_size = 64;
+
+    DispatchShards(const DispatchShards&) = delete;
+    DispatchShards& operator=(const DispatchShards&) = delete;
+
+    DispatchShards(TaskScheduler& scheduler, std::size_t shards, handler_t&& handler, idle_t&& idle = nullptr) :
+        scheduler_(scheduler), handler_(std::move(handler)), idle_(std::move(idle))
+    {
+        for (std::size_t i = 0; i < std::max<std::size_t>(shards, 1); ++i) {
+            shards_.push_back(std::make_unique<shard_t>());
+        }
+    }
+
+    ~DispatchShards() {
+        Stop();
+    }
+
+    std::size_t GetShards() const noexcept { return shards_.size(); }
+
+    std::size_t ShardOf(uint64_t key) const noexcept {
+        /* connection and user ids are sequential, spread them before modulo */
+        return static_cast<std::size_t>(((key * 0x9E3779B97F4A7C15ull) >> 32) % shards_.size());
+    }
+
+    void Push(uint64_t key, message_lane_t lane, T&& item) {
+        auto index = ShardOf(key);
+        auto& shard = *shards_[index];
+        {
+            std::unique_lock lk(shard.mutex);
+            shard.queue.Push(lane, std::move(item));
+            if (shard.scheduled) {
+                return;
+            }
+            shard.scheduled = true;
+        }
+        {
+            std::unique_lock lk(mutex_);
+            active_++;
+        }
+        if (!scheduler_.Submit([this, index]() { Drain(index); })) {
+            Reject(index);
+        }
+    }
+
+    /* waits until items queued already are handled, must not be called from scheduler thread */
+    void Stop() noexcept {
+        std::unique_lock lk(mutex_);
+        cv_.wait(lk, [this]() { return active_ == 0; });
+    }
+
+    /* the same with deadline, shards keep running; false if they are still busy */
+    bool Flush(std::chrono::steady_clock::time_point deadline) noexcept {
+        std::unique_lock lk(mutex_);
+        return cv_.wait_until(lk, deadline, [this]() { return active_ == 0; });
+    }
+
+private:
+
+    struct shard_t {
+        std::mutex mutex;
+        PriorityLanes<T> queue;
+        bool scheduled = false;     // drain task is queued or running, at most one at a time
+    };
+
+    TaskScheduler& scheduler_;
+    std::vector<std::unique_ptr<shard_t>> shards_;
+    handler_t handler_;
+    idle_t idle_;
+
+    /* shards with drain task */
+    std::size_t active_ = 0;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+
+    void Drain(std::size_t index) {
+        auto& shard = *shards_[index];
+        for (std::size_t handled = 0; handled < batch_size; ++handled) {
+            T item{};
+            {
+                std::unique_lock lk(shard.mutex);
+                if (!shard.queue.Pop(item)) {
+                    /* still scheduled, so idle callback doesn't race with handler of this shard */
+                    if (idle_) {
+                        lk.unlock();
+                        idle_(index);
+                        lk.lock();
+                    }
+                    if (!shard.queue.Pop(item)) {
+                        shard.scheduled = false;
+                        lk.unlock();
+                        Done();
+                        return;
+                    }
+                }
+            }
+            try {
+                handler_(index, std::move(item));
+            }
+            catch (std::exception& ex) {
+                ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
+            }
+        }
+        /* hot shard goes behind others waiting for a thread */
+        if (!scheduler_.Submit([this, index]() { Drain(index); })) {
+            Reject(index);
+        }
+    }
+
+    /* scheduler has stopped and won't run drain task, shard is given up
+     * so that Stop() doesn't wait for it; next Push tries again */
+    void Reject(std::size_t index) noexcept {
+        static auto& dropped = Metrics::GetInstance()->GetCounter("dispatch_dropped_total{reason=\"stopped\"}");
+        auto& shard = *shards_[index];
+        {
+            std::unique_lock lk(shard.mutex);
+            T item{};
+            while (shard.queue.Pop(item)) {
+                dropped.Inc();
+            }
+            shard.scheduled = false;
+        }
+        Done();
+    }
+
+    /* the last touch of this object by drain task */
+    void Done() noexcept {
+        std::unique_lock lk(mutex_);
+        if (--active_ == 0) {
+            cv_.notify_all();
+        }
+    }
+};
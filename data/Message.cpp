@@ -0,0 +1,115 @@
+/*****************************************************************
+ *  @file       Message.cpp
+ *  @brief      Client request parsing and validation
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+
+#include "Message.h"
+
+#include <sstream>
+
+#include <boost/format.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include "../log/Logger.h"
+#include "../log/Metrics.h"
+
+namespace {
+    Metrics::Counter& malformed = Metrics::GetInstance()->GetCounter("frames_malformed_total");
+
+    /* ptree numeric translator builds a stream per call, lexical_cast is several times cheaper */
+    template <typename T>
+    T Number(const boost::property_tree::ptree& tree, const std::string& key) {
+        return boost::lexical_cast<T>(tree.get<std::string>(key));
+    }
+
+    template <typename T>
+    std::optional<T> OptionalNumber(const boost::property_tree::ptree& tree, const std::string& key) {
+        if (auto value = tree.get_optional<std::string>(key)) {
+            return boost::lexical_cast<T>(*value);
+        }
+        return std::nullopt;
+    }
+}
+
+std::optional<Message> Message::Parse(const std::string& frame) noexcept {
+
+    namespace pt = boost::property_tree;
+    using req_t = JsonHandler::json_req_t;
+    try {
+        pt::ptree tree;
+        std::istringstream is(frame);
+        pt::read_json(is, tree);
+
+        Message msg;
+        msg.type = static_cast<req_t>(Number<uint32_t>(tree, JsonHandler::msg_identificator_token));
+        switch (msg.type) {
+            case req_t::users_list_message: {
+                msg.src = Number<id_t>(tree, JsonHandler::src_user_msg_token);
+                tree.get<std::string>(JsonHandler::msg_timestamp_token);
+                tree.get<std::string>(JsonHandler::msg_hash_token);
+                break;
+            }
+            case req_t::authentication_message: {
+                /* absent when client tried session token only */
+                msg.payload = tree.get<std::string>(JsonHandler::user_msg_token, "");
+                break;
+            }
+            case req_t::user_message: {
+                msg.src = Number<id_t>(tree, JsonHandler::src_user_msg_token);
+                msg.dst = Number<id_t>(tree, JsonHandler::dst_user_msg_token);
+                msg.payload = tree.get<std::string>(JsonHandler::user_msg_token);
+                break;
+            }
+            case req_t::group_users_message: {
+                msg.src = Number<id_t>(tree, JsonHandler::src_user_msg_token);
+                msg.payload = tree.get<std::string>(JsonHandler::user_msg_token);
+                break;
+            }
+            case req_t::history_message: {
+                msg.dst = Number<id_t>(tree, JsonHandler::dst_user_msg_token);
+                msg.before = OptionalNumber<uint64_t>(tree, JsonHandler::history_before_token);
+                msg.after = OptionalNumber<uint64_t>(tree, JsonHandler::history_after_token);
+                msg.limit = OptionalNumber<uint32_t>(tree, JsonHandler::history_limit_token);
+                break;
+            }
+            case req_t::heartbeat_message:
+                break;
+            default:
+                malformed.Inc();
+                ConsoleLogger::Error(boost::str(boost::format("Undefined message identifier %1%") %
+                    static_cast<uint32_t>(msg.type)));
+                return std::nullopt;
+        }
+        return msg;
+    }
+    catch (std::exception& ex) {
+        malformed.Inc();
+        ConsoleLogger::Error(boost::str(boost::format("Malformed frame: %1%") % ex.what()));
+    }
+    return std::nullopt;
+}
+
+bool Message::SetSender(id_t connection, bool guest) noexcept {
+
+    using req_t = JsonHandler::json_req_t;
+    switch (type) {
+        case req_t::user_message:
+        case req_t::group_users_message:
+            if (guest) {
+                return false;
+            }
+            src = connection;
+            break;
+        case req_t::users_list_message:
+            src = connection;
+            break;
+        default:
+            break;
+    }
+    return true;
+}
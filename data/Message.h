@@ -0,0 +1,40 @@
+/*****************************************************************
+ *  @file       Message.h
+ *  @brief      Client request parsed and validated on the io thread
+ *              which received it
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+#pragma once
+
+/* std C++ lib headers */
+#include <string>
+#include <optional>
+#include <cstdint>
+
+#include "../format/json.h"
+
+/* Frame is parsed once, by io thread, into the fields its request type
+ * needs; malformed frames never reach the dispatcher, which only routes
+ * by type and doesn't touch JSON. Text is moved along, not copied. */
+struct Message {
+
+    using id_t = uint32_t;
+
+    JsonHandler::json_req_t type = JsonHandler::json_req_t::heartbeat_message;
+    id_t src = 0;
+    id_t dst = 0;
+    std::string payload;                // chat text, credentials of authentication
+    /* history page, bounds are message timestamps */
+    std::optional<uint64_t> before;
+    std::optional<uint64_t> after;
+    std::optional<uint32_t> limit;
+
+    /* nullopt for malformed frame or unknown request */
+    static std::optional<Message> Parse(const std::string& frame) noexcept;
+
+    /* sender is the connection which read the frame, never a field of it:
+     * src is replaced by connection id; false when guest writes to users */
+    bool SetSender(id_t connection, bool guest) noexcept;
+};
@@ -5,10 +5,14 @@
 #pragma once
 
 #include "../core/ConnectionManager.h"
+#include "PriorityLanes.h"
+#include "DispatchShards.h"
 
 #include <shared_mutex>
-#include <queue>
+#include <mutex>
+#include <vector>
 #include <memory>
+#include <functional>
 
 #include <spdlog/spdlog.h>
 
@@ -20,7 +24,14 @@ class MessageBroker {
 public:
     using T = AsyncTcpConnection::id_t;
     
-    using record_t = std::pair<T, const std::string>;
+    struct record_t {
+        T id = 0;
+        std::string msg;
+        uint64_t walSeq = 0;    // entry of message WAL completed on hand-over, 0 if not logged
+        uint64_t mailboxSeq = 0;    // offline mailbox message completed on hand-over, 0 if not from mailbox
+    };
+
+    using deliver_t = std::function<void(record_t&& record)>;
 
     // to avoid copying and creating any one instance
     MessageBroker(const MessageBroker& mb) = delete;
@@ -35,36 +46,64 @@ public:
     }
 
     static const std::shared_ptr<MessageBroker>& GetInstance() {
-        if(!mb_) {
-            mb_ = std::make_shared<MessageBroker>();
-        }
+        static std::once_flag once;
+        std::call_once(once, []() { mb_ = std::make_shared<MessageBroker>(); });
         return mb_;
     }
 
-    void PushMessage(const T& connId, std::string&& msg) {
+    /* auth responses must not wait behind chat burst, messages of one lane keep their order;
+     * messages of one recipient are delivered by the same thread */
+    void PushMessage(const T& connId, std::string&& msg, message_lane_t lane = message_lane_t::interactive,
+        uint64_t walSeq = 0, uint64_t mailboxSeq = 0) {
+        {
+            std::shared_lock lk(m_);
+            if (shards_) {
+                shards_->Push(connId, lane, record_t{ connId, std::move(msg), walSeq, mailboxSeq });
+                return;
+            }
+        }
         std::unique_lock lk(m_);
-        msgQueue.emplace(std::make_pair(connId, msg));
-        msgNum++;
-    }
-
-    bool IsQueueEmpty() noexcept {
-        std::shared_lock lk(m_);
-        return msgNum == 0;
+        if (shards_) {
+            shards_->Push(connId, lane, record_t{ connId, std::move(msg), walSeq, mailboxSeq });
+        }
+        else {
+            pending_.emplace_back(lane, record_t{ connId, std::move(msg), walSeq, mailboxSeq });
+        }
     }
 
 protected:
 
-    const record_t PullMessage() {
+    /* messages queued before start, e.g. replayed from WAL, are delivered first */
+    void Start(TaskScheduler& scheduler, std::size_t shards, deliver_t&& deliver) {
         std::unique_lock lk(m_);
-        record_t msg{ msgQueue.front() };
-        msgQueue.pop();
-        msgNum--;
-        return msg;
+        shards_ = std::make_unique<DispatchShards<record_t>>(scheduler, shards,
+            [deliver = std::move(deliver)](std::size_t, record_t&& record) { deliver(std::move(record)); });
+        for (auto& [lane, record] : pending_) {
+            auto id = record.id;
+            shards_->Push(id, lane, std::move(record));
+        }
+        pending_.clear();
+    }
+
+    /* waits until what is queued already is delivered, false if deadline passes first */
+    bool Flush(std::chrono::steady_clock::time_point deadline) noexcept {
+        std::shared_lock lk(m_);
+        return !shards_ || shards_->Flush(deadline);
+    }
+
+    /* delivers what is queued already, later messages wait for next start */
+    void Stop() noexcept {
+        std::unique_ptr<DispatchShards<record_t>> shards;
+        {
+            std::unique_lock lk(m_);
+            shards = std::move(shards_);
+        }
+        shards.reset();
     }
 
 private:
 
-    std::queue<record_t> msgQueue;
+    std::unique_ptr<DispatchShards<record_t>> shards_;
+    std::vector<std::pair<message_lane_t, record_t>> pending_;
     std::shared_mutex m_;
-    std::atomic_size_t msgNum;
-};
\ No newline at end of file
+};
@@ -0,0 +1,374 @@
+/*****************************************************************
+ *  @file       MessageWal.cpp
+ *  @brief      Write-ahead log of undelivered messages implementation
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+
+#include "MessageWal.h"
+
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <boost/crc.hpp>
+#include <boost/format.hpp>
+
+#include "../log/Logger.h"
+#include "../log/Metrics.h"
+
+namespace {
+    Metrics::Counter& appended = Metrics::GetInstance()->GetCounter("wal_appended_total");
+    Metrics::Counter& replayed = Metrics::GetInstance()->GetCounter("wal_replayed_total");
+    Metrics::Counter& syncs = Metrics::GetInstance()->GetCounter("wal_syncs_total");
+    Metrics::Counter& writeErrors = Metrics::GetInstance()->GetCounter("wal_write_errors_total");
+    Metrics::Gauge& undelivered = Metrics::GetInstance()->GetGauge("wal_undelivered_messages");
+    Metrics::Gauge& segmentsCount = Metrics::GetInstance()->GetGauge("wal_segments");
+    Metrics::Histogram& syncLatency = Metrics::GetInstance()->GetHistogram("wal_sync_latency_us");
+    Metrics::Histogram& commitLatency = Metrics::GetInstance()->GetHistogram("wal_commit_latency_us");
+}
+
+std::shared_ptr<MessageWal> MessageWal::mw_ = nullptr;
+
+MessageWal::MessageWal() {
+    ConsoleLogger::Debug("Construct MessageWal class");
+}
+
+MessageWal::~MessageWal() {
+    Close();
+    ConsoleLogger::Debug("Destruct MessageWal class");
+}
+
+uint32_t MessageWal::Checksum(const record_header_t& header, const char* data, uint32_t size) {
+    record_header_t h = header;
+    h.crc = 0;
+    boost::crc_32_type crc;
+    crc.process_bytes(&h, sizeof(h));
+    crc.process_bytes(data, size);
+    return crc.checksum();
+}
+
+void MessageWal::AppendRecord(std::string& out, record_t type, id_t dst, uint64_t seq, const std::string& msg) {
+    record_header_t header{ record_magic, 0, static_cast<uint32_t>(type), dst, seq, static_cast<uint32_t>(msg.size()), 0 };
+    header.crc = Checksum(header, msg.data(), header.size);
+    out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.append(msg);
+}
+
+void MessageWal::Open(const config_t& config, committed_t&& committed) {
+
+    std::map<uint64_t, entry_t> pending;
+    {
+        std::unique_lock lk(mutex_);
+        if (open_) {
+            throw std::runtime_error("Message WAL is already open");
+        }
+        config_ = config;
+        committed_ = std::move(committed);
+        std::filesystem::create_directories(config_.directory);
+
+        std::vector<uint64_t> ids;
+        for (const auto& entry : std::filesystem::directory_iterator(config_.directory)) {
+            if (entry.path().extension() == ".wal") {
+                ids.push_back(std::stoull(entry.path().stem().string()));
+            }
+        }
+        std::sort(ids.begin(), ids.end());
+
+        nextSeq_ = 1;
+        for (auto id : ids) {
+            segments_.push_back(segment_t{ id, (std::filesystem::path(config_.directory) / (std::to_string(id) + ".wal")).string(),
+                nextSeq_ });
+            Recover(segments_.back(), pending);
+        }
+        for (const auto& [seq, entry] : pending) {
+            SegmentOf(seq)->live++;
+        }
+
+        /* previous run may have stopped in the middle of record, new segment is started anyway */
+        nextSegment_ = ids.empty() ? 1 : ids.back() + 1;
+        auto path = (std::filesystem::path(config_.directory) / (std::to_string(nextSegment_) + ".wal")).string();
+        fd_ = CreateSegment(path);
+        segments_.push_back(segment_t{ nextSegment_++, path, nextSeq_ });
+        writeOffset_ = 0;
+        ReleaseDone();
+
+        undelivered_ = pending.size();
+        undelivered.Set(static_cast<int64_t>(undelivered_));
+        open_ = true;
+        stop_ = false;
+        writer_ = std::thread([this]() { Writer(); });
+
+        ConsoleLogger::Info(boost::str(boost::format("Message WAL opened: %1% segments, %2% undelivered messages") %
+            segments_.size() % pending.size()));
+    }
+
+    for (auto& [seq, entry] : pending) {
+        replayed.Inc();
+        committed_(seq, entry.dst, std::move(entry.msg));
+    }
+}
+
+void MessageWal::Close() noexcept {
+
+    {
+        std::unique_lock lk(mutex_);
+        if (!open_ || stop_) {
+            return;
+        }
+        stop_ = true;
+    }
+    cv_.notify_all();
+    writer_.join();
+
+    std::unique_lock lk(mutex_);
+    ::close(fd_);
+    fd_ = -1;
+    segments_.clear();
+    unlogged_.clear();
+    undelivered_ = 0;
+    open_ = false;
+}
+
+bool MessageWal::IsOpen() const noexcept {
+    std::unique_lock lk(mutex_);
+    return open_ && !stop_;
+}
+
+void MessageWal::Recover(segment_t& segment, std::map<uint64_t, entry_t>& pending) {
+
+    std::ifstream file(segment.path, std::ios::binary);
+    std::string data{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+
+    std::size_t offset = 0;
+    record_header_t header;
+    while (offset + sizeof(header) <= data.size()) {
+        std::memcpy(&header, data.data() + offset, sizeof(header));
+        if (header.magic != record_magic || offset + sizeof(header) + header.size > data.size() ||
+            Checksum(header, data.data() + offset + sizeof(header), header.size) != header.crc) {
+            break;
+        }
+        if (header.type == static_cast<uint32_t>(record_t::message)) {
+            pending[header.seq] = entry_t{ header.seq, header.dst,
+                data.substr(offset + sizeof(header), header.size), std::chrono::steady_clock::now() };
+            nextSeq_ = std::max(nextSeq_, header.seq + 1);
+        }
+        else {
+            pending.erase(header.seq);
+        }
+        offset += sizeof(header) + header.size;
+    }
+
+    if (offset != data.size()) {
+        ConsoleLogger::Error(boost::str(boost::format("WAL segment %1% is truncated from %2% to %3% bytes") %
+            segment.path % data.size() % offset));
+        std::filesystem::resize_file(segment.path, offset);
+    }
+}
+
+int MessageWal::CreateSegment(const std::string& path) {
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("WAL segment can't be created: " + path);
+    }
+    return fd;
+}
+
+/* called unlocked from log thread, segment list is updated under the lock */
+void MessageWal::StartSegment(uint64_t firstSeq, std::unique_lock<std::mutex>& lk) {
+    auto path = (std::filesystem::path(config_.directory) / (std::to_string(nextSegment_) + ".wal")).string();
+    int fd = CreateSegment(path);
+    ::close(fd_);
+    fd_ = fd;
+    writeOffset_ = 0;
+    lk.lock();
+    segments_.push_back(segment_t{ nextSegment_++, path, firstSeq });
+    lk.unlock();
+}
+
+MessageWal::segment_t* MessageWal::SegmentOf(uint64_t seq) noexcept {
+    auto it = std::upper_bound(segments_.begin(), segments_.end(), seq,
+        [](uint64_t value, const segment_t& segment) { return value < segment.firstSeq; });
+    return it == segments_.begin() ? nullptr : &*std::prev(it);
+}
+
+/* only from the front: done records of surviving newer segments must not outlive their messages */
+void MessageWal::ReleaseDone() {
+    while (segments_.size() > 1 && segments_.front().live == 0) {
+        std::error_code ec;
+        std::filesystem::remove(segments_.front().path, ec);
+        segments_.pop_front();
+    }
+    segmentsCount.Set(static_cast<int64_t>(segments_.size()));
+}
+
+bool MessageWal::Append(id_t dst, std::string&& msg) noexcept {
+
+    try {
+        bool wake = false;
+        {
+            std::unique_lock lk(mutex_);
+            if (!open_ || stop_) {
+                return false;
+            }
+            auto seq = nextSeq_++;
+            AppendRecord(batch_, record_t::message, dst, seq, msg);
+            entries_.push_back(entry_t{ seq, dst, std::move(msg), std::chrono::steady_clock::now() });
+            wake = entries_.size() == 1;
+            undelivered.Set(static_cast<int64_t>(++undelivered_));
+        }
+        appended.Inc();
+        if (wake) {
+            cv_.notify_one();
+        }
+        return true;
+    }
+    catch (std::exception& ex) {
+        ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
+    }
+    return false;
+}
+
+void MessageWal::Complete(uint64_t seq) noexcept {
+
+    try {
+        std::unique_lock lk(mutex_);
+        if (!open_) {
+            return;
+        }
+        if (unlogged_.erase(seq) > 0) {
+            if (undelivered_ > 0) {
+                undelivered.Set(static_cast<int64_t>(--undelivered_));
+            }
+            return;
+        }
+        /* goes to disk with the next batch, nobody waits for it */
+        AppendRecord(batch_, record_t::done, 0, seq, {});
+        hasDone_ = true;
+        if (auto segment = SegmentOf(seq); segment && segment->live > 0) {
+            segment->live--;
+        }
+        if (undelivered_ > 0) {
+            undelivered.Set(static_cast<int64_t>(--undelivered_));
+        }
+    }
+    catch (std::exception& ex) {
+        ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
+    }
+}
+
+void MessageWal::Write(const std::string& bytes) {
+    const char* data = bytes.data();
+    std::size_t size = bytes.size();
+    while (size > 0) {
+        auto n = ::pwrite(fd_, data, size, static_cast<off_t>(writeOffset_));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(std::string("WAL write failed: ") + std::strerror(errno));
+        }
+        data += n;
+        size -= static_cast<std::size_t>(n);
+        writeOffset_ += static_cast<uint64_t>(n);
+    }
+}
+
+void MessageWal::Writer() noexcept {
+
+    auto lastSync = std::chrono::steady_clock::now() - config_.syncInterval;
+    std::unique_lock lk(mutex_);
+    for (;;) {
+        cv_.wait_for(lk, done_flush_interval, [&]() { return stop_ || !entries_.empty(); });
+        if (entries_.empty() && !hasDone_) {
+            if (stop_) {
+                break;
+            }
+            continue;
+        }
+        /* messages accepted until the interval ends share one sync */
+        if (!stop_ && !entries_.empty() && config_.syncInterval.count() > 0) {
+            cv_.wait_until(lk, lastSync + config_.syncInterval, [&]() { return stop_; });
+        }
+
+        std::string bytes;
+        bytes.swap(batch_);
+        std::vector<entry_t> entries;
+        entries.swap(entries_);
+        hasDone_ = false;
+        bool stopping = stop_;
+        uint64_t firstSeq = entries.empty() ? nextSeq_ : entries.front().seq;
+        lk.unlock();
+
+        bool durable = true;
+        uint64_t batchOffset = writeOffset_;
+        try {
+            if (writeOffset_ > 0 && writeOffset_ + bytes.size() > config_.segmentSize) {
+                StartSegment(firstSeq, lk);
+            }
+            batchOffset = writeOffset_;
+            Write(bytes);
+            auto start = std::chrono::steady_clock::now();
+            if (::fdatasync(fd_) != 0) {
+                throw std::runtime_error(std::string("WAL sync failed: ") + std::strerror(errno));
+            }
+            lastSync = std::chrono::steady_clock::now();
+            syncLatency.Observe(lastSync - start);
+            syncs.Inc();
+        }
+        catch (std::exception& ex) {
+            /* chat keeps working, messages of this batch just aren't durable; torn batch is cut
+             * off, otherwise recovery would stop at it and drop every record written after */
+            durable = false;
+            writeErrors.Inc();
+            ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
+            try {
+                if (::ftruncate(fd_, static_cast<off_t>(batchOffset)) == 0) {
+                    writeOffset_ = batchOffset;
+                }
+                else {
+                    StartSegment(firstSeq, lk);
+                }
+            }
+            catch (std::exception& ex) {
+                ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
+            }
+        }
+
+        lk.lock();
+        if (durable) {
+            segments_.back().live += entries.size();
+        }
+        else if (!stopping) {
+            for (const auto& entry : entries) {
+                unlogged_.insert(entry.seq);
+            }
+        }
+        ReleaseDone();
+        if (stopping) {
+            /* synced but never handed over, replayed on next open */
+            continue;
+        }
+        lk.unlock();
+
+        auto now = std::chrono::steady_clock::now();
+        for (auto& entry : entries) {
+            commitLatency.Observe(now - entry.accepted);
+            committed_(entry.seq, entry.dst, std::move(entry.msg));
+        }
+        lk.lock();
+    }
+}
+
+std::size_t MessageWal::GetUndelivered() const noexcept {
+    std::unique_lock lk(mutex_);
+    return undelivered_;
+}
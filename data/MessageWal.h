@@ -0,0 +1,141 @@
+/*****************************************************************
+ *  @file       MessageWal.h
+ *  @brief      Write-ahead log of accepted but not yet delivered
+ *              user messages with group commit
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+#pragma once
+
+/* std C++ lib headers */
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <unordered_set>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <cstdint>
+
+/* Accepted message is appended to memory batch and released to delivery
+ * only after the batch is written and synced, so one fsync covers every
+ * message accepted meanwhile. Sync interval bounds fsync rate: messages
+ * wait up to the interval and go to disk together. Handing message over to
+ * connection, mailbox or cluster appends done record, which isn't synced
+ * on its own; after crash message without done record is delivered again.
+ * Log is split into segment files, fully done oldest segment is deleted. */
+class MessageWal {
+
+public:
+
+    using id_t = uint32_t;
+
+    struct config_t {
+        std::string directory;
+        std::size_t segmentSize = 64 * 1024 * 1024;
+        std::chrono::milliseconds syncInterval{ 0 };    // 0 syncs as soon as previous sync ends
+    };
+
+    /* invoked from log thread for synced messages and for replayed ones on open */
+    using committed_t = std::function<void(uint64_t seq, id_t dst, std::string&& msg)>;
+
+    MessageWal(const MessageWal&) = delete;
+    MessageWal& operator=(const MessageWal&) = delete;
+
+    MessageWal();
+    ~MessageWal();
+
+    static const std::shared_ptr<MessageWal>& GetInstance() {
+        static std::once_flag once;
+        std::call_once(once, []() { mw_ = std::make_shared<MessageWal>(); });
+        return mw_;
+    }
+
+    /* undelivered messages of previous run are passed to callback before return */
+    void Open(const config_t& config, committed_t&& committed);
+    /* pending batch is synced but not released, it is replayed on next open */
+    void Close() noexcept;
+
+    bool IsOpen() const noexcept;
+
+    /* non-blocking, false when log is closed, message is left intact then */
+    bool Append(id_t dst, std::string&& msg) noexcept;
+    /* message is handed over, its entry isn't replayed any more */
+    void Complete(uint64_t seq) noexcept;
+
+    std::size_t GetUndelivered() const noexcept;
+
+private:
+
+    enum class record_t : uint32_t {
+        message = 1,
+        done,
+    };
+
+    struct record_header_t {
+        uint32_t magic;
+        uint32_t crc;
+        uint32_t type;
+        uint32_t dst;
+        uint64_t seq;
+        uint32_t size;
+        uint32_t reserved;
+    };
+
+    struct entry_t {
+        uint64_t seq;
+        id_t dst;
+        std::string msg;
+        std::chrono::steady_clock::time_point accepted;
+    };
+
+    struct segment_t {
+        uint64_t id;
+        std::string path;
+        uint64_t firstSeq;          // messages of older segments have lower seq
+        std::size_t live = 0;       // messages not yet done
+    };
+
+    static constexpr uint32_t record_magic = 0x57414c31; // "WAL1"
+    const std::chrono::milliseconds done_flush_interval{ 100 };
+
+    config_t config_;
+    committed_t committed_;
+    bool open_ = false;
+    bool stop_ = false;
+
+    /* filled by callers, swapped out by log thread */
+    std::string batch_;
+    std::vector<entry_t> entries_;
+    bool hasDone_ = false;
+
+    std::deque<segment_t> segments_;    // oldest first, last is written
+    int fd_ = -1;
+    uint64_t writeOffset_ = 0;
+    uint64_t nextSeq_ = 1;
+    uint64_t nextSegment_ = 1;
+    std::size_t undelivered_ = 0;
+    /* handed to delivery though their batch failed to reach disk, no done record is due */
+    std::unordered_set<uint64_t> unlogged_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread writer_;
+
+    static std::shared_ptr<MessageWal> mw_;
+
+    void Writer() noexcept;
+    void Write(const std::string& bytes);
+    void Recover(segment_t& segment, std::map<uint64_t, entry_t>& pending);
+    int CreateSegment(const std::string& path);
+    void StartSegment(uint64_t firstSeq, std::unique_lock<std::mutex>& lk);
+    segment_t* SegmentOf(uint64_t seq) noexcept;
+    void ReleaseDone();
+    static void AppendRecord(std::string& out, record_t type, id_t dst, uint64_t seq, const std::string& msg);
+    static uint32_t Checksum(const record_header_t& header, const char* data, uint32_t size);
+};
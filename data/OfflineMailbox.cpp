@@ -0,0 +1,400 @@
+/*****************************************************************
+ *  @file       OfflineMailbox.cpp
+ *  @brief      Store-and-forward mailboxes implementation
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+
+#include "OfflineMailbox.h"
+
+#include <cstring>
+#include <cstdio>
+#include <stdexcept>
+#include <filesystem>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <boost/crc.hpp>
+#include <boost/format.hpp>
+
+#include "../log/Logger.h"
+#include "../log/Metrics.h"
+
+namespace {
+    Metrics::Counter& appended = Metrics::GetInstance()->GetCounter("mailbox_appended_total");
+    Metrics::Counter& delivered = Metrics::GetInstance()->GetCounter("mailbox_delivered_total");
+    Metrics::Counter& dropped = Metrics::GetInstance()->GetCounter("mailbox_dropped_total");
+    Metrics::Gauge& pending = Metrics::GetInstance()->GetGauge("mailbox_pending_messages");
+    Metrics::Gauge& segmentsCount = Metrics::GetInstance()->GetGauge("mailbox_segments");
+
+    constexpr std::size_t Align(std::size_t size, std::size_t align) {
+        return (size + align - 1) & ~(align - 1);
+    }
+}
+
+std::shared_ptr<OfflineMailbox> OfflineMailbox::om_ = nullptr;
+
+OfflineMailbox::OfflineMailbox() {
+    ConsoleLogger::Debug("Construct OfflineMailbox class");
+}
+
+OfflineMailbox::~OfflineMailbox() {
+    Close();
+    ConsoleLogger::Debug("Destruct OfflineMailbox class");
+}
+
+uint64_t OfflineMailbox::NowMs() noexcept {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+uint32_t OfflineMailbox::Checksum(const record_header_t& header, const char* data, uint32_t size) {
+    record_header_t h = header;
+    h.crc = 0;
+    boost::crc_32_type crc;
+    crc.process_bytes(&h, sizeof(h));
+    crc.process_bytes(data, size);
+    return crc.checksum();
+}
+
+void OfflineMailbox::Open(const config_t& config) {
+
+    std::unique_lock lk(mutex_);
+    if (open_) {
+        throw std::runtime_error("Offline mailbox is already open");
+    }
+    config_ = config;
+    config_.segmentSize = Align(config_.segmentSize, record_align);
+    std::filesystem::create_directories(config_.directory);
+
+    std::vector<std::pair<uint64_t, std::string>> files;
+    for (const auto& entry : std::filesystem::directory_iterator(config_.directory)) {
+        if (entry.path().extension() == ".seg") {
+            files.emplace_back(std::stoull(entry.path().stem().string()), entry.path().string());
+        }
+    }
+    std::sort(files.begin(), files.end());
+
+    for (const auto& [id, path] : files) {
+        segments_.push_back(MapSegment(path, id, false));
+        Recover(*segments_.back());
+    }
+    if (segments_.empty()) {
+        CreateSegment(1);
+    }
+    segmentsCount.Set(static_cast<int64_t>(segments_.size()));
+
+    std::size_t messages = 0;
+    for (const auto& [id, box] : index_) {
+        messages += box.size();
+    }
+    pending.Set(static_cast<int64_t>(messages));
+
+    open_ = true;
+    lastMaintenance_ = std::chrono::steady_clock::now();
+    ReleaseDrained();
+    Maintenance();
+
+    ConsoleLogger::Info(boost::str(boost::format("Offline mailbox opened: %1% segments, %2% pending messages for %3% users") %
+        segments_.size() % messages % index_.size()));
+}
+
+void OfflineMailbox::Close() noexcept {
+    std::unique_lock lk(mutex_);
+    for (auto& segment : segments_) {
+        UnmapSegment(*segment);
+    }
+    segments_.clear();
+    index_.clear();
+    taken_.clear();
+    open_ = false;
+}
+
+bool OfflineMailbox::IsOpen() const noexcept {
+    std::unique_lock lk(mutex_);
+    return open_;
+}
+
+std::unique_ptr<OfflineMailbox::segment_t> OfflineMailbox::MapSegment(const std::string& path, uint64_t id, bool create) {
+
+    auto segment = std::make_unique<segment_t>();
+    segment->id = id;
+    segment->path = path;
+
+    segment->fd = ::open(path.c_str(), O_RDWR | (create ? O_CREAT | O_EXCL : 0), 0644);
+    if (segment->fd < 0) {
+        throw std::runtime_error("Mailbox segment can't be opened: " + path);
+    }
+    if (create && ::ftruncate(segment->fd, static_cast<off_t>(config_.segmentSize)) != 0) {
+        ::close(segment->fd);
+        throw std::runtime_error("Mailbox segment can't be allocated: " + path);
+    }
+
+    struct stat st {};
+    ::fstat(segment->fd, &st);
+    segment->size = static_cast<std::size_t>(st.st_size);
+
+    void* base = ::mmap(nullptr, segment->size, PROT_READ | PROT_WRITE, MAP_SHARED, segment->fd, 0);
+    if (base == MAP_FAILED) {
+        ::close(segment->fd);
+        throw std::runtime_error("Mailbox segment can't be mapped: " + path);
+    }
+    segment->base = static_cast<char*>(base);
+    return segment;
+}
+
+void OfflineMailbox::UnmapSegment(segment_t& segment) noexcept {
+    if (segment.base) {
+        ::munmap(segment.base, segment.size);
+        segment.base = nullptr;
+    }
+    if (segment.fd >= 0) {
+        ::close(segment.fd);
+        segment.fd = -1;
+    }
+}
+
+OfflineMailbox::segment_t* OfflineMailbox::CreateSegment(uint64_t id) {
+
+    /* disk limit: oldest segments are sacrificed for the new one */
+    while (!segments_.empty() && (segments_.size() + 1) * config_.segmentSize > config_.maxDiskSize) {
+        DropSegment(segments_.front().get());
+    }
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llu.seg", static_cast<unsigned long long>(id));
+    auto path = (std::filesystem::path(config_.directory) / name).string();
+
+    segments_.push_back(MapSegment(path, id, true));
+    segmentsCount.Set(static_cast<int64_t>(segments_.size()));
+    return segments_.back().get();
+}
+
+void OfflineMailbox::Recover(segment_t& segment) {
+
+    std::size_t offset = 0;
+    bool torn = false;
+
+    while (offset + sizeof(record_header_t) <= segment.size) {
+        record_header_t header;
+        std::memcpy(&header, segment.base + offset, sizeof(header));
+        if (header.magic != record_magic) {
+            break;
+        }
+        const char* payload = segment.base + offset + sizeof(header);
+        if (offset + sizeof(header) + header.size > segment.size ||
+            Checksum(header, payload, header.size) != header.crc) {
+            /* process stopped in the middle of append */
+            torn = true;
+            break;
+        }
+
+        if (header.type == static_cast<uint32_t>(record_t::message)) {
+            index_[header.userId].push_back(location_t{ &segment, offset + sizeof(header), header.size, header.seq });
+            segment.live++;
+        }
+        else if (header.type == static_cast<uint32_t>(record_t::ack)) {
+            auto it = index_.find(header.userId);
+            if (it != index_.end()) {
+                auto& box = it->second;
+                while (!box.empty() && box.front().seq <= header.seq) {
+                    box.front().segment->live--;
+                    box.pop_front();
+                }
+                if (box.empty()) {
+                    index_.erase(it);
+                }
+            }
+        }
+        nextSeq_ = std::max(nextSeq_, header.seq + 1);
+        segment.lastWriteMs = std::max(segment.lastWriteMs, header.timestampMs);
+        offset += Align(sizeof(header) + header.size, record_align);
+    }
+
+    segment.writeOffset = offset;
+    if (torn) {
+        std::memset(segment.base + offset, 0, segment.size - offset);
+    }
+}
+
+bool OfflineMailbox::WriteRecord(record_t type, const id_t& userId, const char* data, uint32_t size, location_t* location) {
+
+    std::size_t total = Align(sizeof(record_header_t) + size, record_align);
+    if (total > config_.segmentSize) {
+        return false;
+    }
+
+    segment_t* active = segments_.back().get();
+    if (active->writeOffset + total > active->size) {
+        active = CreateSegment(active->id + 1);
+    }
+
+    record_header_t header{};
+    header.magic = record_magic;
+    header.type = static_cast<uint32_t>(type);
+    header.userId = userId;
+    header.timestampMs = NowMs();
+    header.size = size;
+    if (type == record_t::message) {
+        header.seq = nextSeq_++;
+    }
+    else {
+        /* ack carries seq of the last delivered message */
+        header.seq = location->seq;
+    }
+    header.crc = Checksum(header, data, size);
+
+    /* payload first, so torn record never passes checksum with valid header */
+    char* dst = active->base + active->writeOffset;
+    std::memcpy(dst + sizeof(header), data, size);
+    std::memcpy(dst, &header, sizeof(header));
+
+    if (type == record_t::message) {
+        *location = location_t{ active, active->writeOffset + sizeof(header), size, header.seq };
+        active->live++;
+    }
+    active->writeOffset += total;
+    active->lastWriteMs = header.timestampMs;
+    return true;
+}
+
+bool OfflineMailbox::Append(const id_t& userId, const std::string& msg) noexcept {
+
+    try {
+        std::unique_lock lk(mutex_);
+        if (!open_) {
+            return false;
+        }
+
+        location_t location{};
+        if (!WriteRecord(record_t::message, userId, msg.data(), static_cast<uint32_t>(msg.size()), &location)) {
+            dropped.Inc();
+            return false;
+        }
+        index_[userId].push_back(location);
+        appended.Inc();
+        pending.Add(1);
+
+        if (std::chrono::steady_clock::now() - lastMaintenance_ > maintenance_period) {
+            Maintenance();
+        }
+        return true;
+    }
+    catch (std::exception& ex) {
+        ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
+    }
+    return false;
+}
+
+std::vector<OfflineMailbox::message_t> OfflineMailbox::Take(const id_t& userId) noexcept {
+
+    std::vector<message_t> messages;
+    try {
+        std::unique_lock lk(mutex_);
+        auto it = index_.find(userId);
+        if (!open_ || it == index_.end()) {
+            return messages;
+        }
+
+        auto& box = it->second;
+        messages.reserve(box.size());
+        for (const auto& loc : box) {
+            messages.push_back(message_t{ loc.seq, std::string(loc.segment->base + loc.offset, loc.size) });
+        }
+        auto& taken = taken_[userId];
+        taken.insert(taken.end(), box.begin(), box.end());
+        index_.erase(it);
+    }
+    catch (std::exception& ex) {
+        ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
+    }
+    return messages;
+}
+
+void OfflineMailbox::Complete(const id_t& userId, uint64_t seq) noexcept {
+
+    try {
+        std::unique_lock lk(mutex_);
+        auto it = taken_.find(userId);
+        if (!open_ || it == taken_.end()) {
+            return;
+        }
+
+        auto& taken = it->second;
+        std::size_t count = 0;
+        location_t last{};
+        while (!taken.empty() && taken.front().seq <= seq) {
+            last = taken.front();
+            last.segment->live--;
+            taken.pop_front();
+            count++;
+        }
+        if (taken.empty()) {
+            taken_.erase(it);
+        }
+        if (count == 0) {
+            return;
+        }
+        delivered.Inc(count);
+        pending.Add(-static_cast<int64_t>(count));
+
+        WriteRecord(record_t::ack, userId, nullptr, 0, &last);
+        ReleaseDrained();
+    }
+    catch (std::exception& ex) {
+        ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
+    }
+}
+
+std::size_t OfflineMailbox::GetPendingCount(const id_t& userId) const noexcept {
+    std::unique_lock lk(mutex_);
+    auto it = index_.find(userId);
+    return it == index_.end() ? 0 : it->second.size();
+}
+
+void OfflineMailbox::ReleaseDrained() {
+    /* only from the front: acks of surviving older segments must not disappear */
+    while (segments_.size() > 1 && segments_.front()->live == 0) {
+        DropSegment(segments_.front().get());
+    }
+}
+
+void OfflineMailbox::Maintenance() {
+
+    lastMaintenance_ = std::chrono::steady_clock::now();
+    uint64_t deadline = NowMs() - std::chrono::duration_cast<std::chrono::milliseconds>(config_.retention).count();
+
+    while (segments_.size() > 1 && segments_.front()->lastWriteMs < deadline) {
+        DropSegment(segments_.front().get());
+    }
+}
+
+void OfflineMailbox::DropSegment(segment_t* segment) {
+
+    /* mailboxes are ordered by seq, so entries of the oldest segment are in front */
+    if (segment->live > 0) {
+        for (auto* boxes : { &index_, &taken_ }) {
+            for (auto it = boxes->begin(); it != boxes->end(); ) {
+                auto& box = it->second;
+                while (!box.empty() && box.front().segment == segment) {
+                    box.pop_front();
+                }
+                it = box.empty() ? boxes->erase(it) : std::next(it);
+            }
+        }
+        dropped.Inc(segment->live);
+        pending.Add(-static_cast<int64_t>(segment->live));
+        ConsoleLogger::Info(boost::str(boost::format("Mailbox segment %1% dropped with %2% undelivered messages") %
+            segment->id % segment->live));
+    }
+
+    UnmapSegment(*segment);
+    ::unlink(segment->path.c_str());
+    segments_.pop_front();
+    segmentsCount.Set(static_cast<int64_t>(segments_.size()));
+}
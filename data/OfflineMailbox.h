@@ -0,0 +1,138 @@
+/*****************************************************************
+ *  @file       OfflineMailbox.h
+ *  @brief      Store-and-forward mailboxes for users which are
+ *              not connected, kept in memory-mapped segment log
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+#pragma once
+
+/* std C++ lib headers */
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <unordered_map>
+#include <cstdint>
+
+/* Log is a sequence of preallocated segment files mapped into memory.
+ * Every message is appended as a record, message handed over to connection
+ * appends an ack record, so mailboxes are rebuilt by one scan of segments
+ * on start and messages taken but not completed before crash come again.
+ * Segment is deleted when all its messages are drained, when it is older
+ * than retention or when disk limit requires space for the new one. */
+class OfflineMailbox {
+
+public:
+
+    using id_t = uint32_t;
+
+    struct message_t {
+        uint64_t seq;
+        std::string msg;
+    };
+
+    struct config_t {
+        std::string directory;
+        std::size_t segmentSize = 64 * 1024 * 1024;
+        std::size_t maxDiskSize = 1024ull * 1024 * 1024;
+        std::chrono::hours retention{ 24 * 7 };
+    };
+
+    OfflineMailbox(const OfflineMailbox&) = delete;
+    OfflineMailbox& operator=(const OfflineMailbox&) = delete;
+
+    OfflineMailbox();
+    ~OfflineMailbox();
+
+    static const std::shared_ptr<OfflineMailbox>& GetInstance() {
+        static std::once_flag once;
+        std::call_once(once, []() { om_ = std::make_shared<OfflineMailbox>(); });
+        return om_;
+    }
+
+    /* recovers pending messages from existing segments */
+    void Open(const config_t& config);
+    void Close() noexcept;
+
+    bool IsOpen() const noexcept;
+
+    /* false when mailboxes are disabled or message doesn't fit segment */
+    bool Append(const id_t& userId, const std::string& msg) noexcept;
+
+    /* all pending messages of user in arrival order, each is delivered as own frame;
+     * they stay on disk until completed */
+    std::vector<message_t> Take(const id_t& userId) noexcept;
+    /* message is handed over together with every message of user taken before it */
+    void Complete(const id_t& userId, uint64_t seq) noexcept;
+
+    std::size_t GetPendingCount(const id_t& userId) const noexcept;
+
+private:
+
+    enum class record_t : uint32_t {
+        message = 1,
+        ack,    // messages of user up to seq are delivered
+    };
+
+    struct record_header_t {
+        uint32_t magic;
+        uint32_t crc;
+        uint32_t type;
+        uint32_t userId;
+        uint64_t seq;
+        uint64_t timestampMs;
+        uint32_t size;
+        uint32_t reserved;
+    };
+
+    struct segment_t {
+        uint64_t id;
+        std::string path;
+        int fd = -1;
+        char* base = nullptr;
+        std::size_t size = 0;
+        std::size_t writeOffset = 0;
+        std::size_t live = 0;       // messages not yet drained
+        uint64_t lastWriteMs = 0;
+    };
+
+    struct location_t {
+        segment_t* segment;
+        std::size_t offset;         // of payload
+        uint32_t size;
+        uint64_t seq;
+    };
+
+    static constexpr uint32_t record_magic = 0x4d424f58; // "MBOX"
+    static constexpr std::size_t record_align = 8;
+    const std::chrono::minutes maintenance_period{ 1 };
+
+    config_t config_;
+    bool open_ = false;
+
+    std::deque<std::unique_ptr<segment_t>> segments_;   // oldest first, last is active
+    std::unordered_map<id_t, std::deque<location_t>> index_;
+    /* taken, not yet completed */
+    std::unordered_map<id_t, std::deque<location_t>> taken_;
+    uint64_t nextSeq_ = 1;
+    std::chrono::steady_clock::time_point lastMaintenance_;
+
+    mutable std::mutex mutex_;
+
+    static std::shared_ptr<OfflineMailbox> om_;
+
+    segment_t* CreateSegment(uint64_t id);
+    std::unique_ptr<segment_t> MapSegment(const std::string& path, uint64_t id, bool create);
+    void Recover(segment_t& segment);
+    bool WriteRecord(record_t type, const id_t& userId, const char* data, uint32_t size, location_t* location);
+    void DropSegment(segment_t* segment);
+    void Maintenance();
+    void ReleaseDrained();
+    static void UnmapSegment(segment_t& segment) noexcept;
+    static uint32_t Checksum(const record_header_t& header, const char* data, uint32_t size);
+    static uint64_t NowMs() noexcept;
+};
@@ -0,0 +1,75 @@
+/*****************************************************************
+ *  @file       PriorityLanes.h
+ *  @brief      Weighted round robin queue of prioritized lanes
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+#pragma once
+
+/* std C++ lib headers */
+#include <array>
+#include <algorithm>
+#include <queue>
+#include <cstdint>
+
+/* lane of dispatcher and delivery queues, lower is more urgent */
+enum class message_lane_t : uint8_t {
+    control,        // authentication, session and protocol messages
+    interactive,    // chat messages
+    bulk,           // users list, history pages
+};
+
+/* Every lane keeps FIFO order, lanes are drained round robin taking up to
+ * weight items from a lane per round, empty lanes are skipped. Burst of
+ * chat messages delays control message by one round at most, while bulk
+ * lane still gets its share and never starves. Not synchronized, owner
+ * guards it with its own lock. */
+template <typename T>
+class PriorityLanes {
+
+public:
+
+    static constexpr std::size_t lanes_count = 3;
+    using weights_t = std::array<uint32_t, lanes_count>;
+
+    explicit PriorityLanes(const weights_t& weights = { 8, 4, 1 }) : weights_(weights) {
+        for (auto& weight : weights_) {
+            weight = std::max<uint32_t>(weight, 1);
+        }
+        credit_ = weights_[0];
+    }
+
+    void Push(message_lane_t lane, T&& item) {
+        lanes_[static_cast<std::size_t>(lane)].push(std::move(item));
+        size_++;
+    }
+
+    /* false if all lanes are empty */
+    bool Pop(T& item) {
+        if (size_ == 0) {
+            return false;
+        }
+        while (lanes_[current_].empty() || credit_ == 0) {
+            current_ = (current_ + 1) % lanes_count;
+            credit_ = weights_[current_];
+        }
+        item = std::move(lanes_[current_].front());
+        lanes_[current_].pop();
+        credit_--;
+        size_--;
+        return true;
+    }
+
+    bool Empty() const noexcept { return size_ == 0; }
+    std::size_t Size() const noexcept { return size_; }
+    std::size_t Size(message_lane_t lane) const noexcept { return lanes_[static_cast<std::size_t>(lane)].size(); }
+
+private:
+
+    weights_t weights_;
+    std::array<std::queue<T>, lanes_count> lanes_;
+    std::size_t size_ = 0;
+    std::size_t current_ = 0;
+    uint32_t credit_ = 0;
+};
@@ -21,6 +21,20 @@ void UsersPool::StoreNewClient(const T &id, AsyncClient::client_ptr &ptr) const
     }
 }
 
+void UsersPool::ReplaceClient(const T &id, AsyncClient::client_ptr &ptr) const noexcept
+{
+    try
+    {
+        std::unique_lock lk(mutex_);
+        clients.insert_or_assign(id, ptr);
+        usersIdsAsStrings.insert(boost::str(boost::format("%1%") % id));
+    }
+    catch (std::exception &ex)
+    {
+        ConsoleLogger::Error(ex.what());
+    }
+}
+
 const AsyncClient::client_ptr UsersPool::GetClient(const T &id) const noexcept
 {
     AsyncClient::client_ptr ptr = nullptr;
@@ -36,18 +50,25 @@ const AsyncClient::client_ptr UsersPool::GetClient(const T &id) const noexcept
     return ptr;
 }
 
-void UsersPool::RemoveExistedClient(const T &id) const noexcept
+bool UsersPool::RemoveExistedClient(const T &id, const AsyncTcpConnection* conn) const noexcept
 {
     try
     {
         std::unique_lock lk(mutex_);
-        clients.erase(id);
+        auto it = clients.find(id);
+        if (it == clients.end() || (conn && it->second->GetConnection() != conn))
+        {
+            return false;
+        }
+        clients.erase(it);
         usersIdsAsStrings.erase(boost::str(boost::format("%1%") % id));
+        return true;
     }
     catch (std::exception &ex)
     {
         ConsoleLogger::Error(ex.what());
     }
+    return false;
 }
 
 bool UsersPool::IsThereSuchClient(const T &id) const noexcept
@@ -64,7 +85,7 @@ void UsersPool::SendUsersListToUser(const T& id) const noexcept
         std::string users{PrepareUsersIdsList()};
         std::string json = DataProcess::GetInstance()->GetUsersListInJson(users, clients.size());
         std::string message = DataProcess::GetInstance()->ConstructMessage(id, json, JsonHandler::json_req_t::users_list_message);
-        DataProcess::GetInstance()->PushNewMessage(id, std::move(message));
+        MessageBroker::GetInstance()->PushMessage(id, std::move(message), message_lane_t::bulk);
     }
     catch (std::exception &ex)
     {
@@ -76,10 +97,10 @@ void UsersPool::DisconnectAllClients() const noexcept
 {
     try
     {
-        std::unique_lock lk(mutex_);
-        for (auto &client : clients)
+        /* disconnected client removes itself from the pool, so no lock is held here */
+        for (auto &client : GetClients())
         {
-            client.second->DisconnectClient();
+            client->DisconnectClient();
         }
     }
     catch (std::exception &ex)
@@ -102,6 +123,18 @@ const size_t UsersPool::GetUsersAmount() const noexcept
     return 0;
 }
 
+std::vector<AsyncClient::client_ptr> UsersPool::GetClients() const
+{
+    std::shared_lock lk(mutex_);
+    std::vector<AsyncClient::client_ptr> result;
+    result.reserve(clients.size());
+    for (auto &client : clients)
+    {
+        result.push_back(client.second);
+    }
+    return result;
+}
+
 std::string UsersPool::PrepareUsersIdsList() const
 {
     std::string usersIds = "";
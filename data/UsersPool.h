@@ -6,6 +6,7 @@
 #include <mutex>
 #include <shared_mutex>
 #include <set>
+#include <vector>
 
 #include "../core/AsyncClient.h"
 #include "../core/AsyncTcpConnection.h"
@@ -43,10 +44,14 @@ public:
     }
 
     void StoreNewClient(const T& id, AsyncClient::client_ptr& ptr) const noexcept;
+    /* newer session of the user takes the place of previous one, which is still closing */
+    void ReplaceClient(const T& id, AsyncClient::client_ptr& ptr) const noexcept;
     const AsyncClient::client_ptr GetClient(const T& id) const noexcept;
-    void RemoveExistedClient(const T& id) const noexcept;
+    /* with conn set, client is removed only if it still owns this connection */
+    bool RemoveExistedClient(const T& id, const AsyncTcpConnection* conn = nullptr) const noexcept;
     bool IsThereSuchClient(const T& id) const noexcept;
     void DisconnectAllClients() const noexcept;
     const size_t GetUsersAmount() const noexcept;
+    std::vector<AsyncClient::client_ptr> GetClients() const;
     void SendUsersListToUser(const T& id) const noexcept;
 };
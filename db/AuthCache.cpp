@@ -0,0 +1,161 @@
+/*****************************************************************
+ *  @file       AuthCache.cpp
+ *  @brief      Bounded in-memory cache of user records implementation
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+
+#include "AuthCache.h"
+
+#include <algorithm>
+#include <functional>
+
+#include <boost/format.hpp>
+
+#include "../log/Logger.h"
+#include "../log/Metrics.h"
+
+namespace {
+    Metrics::Counter& hits = Metrics::GetInstance()->GetCounter("auth_cache_hits_total");
+    Metrics::Counter& negativeHits = Metrics::GetInstance()->GetCounter("auth_cache_negative_hits_total");
+    Metrics::Counter& misses = Metrics::GetInstance()->GetCounter("auth_cache_misses_total");
+    Metrics::Counter& evictions = Metrics::GetInstance()->GetCounter("auth_cache_evictions_total");
+    Metrics::Counter& invalidations = Metrics::GetInstance()->GetCounter("auth_cache_invalidations_total");
+    Metrics::Gauge& entries = Metrics::GetInstance()->GetGauge("auth_cache_entries");
+}
+
+AuthCache::AuthCache(std::size_t capacity, std::chrono::seconds ttl, std::chrono::seconds negativeTtl) :
+    shardCapacity_(std::max<std::size_t>(capacity / shards_count, 1)),
+    protectedCapacity_(shardCapacity_ * protected_percent / 100),
+    ttl_(ttl),
+    negativeTtl_(negativeTtl)
+{
+    ConsoleLogger::Debug(boost::str(boost::format("Construct AuthCache class, capacity %1%") % capacity));
+}
+
+AuthCache::~AuthCache() {
+    ConsoleLogger::Debug("Destruct AuthCache class");
+}
+
+AuthCache::shard_t& AuthCache::GetShard(const std::string& login) {
+    return shards_[std::hash<std::string>{}(login) % shards_count];
+}
+
+const AuthCache::shard_t& AuthCache::GetShard(const std::string& login) const {
+    return shards_[std::hash<std::string>{}(login) % shards_count];
+}
+
+void AuthCache::Erase(shard_t& shard, list_t::iterator it) {
+    shard.index.erase(it->login);
+    (it->isProtected ? shard.protectedList : shard.probation).erase(it);
+    entries.Add(-1);
+}
+
+AuthCache::lookup_t AuthCache::Lookup(const std::string& login, std::optional<profile_t>& profile) {
+
+    auto& shard = GetShard(login);
+    std::unique_lock lk(shard.mutex);
+
+    auto found = shard.index.find(login);
+    if (found == shard.index.end()) {
+        misses.Inc();
+        return lookup_t::miss;
+    }
+
+    auto it = found->second;
+    if (it->expiresAt <= clock_t::now()) {
+        Erase(shard, it);
+        misses.Inc();
+        return lookup_t::miss;
+    }
+
+    if (it->isProtected) {
+        shard.protectedList.splice(shard.protectedList.begin(), shard.protectedList, it);
+    }
+    else {
+        /* second hit, record is worth keeping */
+        it->isProtected = true;
+        shard.protectedList.splice(shard.protectedList.begin(), shard.probation, it);
+        if (shard.protectedList.size() > protectedCapacity_) {
+            auto demoted = std::prev(shard.protectedList.end());
+            demoted->isProtected = false;
+            shard.probation.splice(shard.probation.begin(), shard.protectedList, demoted);
+        }
+    }
+
+    profile = it->profile;
+    if (profile) {
+        hits.Inc();
+        return lookup_t::hit;
+    }
+    negativeHits.Inc();
+    return lookup_t::negative_hit;
+}
+
+uint64_t AuthCache::GetEpoch(const std::string& login) const {
+    auto& shard = GetShard(login);
+    std::unique_lock lk(shard.mutex);
+    return shard.epoch;
+}
+
+void AuthCache::Store(const std::string& login, const std::optional<profile_t>& profile, uint64_t epoch) {
+
+    auto& shard = GetShard(login);
+    std::unique_lock lk(shard.mutex);
+
+    if (shard.epoch != epoch) {
+        return;
+    }
+
+    auto expiresAt = clock_t::now() + (profile ? ttl_ : negativeTtl_);
+    auto found = shard.index.find(login);
+    if (found != shard.index.end()) {
+        found->second->profile = profile;
+        found->second->expiresAt = expiresAt;
+        return;
+    }
+
+    shard.probation.push_front(node_t{ login, profile, expiresAt, false });
+    shard.index.emplace(login, shard.probation.begin());
+    entries.Add(1);
+
+    if (shard.index.size() > shardCapacity_) {
+        auto& victims = shard.probation.empty() ? shard.protectedList : shard.probation;
+        Erase(shard, std::prev(victims.end()));
+        evictions.Inc();
+    }
+}
+
+void AuthCache::Invalidate(const std::string& login) {
+
+    auto& shard = GetShard(login);
+    std::unique_lock lk(shard.mutex);
+
+    shard.epoch++;
+    auto found = shard.index.find(login);
+    if (found != shard.index.end()) {
+        Erase(shard, found->second);
+    }
+    invalidations.Inc();
+}
+
+void AuthCache::Clear() {
+    for (auto& shard : shards_) {
+        std::unique_lock lk(shard.mutex);
+        shard.epoch++;
+        entries.Add(-static_cast<int64_t>(shard.index.size()));
+        shard.index.clear();
+        shard.probation.clear();
+        shard.protectedList.clear();
+    }
+}
+
+std::size_t AuthCache::Size() const {
+    std::size_t size = 0;
+    for (auto& shard : shards_) {
+        std::unique_lock lk(shard.mutex);
+        size += shard.index.size();
+    }
+    return size;
+}
@@ -0,0 +1,94 @@
+/*****************************************************************
+ *  @file       AuthCache.h
+ *  @brief      Bounded in-memory cache of user records in front
+ *              of users table
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+#pragma once
+
+/* std C++ lib headers */
+#include <string>
+#include <list>
+#include <array>
+#include <optional>
+#include <unordered_map>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+
+/* segmented LRU: new records land in probation segment and are promoted
+ * to protected one only on second hit, so one pass of unique logins
+ * (reconnect storm, credential stuffing) can't flush the hot users.
+ * Unknown logins are cached as empty records with shorter TTL. */
+class AuthCache {
+
+public:
+
+    struct profile_t {
+        int32_t id;
+        std::string password;
+        bool active;
+    };
+
+    enum class lookup_t {
+        miss,
+        hit,
+        negative_hit,
+    };
+
+    AuthCache() = delete;
+    AuthCache(const AuthCache&) = delete;
+    AuthCache& operator=(const AuthCache&) = delete;
+
+    AuthCache(std::size_t capacity, std::chrono::seconds ttl, std::chrono::seconds negativeTtl);
+    ~AuthCache();
+
+    lookup_t Lookup(const std::string& login, std::optional<profile_t>& profile);
+
+    /* epoch must be taken before database request is sent, record is dropped if
+     * login was invalidated meanwhile, so stale answer can't overwrite fresh notify */
+    uint64_t GetEpoch(const std::string& login) const;
+    void Store(const std::string& login, const std::optional<profile_t>& profile, uint64_t epoch);
+
+    void Invalidate(const std::string& login);
+    void Clear();
+    std::size_t Size() const;
+
+private:
+
+    using clock_t = std::chrono::steady_clock;
+
+    struct node_t {
+        std::string login;
+        std::optional<profile_t> profile;
+        clock_t::time_point expiresAt;
+        bool isProtected;
+    };
+
+    using list_t = std::list<node_t>;
+
+    struct shard_t {
+        mutable std::mutex mutex;
+        list_t probation;
+        list_t protectedList;
+        std::unordered_map<std::string, list_t::iterator> index;
+        uint64_t epoch = 0;
+    };
+
+    static constexpr std::size_t shards_count = 16;
+    /* share of shard capacity reserved for records hit at least twice */
+    static constexpr std::size_t protected_percent = 80;
+
+    const std::size_t shardCapacity_;
+    const std::size_t protectedCapacity_;
+    const std::chrono::seconds ttl_;
+    const std::chrono::seconds negativeTtl_;
+
+    std::array<shard_t, shards_count> shards_;
+
+    shard_t& GetShard(const std::string& login);
+    const shard_t& GetShard(const std::string& login) const;
+    void Erase(shard_t& shard, list_t::iterator it);
+};
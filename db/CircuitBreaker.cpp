@@ -0,0 +1,97 @@
+/*****************************************************************
+ *  @file       CircuitBreaker.cpp
+ *  @brief      Health tracking of external backend implementation
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+
+#include "CircuitBreaker.h"
+
+#include <boost/format.hpp>
+
+#include "../log/Logger.h"
+
+CircuitBreaker::CircuitBreaker(const std::string& name, const config_t& config) :
+    name_(name), config_(config),
+    stateGauge_(Metrics::GetInstance()->GetGauge(boost::str(boost::format("backend_breaker_state{backend=\"%1%\"}") % name))),
+    opened_(Metrics::GetInstance()->GetCounter(boost::str(boost::format("backend_breaker_opened_total{backend=\"%1%\"}") % name))),
+    rejected_(Metrics::GetInstance()->GetCounter(boost::str(boost::format("backend_breaker_rejected_total{backend=\"%1%\"}") % name)))
+{
+    ConsoleLogger::Debug("Construct CircuitBreaker class");
+    stateGauge_.Set(static_cast<int64_t>(state_));
+}
+
+void CircuitBreaker::SetState(state_t state) noexcept {
+    state_ = state;
+    stateGauge_.Set(static_cast<int64_t>(state_));
+}
+
+CircuitBreaker::~CircuitBreaker() {
+    ConsoleLogger::Debug("Destruct CircuitBreaker class");
+}
+
+bool CircuitBreaker::Allow() noexcept {
+
+    std::unique_lock lk(mutex_);
+    if (state_ == state_t::closed) {
+        return true;
+    }
+
+    /* one probe per open period, so lost probe result can't keep breaker half open forever */
+    auto now = clock_t::now();
+    if (now < retryAt_) {
+        rejected_.Inc();
+        return false;
+    }
+    SetState(state_t::half_open);
+    retryAt_ = now + config_.openTime;
+    return true;
+}
+
+void CircuitBreaker::Record(bool success, std::chrono::steady_clock::duration latency) noexcept {
+
+    bool failed = !success || latency > config_.slowCall;
+    std::unique_lock lk(mutex_);
+
+    switch (state_) {
+        case state_t::closed:
+            failures_ = failed ? failures_ + 1 : 0;
+            if (failures_ >= config_.failureThreshold) {
+                Open(clock_t::now());
+            }
+            break;
+        case state_t::half_open:
+            if (failed) {
+                Open(clock_t::now());
+            }
+            else {
+                SetState(state_t::closed);
+                failures_ = 0;
+                ConsoleLogger::Info(boost::str(boost::format("Backend %1% recovered, circuit breaker closed") % name_));
+            }
+            break;
+        default:
+            /* calls allowed before breaker opened */
+            break;
+    }
+}
+
+void CircuitBreaker::Open(clock_t::time_point now) noexcept {
+    SetState(state_t::open);
+    failures_ = 0;
+    retryAt_ = now + config_.openTime;
+    opened_.Inc();
+    ConsoleLogger::Error(boost::str(boost::format("Backend %1% is failing, circuit breaker opened for %2% ms") %
+        name_ % config_.openTime.count()));
+}
+
+CircuitBreaker::state_t CircuitBreaker::GetState() const noexcept {
+    std::unique_lock lk(mutex_);
+    return state_;
+}
+
+std::chrono::steady_clock::time_point CircuitBreaker::GetRetryTime() const noexcept {
+    std::unique_lock lk(mutex_);
+    return state_ == state_t::closed ? clock_t::now() : retryAt_;
+}
@@ -0,0 +1,74 @@
+/*****************************************************************
+ *  @file       CircuitBreaker.h
+ *  @brief      Health tracking of external backend, stops calls
+ *              to it while it fails
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+#pragma once
+
+/* std C++ lib headers */
+#include <string>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+
+#include "../log/Metrics.h"
+
+/* closed: calls pass, consecutive failures (errors or calls slower than
+ * slowCall) open the breaker; open: calls are rejected without touching
+ * backend until openTime passes; half open: single probe call decides
+ * whether breaker closes or opens again */
+class CircuitBreaker {
+
+public:
+
+    enum class state_t {
+        closed = 0,
+        open,
+        half_open,
+    };
+
+    struct config_t {
+        uint32_t failureThreshold = 5;
+        std::chrono::milliseconds openTime{ 2000 };
+        std::chrono::milliseconds slowCall{ 1000 };
+    };
+
+    CircuitBreaker() = delete;
+    CircuitBreaker(const CircuitBreaker&) = delete;
+    CircuitBreaker& operator=(const CircuitBreaker&) = delete;
+
+    /* name labels metrics of backend */
+    CircuitBreaker(const std::string& name, const config_t& config);
+    ~CircuitBreaker();
+
+    /* false when call must not be made */
+    bool Allow() noexcept;
+    /* result of call permitted by Allow() */
+    void Record(bool success, std::chrono::steady_clock::duration latency) noexcept;
+
+    state_t GetState() const noexcept;
+    /* when open breaker lets the next probe through */
+    std::chrono::steady_clock::time_point GetRetryTime() const noexcept;
+
+private:
+
+    using clock_t = std::chrono::steady_clock;
+
+    const std::string name_;
+    const config_t config_;
+
+    state_t state_ = state_t::closed;
+    uint32_t failures_ = 0;
+    clock_t::time_point retryAt_;
+    mutable std::mutex mutex_;
+
+    Metrics::Gauge& stateGauge_;
+    Metrics::Counter& opened_;
+    Metrics::Counter& rejected_;
+
+    void SetState(state_t state) noexcept;
+    void Open(clock_t::time_point now) noexcept;
+};
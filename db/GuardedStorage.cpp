@@ -0,0 +1,403 @@
+/*****************************************************************
+ *  @file       GuardedStorage.cpp
+ *  @brief      Message storage decorator implementation
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+
+#include "GuardedStorage.h"
+
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <filesystem>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <boost/crc.hpp>
+#include <boost/format.hpp>
+
+#include "../log/Logger.h"
+#include "../log/Metrics.h"
+
+namespace {
+    Metrics::Counter& spilledTotal = Metrics::GetInstance()->GetCounter("storage_spilled_total");
+    Metrics::Counter& replayedTotal = Metrics::GetInstance()->GetCounter("storage_replayed_total");
+    Metrics::Counter& droppedTotal = Metrics::GetInstance()->GetCounter("storage_spill_dropped_total");
+    Metrics::Counter& deadLetterTotal = Metrics::GetInstance()->GetCounter("storage_dead_letter_total");
+    Metrics::Gauge& backlog = Metrics::GetInstance()->GetGauge("storage_backlog_messages");
+
+    void WriteAll(int fd, const char* data, std::size_t size, off_t offset) {
+        while (size > 0) {
+            auto n = ::pwrite(fd, data, size, offset);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error(std::string("Spill write failed: ") + std::strerror(errno));
+            }
+            data += n;
+            size -= static_cast<std::size_t>(n);
+            offset += n;
+        }
+    }
+
+    std::size_t MemorySize(const IMessageStorage::message_t& msg) {
+        return sizeof(msg) + msg.text.size();
+    }
+}
+
+GuardedStorage::GuardedStorage(std::unique_ptr<IMessageStorage>&& backend, const std::string& name, const config_t& config) :
+    config_(config),
+    backend_(std::move(backend)),
+    breaker_(name, config.breaker)
+{
+    ConsoleLogger::Debug("Construct GuardedStorage class");
+    std::filesystem::create_directories(config_.spillDirectory);
+    spillPath_ = (std::filesystem::path(config_.spillDirectory) / (name + ".spill")).string();
+    deadLetterPath_ = (std::filesystem::path(config_.spillDirectory) / (name + ".dead")).string();
+    OpenSpill();
+    UpdateBacklog();
+    if (spilled_ > 0) {
+        ConsoleLogger::Info(boost::str(boost::format("%1% messages of previous run will be replayed to %2%") %
+            spilled_ % name));
+    }
+    writer_ = std::thread([this]() { Writer(); });
+}
+
+GuardedStorage::~GuardedStorage() {
+    {
+        std::unique_lock lk(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    writer_.join();
+
+    SaveBacklog();
+    if (spillFd_ >= 0) {
+        ::close(spillFd_);
+    }
+    ConsoleLogger::Debug("Destruct GuardedStorage class");
+}
+
+uint32_t GuardedStorage::Checksum(const spill_header_t& header, const std::string& text) {
+    spill_header_t h = header;
+    h.crc = 0;
+    boost::crc_32_type crc;
+    crc.process_bytes(&h, sizeof(h));
+    crc.process_bytes(text.data(), text.size());
+    return crc.checksum();
+}
+
+void GuardedStorage::OpenSpill() {
+
+    spillFd_ = ::open(spillPath_.c_str(), O_RDWR | O_CREAT, 0644);
+    if (spillFd_ < 0) {
+        throw std::runtime_error("Spill file can't be opened: " + spillPath_);
+    }
+    struct stat st {};
+    ::fstat(spillFd_, &st);
+    writeOffset_ = static_cast<uint64_t>(st.st_size);
+
+    /* messages left by previous run, torn tail is cut */
+    uint64_t offset = 0, next = 0;
+    message_t msg;
+    while (offset < writeOffset_ && ReadSpill(offset, msg, next)) {
+        offset = next;
+        spilled_++;
+    }
+    if (offset != writeOffset_) {
+        ConsoleLogger::Error(boost::str(boost::format("Spill file %1% is truncated from %2% to %3% bytes") %
+            spillPath_ % writeOffset_ % offset));
+        if (::ftruncate(spillFd_, static_cast<off_t>(offset)) != 0) {
+            throw std::runtime_error("Spill file can't be truncated: " + spillPath_);
+        }
+        writeOffset_ = offset;
+    }
+}
+
+bool GuardedStorage::ReadSpill(uint64_t offset, message_t& msg, uint64_t& nextOffset) const {
+
+    spill_header_t header;
+    if (offset + sizeof(header) > writeOffset_ ||
+        ::pread(spillFd_, &header, sizeof(header), static_cast<off_t>(offset)) != static_cast<ssize_t>(sizeof(header)) ||
+        offset + sizeof(header) + header.size > writeOffset_) {
+        return false;
+    }
+    msg.text.resize(header.size);
+    if (::pread(spillFd_, msg.text.data(), header.size, static_cast<off_t>(offset + sizeof(header))) !=
+        static_cast<ssize_t>(header.size) || Checksum(header, msg.text) != header.crc) {
+        return false;
+    }
+    msg.src = header.src;
+    msg.dst = header.dst;
+    msg.timestampMs = header.timestampMs;
+    nextOffset = offset + sizeof(header) + header.size;
+    return true;
+}
+
+std::string GuardedStorage::MakeRecord(const message_t& msg) {
+
+    spill_header_t header{ static_cast<uint32_t>(msg.text.size()), 0, msg.src, msg.dst, msg.timestampMs };
+    header.crc = Checksum(header, msg.text);
+    std::string record(reinterpret_cast<const char*>(&header), sizeof(header));
+    record += msg.text;
+    return record;
+}
+
+bool GuardedStorage::Spill(const message_t& msg) {
+
+    if (writeOffset_ - readOffset_ + sizeof(spill_header_t) + msg.text.size() > config_.maxDiskBytes) {
+        return false;
+    }
+    auto record = MakeRecord(msg);
+    WriteAll(spillFd_, record.data(), record.size(), static_cast<off_t>(writeOffset_));
+    writeOffset_ += record.size();
+    spilled_++;
+    spilledTotal.Inc();
+    return true;
+}
+
+bool GuardedStorage::Store(message_t&& msg) noexcept {
+
+    try {
+        {
+            std::unique_lock lk(mutex_);
+            /* once spilling started, new messages follow spilled ones to keep arrival order */
+            if (spilled_ == 0 && memoryBytes_ + MemorySize(msg) <= config_.maxMemoryBytes) {
+                memoryBytes_ += MemorySize(msg);
+                memory_.push_back(std::move(msg));
+            }
+            else if (!Spill(msg)) {
+                droppedTotal.Inc();
+                return false;
+            }
+            UpdateBacklog();
+        }
+        cv_.notify_one();
+        return true;
+    }
+    catch (std::exception& ex) {
+        droppedTotal.Inc();
+        ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
+    }
+    return false;
+}
+
+bool GuardedStorage::Next(message_t& msg, uint64_t& nextOffset) {
+    if (!memory_.empty()) {
+        msg = memory_.front();
+        return true;
+    }
+    if (!ReadSpill(readOffset_, msg, nextOffset)) {
+        /* unreadable spill can't be replayed past the broken record */
+        ConsoleLogger::Error(boost::str(boost::format("Spill file %1% is corrupted, %2% messages dropped") %
+            spillPath_ % spilled_));
+        droppedTotal.Inc(spilled_);
+        spilled_ = 0;
+        Pop(false, writeOffset_);
+        return false;
+    }
+    return true;
+}
+
+void GuardedStorage::Pop(bool fromMemory, uint64_t nextOffset) {
+
+    if (fromMemory) {
+        memoryBytes_ -= MemorySize(memory_.front());
+        memory_.pop_front();
+    }
+    else {
+        readOffset_ = nextOffset;
+        if (spilled_ > 0) {
+            spilled_--;
+            replayedTotal.Inc();
+        }
+        if (spilled_ == 0) {
+            /* whole file is replayed, start it over */
+            readOffset_ = writeOffset_ = 0;
+            if (::ftruncate(spillFd_, 0) != 0) {
+                ConsoleLogger::Error("Spill file can't be truncated: " + spillPath_);
+            }
+        }
+    }
+    UpdateBacklog();
+}
+
+/* dead letter file has spill format, it can be replayed by hand after the cause is fixed */
+void GuardedStorage::DeadLetter(const message_t& msg) noexcept {
+
+    deadLetterTotal.Inc();
+    ConsoleLogger::Error(boost::str(boost::format("Message %1%->%2% at %3% failed %4% times, moved to %5%") %
+        msg.src % msg.dst % msg.timestampMs % config_.maxAttempts % deadLetterPath_));
+    try {
+        int fd = ::open(deadLetterPath_.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("Dead letter file can't be opened: " + deadLetterPath_);
+        }
+        struct stat st {};
+        ::fstat(fd, &st);
+        auto record = MakeRecord(msg);
+        try {
+            WriteAll(fd, record.data(), record.size(), st.st_size);
+        }
+        catch (...) {
+            ::close(fd);
+            throw;
+        }
+        ::fdatasync(fd);
+        ::close(fd);
+    }
+    catch (std::exception& ex) {
+        ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
+    }
+}
+
+void GuardedStorage::Writer() noexcept {
+
+    /* refusals of the current queue head by otherwise healthy backend */
+    uint32_t attempts = 0;
+
+    for (;;) {
+        message_t msg;
+        uint64_t nextOffset = 0;
+        bool fromMemory = false;
+
+        try {
+            {
+                std::unique_lock lk(mutex_);
+                cv_.wait(lk, [&]() { return stop_ || !memory_.empty() || spilled_ > 0; });
+                if (stop_) {
+                    break;
+                }
+            }
+
+            /* backend is not called at all while it is known to be down */
+            if (!breaker_.Allow()) {
+                std::unique_lock lk(mutex_);
+                cv_.wait_until(lk, breaker_.GetRetryTime(), [&]() { return stop_.load(); });
+                continue;
+            }
+
+            {
+                std::unique_lock lk(mutex_);
+                fromMemory = !memory_.empty();
+                if (!Next(msg, nextOffset)) {
+                    attempts = 0;
+                    continue;
+                }
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            bool ok = backend_->Store(message_t{ msg });
+            breaker_.Record(ok, std::chrono::steady_clock::now() - start);
+
+            if (ok) {
+                std::unique_lock lk(mutex_);
+                Pop(fromMemory, nextOffset);
+                attempts = 0;
+            }
+            else if (!Answers(msg)) {
+                /* backend is down rather than refusing this message */
+                attempts = 0;
+            }
+            else if (++attempts >= config_.maxAttempts) {
+                /* head which backend keeps refusing must not hold the rest of the queue */
+                DeadLetter(msg);
+                std::unique_lock lk(mutex_);
+                Pop(fromMemory, nextOffset);
+                attempts = 0;
+            }
+        }
+        catch (std::exception& ex) {
+            ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
+        }
+    }
+}
+
+/* read of the refused message's conversation tells outage from refusal of the message itself */
+bool GuardedStorage::Answers(const message_t& msg) const noexcept {
+    try {
+        backend_->Read(ConversationKey(msg.src, msg.dst), msg.timestampMs, msg.timestampMs, 1, true);
+        return true;
+    }
+    catch (std::exception&) {
+        return false;
+    }
+}
+
+void GuardedStorage::SaveBacklog() noexcept {
+
+    try {
+        if (memory_.empty() && readOffset_ == 0) {
+            ::fsync(spillFd_);
+            return;
+        }
+
+        /* memory queue is older than spilled messages, replayed part of file is skipped */
+        auto tmpPath = spillPath_ + ".tmp";
+        int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("Spill file can't be created: " + tmpPath);
+        }
+        uint64_t offset = 0;
+        for (const auto& msg : memory_) {
+            auto record = MakeRecord(msg);
+            WriteAll(fd, record.data(), record.size(), static_cast<off_t>(offset));
+            offset += record.size();
+        }
+        std::string chunk(1024 * 1024, '\0');
+        for (uint64_t pos = readOffset_; pos < writeOffset_; ) {
+            auto n = ::pread(spillFd_, chunk.data(), std::min<uint64_t>(chunk.size(), writeOffset_ - pos), static_cast<off_t>(pos));
+            if (n <= 0) {
+                break;
+            }
+            WriteAll(fd, chunk.data(), static_cast<std::size_t>(n), static_cast<off_t>(offset));
+            offset += static_cast<uint64_t>(n);
+            pos += static_cast<uint64_t>(n);
+        }
+        ::fsync(fd);
+        ::close(fd);
+        std::filesystem::rename(tmpPath, spillPath_);
+
+        ConsoleLogger::Info(boost::str(boost::format("%1% undelivered messages saved to %2%") %
+            (memory_.size() + spilled_) % spillPath_));
+    }
+    catch (std::exception& ex) {
+        ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
+    }
+}
+
+void GuardedStorage::UpdateBacklog() noexcept {
+    backlog.Set(static_cast<int64_t>(memory_.size() + spilled_));
+}
+
+std::vector<IMessageStorage::message_t> GuardedStorage::Read(uint64_t conversation, uint64_t fromMs, uint64_t toMs,
+    std::size_t limit, bool latest) const {
+
+    if (!breaker_.Allow()) {
+        throw std::runtime_error("message storage is unavailable");
+    }
+    auto start = std::chrono::steady_clock::now();
+    try {
+        auto page = backend_->Read(conversation, fromMs, toMs, limit, latest);
+        breaker_.Record(true, std::chrono::steady_clock::now() - start);
+        return page;
+    }
+    catch (...) {
+        breaker_.Record(false, std::chrono::steady_clock::now() - start);
+        throw;
+    }
+}
+
+std::size_t GuardedStorage::GetBacklog() const noexcept {
+    std::unique_lock lk(mutex_);
+    return memory_.size() + spilled_;
+}
+
+CircuitBreaker::state_t GuardedStorage::GetState() const noexcept {
+    return breaker_.GetState();
+}
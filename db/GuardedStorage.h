@@ -0,0 +1,104 @@
+/*****************************************************************
+ *  @file       GuardedStorage.h
+ *  @brief      Message storage decorator which keeps dispatcher
+ *              independent of remote backend health
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+#pragma once
+
+/* std C++ lib headers */
+#include <string>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "IMessageStorage.h"
+#include "CircuitBreaker.h"
+
+/* Store only queues the message, writer thread passes queue to backend
+ * through circuit breaker. While backend is down messages wait in memory,
+ * above memory limit they are spilled to file, above disk limit they are
+ * dropped. Queue is replayed in arrival order when breaker probe succeeds,
+ * backlog left at stop is saved to spill file and replayed on next start.
+ * Message refused maxAttempts times while backend still answers reads is
+ * moved to dead letter file so it can't block the queue; refusals during
+ * outage, when reads fail as well, don't count against the message.
+ * Reads fail fast while breaker is open. */
+class GuardedStorage : public IMessageStorage {
+
+public:
+
+    struct config_t {
+        std::string spillDirectory;
+        std::size_t maxMemoryBytes = 64 * 1024 * 1024;
+        std::size_t maxDiskBytes = 1024ull * 1024 * 1024;
+        uint32_t maxAttempts = 20;
+        CircuitBreaker::config_t breaker;
+    };
+
+    GuardedStorage() = delete;
+    GuardedStorage(const GuardedStorage&) = delete;
+    GuardedStorage& operator=(const GuardedStorage&) = delete;
+
+    GuardedStorage(std::unique_ptr<IMessageStorage>&& backend, const std::string& name, const config_t& config);
+    ~GuardedStorage() override;
+
+    /* never waits for backend, false only when spill limits are exhausted */
+    bool Store(message_t&& msg) noexcept override;
+    std::vector<message_t> Read(uint64_t conversation, uint64_t fromMs, uint64_t toMs,
+        std::size_t limit, bool latest) const override;
+
+    /* messages accepted but not yet written to backend */
+    std::size_t GetBacklog() const noexcept;
+    CircuitBreaker::state_t GetState() const noexcept;
+
+private:
+
+    struct spill_header_t {
+        uint32_t size;
+        uint32_t crc;
+        uint32_t src;
+        uint32_t dst;
+        uint64_t timestampMs;
+    };
+
+    const config_t config_;
+    const std::unique_ptr<IMessageStorage> backend_;
+    mutable CircuitBreaker breaker_;
+
+    std::deque<message_t> memory_;
+    std::size_t memoryBytes_ = 0;
+
+    /* spill file is a FIFO: appended at writeOffset, replayed from readOffset */
+    std::string spillPath_;
+    int spillFd_ = -1;
+    uint64_t readOffset_ = 0;
+    uint64_t writeOffset_ = 0;
+    std::size_t spilled_ = 0;
+    std::string deadLetterPath_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::atomic_bool stop_{ false };
+    std::thread writer_;
+
+    void Writer() noexcept;
+    bool Next(message_t& msg, uint64_t& nextOffset);
+    void Pop(bool fromMemory, uint64_t nextOffset);
+    bool Spill(const message_t& msg);
+    void DeadLetter(const message_t& msg) noexcept;
+    bool Answers(const message_t& msg) const noexcept;
+    static std::string MakeRecord(const message_t& msg);
+    bool ReadSpill(uint64_t offset, message_t& msg, uint64_t& nextOffset) const;
+    void OpenSpill();
+    void SaveBacklog() noexcept;
+    void UpdateBacklog() noexcept;
+    static uint32_t Checksum(const spill_header_t& header, const std::string& text);
+};
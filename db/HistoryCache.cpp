@@ -0,0 +1,103 @@
+/*****************************************************************
+ *  @file       HistoryCache.cpp
+ *  @brief      Recent messages of active conversations implementation
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+
+#include "HistoryCache.h"
+
+#include <algorithm>
+
+#include "../log/Logger.h"
+
+HistoryCache::HistoryCache(std::size_t conversations, std::size_t depth) :
+    conversations_(std::max<std::size_t>(conversations, 1)),
+    depth_(std::max<std::size_t>(depth, 1))
+{
+    ConsoleLogger::Debug("Construct HistoryCache class");
+}
+
+HistoryCache::~HistoryCache() {
+    ConsoleLogger::Debug("Destruct HistoryCache class");
+}
+
+void HistoryCache::Append(const message_t& msg) {
+
+    uint64_t key = IMessageStorage::ConversationKey(msg.src, msg.dst);
+    std::unique_lock lk(mutex_);
+
+    auto it = rings_.find(key);
+    if (it == rings_.end()) {
+        if (rings_.size() >= conversations_) {
+            rings_.erase(lru_.back());
+            lru_.pop_back();
+        }
+        lru_.push_front(key);
+        it = rings_.emplace(key, ring_t{}).first;
+        it->second.messages.reserve(depth_);
+        it->second.lru = lru_.begin();
+        /* older messages of conversation may be in storage only */
+        it->second.floorMs = msg.timestampMs;
+    }
+    else {
+        lru_.splice(lru_.begin(), lru_, it->second.lru);
+    }
+
+    auto& ring = it->second;
+    if (ring.count < depth_) {
+        ring.messages.push_back(msg);
+        ring.count++;
+        return;
+    }
+    /* overwrite the oldest one, messages with its timestamp aren't complete anymore */
+    ring.floorMs = std::max(ring.floorMs, ring.messages[ring.head].timestampMs + 1);
+    ring.messages[ring.head] = msg;
+    ring.head = (ring.head + 1) % depth_;
+}
+
+std::optional<std::vector<HistoryCache::message_t>> HistoryCache::Read(uint64_t conversation, uint64_t fromMs,
+    uint64_t toMs, std::size_t limit, bool latest) const {
+
+    std::unique_lock lk(mutex_);
+    auto it = rings_.find(conversation);
+    if (it == rings_.end()) {
+        return std::nullopt;
+    }
+    const auto& ring = it->second;
+
+    std::vector<message_t> page;
+    for (std::size_t i = 0; i < ring.count; ++i) {
+        const auto& msg = ring.messages[(ring.head + i) % ring.messages.size()];
+        if (msg.timestampMs >= fromMs && msg.timestampMs <= toMs) {
+            page.push_back(msg);
+        }
+    }
+    std::stable_sort(page.begin(), page.end(), [](const message_t& l, const message_t& r) {
+        return l.timestampMs < r.timestampMs;
+    });
+
+    /* hot if whole range is covered, or the latest page doesn't reach below floor */
+    bool covered = fromMs >= ring.floorMs ||
+        (latest && page.size() >= limit && limit > 0 && page[page.size() - limit].timestampMs >= ring.floorMs);
+    if (!covered) {
+        return std::nullopt;
+    }
+    lru_.splice(lru_.begin(), lru_, ring.lru);
+
+    if (page.size() > limit) {
+        if (latest) {
+            page.erase(page.begin(), page.end() - static_cast<std::ptrdiff_t>(limit));
+        }
+        else {
+            page.resize(limit);
+        }
+    }
+    return page;
+}
+
+std::size_t HistoryCache::Size() const {
+    std::unique_lock lk(mutex_);
+    return rings_.size();
+}
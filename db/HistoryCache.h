@@ -0,0 +1,62 @@
+/*****************************************************************
+ *  @file       HistoryCache.h
+ *  @brief      Recent messages of active conversations kept in
+ *              memory in front of message storage
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+#pragma once
+
+/* std C++ lib headers */
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <optional>
+#include <mutex>
+#include <cstdint>
+
+#include "IMessageStorage.h"
+
+/* Ring of the latest messages per conversation, least recently used
+ * conversations are evicted. Ring is created by the first message stored
+ * after start and covers every message from its floor timestamp, so page
+ * is served from memory only when it can't miss older stored messages. */
+class HistoryCache {
+
+public:
+
+    using message_t = IMessageStorage::message_t;
+
+    HistoryCache() = delete;
+    HistoryCache(const HistoryCache&) = delete;
+    HistoryCache& operator=(const HistoryCache&) = delete;
+
+    HistoryCache(std::size_t conversations, std::size_t depth);
+    ~HistoryCache();
+
+    void Append(const message_t& msg);
+
+    /* same contract as IMessageStorage::Read, nullopt when page is cold */
+    std::optional<std::vector<message_t>> Read(uint64_t conversation, uint64_t fromMs, uint64_t toMs,
+        std::size_t limit, bool latest) const;
+
+    std::size_t Size() const;
+
+private:
+
+    struct ring_t {
+        std::vector<message_t> messages;    // circular, capacity is depth
+        std::size_t head = 0;               // index of the oldest message
+        std::size_t count = 0;
+        uint64_t floorMs = 0;               // every message since then is in ring
+        std::list<uint64_t>::iterator lru;
+    };
+
+    const std::size_t conversations_;
+    const std::size_t depth_;
+
+    mutable std::unordered_map<uint64_t, ring_t> rings_;
+    mutable std::list<uint64_t> lru_;   // most recent first
+    mutable std::mutex mutex_;
+};
@@ -0,0 +1,44 @@
+/*****************************************************************
+ *  @file       IMessageStorage.h
+ *  @brief      Interface of persistent storage for users messages
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+#pragma once
+
+/* std C++ lib headers */
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+class IMessageStorage {
+
+public:
+
+    struct message_t {
+        uint32_t src;
+        uint32_t dst;
+        uint64_t timestampMs;   // server receive time, unix epoch
+        std::string text;
+    };
+
+    virtual ~IMessageStorage() = default;
+
+    /* called by dispatcher thread for every user message, false when message is lost */
+    virtual bool Store(message_t&& msg) noexcept = 0;
+
+    /* messages of conversation within [fromMs, toMs] in chronological order,
+     * at most limit of the latest (or of the earliest) ones; throws when backend fails */
+    virtual std::vector<message_t> Read(uint64_t conversation, uint64_t fromMs, uint64_t toMs,
+        std::size_t limit, bool latest) const = 0;
+
+    /* conversation of two users doesn't depend on direction of message */
+    static uint64_t ConversationKey(uint32_t a, uint32_t b) noexcept {
+        return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+    }
+
+    /* engine is selected by "message_storage" key of server.ini: mongo (default) or log */
+    static std::unique_ptr<IMessageStorage> Create();
+};
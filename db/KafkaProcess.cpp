@@ -1,138 +1,360 @@
+/*****************************************************************
+ *  @file       KafkaProcess.cpp
+ *  @brief      Asynchronous export of chat events implementation
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
 
-// #include "KafkaProcess.h"
-
-// #include <iostream>
-// #include <string>
-
-// #include <stdexcept>
-// #include <iostream>
-// #include <csignal>
-// #include <boost/program_options.hpp>
-// #include "cppkafka/consumer.h"
-// #include "cppkafka/configuration.h"
-
-// // #include <boost/asio.hpp>
-
-// // #include <librdkafka/rdkafkacpp.h>
-// // #include <librdkafka/rdkafka.h>
-
-// #include <cppkafka/cppkafka.h>
-
-// void KafkaProcess::CreateKafkaConsumer()
-// {
-//     std::cout << __func__ << "\n";
-
-//     using namespace cppkafka;
-//     using namespace std;
-
-//     string brokers = "127.0.0.1:9092";
-//     string topic_name = "test-topic";
-//     string group_id = "test-consumer-group";
-
-//     // Construct the configuration
-//     Configuration config = {
-//         {"bootstrap.servers", brokers},
-//         {"group.id", group_id},
-//         // Disable auto commit
-//         {"enable.auto.commit", false}};
-
-//     // Create the consumer
-//     Consumer consumer(config);
-
-//     // Print the assigned partitions on assignment
-//     consumer.set_assignment_callback([](const TopicPartitionList &partitions)
-//                                      { cout << "Got assigned: " << partitions << endl; });
-
-//     // Print the revoked partitions on revocation
-//     consumer.set_revocation_callback([](const TopicPartitionList &partitions)
-//                                      { cout << "Got revoked: " << partitions << endl; });
-
-//     // Subscribe to the topic
-//     consumer.subscribe({topic_name});
-
-//     cout << "Consuming messages from topic " << topic_name << endl;
-
-//     // Now read lines and write them into kafka
-//     while (true)
-//     {
-//         // Try to consume a message
-//         Message msg = consumer.poll();
-//         if (msg)
-//         {
-//             // If we managed to get a message
-//             if (msg.get_error())
-//             {
-//                 // Ignore EOF notifications from rdkafka
-//                 if (!msg.is_eof())
-//                 {
-//                     cout << "[+] Received error notification: " << msg.get_error() << endl;
-//                 }
-//             }
-//             else
-//             {
-//                 // Print the key (if any)
-//                 if (msg.get_key())
-//                 {
-//                     cout << msg.get_key() << " -> ";
-//                 }
-//                 // Print the payload
-//                 cout << "Received: " << msg.get_payload() << endl;
-//                 // Now commit the message
-//                 consumer.commit(msg);
-//             }
-//         }
-//     }
-// }
-
-// void KafkaProcess::CreateKafkaProducer()
-// {
-//     std::cout << __func__ << "\n";
-//     using namespace cppkafka;
-//     using namespace std;
-
-//     string brokers = "127.0.0.1:9092";
-//     string topic_name = "test-topic";
-//     int partition_value = 1;
-
-//     // Create a message builder for this topic
-//     MessageBuilder builder(topic_name);
-
-//     // Construct the configuration
-//     Configuration config = {
-//         { "bootstrap.servers", brokers }
-//     };
-
-//     // Create the producer
-//     Producer producer(config);
-
-//     cout << "Producing messages into topic " << topic_name << endl;
-
-//     // Now read lines and write them into kafka
-//     string line = "hello";
-//     while (getline(cin, line)) {
-//         // Set the payload on this builder
-//         builder.payload(line);
-
-//         // Actually produce the message we've built
-//         producer.produce(builder);
-//     }
-    
-//     // Flush all produced messages
-//     producer.flush();
-// }
-
-// KafkaProcess::KafkaProcess()
-// {
-//     std::cout << "Construct KafkaProcess class\n";
-//     auto t1 = std::thread{ [&] () { CreateKafkaProducer(); }};
-//     auto t2 = std::thread{ [&] () { CreateKafkaConsumer(); }};
-
-//     t1.join();
-//     t2.join();
-//     // CreateKafkaConsumer();
-// }
-
-// KafkaProcess::~KafkaProcess()
-// {
-//     std::cout << "Destruct KafkaProcess class\n";
-// }
\ No newline at end of file
+#include "KafkaProcess.h"
+
+#include <stdexcept>
+#include <algorithm>
+
+#include <boost/format.hpp>
+
+#if USE_CPPKAFKA
+#include <cppkafka/cppkafka.h>
+#endif // USE_CPPKAFKA
+
+#include "../log/Logger.h"
+#include "../log/Metrics.h"
+
+namespace {
+    Metrics::Counter& produced = Metrics::GetInstance()->GetCounter("kafka_produced_total");
+    Metrics::Counter& delivered = Metrics::GetInstance()->GetCounter("kafka_delivered_total");
+    Metrics::Counter& failed = Metrics::GetInstance()->GetCounter("kafka_delivery_failed_total");
+    Metrics::Counter& dropped = Metrics::GetInstance()->GetCounter("kafka_dropped_total");
+    Metrics::Gauge& buffered = Metrics::GetInstance()->GetGauge("kafka_buffered_events");
+    Metrics::Gauge& inFlight = Metrics::GetInstance()->GetGauge("kafka_in_flight");
+    Metrics::Histogram& deliveryLatency = Metrics::GetInstance()->GetHistogram("kafka_delivery_latency_us");
+
+    void AppendJsonString(std::string& out, const std::string& text) {
+        static const char hex[] = "0123456789abcdef";
+        out += '"';
+        for (unsigned char c : text) {
+            switch (c) {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                default:
+                    if (c < 0x20) {
+                        out += "\\u00";
+                        out += hex[c >> 4];
+                        out += hex[c & 0xf];
+                    }
+                    else {
+                        out += static_cast<char>(c);
+                    }
+            }
+        }
+        out += '"';
+    }
+
+#if USE_CPPKAFKA
+    class CppKafkaProducer : public IEventProducer {
+
+    public:
+
+        explicit CppKafkaProducer(const KafkaProcess::config_t& config) :
+            producer_(MakeConfiguration(config, this))
+        {
+        }
+
+        void SetDeliveryCallback(delivery_callback_t&& cb) override {
+            cb_ = std::move(cb);
+        }
+
+        bool Produce(const record_t& record) override {
+            /* copy of record travels with message as opaque and comes back in delivery report */
+            auto opaque = std::make_unique<record_t>(record);
+            cppkafka::MessageBuilder builder(record.topic);
+            builder.key(opaque->key).payload(opaque->payload).user_data(opaque.get());
+            if (record.partition != UNASSIGNED_PARTITION) {
+                builder.partition(record.partition);
+            }
+            try {
+                producer_.produce(builder);
+            }
+            catch (cppkafka::HandleException& ex) {
+                if (ex.get_error().get_error() == RD_KAFKA_RESP_ERR__QUEUE_FULL) {
+                    return false;
+                }
+                throw;
+            }
+            opaque.release();
+            return true;
+        }
+
+        void Poll(std::chrono::milliseconds timeout) override {
+            producer_.poll(timeout);
+        }
+
+        bool Flush(std::chrono::milliseconds timeout) override {
+            try {
+                producer_.flush(timeout);
+            }
+            catch (cppkafka::HandleException&) {
+                return false;
+            }
+            return producer_.get_out_queue_length() == 0;
+        }
+
+    private:
+
+        delivery_callback_t cb_;
+        cppkafka::Producer producer_;
+
+        static cppkafka::Configuration MakeConfiguration(const KafkaProcess::config_t& config, CppKafkaProducer* self) {
+            /* client batches records of partition up to linger time and compresses batch as a whole */
+            cppkafka::Configuration conf = {
+                { "bootstrap.servers", config.brokers },
+                { "linger.ms", std::to_string(config.linger.count()) },
+                { "batch.num.messages", std::to_string(config.batchSize) },
+                { "compression.codec", config.compression },
+                { "acks", config.acks },
+                { "queue.buffering.max.kbytes", std::to_string(std::max<std::size_t>(config.maxBufferBytes / 1024, 1)) },
+            };
+            conf.set_delivery_report_callback([self](cppkafka::Producer&, const cppkafka::Message& msg) {
+                std::unique_ptr<record_t> record(static_cast<record_t*>(msg.get_user_data()));
+                if (record && self->cb_) {
+                    self->cb_(*record, !msg.get_error());
+                }
+            });
+            return conf;
+        }
+    };
+#endif // USE_CPPKAFKA
+
+    std::unique_ptr<IEventProducer> CreateProducer(const KafkaProcess::config_t& config) {
+#if USE_CPPKAFKA
+        return std::make_unique<CppKafkaProducer>(config);
+#else
+        (void)config;
+        throw std::runtime_error("Server is built without Kafka support");
+#endif // USE_CPPKAFKA
+    }
+}
+
+std::shared_ptr<KafkaProcess> KafkaProcess::kp_ = nullptr;
+
+KafkaProcess::KafkaProcess() {
+    ConsoleLogger::Debug("Construct KafkaProcess class");
+}
+
+KafkaProcess::~KafkaProcess() {
+    Close();
+    ConsoleLogger::Debug("Destruct KafkaProcess class");
+}
+
+void KafkaProcess::Open(const config_t& config, std::unique_ptr<IEventProducer>&& producer) {
+
+    std::unique_lock lk(mutex_);
+    if (open_) {
+        throw std::runtime_error("Kafka export is already open");
+    }
+    config_ = config;
+    config_.batchSize = std::max<uint32_t>(config_.batchSize, 1);
+    producer_ = producer ? std::move(producer) : CreateProducer(config_);
+    producer_->SetDeliveryCallback([this](const IEventProducer::record_t& record, bool ok) {
+        OnDelivery(record, ok);
+    });
+
+    open_ = true;
+    stop_ = false;
+    exporter_ = std::thread([this]() { Exporter(); });
+
+    ConsoleLogger::Info(boost::str(boost::format("Events are exported to Kafka %1%: %2%, %3%") %
+        config_.brokers % config_.messagesTopic % config_.presenceTopic));
+}
+
+void KafkaProcess::Close() noexcept {
+
+    {
+        std::unique_lock lk(mutex_);
+        if (!open_ || stop_) {
+            return;
+        }
+        stop_ = true;
+    }
+    cv_.notify_all();
+    exporter_.join();
+
+    try {
+        if (!producer_->Flush(config_.closeTimeout)) {
+            ConsoleLogger::Error("Kafka export closed with undelivered events");
+        }
+    }
+    catch (std::exception& ex) {
+        ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
+    }
+    producer_.reset();
+
+    std::unique_lock lk(mutex_);
+    open_ = false;
+}
+
+bool KafkaProcess::IsOpen() const noexcept {
+    std::unique_lock lk(mutex_);
+    return open_ && !stop_;
+}
+
+std::size_t KafkaProcess::EventSize(const event_t& event) noexcept {
+    return sizeof(event) + event.msg.text.size();
+}
+
+bool KafkaProcess::PublishMessage(const IMessageStorage::message_t& msg) noexcept {
+    try {
+        return Publish(event_t{ event_type_t::message, msg, false, std::chrono::steady_clock::now() });
+    }
+    catch (std::exception& ex) {
+        ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
+    }
+    return false;
+}
+
+bool KafkaProcess::PublishPresence(uint32_t userId, bool online) noexcept {
+    try {
+        auto nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        return Publish(event_t{ event_type_t::presence, { userId, 0, static_cast<uint64_t>(nowMs), {} }, online,
+            std::chrono::steady_clock::now() });
+    }
+    catch (std::exception& ex) {
+        ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
+    }
+    return false;
+}
+
+bool KafkaProcess::Publish(event_t&& event) noexcept {
+
+    std::size_t size = EventSize(event);
+    std::size_t count = 0;
+    {
+        std::unique_lock lk(mutex_);
+        if (!open_ || stop_) {
+            return false;
+        }
+        if (bufferBytes_ + size > config_.maxBufferBytes) {
+            lk.unlock();
+            dropped.Inc();
+            return false;
+        }
+        bufferBytes_ += size;
+        buffer_.push_back(std::move(event));
+        count = buffer_.size();
+        buffered.Set(static_cast<int64_t>(count));
+    }
+    /* exporter waits either for the first event to start linger or for full batch */
+    if (count == 1 || count >= config_.batchSize) {
+        cv_.notify_one();
+    }
+    return true;
+}
+
+IEventProducer::record_t KafkaProcess::MakeRecord(const event_t& event) const {
+
+    IEventProducer::record_t record;
+    if (event.type == event_type_t::message) {
+        record.topic = config_.messagesTopic;
+        record.payload = boost::str(boost::format("{\"src\":%1%,\"dst\":%2%,\"timestamp\":%3%,\"text\":") %
+            event.msg.src % event.msg.dst % event.msg.timestampMs);
+        AppendJsonString(record.payload, event.msg.text);
+        record.payload += '}';
+    }
+    else {
+        record.topic = config_.presenceTopic;
+        record.payload = boost::str(boost::format("{\"user\":%1%,\"online\":%2%,\"timestamp\":%3%}") %
+            event.msg.src % (event.online ? "true" : "false") % event.msg.timestampMs);
+    }
+
+    /* user who caused the event is the key */
+    record.key = std::to_string(event.msg.src);
+    if (config_.partitions > 0) {
+        record.partition = static_cast<int32_t>(event.msg.src % config_.partitions);
+    }
+    record.enqueued = event.enqueued;
+    return record;
+}
+
+void KafkaProcess::Exporter() noexcept {
+
+    std::unique_lock lk(mutex_);
+    for (;;) {
+        cv_.wait_for(lk, poll_interval, [&]() { return stop_ || !buffer_.empty(); });
+        if (buffer_.empty()) {
+            if (stop_) {
+                break;
+            }
+            /* delivery reports are served even when nothing is exported */
+            lk.unlock();
+            producer_->Poll(std::chrono::milliseconds(0));
+            lk.lock();
+            continue;
+        }
+        if (!stop_ && buffer_.size() < config_.batchSize) {
+            cv_.wait_until(lk, buffer_.front().enqueued + config_.linger,
+                [&]() { return stop_ || buffer_.size() >= config_.batchSize; });
+        }
+
+        std::deque<event_t> batch;
+        auto count = std::min<std::size_t>(buffer_.size(), config_.batchSize);
+        for (std::size_t i = 0; i < count; ++i) {
+            bufferBytes_ -= EventSize(buffer_.front());
+            batch.push_back(std::move(buffer_.front()));
+            buffer_.pop_front();
+        }
+        buffered.Set(static_cast<int64_t>(buffer_.size()));
+
+        lk.unlock();
+        Export(batch);
+        lk.lock();
+    }
+}
+
+void KafkaProcess::Export(std::deque<event_t>& batch) noexcept {
+
+    for (const auto& event : batch) {
+        try {
+            auto record = MakeRecord(event);
+            uint32_t attempt = 0;
+            /* full client queue is drained by serving delivery reports, on close it isn't waited for */
+            while (!producer_->Produce(record)) {
+                if (++attempt > produce_retries || stop_) {
+                    attempt = produce_retries + 1;
+                    break;
+                }
+                producer_->Poll(std::chrono::milliseconds(10));
+            }
+            if (attempt > produce_retries) {
+                dropped.Inc();
+                continue;
+            }
+            produced.Inc();
+            inFlight.Add(1);
+        }
+        catch (std::exception& ex) {
+            dropped.Inc();
+            ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
+        }
+    }
+    producer_->Poll(std::chrono::milliseconds(0));
+}
+
+void KafkaProcess::OnDelivery(const IEventProducer::record_t& record, bool ok) noexcept {
+    inFlight.Add(-1);
+    if (ok) {
+        delivered.Inc();
+        deliveryLatency.Observe(std::chrono::steady_clock::now() - record.enqueued);
+    }
+    else {
+        failed.Inc();
+    }
+}
+
+std::size_t KafkaProcess::GetBuffered() const noexcept {
+    std::unique_lock lk(mutex_);
+    return buffer_.size();
+}
@@ -1,12 +1,137 @@
-
+/*****************************************************************
+ *  @file       KafkaProcess.h
+ *  @brief      Asynchronous export of chat events to Kafka topics
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
 #pragma once
 
-class KafkaProcess
-{
-    void CreateKafkaProducer();
-    void CreateKafkaConsumer();
+/* std C++ lib headers */
+#include <string>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <cstdint>
+
+#include "IMessageStorage.h"
+
+/* Transport used by exporter, implemented over cppkafka producer when
+ * built with Kafka support, tests substitute mock one */
+class IEventProducer {
+
+public:
+
+    /* partition is unassigned when client partitioner hashes the key */
+    static constexpr int32_t UNASSIGNED_PARTITION = -1;
+
+    struct record_t {
+        std::string topic;
+        int32_t partition = UNASSIGNED_PARTITION;
+        std::string key;
+        std::string payload;
+        std::chrono::steady_clock::time_point enqueued;
+    };
+
+    /* invoked once per accepted record from Poll() or Flush() */
+    using delivery_callback_t = std::function<void(const record_t& record, bool delivered)>;
+
+    virtual ~IEventProducer() = default;
+
+    virtual void SetDeliveryCallback(delivery_callback_t&& cb) = 0;
+    /* false when client queue is full, nothing is accepted then */
+    virtual bool Produce(const record_t& record) = 0;
+    virtual void Poll(std::chrono::milliseconds timeout) = 0;
+    /* false when some records are still undelivered after timeout */
+    virtual bool Flush(std::chrono::milliseconds timeout) = 0;
+};
+
+/* Chat path only copies event into bounded buffer, export thread turns
+ * buffered events into records in batches once batch is full or linger
+ * time of the oldest one passed. Events are keyed by user ID, so events
+ * of one user stay ordered within partition. Full buffer drops new events
+ * instead of blocking, delivery reports are counted in metrics. */
+class KafkaProcess {
 
 public:
+
+    struct config_t {
+        std::string brokers;
+        std::string messagesTopic = "chat.messages";
+        std::string presenceTopic = "chat.presence";
+        uint32_t partitions = 0;        // 0 lets client partitioner choose by key
+        uint32_t batchSize = 1000;
+        std::chrono::milliseconds linger{ 5 };
+        std::string compression = "lz4";
+        std::string acks = "1";
+        std::size_t maxBufferBytes = 32 * 1024 * 1024;
+        std::chrono::milliseconds closeTimeout{ 5000 };
+    };
+
+    KafkaProcess(const KafkaProcess&) = delete;
+    KafkaProcess& operator=(const KafkaProcess&) = delete;
+
     KafkaProcess();
     ~KafkaProcess();
-};
\ No newline at end of file
+
+    static const std::shared_ptr<KafkaProcess>& GetInstance() {
+        static std::once_flag once;
+        std::call_once(once, []() { kp_ = std::make_shared<KafkaProcess>(); });
+        return kp_;
+    }
+
+    /* cppkafka producer is created from config when producer is not given */
+    void Open(const config_t& config, std::unique_ptr<IEventProducer>&& producer = nullptr);
+    /* exports buffered events and waits for delivery reports up to close timeout */
+    void Close() noexcept;
+
+    bool IsOpen() const noexcept;
+
+    /* never block, false when export is closed or buffer is full */
+    bool PublishMessage(const IMessageStorage::message_t& msg) noexcept;
+    bool PublishPresence(uint32_t userId, bool online) noexcept;
+
+    std::size_t GetBuffered() const noexcept;
+
+private:
+
+    enum class event_type_t {
+        message,
+        presence,
+    };
+
+    struct event_t {
+        event_type_t type;
+        IMessageStorage::message_t msg;     // presence event keeps user in src
+        bool online;
+        std::chrono::steady_clock::time_point enqueued;
+    };
+
+    const std::chrono::milliseconds poll_interval{ 100 };
+    const uint32_t produce_retries = 50;
+
+    config_t config_;
+    std::unique_ptr<IEventProducer> producer_;
+
+    std::deque<event_t> buffer_;
+    std::size_t bufferBytes_ = 0;
+    bool open_ = false;
+    std::atomic_bool stop_{ false };
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread exporter_;
+
+    static std::shared_ptr<KafkaProcess> kp_;
+
+    bool Publish(event_t&& event) noexcept;
+    void Exporter() noexcept;
+    void Export(std::deque<event_t>& batch) noexcept;
+    IEventProducer::record_t MakeRecord(const event_t& event) const;
+    void OnDelivery(const IEventProducer::record_t& record, bool delivered) noexcept;
+    static std::size_t EventSize(const event_t& event) noexcept;
+};
@@ -0,0 +1,753 @@
+/*****************************************************************
+ *  @file       LogStorage.cpp
+ *  @brief      Embedded append-only messages log implementation
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+
+#include "LogStorage.h"
+
+#include <cstring>
+#include <cstddef>
+#include <cstdio>
+#include <stdexcept>
+#include <filesystem>
+#include <algorithm>
+#include <tuple>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <boost/crc.hpp>
+#include <boost/format.hpp>
+
+#include "../log/Logger.h"
+#include "../log/Metrics.h"
+
+namespace {
+    Metrics::Counter& stored = Metrics::GetInstance()->GetCounter("storage_stored_total");
+    Metrics::Counter& dropped = Metrics::GetInstance()->GetCounter("storage_dropped_total");
+    Metrics::Counter& compactions = Metrics::GetInstance()->GetCounter("storage_compactions_total");
+    Metrics::Counter& commitErrors = Metrics::GetInstance()->GetCounter("storage_commit_errors_total");
+    Metrics::Histogram& commitLatency = Metrics::GetInstance()->GetHistogram("storage_commit_latency_us");
+    Metrics::Histogram& commitRecords = Metrics::GetInstance()->GetHistogram("storage_commit_records");
+    Metrics::Gauge& tablesCount = Metrics::GetInstance()->GetGauge("storage_tables");
+
+    constexpr std::size_t Align(std::size_t size, std::size_t align) {
+        return (size + align - 1) & ~(align - 1);
+    }
+
+    void WriteAll(int fd, const char* data, std::size_t size, off_t offset) {
+        while (size > 0) {
+            auto n = ::pwrite(fd, data, size, offset);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error(std::string("Storage write failed: ") + std::strerror(errno));
+            }
+            data += n;
+            size -= static_cast<std::size_t>(n);
+            offset += n;
+        }
+    }
+
+    uint64_t NowMs() noexcept {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+}
+
+LogStorage::LogStorage(const config_t& config) : config_(config) {
+
+    ConsoleLogger::Debug("Construct LogStorage class");
+    config_.segmentSize = Align(config_.segmentSize, record_align);
+    config_.indexInterval = std::max<std::size_t>(config_.indexInterval, 1);
+    std::filesystem::create_directories(config_.directory);
+
+    std::vector<uint64_t> segments, tables;
+    for (const auto& entry : std::filesystem::directory_iterator(config_.directory)) {
+        const auto& path = entry.path();
+        if (path.extension() == ".tmp") {
+            /* compaction was interrupted, its source segment is still there */
+            std::filesystem::remove(path);
+        }
+        else if (path.extension() == ".log") {
+            segments.push_back(std::stoull(path.stem().string()));
+        }
+        else if (path.extension() == ".sst") {
+            tables.push_back(std::stoull(path.stem().string()));
+        }
+    }
+    std::sort(segments.begin(), segments.end());
+    std::sort(tables.begin(), tables.end());
+
+    for (auto id : tables) {
+        try {
+            tables_.push_back(OpenTable(FilePath(id, ".sst"), id));
+            IndexTable(*tables_.back());
+        }
+        catch (std::exception& ex) {
+            ConsoleLogger::Error(boost::str(boost::format("Storage table %1% skipped: %2%") % id % ex.what()));
+        }
+        nextId_ = std::max(nextId_, id + 1);
+    }
+    for (auto id : segments) {
+        if (std::binary_search(tables.begin(), tables.end(), id)) {
+            /* compacted, but not removed before stop */
+            std::filesystem::remove(FilePath(id, ".log"));
+            continue;
+        }
+        auto segment = OpenSegment(FilePath(id, ".log"), id);
+        if (active_) {
+            sealed_.push_back(std::move(active_));
+        }
+        active_ = std::move(segment);
+        nextId_ = std::max(nextId_, id + 1);
+    }
+    if (!active_) {
+        active_ = CreateSegment(nextId_++);
+    }
+    tablesCount.Set(static_cast<int64_t>(tables_.size()));
+
+    ConsoleLogger::Info(boost::str(boost::format("Message log opened: %1% tables, %2% segments to compact") %
+        tables_.size() % sealed_.size()));
+
+    committer_ = std::thread([this]() { CommitLoop(); });
+    compactor_ = std::thread([this]() { CompactLoop(); });
+}
+
+LogStorage::~LogStorage() {
+
+    {
+        std::unique_lock lk(pendingMutex_);
+        stop_ = true;
+    }
+    commitCv_.notify_all();
+    {
+        std::unique_lock lk(compactMutex_);
+        stop_ = true;
+    }
+    compactCv_.notify_all();
+
+    /* committer writes everything stored before it exits,
+     * not compacted segments are picked up on the next start */
+    committer_.join();
+    compactor_.join();
+
+    if (active_) {
+        Unmap(active_->file);
+    }
+    for (auto& segment : sealed_) {
+        Unmap(segment->file);
+    }
+    for (auto& table : tables_) {
+        Unmap(table->file);
+    }
+    ConsoleLogger::Debug("Destruct LogStorage class");
+}
+
+std::string LogStorage::FilePath(uint64_t id, const char* extension) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llu%s", static_cast<unsigned long long>(id), extension);
+    return (std::filesystem::path(config_.directory) / name).string();
+}
+
+uint32_t LogStorage::Checksum(const record_header_t& header, const char* data, uint32_t size) {
+    record_header_t h = header;
+    h.crc = 0;
+    boost::crc_32_type crc;
+    crc.process_bytes(&h, sizeof(h));
+    crc.process_bytes(data, size);
+    return crc.checksum();
+}
+
+void LogStorage::Map(mapping_t& file) {
+    struct stat st {};
+    ::fstat(file.fd, &st);
+    file.size = static_cast<std::size_t>(st.st_size);
+    if (file.size == 0) {
+        return;
+    }
+    void* base = ::mmap(nullptr, file.size, PROT_READ, MAP_SHARED, file.fd, 0);
+    if (base == MAP_FAILED) {
+        throw std::runtime_error("Storage file can't be mapped: " + file.path);
+    }
+    file.base = static_cast<char*>(base);
+}
+
+void LogStorage::Unmap(mapping_t& file) noexcept {
+    if (file.base) {
+        ::munmap(file.base, file.size);
+        file.base = nullptr;
+    }
+    if (file.fd >= 0) {
+        ::close(file.fd);
+        file.fd = -1;
+    }
+}
+
+std::unique_ptr<LogStorage::segment_t> LogStorage::CreateSegment(uint64_t id) {
+
+    auto segment = std::make_unique<segment_t>();
+    segment->id = id;
+    segment->file.path = FilePath(id, ".log");
+    segment->file.fd = ::open(segment->file.path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (segment->file.fd < 0) {
+        throw std::runtime_error("Storage segment can't be created: " + segment->file.path);
+    }
+    /* preallocated, so mapping covers all future appends */
+    if (::ftruncate(segment->file.fd, static_cast<off_t>(config_.segmentSize)) != 0) {
+        ::close(segment->file.fd);
+        throw std::runtime_error("Storage segment can't be allocated: " + segment->file.path);
+    }
+    Map(segment->file);
+    return segment;
+}
+
+bool LogStorage::ValidRecord(const char* base, std::size_t offset, std::size_t size) {
+    if (offset + sizeof(record_header_t) > size) {
+        return false;
+    }
+    record_header_t header;
+    std::memcpy(&header, base + offset, sizeof(header));
+    return header.magic == record_magic &&
+        offset + sizeof(header) + header.size <= size &&
+        Checksum(header, base + offset + sizeof(header), header.size) == header.crc;
+}
+
+std::unique_ptr<LogStorage::segment_t> LogStorage::OpenSegment(const std::string& path, uint64_t id) {
+
+    auto segment = std::make_unique<segment_t>();
+    segment->id = id;
+    segment->file.path = path;
+    segment->file.fd = ::open(path.c_str(), O_RDWR);
+    if (segment->file.fd < 0) {
+        throw std::runtime_error("Storage segment can't be opened: " + path);
+    }
+    Map(segment->file);
+
+    std::size_t offset = 0;
+    while (ValidRecord(segment->file.base, offset, segment->file.size)) {
+        record_header_t header;
+        std::memcpy(&header, segment->file.base + offset, sizeof(header));
+        segment->index[header.conversation].push_back(offset);
+        offset += Align(sizeof(header) + header.size, record_align);
+    }
+    segment->writeOffset = offset;
+
+    /* tail of interrupted commit is zeroed: its pages could reach disk out of order,
+     * and a complete record behind the torn one must not revive after next append */
+    if (offset < segment->file.size) {
+        Unmap(segment->file);
+        segment->file.fd = ::open(path.c_str(), O_RDWR);
+        if (segment->file.fd < 0 ||
+            ::ftruncate(segment->file.fd, static_cast<off_t>(offset)) != 0 ||
+            ::ftruncate(segment->file.fd, static_cast<off_t>(std::max(config_.segmentSize, offset))) != 0) {
+            throw std::runtime_error("Storage segment can't be recovered: " + path);
+        }
+        Map(segment->file);
+    }
+    return segment;
+}
+
+std::unique_ptr<LogStorage::table_t> LogStorage::OpenTable(const std::string& path, uint64_t id) {
+
+    auto table = std::make_unique<table_t>();
+    table->id = id;
+    table->file.path = path;
+    table->file.fd = ::open(path.c_str(), O_RDONLY);
+    if (table->file.fd < 0) {
+        throw std::runtime_error("Storage table can't be opened: " + path);
+    }
+    Map(table->file);
+
+    const auto& file = table->file;
+    if (file.size < sizeof(table_footer_t)) {
+        Unmap(table->file);
+        throw std::runtime_error("Storage table is truncated: " + path);
+    }
+    std::memcpy(&table->footer, file.base + file.size - sizeof(table_footer_t), sizeof(table_footer_t));
+    if (table->footer.magic != table_magic ||
+        table->footer.dataSize + table->footer.indexCount * sizeof(index_entry_t) + sizeof(table_footer_t) != file.size) {
+        Unmap(table->file);
+        throw std::runtime_error("Storage table footer is corrupted: " + path);
+    }
+    table->index = reinterpret_cast<const index_entry_t*>(file.base + table->footer.dataSize);
+    return table;
+}
+
+bool LogStorage::Store(message_t&& msg) noexcept {
+
+    try {
+        record_header_t header{};
+        header.magic = record_magic;
+        header.conversation = ConversationKey(msg.src, msg.dst);
+        header.timestampMs = msg.timestampMs;
+        header.src = msg.src;
+        header.dst = msg.dst;
+        header.size = static_cast<uint32_t>(msg.text.size());
+        header.crc = Checksum(header, msg.text.data(), header.size);
+
+        std::size_t total = Align(sizeof(header) + header.size, record_align);
+        if (total > config_.segmentSize) {
+            dropped.Inc();
+            ConsoleLogger::Error(boost::str(boost::format("Message of %1% bytes doesn't fit storage segment") % header.size));
+            return false;
+        }
+
+        bool wake = false;
+        {
+            std::unique_lock lk(pendingMutex_);
+            flushCv_.wait(lk, [&]() { return pending_.size() < config_.maxPendingBytes || stop_; });
+            std::size_t offset = pending_.size();
+            pending_.resize(offset + total);
+            std::memcpy(pending_.data() + offset, &header, sizeof(header));
+            std::memcpy(pending_.data() + offset + sizeof(header), msg.text.data(), header.size);
+            storedSeq_++;
+            /* first record opens commit window, big batch closes it */
+            wake = offset == 0 || pending_.size() >= config_.commitBytes;
+        }
+        if (wake) {
+            commitCv_.notify_one();
+        }
+        stored.Inc();
+        return true;
+    }
+    catch (std::exception& ex) {
+        dropped.Inc();
+        ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
+    }
+    return false;
+}
+
+void LogStorage::Flush() {
+    std::unique_lock lk(pendingMutex_);
+    uint64_t target = storedSeq_;
+    commitCv_.notify_one();
+    flushCv_.wait(lk, [&]() { return committedSeq_ >= target; });
+}
+
+void LogStorage::CommitLoop() {
+
+    const std::chrono::milliseconds retry_interval{ 100 };
+
+    /* records of failed commit stay in batch and are written again before anything newer,
+     * writers are held back by maxPendingBytes meanwhile */
+    std::string batch;
+    uint64_t seq = 0;
+    for (;;) {
+        if (batch.empty()) {
+            std::unique_lock lk(pendingMutex_);
+            commitCv_.wait(lk, [&]() { return stop_ || !pending_.empty(); });
+            if (pending_.empty()) {
+                break;
+            }
+            commitCv_.wait_for(lk, config_.commitInterval, [&]() {
+                return stop_ || pending_.size() >= config_.commitBytes;
+            });
+            batch.swap(pending_);
+            seq = storedSeq_;
+        }
+
+        std::size_t committed = 0;
+        try {
+            Commit(batch, committed);
+        }
+        catch (std::exception& ex) {
+            commitErrors.Inc();
+            ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
+        }
+        batch.erase(0, committed);
+
+        if (!batch.empty()) {
+            std::unique_lock lk(pendingMutex_);
+            if (stop_) {
+                /* nothing is left to retry with, records are lost and said so */
+                dropped.Inc();
+                ConsoleLogger::Error(boost::str(boost::format("Storage stops with %1% bytes not committed") % batch.size()));
+                break;
+            }
+            commitCv_.wait_for(lk, retry_interval, [&]() { return stop_.load(); });
+            continue;
+        }
+
+        {
+            std::unique_lock lk(pendingMutex_);
+            committedSeq_ = seq;
+        }
+        flushCv_.notify_all();
+    }
+    /* writers held back by failed disk see stop */
+    flushCv_.notify_all();
+}
+
+void LogStorage::Commit(const std::string& batch, std::size_t& committed) {
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::pair<uint64_t, std::size_t>> written;   // conversation, offset in segment
+    std::size_t records = 0;
+    std::size_t pos = committed;
+    /* failed write or sync leaves segment where the last published record ends,
+     * retry writes the same records over whatever reached the file */
+    std::size_t publishedOffset = active_->writeOffset;
+
+    /* only committer changes active segment, readers see records after they are in index */
+    auto publish = [&](std::unique_ptr<segment_t> next) {
+        if (::fdatasync(active_->file.fd) != 0) {
+            auto error = std::string("Storage sync failed: ") + std::strerror(errno);
+            if (next) {
+                Unmap(next->file);
+                std::filesystem::remove(next->file.path);
+            }
+            throw std::runtime_error(error);
+        }
+        std::unique_lock lk(stateMutex_);
+        for (const auto& [conversation, offset] : written) {
+            active_->index[conversation].push_back(offset);
+        }
+        if (next) {
+            sealed_.push_back(std::move(active_));
+            active_ = std::move(next);
+        }
+        publishedOffset = active_->writeOffset;
+        committed = pos;
+        records += written.size();
+        written.clear();
+    };
+
+    try {
+        while (pos < batch.size()) {
+
+            std::size_t runStart = pos;
+            std::size_t fileOffset = active_->writeOffset;
+            while (pos < batch.size()) {
+                record_header_t header;
+                std::memcpy(&header, batch.data() + pos, sizeof(header));
+                std::size_t total = Align(sizeof(header) + header.size, record_align);
+                if (fileOffset + total > active_->file.size) {
+                    break;
+                }
+                written.emplace_back(header.conversation, fileOffset);
+                fileOffset += total;
+                pos += total;
+            }
+
+            WriteAll(active_->file.fd, batch.data() + runStart, pos - runStart, static_cast<off_t>(active_->writeOffset));
+            active_->writeOffset = fileOffset;
+
+            if (pos < batch.size()) {
+                /* segment is full: seal it and continue batch in the new one */
+                auto next = CreateSegment(nextId_++);
+                publish(std::move(next));
+                {
+                    std::unique_lock lk(compactMutex_);
+                }
+                compactCv_.notify_one();
+            }
+        }
+        publish(nullptr);
+    }
+    catch (...) {
+        active_->writeOffset = publishedOffset;
+        throw;
+    }
+
+    commitRecords.Observe(records);
+    commitLatency.Observe(std::chrono::steady_clock::now() - start);
+}
+
+void LogStorage::CompactLoop() {
+
+    auto lastRetention = std::chrono::steady_clock::now();
+    for (;;) {
+        {
+            std::unique_lock lk(compactMutex_);
+            compactCv_.wait_for(lk, retention_period, [&]() {
+                std::shared_lock slk(stateMutex_);
+                return stop_ || !sealed_.empty();
+            });
+            if (stop_) {
+                break;
+            }
+        }
+
+        try {
+            segment_t* segment = nullptr;
+            {
+                std::shared_lock lk(stateMutex_);
+                if (!sealed_.empty()) {
+                    segment = sealed_.front().get();
+                }
+            }
+            /* sealed segment is immutable and removed only here */
+            if (segment) {
+                Compact(*segment);
+            }
+            if (std::chrono::steady_clock::now() - lastRetention >= retention_period) {
+                lastRetention = std::chrono::steady_clock::now();
+                ApplyRetention();
+            }
+        }
+        catch (std::exception& ex) {
+            ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
+            /* don't spin on the same broken segment */
+            std::unique_lock lk(compactMutex_);
+            compactCv_.wait_for(lk, std::chrono::seconds(1), [&]() { return stop_.load(); });
+        }
+    }
+}
+
+void LogStorage::Compact(const segment_t& segment) {
+
+    auto start = std::chrono::steady_clock::now();
+    const char* base = segment.file.base;
+
+    std::vector<index_entry_t> records;
+    for (const auto& [conversation, offsets] : segment.index) {
+        for (auto offset : offsets) {
+            record_header_t header;
+            std::memcpy(&header, base + offset, sizeof(header));
+            records.push_back(index_entry_t{ conversation, header.timestampMs, offset });
+        }
+    }
+    std::sort(records.begin(), records.end(), [](const index_entry_t& l, const index_entry_t& r) {
+        return std::tie(l.conversation, l.timestampMs, l.offset) < std::tie(r.conversation, r.timestampMs, r.offset);
+    });
+
+    auto tmpPath = FilePath(segment.id, ".sst.tmp");
+    int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Storage table can't be created: " + tmpPath);
+    }
+
+    try {
+        std::string buffer;
+        std::vector<index_entry_t> sparse;
+        table_footer_t footer{};
+        footer.magic = table_magic;
+        footer.minTimestampMs = UINT64_MAX;
+        uint64_t offset = 0;
+
+        for (std::size_t i = 0; i < records.size(); ++i) {
+            const auto& r = records[i];
+            /* every conversation starts with index entry, long ones get more */
+            if (i % config_.indexInterval == 0 || records[i - 1].conversation != r.conversation) {
+                sparse.push_back(index_entry_t{ r.conversation, r.timestampMs, offset });
+            }
+            record_header_t header;
+            std::memcpy(&header, base + r.offset, sizeof(header));
+            std::size_t total = Align(sizeof(header) + header.size, record_align);
+            buffer.append(base + r.offset, total);
+            offset += total;
+
+            footer.minTimestampMs = std::min(footer.minTimestampMs, r.timestampMs);
+            footer.maxTimestampMs = std::max(footer.maxTimestampMs, r.timestampMs);
+
+            if (buffer.size() >= 1024 * 1024) {
+                WriteAll(fd, buffer.data(), buffer.size(), static_cast<off_t>(offset - buffer.size()));
+                buffer.clear();
+            }
+        }
+        WriteAll(fd, buffer.data(), buffer.size(), static_cast<off_t>(offset - buffer.size()));
+
+        footer.dataSize = offset;
+        footer.indexCount = sparse.size();
+        WriteAll(fd, reinterpret_cast<const char*>(sparse.data()), sparse.size() * sizeof(index_entry_t),
+            static_cast<off_t>(offset));
+        WriteAll(fd, reinterpret_cast<const char*>(&footer), sizeof(footer),
+            static_cast<off_t>(offset + sparse.size() * sizeof(index_entry_t)));
+
+        if (::fsync(fd) != 0) {
+            throw std::runtime_error(std::string("Storage sync failed: ") + std::strerror(errno));
+        }
+        ::close(fd);
+    }
+    catch (...) {
+        ::close(fd);
+        std::filesystem::remove(tmpPath);
+        throw;
+    }
+
+    auto path = FilePath(segment.id, ".sst");
+    std::filesystem::rename(tmpPath, path);
+    int dir = ::open(config_.directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dir >= 0) {
+        ::fsync(dir);
+        ::close(dir);
+    }
+    auto table = OpenTable(path, segment.id);
+
+    std::unique_ptr<segment_t> source;
+    {
+        std::unique_lock lk(stateMutex_);
+        IndexTable(*table);
+        tables_.push_back(std::move(table));
+        source = std::move(sealed_.front());
+        sealed_.pop_front();
+        tablesCount.Set(static_cast<int64_t>(tables_.size()));
+    }
+    Unmap(source->file);
+    std::filesystem::remove(source->file.path);
+
+    compactions.Inc();
+    ConsoleLogger::Debug(boost::str(boost::format("Storage segment %1% compacted: %2% records in %3% ms") %
+        segment.id % records.size() %
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count()));
+}
+
+void LogStorage::ApplyRetention() {
+
+    uint64_t deadline = NowMs() - std::chrono::duration_cast<std::chrono::milliseconds>(config_.retention).count();
+    std::vector<std::unique_ptr<table_t>> expired;
+    {
+        std::unique_lock lk(stateMutex_);
+        for (auto it = tables_.begin(); it != tables_.end(); ) {
+            if ((*it)->footer.maxTimestampMs < deadline) {
+                UnindexTable(**it);
+                expired.push_back(std::move(*it));
+                it = tables_.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+        tablesCount.Set(static_cast<int64_t>(tables_.size()));
+    }
+    for (auto& table : expired) {
+        Unmap(table->file);
+        std::filesystem::remove(table->file.path);
+        ConsoleLogger::Info(boost::str(boost::format("Storage table %1% removed by retention") % table->id));
+    }
+}
+
+void LogStorage::IndexTable(const table_t& table) {
+    for (uint64_t i = 0; i < table.footer.indexCount; ++i) {
+        auto conversation = table.index[i].conversation;
+        if (i == 0 || table.index[i - 1].conversation != conversation) {
+            tablesByConversation_[conversation].push_back(&table);
+        }
+    }
+}
+
+void LogStorage::UnindexTable(const table_t& table) {
+    for (uint64_t i = 0; i < table.footer.indexCount; ++i) {
+        auto conversation = table.index[i].conversation;
+        if (i > 0 && table.index[i - 1].conversation == conversation) {
+            continue;
+        }
+        auto it = tablesByConversation_.find(conversation);
+        if (it == tablesByConversation_.end()) {
+            continue;
+        }
+        auto& tables = it->second;
+        tables.erase(std::remove(tables.begin(), tables.end(), &table), tables.end());
+        if (tables.empty()) {
+            tablesByConversation_.erase(it);
+        }
+    }
+}
+
+IMessageStorage::message_t LogStorage::ToMessage(const char* record) {
+    record_header_t header;
+    std::memcpy(&header, record, sizeof(header));
+    return message_t{ header.src, header.dst, header.timestampMs,
+        std::string(record + sizeof(header), header.size) };
+}
+
+void LogStorage::ReadSegment(const segment_t& segment, uint64_t conversation, uint64_t fromMs, uint64_t toMs,
+    std::vector<message_t>& out) {
+
+    auto it = segment.index.find(conversation);
+    if (it == segment.index.end()) {
+        return;
+    }
+    for (auto offset : it->second) {
+        const char* record = segment.file.base + offset;
+        uint64_t timestampMs;
+        std::memcpy(&timestampMs, record + offsetof(record_header_t, timestampMs), sizeof(timestampMs));
+        if (timestampMs >= fromMs && timestampMs <= toMs) {
+            out.push_back(ToMessage(record));
+        }
+    }
+}
+
+void LogStorage::ReadTable(const table_t& table, uint64_t conversation, uint64_t fromMs, uint64_t toMs,
+    std::vector<message_t>& out) {
+
+    const auto& footer = table.footer;
+    if (footer.indexCount == 0 || footer.maxTimestampMs < fromMs || footer.minTimestampMs > toMs) {
+        return;
+    }
+
+    /* scan starts from the last index entry before (conversation, fromMs) */
+    const index_entry_t* begin = table.index;
+    const index_entry_t* end = table.index + footer.indexCount;
+    auto it = std::lower_bound(begin, end, std::make_pair(conversation, fromMs),
+        [](const index_entry_t& e, const std::pair<uint64_t, uint64_t>& key) {
+            return std::tie(e.conversation, e.timestampMs) < std::tie(key.first, key.second);
+        });
+    if (it != begin) {
+        --it;
+    }
+
+    std::size_t offset = it->offset;
+    while (offset < footer.dataSize) {
+        record_header_t header;
+        std::memcpy(&header, table.file.base + offset, sizeof(header));
+        if (header.conversation > conversation ||
+            (header.conversation == conversation && header.timestampMs > toMs)) {
+            break;
+        }
+        if (header.conversation == conversation && header.timestampMs >= fromMs) {
+            out.push_back(ToMessage(table.file.base + offset));
+        }
+        offset += Align(sizeof(header) + header.size, record_align);
+    }
+}
+
+std::vector<IMessageStorage::message_t> LogStorage::Read(uint64_t conversation, uint64_t fromMs, uint64_t toMs,
+    std::size_t limit, bool latest) const {
+
+    std::vector<message_t> out;
+    {
+        std::shared_lock lk(stateMutex_);
+        /* only tables holding the conversation are visited */
+        if (auto it = tablesByConversation_.find(conversation); it != tablesByConversation_.end()) {
+            for (const auto* table : it->second) {
+                ReadTable(*table, conversation, fromMs, toMs, out);
+            }
+        }
+        for (const auto& segment : sealed_) {
+            ReadSegment(*segment, conversation, fromMs, toMs, out);
+        }
+        ReadSegment(*active_, conversation, fromMs, toMs, out);
+    }
+
+    /* sources are in arrival order, stable sort keeps it for equal timestamps */
+    std::stable_sort(out.begin(), out.end(), [](const message_t& l, const message_t& r) {
+        return l.timestampMs < r.timestampMs;
+    });
+    if (out.size() > limit) {
+        if (latest) {
+            out.erase(out.begin(), out.end() - static_cast<std::ptrdiff_t>(limit));
+        }
+        else {
+            out.resize(limit);
+        }
+    }
+    return out;
+}
+
+std::size_t LogStorage::GetSegmentsCount() const noexcept {
+    std::shared_lock lk(stateMutex_);
+    return sealed_.size() + 1;
+}
+
+std::size_t LogStorage::GetTablesCount() const noexcept {
+    std::shared_lock lk(stateMutex_);
+    return tables_.size();
+}
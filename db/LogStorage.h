@@ -0,0 +1,170 @@
+/*****************************************************************
+ *  @file       LogStorage.h
+ *  @brief      Embedded append-only messages log, local alternative
+ *              to MongoDB storage
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+#pragma once
+
+/* std C++ lib headers */
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <unordered_map>
+#include <cstdint>
+
+#include "IMessageStorage.h"
+
+/* Messages are appended in arrival order to the active log segment by one
+ * commit thread: records stored during commit interval are written and
+ * fdatasync'ed as one batch (group commit) and become readable afterwards.
+ * Full segment is sealed and compaction thread rewrites it into a table
+ * sorted by (conversation, timestamp) with sparse index in the footer,
+ * tables are read through mmap and removed after retention period. */
+class LogStorage : public IMessageStorage {
+
+public:
+
+    struct config_t {
+        std::string directory;
+        std::size_t segmentSize = 128 * 1024 * 1024;
+        std::chrono::milliseconds commitInterval{ 2 };
+        std::size_t commitBytes = 1024 * 1024;      // commit earlier when batch is that big
+        std::size_t maxPendingBytes = 64 * 1024 * 1024; // writers wait for disk above it
+        std::chrono::hours retention{ 24 * 30 };
+        std::size_t indexInterval = 64;             // table records per sparse index entry
+    };
+
+    LogStorage(const LogStorage&) = delete;
+    LogStorage& operator=(const LogStorage&) = delete;
+
+    explicit LogStorage(const config_t& config);
+    ~LogStorage() override;
+
+    /* returns before commit, blocks only when disk falls behind by maxPendingBytes */
+    bool Store(message_t&& msg) noexcept override;
+
+    /* blocks until everything stored before the call is on disk */
+    void Flush();
+
+    std::vector<message_t> Read(uint64_t conversation, uint64_t fromMs, uint64_t toMs,
+        std::size_t limit, bool latest) const override;
+
+    std::size_t GetSegmentsCount() const noexcept;
+    std::size_t GetTablesCount() const noexcept;
+
+private:
+
+    struct record_header_t {
+        uint32_t magic;
+        uint32_t crc;
+        uint64_t conversation;
+        uint64_t timestampMs;
+        uint32_t src;
+        uint32_t dst;
+        uint32_t size;
+        uint32_t reserved;
+    };
+
+    struct table_footer_t {
+        uint64_t dataSize;
+        uint64_t indexCount;
+        uint64_t minTimestampMs;
+        uint64_t maxTimestampMs;
+        uint64_t magic;
+    };
+
+    struct index_entry_t {
+        uint64_t conversation;
+        uint64_t timestampMs;
+        uint64_t offset;
+    };
+
+    struct mapping_t {
+        std::string path;
+        int fd = -1;
+        char* base = nullptr;
+        std::size_t size = 0;
+    };
+
+    /* raw log in arrival order, indexed in memory */
+    struct segment_t {
+        uint64_t id;
+        mapping_t file;
+        std::size_t writeOffset = 0;
+        std::unordered_map<uint64_t, std::vector<std::size_t>> index;  // conversation -> record offsets
+    };
+
+    /* sorted by (conversation, timestamp) */
+    struct table_t {
+        uint64_t id;
+        mapping_t file;
+        table_footer_t footer;
+        const index_entry_t* index;
+    };
+
+    static constexpr uint32_t record_magic = 0x4d4c4f47;            // "MLOG"
+    static constexpr uint64_t table_magic = 0x454c4241544c4f47;     // "GOLTABLE"
+    static constexpr std::size_t record_align = 8;
+    const std::chrono::minutes retention_period{ 1 };
+
+    config_t config_;
+
+    /* records waiting for group commit */
+    std::string pending_;
+    uint64_t storedSeq_ = 0;
+    uint64_t committedSeq_ = 0;
+    std::mutex pendingMutex_;
+    std::condition_variable commitCv_;
+    std::condition_variable flushCv_;
+
+    /* readable state: active segment, sealed segments and tables */
+    std::unique_ptr<segment_t> active_;
+    std::deque<std::unique_ptr<segment_t>> sealed_;
+    std::deque<std::unique_ptr<table_t>> tables_;
+    /* tables holding records of conversation, in tables_ order; built from sparse
+     * index where every conversation of a table has an entry */
+    std::unordered_map<uint64_t, std::vector<const table_t*>> tablesByConversation_;
+    uint64_t nextId_ = 1;
+    mutable std::shared_mutex stateMutex_;
+
+    std::mutex compactMutex_;
+    std::condition_variable compactCv_;
+
+    std::atomic_bool stop_{ false };
+    std::thread committer_;
+    std::thread compactor_;
+
+    void CommitLoop();
+    /* committed is advanced past every published record, the rest is retried */
+    void Commit(const std::string& batch, std::size_t& committed);
+    void CompactLoop();
+    void Compact(const segment_t& segment);
+    void ApplyRetention();
+    void IndexTable(const table_t& table);
+    void UnindexTable(const table_t& table);
+
+    std::unique_ptr<segment_t> CreateSegment(uint64_t id);
+    std::unique_ptr<segment_t> OpenSegment(const std::string& path, uint64_t id);
+    std::unique_ptr<table_t> OpenTable(const std::string& path, uint64_t id);
+    std::string FilePath(uint64_t id, const char* extension) const;
+
+    static void ReadSegment(const segment_t& segment, uint64_t conversation, uint64_t fromMs, uint64_t toMs,
+        std::vector<message_t>& out);
+    static void ReadTable(const table_t& table, uint64_t conversation, uint64_t fromMs, uint64_t toMs,
+        std::vector<message_t>& out);
+    static bool ValidRecord(const char* base, std::size_t offset, std::size_t size);
+    static message_t ToMessage(const char* record);
+    static uint32_t Checksum(const record_header_t& header, const char* data, uint32_t size);
+    static void Map(mapping_t& file);
+    static void Unmap(mapping_t& file) noexcept;
+};
@@ -0,0 +1,73 @@
+/*****************************************************************
+ *  @file       MessageStorage.cpp
+ *  @brief      Selection of users messages storage engine
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+
+#include "IMessageStorage.h"
+
+#include <boost/format.hpp>
+
+#include "MongoProcess.h"
+#include "LogStorage.h"
+#include "GuardedStorage.h"
+#include "../config/config.h"
+#include "../log/Logger.h"
+
+std::unique_ptr<IMessageStorage> IMessageStorage::Create() {
+
+    auto scfg = std::make_shared<IConfig>();
+    try {
+        scfg->Open("server.ini");
+    }
+    catch (std::exception& ex) {
+        ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
+    }
+
+    if (scfg->GetConfigValueByKey("message_storage") != "log") {
+        /* remote backend is written behind breaker and spill queue */
+        GuardedStorage::config_t config;
+        config.spillDirectory = scfg->GetConfigValueByKey("storage_spill_dir");
+        if (config.spillDirectory.empty()) {
+            config.spillDirectory = "spill";
+        }
+        if (auto v = scfg->GetConfigValueByKey("storage_spill_memory_mb"); !v.empty()) {
+            config.maxMemoryBytes = std::stoull(v) * 1024 * 1024;
+        }
+        if (auto v = scfg->GetConfigValueByKey("storage_spill_disk_mb"); !v.empty()) {
+            config.maxDiskBytes = std::stoull(v) * 1024 * 1024;
+        }
+        if (auto v = scfg->GetConfigValueByKey("storage_max_attempts"); !v.empty()) {
+            config.maxAttempts = std::stoul(v);
+        }
+        if (auto v = scfg->GetConfigValueByKey("storage_breaker_failures"); !v.empty()) {
+            config.breaker.failureThreshold = std::stoul(v);
+        }
+        if (auto v = scfg->GetConfigValueByKey("storage_breaker_open_ms"); !v.empty()) {
+            config.breaker.openTime = std::chrono::milliseconds(std::stoul(v));
+        }
+        if (auto v = scfg->GetConfigValueByKey("storage_slow_ms"); !v.empty()) {
+            config.breaker.slowCall = std::chrono::milliseconds(std::stoul(v));
+        }
+        return std::make_unique<GuardedStorage>(std::make_unique<MongoProcessor>("mongo.ini"), "mongo", config);
+    }
+
+    LogStorage::config_t config;
+    config.directory = scfg->GetConfigValueByKey("storage_dir");
+    if (config.directory.empty()) {
+        config.directory = "messages";
+    }
+    if (auto v = scfg->GetConfigValueByKey("storage_segment_mb"); !v.empty()) {
+        config.segmentSize = std::stoull(v) * 1024 * 1024;
+    }
+    if (auto v = scfg->GetConfigValueByKey("storage_commit_interval_ms"); !v.empty()) {
+        config.commitInterval = std::chrono::milliseconds(std::stoul(v));
+    }
+    if (auto v = scfg->GetConfigValueByKey("storage_retention_hours"); !v.empty()) {
+        config.retention = std::chrono::hours(std::stoul(v));
+    }
+    ConsoleLogger::Info(boost::str(boost::format("Messages are stored in embedded log: %1%") % config.directory));
+    return std::make_unique<LogStorage>(config);
+}
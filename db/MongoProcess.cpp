@@ -14,6 +14,9 @@
 #include <boost/date_time.hpp>
 #include <boost/format.hpp>
 
+#include <algorithm>
+#include <stdexcept>
+
 #include <spdlog/spdlog.h>
 
 using bsoncxx::builder::stream::close_array;
@@ -24,12 +27,37 @@ using bsoncxx::builder::stream::open_array;
 using bsoncxx::builder::stream::open_document;
 
 void MongoProcessor::InitializeConnection(std::string&& config) noexcept {
-    mongocxx::instance instance{};
+    /* driver must be initialized once and outlive every client */
+    static mongocxx::instance instance{};
     try
     {
         dbcfg = std::make_shared<IConfig>();
         dbcfg->Open(std::move(config));
         connectingString_ = dbcfg->GetConfigValueByKey("connstr");
+
+        if (dbcfg->GetConfigValueByKey("schema") == "bucket") {
+            schema_ = schema_t::bucket;
+            if (auto v = dbcfg->GetConfigValueByKey("bucket_minutes"); !v.empty()) {
+                bucketWindow_ = std::chrono::minutes(std::max(std::stoul(v), 1ul));
+            }
+            if (auto v = dbcfg->GetConfigValueByKey("bucket_capacity"); !v.empty()) {
+                bucketCapacity_ = std::max(std::stoi(v), 1);
+            }
+        }
+        auto cfgMs = [this](std::string&& key, std::chrono::milliseconds defaultValue) {
+            auto value = dbcfg->GetConfigValueByKey(std::move(key));
+            return value.empty() ? defaultValue : std::chrono::milliseconds(std::stoul(value));
+        };
+        connectTimeout_ = cfgMs("connect_timeout_ms", connectTimeout_);
+        insertTimeout_ = cfgMs("insert_timeout_ms", insertTimeout_);
+        readTimeout_ = cfgMs("read_timeout_ms", readTimeout_);
+
+        /* driver defaults wait up to 30 s for server selection */
+        std::string uri = connectingString_ + (connectingString_.find('?') == std::string::npos ? "?" : "&") +
+            boost::str(boost::format("connectTimeoutMS=%1%&serverSelectionTimeoutMS=%1%&socketTimeoutMS=%2%") %
+                connectTimeout_.count() % (std::max(insertTimeout_, readTimeout_) + connectTimeout_).count());
+        pool_ = std::make_unique<mongocxx::pool>(mongocxx::uri{uri});
+        MongoLog(boost::str(boost::format("MongoDB messages collection: %1%") % GetCollectionName()));
     } catch (std::exception const& ex) {
         MongoError(boost::str(boost::format("%1% %2%") % "Initialize MongDB connection error: " % ex.what()));
     }
@@ -46,8 +74,8 @@ MongoProcessor::~MongoProcessor() {
 
 void MongoProcessor::InsertNewMessage(const boost::property_tree::ptree& tree) noexcept {
     try {
-        mongocxx::client client{mongocxx::uri{connectingString_}};
-        mongocxx::database db = client["msgdb"];
+        auto client = Acquire();
+        mongocxx::database db = (*client)["msgdb"];
         auto collection = std::make_unique<mongocxx::collection>(db["msgtable"]);
         Insert(std::move(collection), std::cref(tree));
     } catch (std::exception &ex) {
@@ -57,15 +85,227 @@ void MongoProcessor::InsertNewMessage(const boost::property_tree::ptree& tree) n
 
 #include <boost/date_time/posix_time/posix_time.hpp>
 
+mongocxx::pool::entry MongoProcessor::Acquire() const {
+    if (!pool_) {
+        throw std::runtime_error("MongoDB connection is not configured");
+    }
+    return pool_->acquire();
+}
+
+mongocxx::collection MongoProcessor::Collection(mongocxx::client& client) const {
+    mongocxx::collection collection = client["msgdb"][GetCollectionName()];
+    CreateIndexes(collection);
+    return collection;
+}
+
+bool MongoProcessor::Store(message_t&& msg) noexcept {
+    try {
+        auto client = Acquire();
+        auto collection = Collection(*client);
+        if (schema_ == schema_t::bucket) {
+            return StoreBucket(collection, msg);
+        }
+        return Insert(collection, std::to_string(msg.dst), std::to_string(msg.src), msg.text, TimestampKey(msg.timestampMs));
+    } catch (std::exception &ex) {
+        MongoError(boost::str(boost::format("%1% %2%") % "Insert message error: " % ex.what()));
+    }
+    return false;
+}
+
+mongocxx::write_concern MongoProcessor::WriteConcern() const {
+    mongocxx::write_concern concern;
+    concern.timeout(insertTimeout_);
+    return concern;
+}
+
+// @brief fixed width, so string order of stored timestamps is numeric order
+std::string MongoProcessor::TimestampKey(uint64_t timestampMs) {
+    return boost::str(boost::format("%013u") % std::min<uint64_t>(timestampMs, 9999999999999ull));
+}
+
+bsoncxx::types::b_date MongoProcessor::Date(uint64_t timestampMs) noexcept {
+    return bsoncxx::types::b_date{ std::chrono::milliseconds{
+        static_cast<int64_t>(std::min<uint64_t>(timestampMs, INT64_MAX)) } };
+}
+
+uint64_t MongoProcessor::BucketStart(uint64_t timestampMs) const noexcept {
+    uint64_t window = static_cast<uint64_t>(bucketWindow_.count());
+    return timestampMs - timestampMs % window;
+}
+
+// @brief history pages are range scans of one conversation by time
+void MongoProcessor::CreateIndexes(mongocxx::collection& collection) const {
+    std::call_once(indexOnce_, [this, &collection]() {
+        if (schema_ == schema_t::bucket) {
+            collection.create_index(document{} << "a" << 1 << "b" << 1 << "start" << 1 << finalize);
+            return;
+        }
+        collection.create_index(document{}
+            << JsonHandler::src_user_msg_token << 1
+            << JsonHandler::dst_user_msg_token << 1
+            << JsonHandler::msg_timestamp_token << 1
+            << finalize);
+    });
+}
+
+// @brief one index entry per window instead of one per message, full bucket is continued by a new one
+bool MongoProcessor::StoreBucket(mongocxx::collection& collection, const message_t& msg) const {
+
+    auto conversation = ConversationKey(msg.src, msg.dst);
+    auto timestamp = Date(msg.timestampMs);
+
+    auto filter = document{}
+        << "a" << static_cast<int32_t>(conversation >> 32)
+        << "b" << static_cast<int32_t>(conversation & 0xffffffff)
+        << "start" << Date(BucketStart(msg.timestampMs))
+        << "count" << open_document << "$lt" << bucketCapacity_ << close_document
+        << finalize;
+
+    auto update = document{}
+        << "$push" << open_document
+            << "messages" << open_document
+                << "s" << static_cast<int32_t>(msg.src) << "t" << timestamp << "m" << msg.text
+            << close_document
+        << close_document
+        << "$inc" << open_document << "count" << 1 << close_document
+        << "$min" << open_document << "first" << timestamp << close_document
+        << "$max" << open_document << "last" << timestamp << close_document
+        << finalize;
+
+    mongocxx::options::update options;
+    options.upsert(true);
+    options.write_concern(WriteConcern());
+    if (!collection.update_one(filter.view(), update.view(), options)) {
+        spdlog::error("MongoDB bucket update is failed");
+        return false;
+    }
+    return true;
+}
+
+std::vector<IMessageStorage::message_t> MongoProcessor::Read(uint64_t conversation, uint64_t fromMs, uint64_t toMs,
+    std::size_t limit, bool latest) const {
+
+    auto client = Acquire();
+    auto collection = Collection(*client);
+    return schema_ == schema_t::bucket ?
+        ReadBucket(collection, conversation, fromMs, toMs, limit, latest) :
+        ReadFlat(collection, conversation, fromMs, toMs, limit, latest);
+}
+
+std::vector<IMessageStorage::message_t> MongoProcessor::ReadFlat(mongocxx::collection& collection, uint64_t conversation,
+    uint64_t fromMs, uint64_t toMs, std::size_t limit, bool latest) const {
+
+    auto a = std::to_string(static_cast<uint32_t>(conversation >> 32));
+    auto b = std::to_string(static_cast<uint32_t>(conversation));
+
+    /* both directions, each branch is a range of the compound index */
+    auto filter = document{}
+        << "$or" << open_array
+            << open_document << JsonHandler::src_user_msg_token << a << JsonHandler::dst_user_msg_token << b << close_document
+            << open_document << JsonHandler::src_user_msg_token << b << JsonHandler::dst_user_msg_token << a << close_document
+        << close_array
+        << JsonHandler::msg_timestamp_token << open_document
+            << "$gte" << TimestampKey(fromMs) << "$lte" << TimestampKey(toMs)
+        << close_document
+        << finalize;
+
+    mongocxx::options::find options;
+    options.sort(document{} << JsonHandler::msg_timestamp_token << (latest ? -1 : 1) << finalize);
+    options.limit(static_cast<int64_t>(std::min<std::size_t>(limit, INT64_MAX)));
+    options.max_time(readTimeout_);
+
+    std::vector<message_t> page;
+    for (auto&& doc : collection.find(filter.view(), options)) {
+        auto text = doc[JsonHandler::user_msg_token].get_utf8().value;
+        auto timestamp = doc[JsonHandler::msg_timestamp_token].get_utf8().value;
+        page.push_back(message_t{
+            static_cast<uint32_t>(std::stoul(std::string{ doc[JsonHandler::src_user_msg_token].get_utf8().value })),
+            static_cast<uint32_t>(std::stoul(std::string{ doc[JsonHandler::dst_user_msg_token].get_utf8().value })),
+            std::stoull(std::string{ timestamp }),
+            std::string{ text }
+        });
+    }
+    if (latest) {
+        std::reverse(page.begin(), page.end());
+    }
+    return page;
+}
+
+std::vector<IMessageStorage::message_t> MongoProcessor::ReadBucket(mongocxx::collection& collection, uint64_t conversation,
+    uint64_t fromMs, uint64_t toMs, std::size_t limit, bool latest) const {
+
+    auto a = static_cast<uint32_t>(conversation >> 32);
+    auto b = static_cast<uint32_t>(conversation);
+    toMs = std::min<uint64_t>(toMs, INT64_MAX);
+    uint64_t window = static_cast<uint64_t>(bucketWindow_.count());
+
+    auto filter = document{}
+        << "a" << static_cast<int32_t>(a) << "b" << static_cast<int32_t>(b)
+        << "start" << open_document
+            << "$gte" << Date(BucketStart(fromMs)) << "$lte" << Date(BucketStart(toMs))
+        << close_document
+        << finalize;
+
+    mongocxx::options::find options;
+    options.sort(document{} << "start" << (latest ? -1 : 1) << finalize);
+    options.max_time(readTimeout_);
+
+    auto byTime = [](const message_t& l, const message_t& r) { return l.timestampMs < r.timestampMs; };
+    std::vector<message_t> page;
+
+    for (auto&& doc : collection.find(filter.view(), options)) {
+        uint64_t start = static_cast<uint64_t>(doc["start"].get_date().value.count());
+
+        /* buckets come window by window, stop when the next one can't change the page */
+        if (limit > 0 && page.size() >= limit) {
+            std::stable_sort(page.begin(), page.end(), byTime);
+            if (latest ? start + window - 1 < page[page.size() - limit].timestampMs :
+                         start > page[limit - 1].timestampMs) {
+                break;
+            }
+        }
+
+        for (auto&& item : doc["messages"].get_array().value) {
+            auto msg = item.get_document().value;
+            uint64_t timestamp = static_cast<uint64_t>(msg["t"].get_date().value.count());
+            if (timestamp < fromMs || timestamp > toMs) {
+                continue;
+            }
+            uint32_t src = static_cast<uint32_t>(msg["s"].get_int32().value);
+            page.push_back(message_t{ src, src == a ? b : a, timestamp, std::string{ msg["m"].get_utf8().value } });
+        }
+    }
+
+    std::stable_sort(page.begin(), page.end(), byTime);
+    if (page.size() > limit) {
+        if (latest) {
+            page.erase(page.begin(), page.end() - static_cast<std::ptrdiff_t>(limit));
+        }
+        else {
+            page.resize(limit);
+        }
+    }
+    return page;
+}
+
 void MongoProcessor::Insert(std::unique_ptr<mongocxx::collection> collection, const boost::property_tree::ptree& tree) noexcept {
-    auto builder = bsoncxx::builder::stream::document{};
 
-    std::unique_ptr<JsonHandler> handle = std::make_unique<JsonHandler>();
-    auto toId = handle->ParseTreeParam<std::string>(tree, JsonHandler::dst_user_msg_token);
-    auto fromId = handle->ParseTreeParam<std::string>(tree, JsonHandler::src_user_msg_token);
-    auto message = handle->ParseTreeParam<std::string>(tree, JsonHandler::user_msg_token);
-    auto timestamp = handle->ParseTreeParam<std::string>(tree, JsonHandler::msg_timestamp_token);
+    try {
+        std::unique_ptr<JsonHandler> handle = std::make_unique<JsonHandler>();
+        auto toId = handle->ParseTreeParam<std::string>(tree, JsonHandler::dst_user_msg_token);
+        auto fromId = handle->ParseTreeParam<std::string>(tree, JsonHandler::src_user_msg_token);
+        auto message = handle->ParseTreeParam<std::string>(tree, JsonHandler::user_msg_token);
+        auto timestamp = handle->ParseTreeParam<std::string>(tree, JsonHandler::msg_timestamp_token);
+        Insert(*collection, toId, fromId, message, timestamp);
+    } catch (std::exception &ex) {
+        MongoError(boost::str(boost::format("%1% %2%") % "Insert message error: " % ex.what()));
+    }
+}
+
+bool MongoProcessor::Insert(mongocxx::collection& collection, const std::string& toId, const std::string& fromId,
+    const std::string& message, const std::string& timestamp) const {
 
+    auto builder = bsoncxx::builder::stream::document{};
     bsoncxx::document::value doc_value = builder
     << JsonHandler::dst_user_msg_token << toId 
     << JsonHandler::src_user_msg_token << fromId
@@ -75,11 +315,14 @@ void MongoProcessor::Insert(std::unique_ptr<mongocxx::collection> collection, co
 
     bsoncxx::document::view view = doc_value.view();
     
-    bsoncxx::stdx::optional<mongocxx::result::insert_one> result = collection->insert_one(view);
+    mongocxx::options::insert options;
+    options.write_concern(WriteConcern());
+    bsoncxx::stdx::optional<mongocxx::result::insert_one> result = collection.insert_one(view, options);
     if(!result) {
         spdlog::error("MongoDB insert function is failed");
-        // TODO:
+        return false;
     }
+    return true;
 }
 
 void MongoProcessor::MongoLog(std::string&& logMsg) {
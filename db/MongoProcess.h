@@ -14,8 +14,13 @@
 #include <cstdint>
 #include <iostream>
 #include <vector>
+#include <mutex>
+#include <chrono>
 #include <bsoncxx/json.hpp>
+#include <bsoncxx/types.hpp>
 #include <mongocxx/client.hpp>
+#include <mongocxx/pool.hpp>
+#include <mongocxx/write_concern.hpp>
 #include <mongocxx/stdx.hpp>
 #include <mongocxx/uri.hpp>
 #include <mongocxx/instance.hpp>
@@ -24,10 +29,25 @@
 #include <bsoncxx/builder/stream/array.hpp>
 
 #include "../config/config.h"
+#include "IMessageStorage.h"
 
 #include <boost/property_tree/json_parser.hpp>
 
-class MongoProcessor {
+/* "schema" key of config selects documents layout:
+ * flat (default) - document per message with string fields,
+ * bucket - messages of conversation are pushed into document per time window
+ *          { a, b : int32 user IDs (a < b), start : date, count, first, last,
+ *            messages : [ { s : int32 sender, t : date, m : text } ] } */
+class MongoProcessor : public IMessageStorage {
+
+public:
+
+    enum class schema_t {
+        flat = 0,
+        bucket,
+    };
+
+private:
 
     enum class ConfigClass {
         debug = 0,
@@ -39,19 +59,52 @@ class MongoProcessor {
     mutable std::string connectingString_;  
     mutable std::shared_ptr<IConfig> dbcfg;
     mutable std::shared_ptr<mongocxx::client> mongoclient_;
+    mutable std::once_flag indexOnce_;
+    std::unique_ptr<mongocxx::pool> pool_;
+
+    schema_t schema_ = schema_t::flat;
+    std::chrono::milliseconds bucketWindow_{ std::chrono::hours(1) };
+    int32_t bucketCapacity_ = 200;
+
+    /* a slow server must fail the operation, not stall the caller */
+    std::chrono::milliseconds connectTimeout_{ 1000 };
+    std::chrono::milliseconds insertTimeout_{ 1000 };
+    std::chrono::milliseconds readTimeout_{ 500 };
 
     static void MongoLog(std::string&& logMsg);
     static void MongoError(std::string&& errMsg);
     
     void Insert(std::unique_ptr<mongocxx::collection> collection, const boost::property_tree::ptree& tree) noexcept;
+    bool Insert(mongocxx::collection& collection, const std::string& toId, const std::string& fromId,
+        const std::string& message, const std::string& timestamp) const;
     void InitializeConnection(std::string&& config) noexcept;
+    void CreateIndexes(mongocxx::collection& collection) const;
+    mongocxx::pool::entry Acquire() const;
+    mongocxx::collection Collection(mongocxx::client& client) const;
+
+    bool StoreBucket(mongocxx::collection& collection, const message_t& msg) const;
+    mongocxx::write_concern WriteConcern() const;
+    std::vector<message_t> ReadFlat(mongocxx::collection& collection, uint64_t conversation, uint64_t fromMs,
+        uint64_t toMs, std::size_t limit, bool latest) const;
+    std::vector<message_t> ReadBucket(mongocxx::collection& collection, uint64_t conversation, uint64_t fromMs,
+        uint64_t toMs, std::size_t limit, bool latest) const;
+
+    uint64_t BucketStart(uint64_t timestampMs) const noexcept;
+    static bsoncxx::types::b_date Date(uint64_t timestampMs) noexcept;
+    static std::string TimestampKey(uint64_t timestampMs);
     
 public:
 
 
     MongoProcessor() = delete;
     MongoProcessor(std::string&& connectingConfig);
-    ~MongoProcessor();
+    ~MongoProcessor() override;
 
     void InsertNewMessage(const boost::property_tree::ptree& tree) noexcept;
+    bool Store(message_t&& msg) noexcept override;
+    std::vector<message_t> Read(uint64_t conversation, uint64_t fromMs, uint64_t toMs,
+        std::size_t limit, bool latest) const override;
+
+    schema_t GetSchema() const noexcept { return schema_; }
+    std::string GetCollectionName() const { return schema_ == schema_t::bucket ? "msgbuckets" : "msgtable"; }
 };
\ No newline at end of file
@@ -0,0 +1,97 @@
+/*****************************************************************
+ *  @file       PostgresListener.cpp
+ *  @brief      Dedicated connection receiving Postgres NOTIFY events
+ *              implementation
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+
+#include "PostgresListener.h"
+
+#include <chrono>
+
+#include <poll.h>
+
+#include <boost/format.hpp>
+
+#include "../log/Logger.h"
+
+PostgresListener::PostgresListener(const std::string& connectionString, const std::string& channel,
+    notify_callback_t&& onNotify, subscribe_callback_t&& onSubscribe) :
+    connectionString_(connectionString),
+    channel_(channel),
+    onNotify_(std::move(onNotify)),
+    onSubscribe_(std::move(onSubscribe))
+{
+    ConsoleLogger::Debug(boost::str(boost::format("Construct PostgresListener class for channel %1%") % channel_));
+    thread_ = std::thread{ [&]() { Run(); } };
+}
+
+PostgresListener::~PostgresListener() {
+    stop_ = true;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    ConsoleLogger::Debug("Destruct PostgresListener class");
+}
+
+PGconn* PostgresListener::Subscribe() noexcept {
+
+    PGconn* conn = PQconnectdb(connectionString_.c_str());
+    if (PQstatus(conn) != CONNECTION_OK) {
+        ConsoleLogger::Error(boost::str(boost::format("Postgres listener connection error: %1%") % PQerrorMessage(conn)));
+        PQfinish(conn);
+        return nullptr;
+    }
+
+    char* channel = PQescapeIdentifier(conn, channel_.c_str(), channel_.size());
+    PGresult* res = PQexec(conn, (std::string{ "LISTEN " } + channel).c_str());
+    PQfreemem(channel);
+
+    bool ok = PQresultStatus(res) == PGRES_COMMAND_OK;
+    if (!ok) {
+        ConsoleLogger::Error(boost::str(boost::format("Postgres LISTEN error: %1%") % PQresultErrorMessage(res)));
+    }
+    PQclear(res);
+    if (!ok) {
+        PQfinish(conn);
+        return nullptr;
+    }
+    return conn;
+}
+
+void PostgresListener::Run() noexcept {
+
+    while (!stop_) {
+
+        PGconn* conn = Subscribe();
+        if (!conn) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(reconnect_delay));
+            continue;
+        }
+        onSubscribe_();
+
+        while (!stop_) {
+            /* short poll timeout only to notice shutdown */
+            pollfd pfd{ PQsocket(conn), POLLIN, 0 };
+            if (poll(&pfd, 1, poll_timeout) < 0) {
+                continue;
+            }
+            if (PQconsumeInput(conn) != 1) {
+                ConsoleLogger::Error(boost::str(boost::format("Postgres listener error: %1%") % PQerrorMessage(conn)));
+                break;
+            }
+            while (PGnotify* notify = PQnotifies(conn)) {
+                try {
+                    onNotify_(notify->extra);
+                }
+                catch (std::exception& ex) {
+                    ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
+                }
+                PQfreemem(notify);
+            }
+        }
+        PQfinish(conn);
+    }
+}
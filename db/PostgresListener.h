@@ -0,0 +1,51 @@
+/*****************************************************************
+ *  @file       PostgresListener.h
+ *  @brief      Dedicated connection receiving Postgres NOTIFY events
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+#pragma once
+
+/* std C++ lib headers */
+#include <string>
+#include <thread>
+#include <atomic>
+#include <functional>
+
+/* libpq C lib headers */
+#include <libpq-fe.h>
+
+class PostgresListener {
+
+public:
+
+    using notify_callback_t = std::function<void(const std::string& payload)>;
+    /* called every time LISTEN is (re)established, events sent while
+     * the connection was down are lost and must be compensated here */
+    using subscribe_callback_t = std::function<void()>;
+
+    PostgresListener() = delete;
+    PostgresListener(const PostgresListener&) = delete;
+    PostgresListener& operator=(const PostgresListener&) = delete;
+
+    PostgresListener(const std::string& connectionString, const std::string& channel,
+        notify_callback_t&& onNotify, subscribe_callback_t&& onSubscribe);
+    ~PostgresListener();
+
+private:
+
+    const std::string connectionString_;
+    const std::string channel_;
+    const notify_callback_t onNotify_;
+    const subscribe_callback_t onSubscribe_;
+
+    const int poll_timeout = 200; // ms
+    const uint32_t reconnect_delay = 1000; // ms
+
+    std::atomic_bool stop_{ false };
+    std::thread thread_;
+
+    void Run() noexcept;
+    PGconn* Subscribe() noexcept;
+};
@@ -0,0 +1,241 @@
+/*****************************************************************
+ *  @file       PostgresPool.cpp
+ *  @brief      Pool of pipelined libpq connections implementation
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+
+#include "PostgresPool.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include <boost/format.hpp>
+
+#include "../log/Logger.h"
+
+PostgresPool::PostgresPool(const std::string& connectionString, std::vector<statement_t>&& statements,
+    uint32_t poolSize, uint32_t pipelineDepth, uint32_t maxQueueSize, const timeouts_t& timeouts, setup_t&& setup) :
+    connectionString_(connectionString),
+    statements_(std::move(statements)),
+    pipelineDepth_(std::max<uint32_t>(pipelineDepth, 1)),
+    maxQueueSize_(maxQueueSize),
+    timeouts_(timeouts),
+    setup_(std::move(setup))
+{
+    ConsoleLogger::Debug(boost::str(boost::format("Construct PostgresPool class, %1% connections") % poolSize));
+
+    for (uint32_t i = 0; i < std::max<uint32_t>(poolSize, 1); ++i) {
+        workers_.emplace_back([&]() { Worker(); });
+    }
+}
+
+PostgresPool::~PostgresPool() {
+    {
+        std::unique_lock lk(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+
+    std::vector<request_t> rest{ std::make_move_iterator(queue_.begin()), std::make_move_iterator(queue_.end()) };
+    Fail(rest, true);
+    ConsoleLogger::Debug("Destruct PostgresPool class");
+}
+
+void PostgresPool::Execute(const std::string& statement, params_t&& params, callback_t&& cb) noexcept {
+
+    try {
+        auto it = std::find_if(statements_.begin(), statements_.end(),
+            [&](const statement_t& st) { return st.name == statement; });
+
+        if (it == statements_.end() || static_cast<int>(params.size()) != it->nParams) {
+            ConsoleLogger::Error(boost::str(boost::format("Postgres statement %1% is unknown") % statement));
+            cb(nullptr, true);
+            return;
+        }
+
+        {
+            std::unique_lock lk(mutex_);
+            if (stop_ || queue_.size() >= maxQueueSize_) {
+                lk.unlock();
+                ConsoleLogger::Error("Postgres request queue is full");
+                cb(nullptr, true);
+                return;
+            }
+            queue_.push_back(request_t{ &it->name, std::move(params), std::move(cb) });
+        }
+        cv_.notify_one();
+    }
+    catch (std::exception& ex) {
+        ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
+    }
+}
+
+std::size_t PostgresPool::GetQueueSize() const noexcept {
+    std::unique_lock lk(mutex_);
+    return queue_.size();
+}
+
+PGconn* PostgresPool::Connect() noexcept {
+
+    /* configured string is expanded, timeouts are added on top of it; server
+     * cancels slow statements, tcp_user_timeout drops silently dead peers */
+    auto connectTimeout = std::to_string(timeouts_.connectSec);
+    auto options = boost::str(boost::format("-c statement_timeout=%1%") % timeouts_.statementMs);
+    auto userTimeout = std::to_string(std::max<uint64_t>(timeouts_.statementMs, timeouts_.connectSec * 1000ull));
+    const char* keywords[] = { "dbname", "connect_timeout", "options", "tcp_user_timeout", nullptr };
+    const char* values[] = { connectionString_.c_str(), connectTimeout.c_str(), options.c_str(), userTimeout.c_str(), nullptr };
+
+    PGconn* conn = PQconnectdbParams(keywords, values, 1);
+    if (PQstatus(conn) != CONNECTION_OK) {
+        ConsoleLogger::Error(boost::str(boost::format("Postgres connection error: %1%") % PQerrorMessage(conn)));
+        PQfinish(conn);
+        return nullptr;
+    }
+
+    /* statements may refer to tables created by setup, other workers wait for it */
+    if (setup_) {
+        std::unique_lock lk(setupMutex_);
+        if (!setupDone_) {
+            try {
+                setupDone_ = setup_();
+            }
+            catch (std::exception& ex) {
+                ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
+            }
+            if (!setupDone_) {
+                PQfinish(conn);
+                return nullptr;
+            }
+        }
+    }
+
+    for (const auto& st : statements_) {
+        PGresult* res = PQprepare(conn, st.name.c_str(), st.sql.c_str(), st.nParams, nullptr);
+        bool ok = PQresultStatus(res) == PGRES_COMMAND_OK;
+        if (!ok) {
+            ConsoleLogger::Error(boost::str(boost::format("Postgres prepare %1% error: %2%") %
+                st.name % PQresultErrorMessage(res)));
+        }
+        PQclear(res);
+        if (!ok) {
+            PQfinish(conn);
+            return nullptr;
+        }
+    }
+
+    if (PQenterPipelineMode(conn) != 1) {
+        ConsoleLogger::Error("Postgres pipeline mode is not supported");
+        PQfinish(conn);
+        return nullptr;
+    }
+    return conn;
+}
+
+void PostgresPool::Worker() noexcept {
+
+    PGconn* conn = nullptr;
+    std::vector<request_t> batch;
+    batch.reserve(pipelineDepth_);
+
+    for (;;) {
+        {
+            std::unique_lock lk(mutex_);
+            cv_.wait(lk, [&]() { return stop_ || !queue_.empty(); });
+            if (stop_) {
+                break;
+            }
+            /* everything queued while previous pipeline was in flight goes out in one round trip */
+            while (!queue_.empty() && batch.size() < pipelineDepth_) {
+                batch.push_back(std::move(queue_.front()));
+                queue_.pop_front();
+            }
+        }
+
+        if (!conn) {
+            conn = Connect();
+        }
+        if (!conn || !RunPipeline(conn, batch)) {
+            Fail(batch, false);
+            if (conn) {
+                PQfinish(conn);
+                conn = nullptr;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(reconnect_delay));
+        }
+        batch.clear();
+    }
+
+    if (conn) {
+        PQfinish(conn);
+    }
+}
+
+bool PostgresPool::RunPipeline(PGconn* conn, std::vector<request_t>& batch) noexcept {
+
+    /* connection is in blocking mode, the pipeline depth is bounded so the
+     * whole batch fits into socket buffers and sending can't deadlock */
+    std::vector<const char*> values;
+    for (const auto& req : batch) {
+        values.clear();
+        for (const auto& p : req.params) {
+            values.push_back(p.c_str());
+        }
+        if (PQsendQueryPrepared(conn, req.statement->c_str(), static_cast<int>(values.size()),
+            values.data(), nullptr, nullptr, 0) != 1) {
+            ConsoleLogger::Error(boost::str(boost::format("Postgres send error: %1%") % PQerrorMessage(conn)));
+            return false;
+        }
+    }
+    if (PQpipelineSync(conn) != 1) {
+        ConsoleLogger::Error(boost::str(boost::format("Postgres sync error: %1%") % PQerrorMessage(conn)));
+        return false;
+    }
+
+    std::size_t done = 0;
+    for (auto& req : batch) {
+        PGresult* res = PQgetResult(conn);
+        if (!res) {
+            break;
+        }
+        try {
+            req.cb(res, false);
+        }
+        catch (std::exception& ex) {
+            ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
+        }
+        PQclear(res);
+        done++;
+        /* every query result is terminated by null */
+        while ((res = PQgetResult(conn)) != nullptr) {
+            PQclear(res);
+        }
+    }
+
+    if (done != batch.size()) {
+        batch.erase(batch.begin(), batch.begin() + done);
+        return false;
+    }
+
+    PGresult* sync = PQgetResult(conn);
+    bool ok = sync && PQresultStatus(sync) == PGRES_PIPELINE_SYNC;
+    PQclear(sync);
+    batch.clear();
+    return ok && PQstatus(conn) == CONNECTION_OK;
+}
+
+void PostgresPool::Fail(std::vector<request_t>& batch, bool rejected) noexcept {
+    for (auto& req : batch) {
+        try {
+            req.cb(nullptr, rejected);
+        }
+        catch (std::exception& ex) {
+            ConsoleLogger::Error(boost::str(boost::format("Exception %1%: %2%\n") % __FUNCTION__ % ex.what()));
+        }
+    }
+    batch.clear();
+}
@@ -0,0 +1,98 @@
+/*****************************************************************
+ *  @file       PostgresPool.h
+ *  @brief      Pool of pipelined libpq connections executing
+ *              prepared statements asynchronously
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+#pragma once
+
+/* std C++ lib headers */
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+#include <cstdint>
+
+/* libpq C lib headers */
+#include <libpq-fe.h>
+
+class PostgresPool {
+
+public:
+
+    using params_t = std::vector<std::string>;
+    /* result is valid only inside callback, nullptr means the query was
+     * not executed at all: rejected is set when pool refused it without
+     * trying (queue overflow, unknown statement, shutdown), otherwise
+     * connection to server failed */
+    using callback_t = std::function<void(const PGresult* result, bool rejected)>;
+
+    /* run once for the pool before statements are prepared, e.g. schema
+     * creation; false fails the connection and it is retried by next one */
+    using setup_t = std::function<bool()>;
+
+    struct statement_t {
+        std::string name;
+        std::string sql;
+        int nParams;
+    };
+
+    /* bounds of a single call, so dead server fails requests instead of holding worker */
+    struct timeouts_t {
+        uint32_t connectSec = 2;
+        uint32_t statementMs = 1000;
+    };
+
+    PostgresPool() = delete;
+    PostgresPool(const PostgresPool&) = delete;
+    PostgresPool& operator=(const PostgresPool&) = delete;
+
+    /* each connection gets own worker thread, statements are prepared on every connection */
+    PostgresPool(const std::string& connectionString, std::vector<statement_t>&& statements,
+        uint32_t poolSize, uint32_t pipelineDepth, uint32_t maxQueueSize, const timeouts_t& timeouts,
+        setup_t&& setup = nullptr);
+    ~PostgresPool();
+
+    /* non-blocking, callback is invoked from pool worker thread */
+    void Execute(const std::string& statement, params_t&& params, callback_t&& cb) noexcept;
+
+    std::size_t GetQueueSize() const noexcept;
+
+private:
+
+    struct request_t {
+        const std::string* statement;
+        params_t params;
+        callback_t cb;
+    };
+
+    const std::string connectionString_;
+    const std::vector<statement_t> statements_;
+    const uint32_t pipelineDepth_;
+    const uint32_t maxQueueSize_;
+    const timeouts_t timeouts_;
+    const uint32_t reconnect_delay = 500; // ms
+
+    const setup_t setup_;
+    std::mutex setupMutex_;
+    bool setupDone_ = false;
+
+    std::deque<request_t> queue_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+
+    std::vector<std::thread> workers_;
+
+    void Worker() noexcept;
+    PGconn* Connect() noexcept;
+    bool RunPipeline(PGconn* conn, std::vector<request_t>& batch) noexcept;
+    static void Fail(std::vector<request_t>& batch, bool rejected) noexcept;
+};
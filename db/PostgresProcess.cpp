@@ -3,8 +3,8 @@
  *  @brief      Postgres connection handler class implementation
  *  @author     Kalmykov Dmitry
  *  @date       26.03.2021
- *  @modified   19.08.2021
- *  @version    0.1
+ *  @modified   19.10.2026
+ *  @version    0.2
  */
 
 #include <iostream>
@@ -17,17 +17,17 @@
 #include <boost/container_hash/hash.hpp>
 
 #include <openssl/sha.h>
+#include <openssl/crypto.h>
 
 #include <pqxx/pqxx>
 #include <spdlog/spdlog.h>
 
 #include "PostgresProcessor.h"
-
-#include <mongocxx/client.hpp>
-#include <mongocxx/instance.hpp>
+#include "../log/Metrics.h"
+#include "../crypto/PasswordHash.h"
 
 const std::string createtableScript {
-    "CREATE TABLE IF NOT EXISTS userstable$167 (\
+    "CREATE TABLE IF NOT EXISTS %1% (\
             id SERIAL PRIMARY KEY,\
             username VARCHAR UNIQUE NOT NULL,\
             email VARCHAR UNIQUE NOT NULL,\
@@ -38,6 +38,37 @@ const std::string createtableScript {
         )"
 };
 
+/* every change of users row is announced to listeners, cached records are invalidated by login */
+const std::string usersChangedChannel { "users_changed" };
+const std::string notifyTriggerScript {
+    "CREATE OR REPLACE FUNCTION notify_users_changed() RETURNS trigger AS $$\
+        BEGIN\
+            IF TG_OP <> 'INSERT' THEN PERFORM pg_notify('users_changed', OLD.username); END IF;\
+            IF TG_OP <> 'DELETE' THEN PERFORM pg_notify('users_changed', NEW.username); END IF;\
+            RETURN NULL;\
+        END;\
+        $$ LANGUAGE plpgsql;\
+    CREATE OR REPLACE TRIGGER users_changed_notify AFTER INSERT OR UPDATE OR DELETE ON %1%\
+        FOR EACH ROW EXECUTE FUNCTION notify_users_changed();"
+};
+
+const std::string lookupUserStatement { "lookup_user" };
+const std::string lookupUserScript { "SELECT id, password, active FROM %1% WHERE username = $1" };
+
+namespace {
+    /* the same quoting as PQescapeIdentifier, table name is needed before any connection */
+    std::string QuoteName(const std::string& name) {
+        std::string quoted{ "\"" };
+        for (char c : name) {
+            if (c == '"') {
+                quoted += c;
+            }
+            quoted += c;
+        }
+        return quoted + "\"";
+    }
+}
+
 /*********************************************************
  *  @brief  Set connection to PostgreSQL database
  */
@@ -48,19 +79,80 @@ void PostgresProcessor::InitializeDatabaseConnection() {
         /* open db config file */
         auto dbcfg = std::make_shared<IConfig>();
         dbcfg->Open("postgres.ini");
-        std::string connection_string{dbcfg->GetConfigValueByKey("postgres_connection_string")};
+        connectionString_ = dbcfg->GetConfigValueByKey("postgres_connection_string");
+
+        /* table name can't be passed as statement parameter, so only it is quoted into the text */
+        usersTable_ = QuoteName(dbcfg->GetConfigValueByKey("dbusertable"));
+
+        auto cfgNumber = [&](std::string&& key, uint32_t defaultValue) {
+            auto value = dbcfg->GetConfigValueByKey(std::move(key));
+            return value.empty() ? defaultValue : static_cast<uint32_t>(std::stoul(value));
+        };
+
+        std::vector<PostgresPool::statement_t> statements{
+            { lookupUserStatement, boost::str(boost::format(lookupUserScript) % usersTable_), 1 },
+        };
+
+        /* verification costs milliseconds of CPU, so it gets own threads */
+        auto hashWorkers = cfgNumber("hash_workers", std::max(1u, std::thread::hardware_concurrency() / 2));
+        hasher_ = std::make_unique<HashWorkerPool>(hashWorkers,
+            cfgNumber("hash_queue_size", default_hash_queue_size),
+            cfgNumber("hash_per_user_limit", default_hash_per_user_limit));
+
+        /* zero size disables caching */
+        if (auto cacheSize = cfgNumber("auth_cache_size", default_cache_size); cacheSize > 0) {
+            cache_ = std::make_unique<AuthCache>(cacheSize,
+                std::chrono::seconds(cfgNumber("auth_cache_ttl", default_cache_ttl)),
+                std::chrono::seconds(cfgNumber("auth_cache_negative_ttl", default_cache_negative_ttl)));
+
+            listener_ = std::make_unique<PostgresListener>(connectionString_, usersChangedChannel,
+                [cache = cache_.get()](const std::string& login) { cache->Invalidate(login); },
+                [cache = cache_.get()]() { cache->Clear(); });
+        }
 
-        pqxx::connection C{ connection_string };
+        CircuitBreaker::config_t breakerConfig;
+        breakerConfig.failureThreshold = cfgNumber("breaker_failures", breakerConfig.failureThreshold);
+        breakerConfig.openTime = std::chrono::milliseconds(cfgNumber("breaker_open_ms",
+            static_cast<uint32_t>(breakerConfig.openTime.count())));
+        breakerConfig.slowCall = std::chrono::milliseconds(cfgNumber("slow_query_ms",
+            static_cast<uint32_t>(breakerConfig.slowCall.count())));
+        breaker_ = std::make_unique<CircuitBreaker>("postgres", breakerConfig);
+
+        /* database being down at start only postpones schema to the first pool connection,
+         * the pool reconnects on its own */
+        if (!CreateSchema()) {
+            spdlog::error("Postgres is unavailable, users table is created once it is reachable");
+        }
+
+        pool_ = std::make_unique<PostgresPool>(connectionString_, std::move(statements),
+            cfgNumber("pool_size", default_pool_size),
+            cfgNumber("pipeline_depth", default_pipeline_depth),
+            cfgNumber("max_queue_size", default_queue_size),
+            PostgresPool::timeouts_t{ cfgNumber("connect_timeout", default_connect_timeout),
+                cfgNumber("statement_timeout_ms", default_statement_timeout) },
+            [this]() { return schemaReady_ || CreateSchema(); });
+    }
+    catch (std::exception const& e)
+    {
+        spdlog::error(e.what());
+    }
+}
+
+bool PostgresProcessor::CreateSchema() noexcept {
+
+    try
+    {
+        pqxx::connection C{ connectionString_ };
         if (C.is_open()) {
             std::cout << "Opened database successfully: " << C.dbname() << std::endl;
         } 
         pqxx::work W{ C };
 
+        pqxx::result R{ W.exec(boost::str(boost::format(createtableScript) % usersTable_)) };
+        W.exec(boost::str(boost::format(notifyTriggerScript) % usersTable_));
 
-        pqxx::result R{ W.exec(createtableScript) };
-
-        R = W.exec(boost::str(boost::format("SELECT * FROM %1% where email = \'%2%\';\n") % 
-                dbcfg->GetConfigValueByKey("dbusertable") % "vasiliy@test.com"));
+        R = W.exec_params(boost::str(boost::format("SELECT * FROM %1% WHERE email = $1") % usersTable_),
+                "vasiliy@test.com");
 
         if (R.size()) {
             spdlog::info(boost::str(boost::format("Found %1% users:") % R.size()));
@@ -74,35 +166,129 @@ void PostgresProcessor::InitializeDatabaseConnection() {
         }
         else {
             spdlog::info("Users not found\n");
+            spdlog::info("Add new user\n");
 
-            std::stringstream req;
-
-            using namespace boost::posix_time;
-            using namespace boost::gregorian;
+            std::string now{ boost::posix_time::to_simple_string(boost::posix_time::second_clock::local_time()) };
 
-            spdlog::info("Add new user\n");
-            ptime now = second_clock::local_time();
-
-            unsigned char obuf[20];
-            std::string pass = "vasyapassword";
-
-            std::string insert_request{
-                boost::str(boost::format("INSERT INTO %1% (username, email, password, update_at, created_at, active) VALUES(\'%2%\',\'%3%\',\'%4%\',\'%5%\',\'%6%\',\'%7%\');")
-                % dbcfg->GetConfigValueByKey("dbusertable")
-                % "vasya123"
-                % "vasiliy@test.com"
-                % pass
-                % boost::posix_time::to_simple_string(boost::posix_time::second_clock::local_time())
-                % boost::posix_time::to_simple_string(boost::posix_time::second_clock::local_time())
-                % true)};
-
-            pqxx::result R{ W.exec(insert_request) };
+            W.exec_params(boost::str(boost::format("INSERT INTO %1% (username, email, password, update_at, created_at, active) "
+                "VALUES($1, $2, $3, $4, $5, $6)") % usersTable_),
+                "vasya123", "vasiliy@test.com", PasswordHash::Hash("vasyapassword"), now, now, true);
         }
         W.commit();
         C.disconnect();
+        schemaReady_ = true;
     }
     catch (std::exception const& e)
     {
-        spdlog::error(e.what(), "\n");
+        spdlog::error(e.what());
+    }
+    return schemaReady_;
+}
+
+void PostgresProcessor::LookupUser(const std::string& login, lookup_callback_t&& cb) noexcept {
+
+    static auto& cacheLatency = Metrics::GetInstance()->GetHistogram("auth_lookup_latency_us{source=\"cache\"}");
+    static auto& dbLatency = Metrics::GetInstance()->GetHistogram("auth_lookup_latency_us{source=\"db\"}");
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t epoch = 0;
+
+    if (cache_) {
+        std::optional<user_profile_t> profile;
+        if (cache_->Lookup(login, profile) != AuthCache::lookup_t::miss) {
+            cacheLatency.Observe(std::chrono::steady_clock::now() - start);
+            cb(std::move(profile), false);
+            return;
+        }
+        epoch = cache_->GetEpoch(login);
+    }
+
+    if (!pool_ || !breaker_->Allow()) {
+        cb(std::nullopt, true);
+        return;
+    }
+
+    pool_->Execute(lookupUserStatement, { login },
+        [cb = std::move(cb), cache = cache_.get(), breaker = breaker_.get(), login, epoch, start](const PGresult* res, bool rejected) {
+        if (!res || PQresultStatus(res) != PGRES_TUPLES_OK) {
+            if (res) {
+                spdlog::error(boost::str(boost::format("Lookup user error: %1%") % PQresultErrorMessage(res)));
+            }
+            /* full queue is load, not a sign of failed database, it must not open breaker */
+            if (!rejected) {
+                breaker->Record(false, std::chrono::steady_clock::now() - start);
+            }
+            cb(std::nullopt, true);
+            return;
+        }
+        breaker->Record(true, std::chrono::steady_clock::now() - start);
+
+        std::optional<user_profile_t> profile;
+        if (PQntuples(res) > 0) {
+            profile = user_profile_t{
+                std::atoi(PQgetvalue(res, 0, 0)),
+                std::string{ PQgetvalue(res, 0, 1), static_cast<std::size_t>(PQgetlength(res, 0, 1)) },
+                !PQgetisnull(res, 0, 2) && PQgetvalue(res, 0, 2)[0] == 't'
+            };
+        }
+        if (cache) {
+            cache->Store(login, profile, epoch);
+        }
+        dbLatency.Observe(std::chrono::steady_clock::now() - start);
+        cb(std::move(profile), false);
+    });
+}
+
+void PostgresProcessor::AuthenticateUser(std::string&& login, std::string&& password, auth_callback_t&& cb) noexcept {
+
+    if (!hasher_) {
+        cb(auth_status_t::unavailable, 0);
+        return;
+    }
+
+    LookupUser(login, [hasher = hasher_.get(), login, password = std::move(password), cb = std::move(cb)]
+        (std::optional<user_profile_t>&& profile, bool dbError) mutable {
+        if (dbError) {
+            cb(auth_status_t::unavailable, 0);
+            return;
+        }
+        if (!profile || !profile->active) {
+            cb(auth_status_t::denied, 0);
+            return;
+        }
+
+        auto submitted = hasher->Submit(login, [password = std::move(password), stored = std::move(profile->password),
+            userId = static_cast<uint32_t>(profile->id), cb]() {
+            /* malformed stored hash must not leave client without an answer */
+            bool verified = false;
+            try {
+                verified = PasswordHash::Verify(password, stored);
+            }
+            catch (std::exception const& e) {
+                spdlog::error(boost::str(boost::format("Verify password of user %1% error: %2%") % userId % e.what()));
+                cb(auth_status_t::unavailable, 0);
+                return;
+            }
+            if (verified) {
+                cb(auth_status_t::approved, userId);
+            }
+            else {
+                cb(auth_status_t::denied, 0);
+            }
+        });
+        if (submitted != HashWorkerPool::submit_t::accepted) {
+            cb(auth_status_t::throttled, 0);
+        }
+    });
+}
+
+bool PostgresProcessor::ParseCredentials(const std::string& payload, std::string& login, std::string& password) {
+
+    auto pos = payload.find('+');
+    if (pos == std::string::npos || pos == 0) {
+        return false;
     }
-}
\ No newline at end of file
+    login = payload.substr(0, pos);
+    password = payload.substr(pos + 1);
+    return true;
+}
@@ -3,8 +3,8 @@
  *  @brief      Postgres connection handler class declaration
  *  @author     Kalmykov Dmitry
  *  @date       26.03.2021
- *  @modified   19.08.2021
- *  @version    0.1
+ *  @modified   19.10.2026
+ *  @version    0.2
  */
 #pragma once
 
@@ -12,22 +12,75 @@
 #include <iostream>
 #include <ctime>
 #include <cstdint>
+#include <memory>
+#include <optional>
+#include <functional>
 
  /* boost C++ lib headers */
 #include <boost/date_time.hpp>
 
 /* local C++ headers */
 #include "../config/config.h"
+#include "PostgresPool.h"
+#include "PostgresListener.h"
+#include "AuthCache.h"
+#include "CircuitBreaker.h"
+#include "../crypto/HashWorkerPool.h"
 
 class PostgresProcessor {
 
+public:
+
+    using user_profile_t = AuthCache::profile_t;
+
+    enum class auth_status_t {
+        approved,
+        denied,
+        unavailable, // database didn't answer, user may retry
+        throttled,   // too many concurrent verifications, user may retry later
+    };
+
+    /* profile is empty when user is not found, dbError is set when lookup wasn't executed */
+    using lookup_callback_t = std::function<void(std::optional<user_profile_t>&& profile, bool dbError)>;
+    /* userId is valid only for approved status */
+    using auth_callback_t = std::function<void(auth_status_t status, uint32_t userId)>;
+
 private:
 
+    const uint32_t default_pool_size = 4;
+    const uint32_t default_pipeline_depth = 64;
+    const uint32_t default_queue_size = 16384;
+    const uint32_t default_cache_size = 100000;
+    const uint32_t default_cache_ttl = 300; // s
+    const uint32_t default_cache_negative_ttl = 30; // s
+    const uint32_t default_hash_queue_size = 4096;
+    const uint32_t default_hash_per_user_limit = 2;
+    const uint32_t default_connect_timeout = 2; // s
+    const uint32_t default_statement_timeout = 1000; // ms
+
+    std::string connectionString_;
+    std::string usersTable_;
+    /* set by the first successful CreateSchema() */
+    bool schemaReady_ = false;
+    /* cache, hasher and breaker must outlive pool and listener, their threads use them */
+    std::unique_ptr<AuthCache> cache_;
+    std::unique_ptr<HashWorkerPool> hasher_;
+    /* lookups fail fast as unavailable while database is down */
+    std::unique_ptr<CircuitBreaker> breaker_;
+    std::unique_ptr<PostgresPool> pool_;
+    std::unique_ptr<PostgresListener> listener_;
+
     /*********************************************************
      *  @brief  Set connection to PostgreSQL database
      */
     void InitializeDatabaseConnection();
 
+    /*********************************************************
+     *  @brief  Create users table, its notify trigger and test user,
+     *          false while database is unreachable
+     */
+    bool CreateSchema() noexcept;
+
 public:
 
     /* constructor */
@@ -42,4 +95,19 @@ public:
         std::cout << "Destruct Postgres processor class\n";
     }
 
-};
\ No newline at end of file
+    /*********************************************************
+     *  @brief  Asynchronous lookup of user record by login
+     */
+    void LookupUser(const std::string& login, lookup_callback_t&& cb) noexcept;
+
+    /*********************************************************
+     *  @brief  Asynchronous validation of user credentials, password
+     *          hash is verified on hashing pool thread which invokes callback
+     */
+    void AuthenticateUser(std::string&& login, std::string&& password, auth_callback_t&& cb) noexcept;
+
+    /*********************************************************
+     *  @brief  Split "${login}+${password}" auth payload
+     */
+    static bool ParseCredentials(const std::string& payload, std::string& login, std::string& password);
+};
@@ -26,11 +26,18 @@ std::string JsonHandler::src_user_msg_token{ "src_user_id" };
 std::string JsonHandler::user_msg_token{ "user_message" };
 std::string JsonHandler::msg_timestamp_token{ "message_timestamp" };
 std::string JsonHandler::msg_hash_token{ "message_hash" };
+std::string JsonHandler::msg_status_token{ "message_status" };
 
 std::string JsonHandler::users_amount_token{ "users_amount" };
 std::string JsonHandler::users_list_token{ "users_list" };
 
 std::string JsonHandler::auth_status_token{ "auth_status" };
+std::string JsonHandler::session_token_token{ "session_token" };
+
+std::string JsonHandler::history_before_token{ "before" };
+std::string JsonHandler::history_after_token{ "after" };
+std::string JsonHandler::history_limit_token{ "limit" };
+std::string JsonHandler::history_token{ "history" };
 
 /* structure of users list request message
 {
@@ -61,6 +68,16 @@ std::string JsonHandler::auth_status_token{ "auth_status" };
 }
 */
 
+/* structure of answer to sender whose message server couldn't accept
+{
+    "message_identifier" : user_message
+    "dst_user_id" : sender connection ID
+    "src_user_id" : recipient of rejected message
+    "message_status" : "rejected"
+    "user_message" : "service unavailable"
+}
+*/
+
 /* structure of message to users group
 {
     "message_identifier" : group_users_message
@@ -81,16 +98,47 @@ std::string JsonHandler::auth_status_token{ "auth_status" };
 }
 */
 
+/* structure of server auth request with session token (reconnect),
+   checked on io thread without DB access, credentials are optional fallback
+{
+    "message_identifier" : authentication_message
+    "session_token" : token from previous auth response
+    "user_message" : " ${login}+${password} " // optional
+}
+*/
+
 /* structure of server auth response
 {
     "message_identifier" : authentication_message
     "dst_user_msg_token" : user ID in server side,
     "auth_status" : "approved" | "denied"
-    "user_message" : "" // any data
+    "session_token" : signed expiring token // approved only
+    "user_message" : "" | "service unavailable" | "too many attempts, try later"
     "message_timestamp" : system datetime
 }
 */
 
+/* structure of conversation history request, requester is the authenticated connection,
+   without "before" and "after" the latest page is returned
+{
+    "message_identifier" : history_message
+    "dst_user_id" : peer user ID
+    "before" : unix time, ms // optional, page of messages older than it
+    "after" : unix time, ms // optional, page of messages newer than it
+    "limit" : 1 ... 200 // optional, 50 by default
+}
+*/
+
+/* structure of conversation history response, messages in chronological order
+{
+    "message_identifier" : history_message
+    "dst_user_id" : requester user ID
+    "src_user_id" : peer user ID
+    "history" : [ { "src_user_id", "dst_user_id", "user_message", "message_timestamp" : unix time, ms }, ... ]
+    "user_message" : "" | "service unavailable"
+}
+*/
+
 boost::property_tree::ptree JsonHandler::ConstructTree(const std::string& jsonString) {
     namespace pt = boost::property_tree;
     pt::ptree ptree;
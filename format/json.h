@@ -21,6 +21,8 @@ public:
         authentication_message,
         user_message,
         group_users_message,
+        history_message,
+        heartbeat_message,      // server probe, client may answer with the same
     };
 
     static std::string msg_identificator_token;
@@ -29,11 +31,18 @@ public:
     static std::string user_msg_token;
     static std::string msg_timestamp_token;
     static std::string msg_hash_token;  
+    static std::string msg_status_token;
 
     static std::string users_amount_token;
     static std::string users_list_token;
 
     static std::string auth_status_token;
+    static std::string session_token_token;
+
+    static std::string history_before_token;
+    static std::string history_after_token;
+    static std::string history_limit_token;
+    static std::string history_token;
 
 private:
 
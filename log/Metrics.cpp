@@ -0,0 +1,137 @@
+/*****************************************************************
+ *  @file       Metrics.cpp
+ *  @brief      Registry of process wide metrics implementation
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+
+#include "Metrics.h"
+
+#include <bit>
+#include <algorithm>
+#include <sstream>
+
+#include "Logger.h"
+
+std::shared_ptr<Metrics> Metrics::metrics_ = nullptr;
+
+void Metrics::Histogram::Observe(uint64_t us) noexcept {
+    std::size_t i = std::min<std::size_t>(std::bit_width(us), buckets_count - 1);
+    buckets_[i].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(us, std::memory_order_relaxed);
+}
+
+uint64_t Metrics::Histogram::Quantile(double q) const noexcept {
+    uint64_t total = Count();
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(q * total), seen = 0;
+    for (std::size_t i = 0; i < buckets_count; ++i) {
+        seen += Bucket(i);
+        if (seen > rank) {
+            return UpperBound(i);
+        }
+    }
+    return UpperBound(buckets_count - 1);
+}
+
+Metrics::Metrics() {
+    ConsoleLogger::Debug("Construct Metrics class");
+}
+
+Metrics::~Metrics() {
+    StopReporter();
+    ConsoleLogger::Debug("Destruct Metrics class");
+}
+
+Metrics::Counter& Metrics::GetCounter(const std::string& name) {
+    std::unique_lock lk(mutex_);
+    auto& ptr = counters_[name];
+    if (!ptr) {
+        ptr = std::make_unique<Counter>();
+    }
+    return *ptr;
+}
+
+Metrics::Gauge& Metrics::GetGauge(const std::string& name) {
+    std::unique_lock lk(mutex_);
+    auto& ptr = gauges_[name];
+    if (!ptr) {
+        ptr = std::make_unique<Gauge>();
+    }
+    return *ptr;
+}
+
+Metrics::Histogram& Metrics::GetHistogram(const std::string& name) {
+    std::unique_lock lk(mutex_);
+    auto& ptr = histograms_[name];
+    if (!ptr) {
+        ptr = std::make_unique<Histogram>();
+    }
+    return *ptr;
+}
+
+std::string Metrics::Export() const {
+
+    std::ostringstream oss;
+    std::unique_lock lk(mutex_);
+
+    for (const auto& [name, counter] : counters_) {
+        oss << name << " " << counter->Get() << "\n";
+    }
+    for (const auto& [name, gauge] : gauges_) {
+        oss << name << " " << gauge->Get() << "\n";
+    }
+    for (const auto& [name, hist] : histograms_) {
+        /* split "name{labels}" to append bucket label and suffixes */
+        auto pos = name.find('{');
+        std::string base = name.substr(0, pos);
+        std::string labels = pos == std::string::npos ? "" : name.substr(pos + 1, name.size() - pos - 2);
+        std::string sep = labels.empty() ? "" : ",";
+        std::string braces = labels.empty() ? "" : "{" + labels + "}";
+
+        uint64_t cumulative = 0;
+        for (std::size_t i = 0; i < Histogram::buckets_count; ++i) {
+            if (hist->Bucket(i) == 0) {
+                continue;
+            }
+            cumulative += hist->Bucket(i);
+            oss << base << "_bucket{" << labels << sep << "le=\"" << Histogram::UpperBound(i) << "\"} " << cumulative << "\n";
+        }
+        oss << base << "_bucket{" << labels << sep << "le=\"+Inf\"} " << hist->Count() << "\n";
+        oss << base << "_sum" << braces << " " << hist->Sum() << "\n";
+        oss << base << "_count" << braces << " " << hist->Count() << "\n";
+    }
+    return oss.str();
+}
+
+void Metrics::StartReporter(uint32_t periodSec) {
+
+    std::unique_lock lk(mutex_);
+    if (reporter_.joinable() || periodSec == 0) {
+        return;
+    }
+    stop_ = false;
+    reporter_ = std::thread{ [&, periodSec]() {
+        std::unique_lock lk(mutex_);
+        while (!cv_.wait_for(lk, std::chrono::seconds(periodSec), [&]() { return stop_; })) {
+            lk.unlock();
+            ConsoleLogger::Info(Export());
+            lk.lock();
+        }
+    }};
+}
+
+void Metrics::StopReporter() noexcept {
+    {
+        std::unique_lock lk(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    if (reporter_.joinable()) {
+        reporter_.join();
+    }
+}
@@ -0,0 +1,103 @@
+/*****************************************************************
+ *  @file       Metrics.h
+ *  @brief      Registry of process wide counters, gauges and
+ *              latency histograms
+ *  @author     Kalmykov Dmitry
+ *  @date       19.10.2026
+ *  @version    0.1
+ */
+#pragma once
+
+/* std C++ lib headers */
+#include <string>
+#include <map>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+
+class Metrics {
+
+public:
+
+    class Counter {
+        std::atomic_uint64_t value_{ 0 };
+    public:
+        void Inc(uint64_t n = 1) noexcept { value_.fetch_add(n, std::memory_order_relaxed); }
+        uint64_t Get() const noexcept { return value_.load(std::memory_order_relaxed); }
+    };
+
+    class Gauge {
+        std::atomic_int64_t value_{ 0 };
+    public:
+        void Set(int64_t v) noexcept { value_.store(v, std::memory_order_relaxed); }
+        void Add(int64_t n) noexcept { value_.fetch_add(n, std::memory_order_relaxed); }
+        int64_t Get() const noexcept { return value_.load(std::memory_order_relaxed); }
+    };
+
+    /* power of two buckets, bucket i counts values in [2^(i-1), 2^i) microseconds */
+    class Histogram {
+    public:
+        static constexpr std::size_t buckets_count = 32;
+
+        void Observe(uint64_t us) noexcept;
+        void Observe(std::chrono::steady_clock::duration d) noexcept {
+            Observe(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(d).count()));
+        }
+        uint64_t Count() const noexcept { return count_.load(std::memory_order_relaxed); }
+        uint64_t Sum() const noexcept { return sum_.load(std::memory_order_relaxed); }
+        uint64_t Bucket(std::size_t i) const noexcept { return buckets_[i].load(std::memory_order_relaxed); }
+        /* upper bound of bucket containing q-quantile */
+        uint64_t Quantile(double q) const noexcept;
+
+        static uint64_t UpperBound(std::size_t i) noexcept { return i == 0 ? 1 : (1ull << i); }
+
+    private:
+        std::array<std::atomic_uint64_t, buckets_count> buckets_{};
+        std::atomic_uint64_t count_{ 0 };
+        std::atomic_uint64_t sum_{ 0 };
+    };
+
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+    Metrics();
+    ~Metrics();
+
+    static const std::shared_ptr<Metrics>& GetInstance() {
+        static std::once_flag once;
+        std::call_once(once, []() { metrics_ = std::make_shared<Metrics>(); });
+        return metrics_;
+    }
+
+    /* returned references stay valid for process lifetime, callers keep them
+     * in statics to avoid registry lookups on hot paths.
+     * name may carry prometheus labels: auth_lookup_latency_us{source="db"} */
+    Counter& GetCounter(const std::string& name);
+    Gauge& GetGauge(const std::string& name);
+    Histogram& GetHistogram(const std::string& name);
+
+    /* prometheus text exposition format */
+    std::string Export() const;
+
+    /* periodically print Export() output to console */
+    void StartReporter(uint32_t periodSec);
+    void StopReporter() noexcept;
+
+private:
+
+    mutable std::mutex mutex_;
+    std::map<std::string, std::unique_ptr<Counter>> counters_;
+    std::map<std::string, std::unique_ptr<Gauge>> gauges_;
+    std::map<std::string, std::unique_ptr<Histogram>> histograms_;
+
+    std::thread reporter_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+
+    static std::shared_ptr<Metrics> metrics_;
+};
@@ -17,6 +17,7 @@
 #include <condition_variable>
 #include <string>
 #include <thread>
+#include <future>
 
 #include <boost/format.hpp>
 #include <boost/asio.hpp>
@@ -60,11 +61,16 @@ int main()
         });
 
         /* asynchronous wait for Ctrl + C signal to occur */
+        std::promise<void> stop;
         signals.async_wait([&](const boost::system::error_code& error, int signal_number) {
-            AsyncTcpServer::StopTcpServer(work.get_io_context());
-            work.get_io_context().stop();
+            stop.set_value();
         });
 
+        /* shutdown waits for io threads to flush connections, so it runs here rather than in the handler */
+        stop.get_future().wait();
+        AsyncTcpServer::StopTcpServer(work.get_io_context());
+        work.get_io_context().stop();
+
         threads.join_all();
     }
     catch (std::exception& ex)
@@ -26,6 +26,30 @@ using testcase_t = enum class Testcase {
     test_JsonParser,
     test_MongoDbConnect,
     test_AsyncTask,
+    test_TrafficReplay,
+    test_PostgresAuth,
+    test_AuthCache,
+    test_HashWorkerPool,
+    test_SessionToken,
+    test_OfflineMailbox,
+    test_LogStorage,
+    test_HistoryCache,
+    test_MongoBuckets,
+    test_GuardedStorage,
+    test_KafkaExport,
+    test_ClusterRouting,
+    test_MessageWal,
+    test_TimerWheel,
+    test_RateLimit,
+    test_AdmissionControl,
+    test_PriorityLanes,
+    test_ShardedDispatch,
+    test_WorkStealing,
+    test_TypedMessages,
+    test_HotUpgrade,
+    test_GracefulShutdown,
+    test_StartupStages,
+    test_IdleConnections,
 };
 
 static void tests_start(testcase_t testcase, unittest_code_t& ret);
@@ -33,7 +57,93 @@ static void tests_start(testcase_t testcase, unittest_code_t& ret);
 unittest_code_t init_unit_tests() {
 
     unittest_code_t ret = UnitestCode::unittest_ok;
+#if TEST_RSA_CRYPTO
+    tests_start(Testcase::test_RSACryptoAlg, ret);
+#endif // TEST_RSA_CRYPTO
+#if TEST_DH_CRYPTO
+    tests_start(Testcase::test_DHCryptoAlg, ret);
+#endif // TEST_DH_CRYPTO
+#if TEST_PARSE_JSON
+    tests_start(Testcase::test_JsonParser, ret);
+#endif // TEST_PARSE_JSON
+#if TEST_MONGO_DB_CONNECT
+    tests_start(Testcase::test_MongoDbConnect, ret);
+#endif // TEST_MONGO_DB_CONNECT
+#if TEST_ASYNC_TASK
     tests_start(Testcase::test_AsyncTask, ret);
+#endif // TEST_ASYNC_TASK
+#if TEST_TRAFFIC_REPLAY
+    tests_start(Testcase::test_TrafficReplay, ret);
+#endif // TEST_TRAFFIC_REPLAY
+#if TEST_POSTGRES_AUTH
+    tests_start(Testcase::test_PostgresAuth, ret);
+#endif // TEST_POSTGRES_AUTH
+#if TEST_AUTH_CACHE
+    tests_start(Testcase::test_AuthCache, ret);
+#endif // TEST_AUTH_CACHE
+#if TEST_HASH_WORKER_POOL
+    tests_start(Testcase::test_HashWorkerPool, ret);
+#endif // TEST_HASH_WORKER_POOL
+#if TEST_SESSION_TOKEN
+    tests_start(Testcase::test_SessionToken, ret);
+#endif // TEST_SESSION_TOKEN
+#if TEST_OFFLINE_MAILBOX
+    tests_start(Testcase::test_OfflineMailbox, ret);
+#endif // TEST_OFFLINE_MAILBOX
+#if TEST_LOG_STORAGE
+    tests_start(Testcase::test_LogStorage, ret);
+#endif // TEST_LOG_STORAGE
+#if TEST_HISTORY_CACHE
+    tests_start(Testcase::test_HistoryCache, ret);
+#endif // TEST_HISTORY_CACHE
+#if TEST_MONGO_BUCKETS
+    tests_start(Testcase::test_MongoBuckets, ret);
+#endif // TEST_MONGO_BUCKETS
+#if TEST_GUARDED_STORAGE
+    tests_start(Testcase::test_GuardedStorage, ret);
+#endif // TEST_GUARDED_STORAGE
+#if TEST_KAFKA_EXPORT
+    tests_start(Testcase::test_KafkaExport, ret);
+#endif // TEST_KAFKA_EXPORT
+#if TEST_CLUSTER_ROUTING
+    tests_start(Testcase::test_ClusterRouting, ret);
+#endif // TEST_CLUSTER_ROUTING
+#if TEST_MESSAGE_WAL
+    tests_start(Testcase::test_MessageWal, ret);
+#endif // TEST_MESSAGE_WAL
+#if TEST_TIMER_WHEEL
+    tests_start(Testcase::test_TimerWheel, ret);
+#endif // TEST_TIMER_WHEEL
+#if TEST_RATE_LIMIT
+    tests_start(Testcase::test_RateLimit, ret);
+#endif // TEST_RATE_LIMIT
+#if TEST_ADMISSION_CONTROL
+    tests_start(Testcase::test_AdmissionControl, ret);
+#endif // TEST_ADMISSION_CONTROL
+#if TEST_PRIORITY_LANES
+    tests_start(Testcase::test_PriorityLanes, ret);
+#endif // TEST_PRIORITY_LANES
+#if TEST_SHARDED_DISPATCH
+    tests_start(Testcase::test_ShardedDispatch, ret);
+#endif // TEST_SHARDED_DISPATCH
+#if TEST_WORK_STEALING
+    tests_start(Testcase::test_WorkStealing, ret);
+#endif // TEST_WORK_STEALING
+#if TEST_TYPED_MESSAGES
+    tests_start(Testcase::test_TypedMessages, ret);
+#endif // TEST_TYPED_MESSAGES
+#if TEST_HOT_UPGRADE
+    tests_start(Testcase::test_HotUpgrade, ret);
+#endif // TEST_HOT_UPGRADE
+#if TEST_GRACEFUL_SHUTDOWN
+    tests_start(Testcase::test_GracefulShutdown, ret);
+#endif // TEST_GRACEFUL_SHUTDOWN
+#if TEST_STARTUP_STAGES
+    tests_start(Testcase::test_StartupStages, ret);
+#endif // TEST_STARTUP_STAGES
+#if TEST_IDLE_CONNECTIONS
+    tests_start(Testcase::test_IdleConnections, ret);
+#endif // TEST_IDLE_CONNECTIONS
     return ret;
 }
 
@@ -54,27 +164,180 @@ static int test_mongo_connect();
 #if TEST_ASYNC_TASK
 static int test_async_task();
 #endif // TEST_ASYNC_TASK
+#if TEST_TRAFFIC_REPLAY
+static int test_traffic_replay();
+#endif // TEST_TRAFFIC_REPLAY
+#if TEST_POSTGRES_AUTH
+static int test_postgres_auth();
+#endif // TEST_POSTGRES_AUTH
+#if TEST_AUTH_CACHE
+static int test_auth_cache();
+#endif // TEST_AUTH_CACHE
+#if TEST_HASH_WORKER_POOL
+static int test_hash_worker_pool();
+#endif // TEST_HASH_WORKER_POOL
+#if TEST_SESSION_TOKEN
+static int test_session_token();
+#endif // TEST_SESSION_TOKEN
+#if TEST_OFFLINE_MAILBOX
+static int test_offline_mailbox();
+#endif // TEST_OFFLINE_MAILBOX
+#if TEST_LOG_STORAGE
+static int test_log_storage();
+#endif // TEST_LOG_STORAGE
+#if TEST_HISTORY_CACHE
+static int test_history_cache();
+#endif // TEST_HISTORY_CACHE
+#if TEST_MONGO_BUCKETS
+static int test_mongo_buckets();
+#endif // TEST_MONGO_BUCKETS
+#if TEST_GUARDED_STORAGE
+static int test_guarded_storage();
+#endif // TEST_GUARDED_STORAGE
+#if TEST_KAFKA_EXPORT
+static int test_kafka_export();
+#endif // TEST_KAFKA_EXPORT
+#if TEST_CLUSTER_ROUTING
+static int test_cluster_routing();
+#endif // TEST_CLUSTER_ROUTING
+#if TEST_MESSAGE_WAL
+static int test_message_wal();
+#endif // TEST_MESSAGE_WAL
+#if TEST_TIMER_WHEEL
+static int test_timer_wheel();
+#endif // TEST_TIMER_WHEEL
+#if TEST_RATE_LIMIT
+static int test_rate_limit();
+#endif // TEST_RATE_LIMIT
+#if TEST_ADMISSION_CONTROL
+static int test_admission_control();
+#endif // TEST_ADMISSION_CONTROL
+#if TEST_PRIORITY_LANES
+static int test_priority_lanes();
+#endif // TEST_PRIORITY_LANES
+#if TEST_SHARDED_DISPATCH
+static int test_sharded_dispatch();
+#endif // TEST_SHARDED_DISPATCH
+#if TEST_WORK_STEALING
+static int test_work_stealing();
+#endif // TEST_WORK_STEALING
+#if TEST_TYPED_MESSAGES
+static int test_typed_messages();
+#endif // TEST_TYPED_MESSAGES
+#if TEST_HOT_UPGRADE
+static int test_hot_upgrade();
+#endif // TEST_HOT_UPGRADE
+#if TEST_GRACEFUL_SHUTDOWN
+static int test_graceful_shutdown();
+#endif // TEST_GRACEFUL_SHUTDOWN
+#if TEST_STARTUP_STAGES
+static int test_startup_stages();
+#endif // TEST_STARTUP_STAGES
+#if TEST_IDLE_CONNECTIONS
+static int test_idle_connections();
+#endif // TEST_IDLE_CONNECTIONS
 
 /* ----------------------------------- */
 static void tests_start(testcase_t testcase, unittest_code_t& ret) {
 
+    /* failed case is kept even if later cases pass */
+    int code = 0;
     switch (testcase) {
 #if TEST_RSA_CRYPTO
-    case Testcase::test_RSACryptoAlg: ret = (unittest_code_t)test_rsa_enc_dec(); break;
-#elif TEST_DH_CRYPTO
-    case Testcase::test_DHCryptoAlg: ret = (unittest_code_t)test_dh_alg(); break;
-#elif TEST_PARSE_JSON
-    case Testcase::test_JsonParser: ret = (unittest_code_t)test_parse_json(); break;
-#elif TEST_MONGO_DB_CONNECT
-    case Testcase::test_MongoDbConnect: ret = (unittest_code_t)test_mongo_connect(); break;
-#elif TEST_ASYNC_TASK
-    case Testcase::test_AsyncTask: ret = (unittest_code_t)test_async_task(); break;
-#endif 
+    case Testcase::test_RSACryptoAlg: code = test_rsa_enc_dec(); break;
+#endif // TEST_RSA_CRYPTO
+#if TEST_DH_CRYPTO
+    case Testcase::test_DHCryptoAlg: code = test_dh_alg(); break;
+#endif // TEST_DH_CRYPTO
+#if TEST_PARSE_JSON
+    case Testcase::test_JsonParser: test_parse_json(); break;
+#endif // TEST_PARSE_JSON
+#if TEST_MONGO_DB_CONNECT
+    case Testcase::test_MongoDbConnect: code = test_mongo_connect(); break;
+#endif // TEST_MONGO_DB_CONNECT
+#if TEST_ASYNC_TASK
+    case Testcase::test_AsyncTask: code = test_async_task(); break;
+#endif // TEST_ASYNC_TASK
+#if TEST_TRAFFIC_REPLAY
+    case Testcase::test_TrafficReplay: code = test_traffic_replay(); break;
+#endif // TEST_TRAFFIC_REPLAY
+#if TEST_POSTGRES_AUTH
+    case Testcase::test_PostgresAuth: code = test_postgres_auth(); break;
+#endif // TEST_POSTGRES_AUTH
+#if TEST_AUTH_CACHE
+    case Testcase::test_AuthCache: code = test_auth_cache(); break;
+#endif // TEST_AUTH_CACHE
+#if TEST_HASH_WORKER_POOL
+    case Testcase::test_HashWorkerPool: code = test_hash_worker_pool(); break;
+#endif // TEST_HASH_WORKER_POOL
+#if TEST_SESSION_TOKEN
+    case Testcase::test_SessionToken: code = test_session_token(); break;
+#endif // TEST_SESSION_TOKEN
+#if TEST_OFFLINE_MAILBOX
+    case Testcase::test_OfflineMailbox: code = test_offline_mailbox(); break;
+#endif // TEST_OFFLINE_MAILBOX
+#if TEST_LOG_STORAGE
+    case Testcase::test_LogStorage: code = test_log_storage(); break;
+#endif // TEST_LOG_STORAGE
+#if TEST_HISTORY_CACHE
+    case Testcase::test_HistoryCache: code = test_history_cache(); break;
+#endif // TEST_HISTORY_CACHE
+#if TEST_MONGO_BUCKETS
+    case Testcase::test_MongoBuckets: code = test_mongo_buckets(); break;
+#endif // TEST_MONGO_BUCKETS
+#if TEST_GUARDED_STORAGE
+    case Testcase::test_GuardedStorage: code = test_guarded_storage(); break;
+#endif // TEST_GUARDED_STORAGE
+#if TEST_KAFKA_EXPORT
+    case Testcase::test_KafkaExport: code = test_kafka_export(); break;
+#endif // TEST_KAFKA_EXPORT
+#if TEST_CLUSTER_ROUTING
+    case Testcase::test_ClusterRouting: code = test_cluster_routing(); break;
+#endif // TEST_CLUSTER_ROUTING
+#if TEST_MESSAGE_WAL
+    case Testcase::test_MessageWal: code = test_message_wal(); break;
+#endif // TEST_MESSAGE_WAL
+#if TEST_TIMER_WHEEL
+    case Testcase::test_TimerWheel: code = test_timer_wheel(); break;
+#endif // TEST_TIMER_WHEEL
+#if TEST_RATE_LIMIT
+    case Testcase::test_RateLimit: code = test_rate_limit(); break;
+#endif // TEST_RATE_LIMIT
+#if TEST_ADMISSION_CONTROL
+    case Testcase::test_AdmissionControl: code = test_admission_control(); break;
+#endif // TEST_ADMISSION_CONTROL
+#if TEST_PRIORITY_LANES
+    case Testcase::test_PriorityLanes: code = test_priority_lanes(); break;
+#endif // TEST_PRIORITY_LANES
+#if TEST_SHARDED_DISPATCH
+    case Testcase::test_ShardedDispatch: code = test_sharded_dispatch(); break;
+#endif // TEST_SHARDED_DISPATCH
+#if TEST_WORK_STEALING
+    case Testcase::test_WorkStealing: code = test_work_stealing(); break;
+#endif // TEST_WORK_STEALING
+#if TEST_TYPED_MESSAGES
+    case Testcase::test_TypedMessages: code = test_typed_messages(); break;
+#endif // TEST_TYPED_MESSAGES
+#if TEST_HOT_UPGRADE
+    case Testcase::test_HotUpgrade: code = test_hot_upgrade(); break;
+#endif // TEST_HOT_UPGRADE
+#if TEST_GRACEFUL_SHUTDOWN
+    case Testcase::test_GracefulShutdown: code = test_graceful_shutdown(); break;
+#endif // TEST_GRACEFUL_SHUTDOWN
+#if TEST_STARTUP_STAGES
+    case Testcase::test_StartupStages: code = test_startup_stages(); break;
+#endif // TEST_STARTUP_STAGES
+#if TEST_IDLE_CONNECTIONS
+    case Testcase::test_IdleConnections: code = test_idle_connections(); break;
+#endif // TEST_IDLE_CONNECTIONS
     default: spdlog::error("Undefined test case");
     }
+    if (code != 0) {
+        ret = static_cast<unittest_code_t>(code);
+    }
 }
 
-#ifdef TEST_ASYNC_TASK
+#if TEST_ASYNC_TASK
 #include <iostream>     // std::cout
 #include <future>       // std::packaged_task, std::future
 #include <chrono>       // std::chrono::seconds
@@ -108,7 +371,7 @@ static int test_async_task() {
 }
 #endif // TEST_ASYNC_TASK
 
-#ifdef TEST_MONGO_DB_CONNECT
+#if TEST_MONGO_DB_CONNECT
 
 #include "../db/MongoProcess.h"
 
@@ -191,4 +454,2719 @@ static void test_parse_json() {
         JsonParser::json_req_t::authentication_request);
 }
 #endif // TEST_PARSE_JSON
+
+#if TEST_TRAFFIC_REPLAY
+#include "../capture/TrafficCapture.h"
+#include "../capture/TrafficReplay.h"
+#include "../config/config.h"
+
+#include <cstdio>
+#include <chrono>
+#include <thread>
+
+/* round trip of capture file format and replay of captured file
+ * against running server described in replay.ini:
+ *   capture_file = server.cap
+ *   host = 127.0.0.1
+ *   port = 40400
+ *   speed = 1      (N times faster, 0 - as fast as possible)
+ */
+static int test_traffic_replay() {
+
+    const std::string tmpFile = "test_capture.cap";
+    {
+        auto capture = std::make_shared<TrafficCapture>();
+        capture->Open(tmpFile);
+        capture->Record(1, "hello", 5);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        capture->Record(300, std::string(200, 'x').data(), 200);
+        capture->Record(1, "", 0);
+        capture->Close();
+    }
+    auto frames = TrafficCapture::Load(tmpFile);
+    std::remove(tmpFile.c_str());
+
+    if (frames.size() != 3 || frames[0].connId != 1 || frames[0].payload != "hello" ||
+        frames[1].connId != 300 || frames[1].payload.size() != 200 || frames[2].payload.size() != 0 ||
+        frames[1].offsetUs - frames[0].offsetUs < 20000 || frames[2].offsetUs < frames[1].offsetUs) {
+        spdlog::error("Capture file round trip failed");
+        return 1;
+    }
+
+    auto cfg = std::make_shared<IConfig>();
+    try {
+        cfg->Open("replay.ini");
+    }
+    catch (std::exception& ex) {
+        spdlog::info("replay.ini not found, skip replay against server");
+        return 0;
+    }
+
+    TrafficReplay replay(cfg->GetConfigValueByKey("capture_file"),
+        std::atof(cfg->GetConfigValueByKey("speed").c_str()));
+    auto stats = replay.Run(cfg->GetConfigValueByKey("host"),
+        static_cast<uint16_t>(std::atoi(cfg->GetConfigValueByKey("port").c_str())));
+
+    return stats.frames == 0 ? 1 : 0;
+}
+#endif // TEST_TRAFFIC_REPLAY
+
+#if TEST_POSTGRES_AUTH
+#include "../db/PostgresProcessor.h"
+#include "../crypto/PasswordHash.h"
+
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <semaphore>
+#include <vector>
+
+#include <boost/format.hpp>
+#include <pqxx/pqxx>
+
+/* logins/s through pooled pipelined connections against local Postgres from postgres.ini,
+ * seeds own users, so that per user verification limit doesn't throttle the benchmark */
+static int test_postgres_auth() {
+
+    const uint32_t logins = 20000;
+    /* well below pool queue size, so pipelines are measured rather than queue overflow */
+    const uint32_t inFlight = 1024;
+    /* default hash_per_user_limit is 2 */
+    const uint32_t perUser = 2;
+    const uint32_t users = inFlight / perUser;
+    auto postgres = std::make_unique<PostgresProcessor>();
+
+    try {
+        IConfig dbcfg;
+        dbcfg.Open("postgres.ini");
+        pqxx::connection C{ dbcfg.GetConfigValueByKey("postgres_connection_string") };
+        pqxx::work W{ C };
+        auto table = W.quote_name(dbcfg.GetConfigValueByKey("dbusertable"));
+        /* one hash for all of them, seeding stays fast */
+        auto stored = PasswordHash::Hash("benchpassword");
+        std::string now{ boost::posix_time::to_simple_string(boost::posix_time::second_clock::local_time()) };
+        for (uint32_t u = 0; u < users; ++u) {
+            W.exec_params(boost::str(boost::format("INSERT INTO %1% (username, email, password, update_at, created_at, active) "
+                "VALUES($1, $2, $3, $4, $5, $6) ON CONFLICT DO NOTHING") % table),
+                "bench" + std::to_string(u), "bench" + std::to_string(u) + "@test.com", stored, now, now, true);
+        }
+        W.commit();
+    }
+    catch (std::exception const& e) {
+        spdlog::error(boost::str(boost::format("Postgres auth: can't seed users: %1%") % e.what()));
+        return 1;
+    }
+
+    std::atomic_uint32_t approved{ 0 }, denied{ 0 }, unavailable{ 0 }, done{ 0 };
+    std::promise<void> finished;
+    std::counting_semaphore<> slots(inFlight);
+    /* logins are spread round robin, each user has no more than perUser of them in flight */
+    std::vector<std::unique_ptr<std::counting_semaphore<>>> userSlots;
+    for (uint32_t u = 0; u < users; ++u) {
+        userSlots.push_back(std::make_unique<std::counting_semaphore<>>(perUser));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < logins; ++i) {
+        auto user = i % users;
+        slots.acquire();
+        userSlots[user]->acquire();
+        /* every 10th login uses wrong password */
+        std::string password = i % 10 ? "benchpassword" : "wrongpassword";
+        postgres->AuthenticateUser("bench" + std::to_string(user), std::move(password),
+            [&, user](PostgresProcessor::auth_status_t status, uint32_t) {
+            switch (status) {
+                case PostgresProcessor::auth_status_t::approved: approved++; break;
+                case PostgresProcessor::auth_status_t::denied: denied++; break;
+                default: unavailable++; break;
+            }
+            userSlots[user]->release();
+            slots.release();
+            if (++done == logins) {
+                finished.set_value();
+            }
+        });
+    }
+    finished.get_future().wait();
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    spdlog::info(boost::str(boost::format("%1% logins in %2% ms, %3% logins/s, %4% in flight (approved %5%, denied %6%, unavailable %7%)") %
+        logins % (elapsed.count() / 1000) % (logins * 1000000ull / std::max<int64_t>(elapsed.count(), 1)) % inFlight %
+        approved % denied % unavailable));
+
+    return (approved == logins - logins / 10 && denied == logins / 10) ? 0 : 1;
+}
+#endif // TEST_POSTGRES_AUTH
+
+#if TEST_AUTH_CACHE
+#include "../db/AuthCache.h"
+#include "../log/Metrics.h"
+
+#include <iostream>
+#include <chrono>
+#include <thread>
+
+static int test_auth_cache() {
+
+    /* single shard worth of capacity per login hash is not predictable,
+     * so capacity is large enough for hot set and scan is much larger */
+    AuthCache cache(16 * 100, std::chrono::seconds(60), std::chrono::seconds(1));
+    std::optional<AuthCache::profile_t> profile;
+
+    /* hot users are looked up twice and become protected */
+    for (int i = 0; i < 200; ++i) {
+        std::string login = "hot" + std::to_string(i);
+        cache.Store(login, AuthCache::profile_t{ i, "pass", true }, cache.GetEpoch(login));
+        cache.Lookup(login, profile);
+    }
+    /* one pass of unique logins must not flush them */
+    for (int i = 0; i < 100000; ++i) {
+        std::string login = "scan" + std::to_string(i);
+        cache.Store(login, std::nullopt, cache.GetEpoch(login));
+    }
+    int survived = 0;
+    for (int i = 0; i < 200; ++i) {
+        survived += cache.Lookup("hot" + std::to_string(i), profile) == AuthCache::lookup_t::hit;
+    }
+    if (survived != 200 || cache.Size() > 16 * 100) {
+        spdlog::error("Auth cache is not scan resistant: {} of 200 hot users survived", survived);
+        return 1;
+    }
+
+    /* negative record expires after its own TTL */
+    cache.Store("ghost", std::nullopt, cache.GetEpoch("ghost"));
+    if (cache.Lookup("ghost", profile) != AuthCache::lookup_t::negative_hit) {
+        spdlog::error("Negative record is not cached");
+        return 1;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    if (cache.Lookup("ghost", profile) != AuthCache::lookup_t::miss) {
+        spdlog::error("Negative record didn't expire");
+        return 1;
+    }
+
+    /* answer of request started before invalidation is dropped */
+    auto epoch = cache.GetEpoch("hot1");
+    cache.Invalidate("hot1");
+    cache.Store("hot1", AuthCache::profile_t{ 1, "old", true }, epoch);
+    if (cache.Lookup("hot1", profile) != AuthCache::lookup_t::miss) {
+        spdlog::error("Stale record stored after invalidation");
+        return 1;
+    }
+
+    std::cout << Metrics::GetInstance()->Export();
+    return 0;
+}
+#endif // TEST_AUTH_CACHE
+
+#if TEST_HASH_WORKER_POOL
+#include "../crypto/PasswordHash.h"
+#include "../crypto/HashWorkerPool.h"
+
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <boost/format.hpp>
+
+static int test_hash_worker_pool() {
+
+    auto start = std::chrono::steady_clock::now();
+    std::string stored = PasswordHash::Hash("secret");
+    auto hashCost = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    spdlog::info(boost::str(boost::format("PBKDF2 cost %1% us, %2%") % hashCost.count() % stored));
+
+    if (!PasswordHash::Verify("secret", stored) || PasswordHash::Verify("secreT", stored) ||
+        !PasswordHash::Verify("plain", "plain") || PasswordHash::Verify("plain", "plain2")) {
+        spdlog::error("Password hash verification failed");
+        return 1;
+    }
+
+    std::atomic_int done{ 0 };
+    {
+        HashWorkerPool pool(2, 8, 2);
+        auto job = [&]() { PasswordHash::Verify("secret", stored); done++; };
+
+        /* third verification of the same user in flight is rejected */
+        int accepted = 0, userLimited = 0, queueFull = 0;
+        for (int i = 0; i < 3; ++i) {
+            auto res = pool.Submit("alice", job);
+            accepted += res == HashWorkerPool::submit_t::accepted;
+            userLimited += res == HashWorkerPool::submit_t::user_limit;
+        }
+        /* flood of distinct users hits queue bound instead of growing it */
+        for (int i = 0; i < 100; ++i) {
+            auto res = pool.Submit("user" + std::to_string(i), job);
+            accepted += res == HashWorkerPool::submit_t::accepted;
+            queueFull += res == HashWorkerPool::submit_t::queue_full;
+        }
+        spdlog::info(boost::str(boost::format("accepted %1%, user limited %2%, queue full %3%") % accepted % userLimited % queueFull));
+
+        if (userLimited != 1 || queueFull == 0 || accepted > 2 + 2 + 8 + 2) {
+            spdlog::error("Hash worker pool limits are not applied");
+            return 1;
+        }
+        /* destructor drains accepted jobs */
+        done -= accepted;
+    }
+    return done == 0 ? 0 : 1;
+}
+#endif // TEST_HASH_WORKER_POOL
+
+#if TEST_SESSION_TOKEN
+#include "../crypto/SessionToken.h"
+
+#include <iostream>
+#include <chrono>
+#include <thread>
+
+#include <boost/format.hpp>
+
+static int test_session_token() {
+
+    SessionToken tokens;
+    tokens.Configure("000102030405060708090a0b0c0d0e0f", std::chrono::seconds(1));
+
+    std::string token = tokens.Issue(42, "vasya:123");
+    auto claims = tokens.Verify(token);
+    if (!claims || claims->userId != 42 || claims->login != "vasya:123") {
+        spdlog::error("Valid session token is rejected");
+        return 1;
+    }
+
+    /* any changed byte breaks signature */
+    std::string tampered = token;
+    tampered[3] = tampered[3] == '0' ? '1' : '0';
+    if (tokens.Verify(tampered) || tokens.Verify("") || tokens.Verify("zz.zz") || tokens.Verify(token + "00")) {
+        spdlog::error("Forged session token is accepted");
+        return 1;
+    }
+
+    /* token of another key is rejected */
+    SessionToken other;
+    if (other.Verify(token)) {
+        spdlog::error("Session token of another key is accepted");
+        return 1;
+    }
+
+    const int rounds = 100000;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i) {
+        tokens.Verify(token);
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    spdlog::info(boost::str(boost::format("Session token verify: %1% ns") % (elapsed.count() / rounds)));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    if (tokens.Verify(token)) {
+        spdlog::error("Expired session token is accepted");
+        return 1;
+    }
+    return 0;
+}
+#endif // TEST_SESSION_TOKEN
+
+#if TEST_OFFLINE_MAILBOX
+#include "../data/OfflineMailbox.h"
+
+#include <iostream>
+#include <chrono>
+#include <filesystem>
+
+#include <boost/format.hpp>
+
+/* append rate for many users and drain time for user with thousands of pending messages */
+static int test_offline_mailbox() {
+
+    OfflineMailbox::config_t config;
+    config.directory = "test_mailbox";
+    config.segmentSize = 16 * 1024 * 1024;
+    config.maxDiskSize = 512 * 1024 * 1024;
+    std::filesystem::remove_all(config.directory);
+
+    const uint32_t users = 1000, perUser = 200, hotUser = 7, hotMessages = 5000;
+    const std::string msg(200, 'm');
+    {
+        OfflineMailbox mailbox;
+        mailbox.Open(config);
+
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < perUser; ++i) {
+            for (uint32_t u = 1; u <= users; ++u) {
+                mailbox.Append(u, msg);
+            }
+        }
+        for (uint32_t i = 0; i < hotMessages; ++i) {
+            mailbox.Append(hotUser, std::to_string(i) + ";");
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        uint64_t total = users * perUser + hotMessages;
+        spdlog::info(boost::str(boost::format("Mailbox append: %1% messages in %2% ms, %3% msg/s") %
+            total % (elapsed.count() / 1000) % (total * 1000000 / std::max<int64_t>(elapsed.count(), 1))));
+
+        start = std::chrono::steady_clock::now();
+        auto taken = mailbox.Take(hotUser);
+        elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        std::size_t bytes = 0;
+        for (const auto& m : taken) {
+            bytes += m.msg.size();
+        }
+        spdlog::info(boost::str(boost::format("Mailbox drain: %1% messages, %2% bytes in %3% us") %
+            taken.size() % bytes % elapsed.count()));
+
+        bool same = taken.size() == perUser + hotMessages;
+        for (uint32_t i = 0; same && i < taken.size(); ++i) {
+            same = taken[i].msg == (i < perUser ? msg : std::to_string(i - perUser) + ";");
+        }
+        if (!same || mailbox.GetPendingCount(hotUser) != 0) {
+            spdlog::error("Mailbox drain returned wrong messages");
+            return 1;
+        }
+        mailbox.Complete(hotUser, taken.back().seq);
+        /* taken but not handed over before crash, comes again */
+        mailbox.Take(2);
+        auto first = mailbox.Take(1);
+        mailbox.Complete(1, first.back().seq);
+    }
+
+    /* completed mailboxes stay empty after restart, others are recovered */
+    {
+        OfflineMailbox mailbox;
+        mailbox.Open(config);
+        if (mailbox.GetPendingCount(hotUser) != 0 || mailbox.GetPendingCount(1) != 0 ||
+            mailbox.GetPendingCount(2) != perUser) {
+            spdlog::error("Mailbox recovery failed");
+            return 1;
+        }
+        for (uint32_t u = 1; u <= users; ++u) {
+            auto taken = mailbox.Take(u);
+            if (!taken.empty()) {
+                mailbox.Complete(u, taken.back().seq);
+            }
+        }
+    }
+
+    /* every segment is drained and only active one is left on disk */
+    std::size_t files = std::distance(std::filesystem::directory_iterator(config.directory), {});
+    std::filesystem::remove_all(config.directory);
+    return files == 1 ? 0 : 1;
+}
+#endif // TEST_OFFLINE_MAILBOX
+
+#if TEST_LOG_STORAGE
+#include "../db/LogStorage.h"
+#include "../log/Metrics.h"
+
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <filesystem>
+
+#include <boost/format.hpp>
+
+/* sustained write rate with group commit, history read of one conversation
+ * from compacted tables and recovery after restart */
+static int test_log_storage() {
+
+    LogStorage::config_t config;
+    config.directory = "test_storage";
+    config.segmentSize = 32 * 1024 * 1024;
+    std::filesystem::remove_all(config.directory);
+
+    const uint32_t writers = 8, perWriter = 125000, users = 2000;
+    const std::string text(200, 'm');
+    const uint64_t baseMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    const uint64_t conversation = IMessageStorage::ConversationKey(1, 2);
+    std::size_t expected = 0;
+    {
+        LogStorage storage(config);
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (uint32_t w = 0; w < writers; ++w) {
+            threads.emplace_back([&, w]() {
+                for (uint32_t i = 0; i < perWriter; ++i) {
+                    uint32_t src = 1 + (i * writers + w) % users;
+                    storage.Store(IMessageStorage::message_t{ src, src % 2 ? src + 1 : src - 1, baseMs + i, text });
+                }
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        storage.Flush();
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+        uint64_t total = writers * perWriter;
+        const auto& commit = Metrics::GetInstance()->GetHistogram("storage_commit_latency_us");
+        spdlog::info(boost::str(boost::format("Log storage: %1% durable writes in %2% ms, %3% msg/s, "
+            "%4% group commits, commit p99 %5% us") % total % (elapsed.count() / 1000) %
+            (total * 1000000 / std::max<int64_t>(elapsed.count(), 1)) % commit.Count() % commit.Quantile(0.99)));
+
+        /* let compaction turn sealed segments into tables */
+        for (int i = 0; i < 200 && storage.GetSegmentsCount() > 1; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        spdlog::info(boost::str(boost::format("Log storage: %1% tables after compaction") % storage.GetTablesCount()));
+
+        start = std::chrono::steady_clock::now();
+        auto all = storage.Read(conversation, 0, UINT64_MAX, SIZE_MAX, true);
+        auto page = storage.Read(conversation, 0, baseMs + perWriter / 2, 50, true);
+        elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        spdlog::info(boost::str(boost::format("Log storage: conversation of %1% messages and page of %2% read in %3% us") %
+            all.size() % page.size() % elapsed.count()));
+
+        expected = total / (users / 2);
+        if (storage.GetTablesCount() == 0 || all.size() != expected || page.size() != 50 ||
+            page.back().timestampMs > baseMs + perWriter / 2 || page.front().timestampMs > page.back().timestampMs) {
+            spdlog::error("Log storage read returned wrong messages");
+            return 1;
+        }
+    }
+
+    /* everything flushed before stop is visible after restart */
+    {
+        LogStorage storage(config);
+        auto all = storage.Read(conversation, 0, UINT64_MAX, SIZE_MAX, true);
+        if (all.size() != expected || all.front().text != text) {
+            spdlog::error("Log storage recovery failed");
+            return 1;
+        }
+    }
+    std::filesystem::remove_all(config.directory);
+    return 0;
+}
+#endif // TEST_LOG_STORAGE
+
+#if TEST_HISTORY_CACHE
+#include "../db/HistoryCache.h"
+#include "../db/LogStorage.h"
+
+#include <iostream>
+#include <chrono>
+#include <filesystem>
+
+#include <boost/format.hpp>
+
+/* recent pages come from memory, pages below ring floor fall back to storage */
+static int test_history_cache() {
+
+    LogStorage::config_t config;
+    config.directory = "test_history";
+    std::filesystem::remove_all(config.directory);
+
+    const uint32_t a = 1, b = 2;
+    const uint64_t conversation = IMessageStorage::ConversationKey(a, b);
+    const std::size_t depth = 128, total = 1000;
+    {
+        /* history written before cache existed */
+        LogStorage storage(config);
+        for (uint64_t ts = 1; ts <= total / 2; ++ts) {
+            storage.Store(IMessageStorage::message_t{ ts % 2 ? a : b, ts % 2 ? b : a, ts, std::to_string(ts) });
+        }
+        storage.Flush();
+    }
+
+    LogStorage storage(config);
+    HistoryCache cache(1000, depth);
+    for (uint64_t ts = total / 2 + 1; ts <= total; ++ts) {
+        IMessageStorage::message_t msg{ ts % 2 ? a : b, ts % 2 ? b : a, ts, std::to_string(ts) };
+        cache.Append(msg);
+        storage.Store(std::move(msg));
+    }
+    storage.Flush();
+    /* unrelated conversations push nothing out of the hot one */
+    for (uint32_t u = 10; u < 500; ++u) {
+        cache.Append(IMessageStorage::message_t{ u, u + 1, total, "x" });
+    }
+
+    auto read = [&](uint64_t fromMs, uint64_t toMs, std::size_t limit, bool latest, bool& hot) {
+        auto page = cache.Read(conversation, fromMs, toMs, limit, latest);
+        hot = page.has_value();
+        return hot ? *page : storage.Read(conversation, fromMs, toMs, limit, latest);
+    };
+
+    const int rounds = 10000;
+    bool hot = false, cold = true;
+    std::vector<IMessageStorage::message_t> latestPage, coldPage, afterPage;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i) {
+        latestPage = read(0, UINT64_MAX, 50, true, hot);
+    }
+    auto hotUs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() / rounds;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i) {
+        coldPage = read(0, total / 2, 50, true, cold);
+    }
+    auto coldUs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() / rounds;
+
+    bool afterHot = false;
+    afterPage = read(total - 9, UINT64_MAX, 50, false, afterHot);
+
+    spdlog::info(boost::str(boost::format("History page of 50: hot %1% ns, cold %2% ns") % hotUs % coldUs));
+
+    /* page reaching below the ring floor must not be served from memory */
+    bool straddleHot = true;
+    auto straddle = read(0, total - depth + 10, 50, true, straddleHot);
+
+    if (!hot || cold || !afterHot || straddleHot ||
+        latestPage.size() != 50 || latestPage.back().timestampMs != total || latestPage.front().timestampMs != total - 49 ||
+        coldPage.size() != 50 || coldPage.back().timestampMs != total / 2 ||
+        afterPage.size() != 10 || afterPage.front().timestampMs != total - 9 ||
+        straddle.size() != 50 || straddle.back().timestampMs != total - depth + 10) {
+        spdlog::error("History pages are wrong");
+        return 1;
+    }
+    std::filesystem::remove_all(config.directory);
+    return 0;
+}
+#endif // TEST_HISTORY_CACHE
+
+#if TEST_MONGO_BUCKETS
+#include "../db/MongoProcess.h"
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+
+#include <boost/format.hpp>
+
+using bsoncxx::builder::stream::document;
+using bsoncxx::builder::stream::finalize;
+
+/* documents, bytes and insert rate per million messages for flat and bucket schemas,
+ * needs MongoDB from mongo.ini "connstr" */
+static int test_mongo_buckets() {
+
+    IConfig cfg;
+    cfg.Open("mongo.ini");
+    const std::string connstr = cfg.GetConfigValueByKey("connstr");
+
+    const uint32_t messages = 1000000, users = 1000;
+    const std::string text(64, 'm');
+    const uint64_t baseMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    int ret = 0;
+
+    for (const std::string schema : { "flat", "bucket" }) {
+        std::string config = "test_mongo_" + schema + ".ini";
+        std::ofstream(config) << "connstr = " << connstr << "\nschema = " << schema << "\n";
+
+        MongoProcessor mongo(std::move(config));
+        mongocxx::client client{ mongocxx::uri{ connstr } };
+        client["msgdb"][mongo.GetCollectionName()].drop();
+
+        /* 500 conversations, a message every 10 ms of each */
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < messages; ++i) {
+            uint32_t src = 1 + i % users;
+            mongo.Store(IMessageStorage::message_t{ src, src % 2 ? src + 1 : src - 1, baseMs + (i / users) * 10, text });
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+        auto stats = client["msgdb"].run_command(document{} << "collStats" << mongo.GetCollectionName() << finalize);
+        auto view = stats.view();
+        auto number = [&view](const char* key) {
+            auto e = view[key];
+            return e.type() == bsoncxx::type::k_int32 ? static_cast<int64_t>(e.get_int32().value) :
+                e.type() == bsoncxx::type::k_int64 ? e.get_int64().value : static_cast<int64_t>(e.get_double().value);
+        };
+        spdlog::info(boost::str(boost::format("Mongo %1% schema: %2% documents, %3% data bytes, %4% storage bytes, "
+            "%5% index bytes, %6% msg/s") % schema % number("count") % number("size") % number("storageSize") %
+            number("totalIndexSize") % (messages * 1000ull / std::max<int64_t>(elapsed.count(), 1))));
+
+        auto page = mongo.Read(IMessageStorage::ConversationKey(1, 2), 0, UINT64_MAX, 50, true);
+        if (page.size() != 50 || page.back().timestampMs != baseMs + (messages / users - 1) * 10) {
+            spdlog::error("Mongo history page is wrong");
+            ret = 1;
+        }
+    }
+    return ret;
+}
+#endif // TEST_MONGO_BUCKETS
+
+#if TEST_GUARDED_STORAGE
+#include "../db/GuardedStorage.h"
+
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <filesystem>
+
+#include <boost/format.hpp>
+
+/* stand-in for remote database: answers, answers slowly or hangs until client timeout,
+ * message with poison text is always refused */
+class FlakyStorage : public IMessageStorage {
+
+public:
+
+    enum class mode_t { ok, slow, down };
+
+    std::atomic<mode_t> mode{ mode_t::ok };
+    std::atomic<uint64_t> calls{ 0 };
+    std::vector<message_t> stored;
+    std::string poison;
+
+    bool Store(message_t&& msg) noexcept override {
+        calls++;
+        if (!poison.empty() && msg.text == poison) {
+            return false;
+        }
+        switch (mode.load()) {
+            case mode_t::down:
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                return false;
+            case mode_t::slow:
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                break;
+            default:
+                break;
+        }
+        stored.push_back(std::move(msg));
+        return true;
+    }
+
+    std::vector<message_t> Read(uint64_t, uint64_t, uint64_t, std::size_t, bool) const override {
+        if (mode.load() != mode_t::ok) {
+            throw std::runtime_error("timeout");
+        }
+        return {};
+    }
+};
+
+/* dispatcher never waits for dead backend, backlog is spilled, replayed in order and survives restart */
+static int test_guarded_storage() {
+
+    GuardedStorage::config_t config;
+    config.spillDirectory = "test_spill";
+    config.maxMemoryBytes = 256 * 1024;
+    config.breaker.failureThreshold = 3;
+    config.breaker.openTime = std::chrono::milliseconds(100);
+    config.breaker.slowCall = std::chrono::milliseconds(10);
+    std::filesystem::remove_all(config.spillDirectory);
+
+    const uint64_t total = 100000;
+    const std::string text(64, 'g');
+    uint64_t ts = 0;
+    std::vector<IMessageStorage::message_t> delivered;
+
+    auto waitBacklog = [](GuardedStorage& storage) {
+        for (int i = 0; i < 1000 && storage.GetBacklog() > 0; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return storage.GetBacklog() == 0;
+    };
+    auto storeHalf = [&](GuardedStorage& storage, int64_t& maxUs) {
+        for (uint64_t i = 0; i < total / 2; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            storage.Store(IMessageStorage::message_t{ 1, 2, ++ts, text });
+            maxUs = std::max<int64_t>(maxUs, std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count());
+        }
+    };
+
+    {
+        auto backend = std::make_unique<FlakyStorage>();
+        auto flaky = backend.get();
+        flaky->mode = FlakyStorage::mode_t::down;
+        GuardedStorage storage(std::move(backend), "test", config);
+
+        int64_t maxStoreUs = 0;
+        auto start = std::chrono::steady_clock::now();
+        storeHalf(storage, maxStoreUs);
+        for (int i = 0; i < 100 && storage.GetState() == CircuitBreaker::state_t::closed; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+        /* open breaker fails reads without calling backend */
+        bool failedFast = false;
+        start = std::chrono::steady_clock::now();
+        try {
+            storage.Read(IMessageStorage::ConversationKey(1, 2), 0, UINT64_MAX, 50, true);
+        }
+        catch (std::exception&) {
+            failedFast = std::chrono::steady_clock::now() - start < std::chrono::milliseconds(1);
+        }
+        spdlog::info(boost::str(boost::format("Guarded storage: %1% stores to dead backend in %2% ms, max store %3% us, "
+            "%4% backend calls, %5% spilled") % (total / 2) % elapsed.count() % maxStoreUs % flaky->calls.load() %
+            Metrics::GetInstance()->GetCounter("storage_spilled_total").Get()));
+
+        if (storage.GetState() == CircuitBreaker::state_t::closed || !failedFast ||
+            flaky->calls > config.breaker.failureThreshold + static_cast<uint64_t>(elapsed / config.breaker.openTime) + 2 ||
+            Metrics::GetInstance()->GetCounter("storage_spilled_total").Get() == 0) {
+            spdlog::error("Guarded storage didn't isolate failed backend");
+            return 1;
+        }
+
+        /* probe succeeds, whole backlog goes out */
+        flaky->mode = FlakyStorage::mode_t::ok;
+        start = std::chrono::steady_clock::now();
+        if (!waitBacklog(storage) || storage.GetState() != CircuitBreaker::state_t::closed) {
+            spdlog::error("Guarded storage backlog isn't replayed");
+            return 1;
+        }
+        spdlog::info(boost::str(boost::format("Guarded storage: backlog replayed in %1% ms after recovery") %
+            std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count()));
+
+        /* slow answers open breaker as well */
+        flaky->mode = FlakyStorage::mode_t::slow;
+        for (int i = 0; i < 100 && storage.GetState() == CircuitBreaker::state_t::closed; ++i) {
+            storage.Store(IMessageStorage::message_t{ 1, 2, ++ts, text });
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        if (storage.GetState() == CircuitBreaker::state_t::closed) {
+            spdlog::error("Guarded storage breaker ignores slow calls");
+            return 1;
+        }
+        flaky->mode = FlakyStorage::mode_t::down;
+        storeHalf(storage, maxStoreUs);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        delivered = flaky->stored;
+    }
+
+    /* backlog left at stop is delivered by the next run */
+    {
+        auto backend = std::make_unique<FlakyStorage>();
+        auto flaky = backend.get();
+        GuardedStorage storage(std::move(backend), "test", config);
+        if (!waitBacklog(storage)) {
+            spdlog::error("Guarded storage backlog isn't restored");
+            return 1;
+        }
+        delivered.insert(delivered.end(), flaky->stored.begin(), flaky->stored.end());
+    }
+
+    bool ordered = delivered.size() == ts;
+    for (std::size_t i = 0; ordered && i < delivered.size(); ++i) {
+        ordered = delivered[i].timestampMs == i + 1 && delivered[i].text == text;
+    }
+    spdlog::info(boost::str(boost::format("Guarded storage: %1% of %2% messages delivered in order") %
+        delivered.size() % ts));
+    if (!ordered) {
+        spdlog::error("Guarded storage lost or reordered messages");
+        return 1;
+    }
+
+    /* outage outlasting many probes costs no message its place in the queue */
+    {
+        auto outage = config;
+        outage.maxAttempts = 3;
+        auto backend = std::make_unique<FlakyStorage>();
+        auto flaky = backend.get();
+        flaky->mode = FlakyStorage::mode_t::down;
+        GuardedStorage storage(std::move(backend), "test", outage);
+        auto deadBefore = Metrics::GetInstance()->GetCounter("storage_dead_letter_total").Get();
+        for (int i = 0; i < 3; ++i) {
+            storage.Store(IMessageStorage::message_t{ 1, 2, ++ts, text });
+        }
+        for (int i = 0; i < 500 && flaky->calls < 4 * outage.maxAttempts; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        flaky->mode = FlakyStorage::mode_t::ok;
+        if (flaky->calls < 4 * outage.maxAttempts || !waitBacklog(storage) || flaky->stored.size() != 3 ||
+            Metrics::GetInstance()->GetCounter("storage_dead_letter_total").Get() != deadBefore) {
+            spdlog::error("Guarded storage dead-lettered messages during outage");
+            return 1;
+        }
+    }
+
+    /* message refused every time goes to dead letter file, the queue behind it moves on */
+    {
+        auto backend = std::make_unique<FlakyStorage>();
+        auto flaky = backend.get();
+        flaky->poison = "poison";
+        GuardedStorage storage(std::move(backend), "test", config);
+        auto deadBefore = Metrics::GetInstance()->GetCounter("storage_dead_letter_total").Get();
+        storage.Store(IMessageStorage::message_t{ 1, 2, ++ts, flaky->poison });
+        storage.Store(IMessageStorage::message_t{ 1, 2, ++ts, text });
+        if (!waitBacklog(storage) || flaky->stored.size() != 1 || flaky->stored.front().text != text ||
+            Metrics::GetInstance()->GetCounter("storage_dead_letter_total").Get() != deadBefore + 1 ||
+            !std::filesystem::exists(std::filesystem::path(config.spillDirectory) / "test.dead")) {
+            spdlog::error("Guarded storage is blocked by poison message");
+            return 1;
+        }
+    }
+    std::filesystem::remove_all(config.spillDirectory);
+    return 0;
+}
+#endif // TEST_GUARDED_STORAGE
+
+#if TEST_KAFKA_EXPORT
+#include "../db/KafkaProcess.h"
+#include "../log/Metrics.h"
+
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <map>
+
+#include <boost/format.hpp>
+
+/* stand-in for broker client: records are appended to partitions of the
+ * broker and reported from Poll(), stalled client refuses everything as queue full */
+struct MockBroker {
+    std::atomic_bool stalled{ false };
+    std::atomic<uint64_t> polls{ 0 };
+    std::map<std::pair<std::string, int32_t>, std::vector<IEventProducer::record_t>> partitions;
+};
+
+class MockEventProducer : public IEventProducer {
+
+public:
+
+    explicit MockEventProducer(MockBroker& broker) : broker_(broker) {}
+
+    void SetDeliveryCallback(delivery_callback_t&& cb) override {
+        cb_ = std::move(cb);
+    }
+
+    bool Produce(const record_t& record) override {
+        if (broker_.stalled) {
+            return false;
+        }
+        broker_.partitions[{ record.topic, record.partition }].push_back(record);
+        pending_.push_back(record);
+        return true;
+    }
+
+    void Poll(std::chrono::milliseconds timeout) override {
+        broker_.polls++;
+        if (pending_.empty() && timeout.count() > 0) {
+            std::this_thread::sleep_for(timeout);
+        }
+        for (const auto& record : pending_) {
+            cb_(record, true);
+        }
+        pending_.clear();
+    }
+
+    bool Flush(std::chrono::milliseconds) override {
+        Poll(std::chrono::milliseconds(0));
+        return true;
+    }
+
+private:
+
+    MockBroker& broker_;
+    delivery_callback_t cb_;
+    std::vector<record_t> pending_;
+};
+
+/* publishing never waits for broker, events of a user keep order in its partition, full buffer drops */
+static int test_kafka_export() {
+
+    KafkaProcess::config_t config;
+    config.brokers = "mock";
+    config.partitions = 8;
+    config.batchSize = 500;
+    config.linger = std::chrono::milliseconds(5);
+
+    const uint32_t threads = 4, perThread = 50000, users = 64;
+    const std::string text(64, 'k');
+    auto& delivered = Metrics::GetInstance()->GetCounter("kafka_delivered_total");
+    auto& dropped = Metrics::GetInstance()->GetCounter("kafka_dropped_total");
+
+    MockBroker broker;
+    KafkaProcess exporter;
+    exporter.Open(config, std::make_unique<MockEventProducer>(broker));
+
+    /* each thread owns a set of users, timestamps of a user grow */
+    std::atomic<int64_t> maxPublishUs{ 0 };
+    std::atomic<uint64_t> refused{ 0 };
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> publishers;
+    for (uint32_t t = 0; t < threads; ++t) {
+        publishers.emplace_back([&, t]() {
+            int64_t maxUs = 0;
+            for (uint32_t i = 0; i < perThread; ++i) {
+                uint32_t user = 1 + t + (i % (users / threads)) * threads;
+                auto begin = std::chrono::steady_clock::now();
+                bool ok = i % 100 == 0 ? exporter.PublishPresence(user, i % 200 == 0) :
+                    exporter.PublishMessage(IMessageStorage::message_t{ user, user + 1, i, text });
+                maxUs = std::max<int64_t>(maxUs, std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - begin).count());
+                refused += ok ? 0 : 1;
+            }
+            int64_t seen = maxPublishUs;
+            while (seen < maxUs && !maxPublishUs.compare_exchange_weak(seen, maxUs)) {
+            }
+        });
+    }
+    for (auto& p : publishers) {
+        p.join();
+    }
+    auto publishUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    for (int i = 0; i < 1000 && exporter.GetBuffered() > 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    auto exportUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    exporter.Close();
+
+    const uint64_t total = threads * perThread;
+    spdlog::info(boost::str(boost::format("Kafka export: %1% events published in %2% ms, max publish %3% us, "
+        "exported in %4% ms, %5% polls, %6% delivered, %7% refused") % total % (publishUs / 1000) %
+        maxPublishUs.load() % (exportUs / 1000) % broker.polls.load() % delivered.Get() % refused.load()));
+
+    /* key decides partition, order of user events inside partition is kept */
+    bool ordered = true;
+    uint64_t exported = 0;
+    for (const auto& [topicPartition, records] : broker.partitions) {
+        std::map<std::string, uint64_t> last;
+        for (const auto& record : records) {
+            auto user = std::stoul(record.key);
+            auto pos = record.payload.find("\"timestamp\":");
+            auto ts = std::stoull(record.payload.substr(pos + 12));
+            if (static_cast<int32_t>(user % config.partitions) != topicPartition.second ||
+                (last.count(record.key) && last[record.key] > ts)) {
+                ordered = false;
+            }
+            last[record.key] = ts;
+        }
+        exported += records.size();
+    }
+    if (!ordered || exported + refused != total || delivered.Get() != exported) {
+        spdlog::error("Kafka export lost or reordered events");
+        return 1;
+    }
+
+    /* stalled broker client fills the buffer, publishing keeps returning immediately */
+    MockBroker stalledBroker;
+    stalledBroker.stalled = true;
+    config.maxBufferBytes = 64 * 1024;
+    config.closeTimeout = std::chrono::milliseconds(100);
+    KafkaProcess stalledExporter;
+    stalledExporter.Open(config, std::make_unique<MockEventProducer>(stalledBroker));
+
+    auto droppedBefore = dropped.Get();
+    int64_t maxUs = 0;
+    for (uint32_t i = 0; i < 20000; ++i) {
+        auto begin = std::chrono::steady_clock::now();
+        stalledExporter.PublishMessage(IMessageStorage::message_t{ 1, 2, i, text });
+        maxUs = std::max<int64_t>(maxUs, std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - begin).count());
+    }
+    spdlog::info(boost::str(boost::format("Kafka export: stalled client, %1% dropped, max publish %2% us") %
+        (dropped.Get() - droppedBefore) % maxUs));
+    if (dropped.Get() == droppedBefore || stalledExporter.GetBuffered() * (sizeof(IMessageStorage::message_t) + text.size()) >
+        config.maxBufferBytes) {
+        spdlog::error("Kafka export buffer isn't bounded");
+        return 1;
+    }
+    return 0;
+}
+#endif // TEST_KAFKA_EXPORT
+
+#if TEST_CLUSTER_ROUTING
+#include "../cluster/ClusterRouter.h"
+#include "../log/Metrics.h"
+
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <boost/format.hpp>
+
+/* three nodes on localhost, node 1 runs in this process and nodes 2 and 3
+ * in forked ones. Remote nodes host users and echo every message back to
+ * user 1, so round trip covers directory lookup, location cache and links */
+static const uint16_t cluster_base_port = 47310;
+static const uint32_t cluster_users_per_node = 100;
+
+static ClusterRouter::config_t cluster_config(ClusterRouter::node_id_t id) {
+    ClusterRouter::config_t config;
+    config.nodeId = id;
+    for (ClusterRouter::node_id_t node = 1; node <= 3; ++node) {
+        config.nodes.push_back({ node, "127.0.0.1", static_cast<uint16_t>(cluster_base_port + node) });
+    }
+    return config;
+}
+
+[[noreturn]] static void cluster_echo_node(ClusterRouter::node_id_t id) {
+
+    ClusterRouter router;
+    std::unordered_map<uint32_t, std::vector<std::string>> kept;
+    std::unordered_set<uint32_t> hosted;
+    for (uint32_t i = 0; i < cluster_users_per_node; ++i) {
+        hosted.insert(id * 1000 + i);
+    }
+
+    ClusterRouter::handlers_t handlers;
+    handlers.deliver = [&](uint32_t user, const std::string& msg) {
+        if (!hosted.count(user)) {
+            return false;
+        }
+        router.Route(1, std::string(msg));
+        return true;
+    };
+    handlers.store = [&](uint32_t user, const std::string& msg) { kept[user].push_back(msg); };
+    handlers.drain = [&](uint32_t user, const std::function<void(std::string&& msg)>& forward) {
+        auto it = kept.find(user);
+        if (it == kept.end()) {
+            return;
+        }
+        auto msgs = std::move(it->second);
+        kept.erase(it);
+        for (auto& msg : msgs) {
+            forward(std::move(msg));
+        }
+    };
+    handlers.evict = [&](uint32_t user, ClusterRouter::epoch_t) { hosted.erase(user); };
+
+    router.Open(cluster_config(id), std::move(handlers));
+    for (auto user : hosted) {
+        router.Register(user, router.NewEpoch());
+    }
+    for (;;) {
+        ::pause();
+    }
+}
+
+static int test_cluster_routing() {
+
+    std::vector<pid_t> children;
+    for (ClusterRouter::node_id_t id : { 2, 3 }) {
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            cluster_echo_node(id);
+        }
+        children.push_back(pid);
+    }
+
+    /* user owned by node 2 and connected nowhere yet */
+    HashRing ring({ 1, 2, 3 }, ClusterRouter::config_t{}.virtualNodes);
+    uint32_t roaming = 500000;
+    while (ring.Owner(roaming) != 2) {
+        roaming++;
+    }
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    uint64_t sent = 0, echoed = 0;
+    bool recording = false;
+    std::string roamingInbox;
+    std::unordered_map<uint32_t, std::string> kept;
+
+    ClusterRouter router;
+    ClusterRouter::handlers_t handlers;
+    handlers.deliver = [&](uint32_t user, const std::string& msg) {
+        if (user != 1 && user != roaming) {
+            return false;
+        }
+        std::unique_lock lk(mutex);
+        if (user == 1) {
+            /* steady clock is shared by processes of one host */
+            auto at = std::stoll(msg.substr(msg.find(':') + 1));
+            if (recording) {
+                Metrics::GetInstance()->GetHistogram("cluster_test_rtt_us").Observe(std::chrono::steady_clock::now() -
+                    std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(at)));
+            }
+            echoed++;
+        }
+        else {
+            roamingInbox += msg;
+        }
+        cv.notify_all();
+        return true;
+    };
+    handlers.store = [&](uint32_t user, const std::string& msg) {
+        std::unique_lock lk(mutex);
+        kept[user] += msg;
+        cv.notify_all();
+    };
+    handlers.drain = [](uint32_t, const std::function<void(std::string&& msg)>&) {};
+    handlers.evict = [](uint32_t, ClusterRouter::epoch_t) {};
+    router.Open(cluster_config(1), std::move(handlers));
+    router.Register(1, router.NewEpoch());
+
+    auto stop = [&](int rc) {
+        router.Close();
+        for (auto pid : children) {
+            ::kill(pid, SIGTERM);
+            ::waitpid(pid, nullptr, 0);
+        }
+        return rc;
+    };
+    auto send = [&](uint32_t user) {
+        std::unique_lock lk(mutex);
+        auto target = ++sent;
+        lk.unlock();
+        router.Route(user, boost::str(boost::format("%1%:%2%;") % target %
+            std::chrono::steady_clock::now().time_since_epoch().count()));
+    };
+    auto wait = [&](std::chrono::milliseconds timeout) {
+        std::unique_lock lk(mutex);
+        return cv.wait_for(lk, timeout, [&]() { return echoed >= sent; });
+    };
+
+    /* links connect and users get registered, every remote user answers once;
+     * unanswered probe is resent, echo counter follows whatever came back */
+    for (ClusterRouter::node_id_t id : { 2, 3 }) {
+        for (uint32_t i = 0; i < cluster_users_per_node; ++i) {
+            bool answered = false;
+            for (uint32_t attempt = 0; attempt < 50 && !answered; ++attempt) {
+                {
+                    std::unique_lock lk(mutex);
+                    sent = echoed;
+                }
+                send(id * 1000 + i);
+                answered = wait(std::chrono::milliseconds(200));
+            }
+            if (!answered) {
+                spdlog::error("Cluster nodes aren't reachable");
+                return stop(1);
+            }
+        }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    {
+        std::unique_lock lk(mutex);
+        sent = echoed;
+    }
+
+    /* one message in flight at a time gives latency of cross-node hop */
+    Metrics::Histogram& rtt = Metrics::GetInstance()->GetHistogram("cluster_test_rtt_us");
+    recording = true;
+    const uint32_t pings = 5000;
+    for (uint32_t i = 0; i < pings; ++i) {
+        send((i % 2 ? 2000 : 3000) + i % cluster_users_per_node);
+        if (!wait(std::chrono::milliseconds(1000))) {
+            spdlog::error("Cluster message is lost");
+            return stop(1);
+        }
+    }
+    spdlog::info(boost::str(boost::format("Cluster routing: %1% round trips, p50 %2% us, p99 %3% us") %
+        rtt.Count() % rtt.Quantile(0.5) % rtt.Quantile(0.99)));
+
+    /* burst to remote users is coalesced into batches by node links */
+    Metrics::Counter& frames = Metrics::GetInstance()->GetCounter("cluster_frames_sent_total");
+    Metrics::Counter& batches = Metrics::GetInstance()->GetCounter("cluster_batches_sent_total");
+    auto framesBefore = frames.Get(), batchesBefore = batches.Get();
+    const uint32_t burst = 200000;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < burst; ++i) {
+        send((i % 2 ? 2000 : 3000) + i % cluster_users_per_node);
+    }
+    if (!wait(std::chrono::milliseconds(30000))) {
+        spdlog::error(boost::str(boost::format("Cluster burst lost %1% messages") % (sent - echoed)));
+        return stop(1);
+    }
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    spdlog::info(boost::str(boost::format("Cluster routing: %1% messages echoed in %2% ms, %3% frames per batch, "
+        "p99 %4% us") % burst % ms % ((frames.Get() - framesBefore) / std::max<uint64_t>(batches.Get() - batchesBefore, 1)) %
+        rtt.Quantile(0.99)));
+
+    /* messages for offline user are kept by its owner and handed over on register */
+    for (uint32_t i = 0; i < 10; ++i) {
+        router.Route(roaming, boost::str(boost::format("offline %1%;") % i));
+    }
+    router.Register(roaming, router.NewEpoch());
+    {
+        std::unique_lock lk(mutex);
+        cv.wait_for(lk, std::chrono::milliseconds(2000), [&]() { return roamingInbox.size() >= 100; });
+        if (roamingInbox.find("offline 0;") != 0 || roamingInbox.find("offline 9;") == std::string::npos) {
+            spdlog::error("Cluster offline messages weren't handed over: " + roamingInbox);
+            lk.unlock();
+            return stop(1);
+        }
+    }
+
+    /* node 3 goes down, messages for its user not owned by node 2 end up in mailbox of node 1 */
+    ::kill(children.back(), SIGKILL);
+    ::waitpid(children.back(), nullptr, 0);
+    children.pop_back();
+    uint32_t stranded = 3000;
+    while (ring.Owner(stranded) == 2) {
+        stranded++;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    {
+        std::unique_lock lk(mutex);
+        kept.clear();
+    }
+    for (uint32_t i = 0; i < 10; ++i) {
+        router.Route(stranded, boost::str(boost::format("stranded %1%;") % i));
+    }
+    {
+        std::unique_lock lk(mutex);
+        cv.wait_for(lk, std::chrono::milliseconds(2000), [&]() { return kept[stranded].size() >= 110; });
+        if (kept[stranded].find("stranded 0;") != 0 || kept[stranded].find("stranded 9;") == std::string::npos) {
+            spdlog::error("Cluster messages for unreachable node weren't stored: " + kept[stranded]);
+            lk.unlock();
+            return stop(1);
+        }
+    }
+    return stop(0);
+}
+#endif // TEST_CLUSTER_ROUTING
+
+#if TEST_MESSAGE_WAL
+#include "../data/MessageWal.h"
+#include "../log/Metrics.h"
+
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include <boost/format.hpp>
+
+/* throughput of accepting messages until they are released to delivery,
+ * without log and with log at several sync intervals; then recovery of
+ * undelivered messages after restart with torn tail and segment cleanup */
+static int test_message_wal() {
+
+    const std::string dir = "test_wal";
+    const std::string text(100, 'x');
+    const uint32_t total = 100000;
+    std::filesystem::remove_all(dir);
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    uint64_t released = 0;
+    auto release = [&]() {
+        std::unique_lock lk(mutex);
+        released++;
+        cv.notify_all();
+    };
+
+    /* baseline hands message over right away */
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < total; ++i) {
+        std::string msg = text;
+        release();
+    }
+    auto baselineUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    spdlog::info(boost::str(boost::format("Message WAL: no log, %1% messages/s") %
+        (total * 1000000ull / std::max<int64_t>(baselineUs, 1))));
+
+    Metrics::Counter& syncs = Metrics::GetInstance()->GetCounter("wal_syncs_total");
+    Metrics::Histogram& commitLatency = Metrics::GetInstance()->GetHistogram("wal_commit_latency_us");
+    for (auto interval : { 0, 1, 5, 20 }) {
+        std::filesystem::remove_all(dir);
+        released = 0;
+        MessageWal wal;
+        MessageWal::config_t config;
+        config.directory = dir;
+        config.syncInterval = std::chrono::milliseconds(interval);
+        wal.Open(config, [&](uint64_t seq, uint32_t, std::string&&) {
+            release();
+            wal.Complete(seq);
+        });
+
+        auto syncsBefore = syncs.Get();
+        auto countBefore = commitLatency.Count(), sumBefore = commitLatency.Sum();
+        start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < total; ++i) {
+            wal.Append(i % 1000, std::string(text));
+        }
+        {
+            std::unique_lock lk(mutex);
+            if (!cv.wait_for(lk, std::chrono::seconds(60), [&]() { return released == total; })) {
+                spdlog::error("Message WAL didn't release all messages");
+                return 1;
+            }
+        }
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        spdlog::info(boost::str(boost::format("Message WAL: sync interval %1% ms, %2% messages/s, %3% syncs, "
+            "mean commit latency %4% us") % interval % (total * 1000000ull / std::max<int64_t>(us, 1)) %
+            (syncs.Get() - syncsBefore) % ((commitLatency.Sum() - sumBefore) / std::max<uint64_t>(commitLatency.Count() - countBefore, 1))));
+
+        /* one message in flight at a time is what sync per message would give */
+        if (interval == 0) {
+            const uint32_t single = 1000;
+            released = 0;
+            start = std::chrono::steady_clock::now();
+            for (uint32_t i = 0; i < single; ++i) {
+                wal.Append(i, std::string(text));
+                std::unique_lock lk(mutex);
+                cv.wait_for(lk, std::chrono::seconds(1), [&]() { return released == i + 1; });
+            }
+            us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+            spdlog::info(boost::str(boost::format("Message WAL: sync per message, %1% messages/s") %
+                (single * 1000000ull / std::max<int64_t>(us, 1))));
+        }
+        wal.Close();
+    }
+
+    /* first run hands over part of messages and stops */
+    std::filesystem::remove_all(dir);
+    MessageWal::config_t config;
+    config.directory = dir;
+    config.segmentSize = 16 * 1024;
+    std::vector<uint64_t> seqs;
+    {
+        MessageWal wal;
+        wal.Open(config, [&](uint64_t seq, uint32_t, std::string&&) {
+            std::unique_lock lk(mutex);
+            seqs.push_back(seq);
+            cv.notify_all();
+        });
+        for (uint32_t i = 0; i < 1000; ++i) {
+            wal.Append(i, boost::str(boost::format("message %1%") % i));
+        }
+        std::unique_lock lk(mutex);
+        cv.wait_for(lk, std::chrono::seconds(10), [&]() { return seqs.size() == 1000; });
+        for (std::size_t i = 0; i < 600 && i < seqs.size(); ++i) {
+            wal.Complete(seqs[i]);
+        }
+        lk.unlock();
+        wal.Close();
+    }
+
+    /* crash in the middle of the last record */
+    std::vector<std::filesystem::path> files;
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+        files.push_back(entry.path());
+    }
+    std::sort(files.begin(), files.end(), [](const auto& a, const auto& b) {
+        return std::stoull(a.stem().string()) < std::stoull(b.stem().string());
+    });
+    std::ofstream(files.back(), std::ios::binary | std::ios::app) << std::string(20, '\x57');
+
+    std::vector<std::pair<uint32_t, std::string>> replayed;
+    MessageWal wal;
+    wal.Open(config, [&](uint64_t, uint32_t dst, std::string&& msg) {
+        replayed.emplace_back(dst, std::move(msg));
+    });
+    bool ordered = replayed.size() == 400;
+    for (std::size_t i = 0; ordered && i < replayed.size(); ++i) {
+        ordered = replayed[i].first == 600 + i && replayed[i].second == boost::str(boost::format("message %1%") % (600 + i));
+    }
+    spdlog::info(boost::str(boost::format("Message WAL: %1% segments written, %2% of 400 undelivered replayed") %
+        files.size() % replayed.size()));
+    if (!ordered || wal.GetUndelivered() != 400) {
+        spdlog::error("Message WAL replayed wrong messages");
+        return 1;
+    }
+
+    /* everything done, only the active segment is left */
+    wal.Append(1, std::string(text));
+    for (uint64_t seq = 601; seq <= 1001; ++seq) {
+        wal.Complete(seq);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    wal.Close();
+    auto left = std::distance(std::filesystem::directory_iterator(dir), std::filesystem::directory_iterator());
+    std::filesystem::remove_all(dir);
+    if (left != 1) {
+        spdlog::error(boost::str(boost::format("Message WAL kept %1% segments") % left));
+        return 1;
+    }
+    return 0;
+}
+#endif // TEST_MESSAGE_WAL
+
+#if TEST_TIMER_WHEEL
+#include "../core/TimerWheel.h"
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <memory>
+
+#include <boost/asio.hpp>
+#include <boost/format.hpp>
+
+/* expiry accuracy over all levels on simulated clock, cancel and re-arm,
+ * then cost of a million connection timers against asio steady_timer each */
+static int test_timer_wheel() {
+
+    using namespace std::chrono;
+    const auto start = steady_clock::now();
+    const milliseconds tick{ 1 };
+
+    /* delays up to 5 minutes of 1 ms ticks span the first three levels */
+    const uint32_t count = 100000;
+    TimerWheel wheel(tick, start);
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int64_t> delays(1, 300000);
+    std::vector<int64_t> due(count), firedAt(count, -1);
+    std::vector<uint32_t> fires(count, 0);
+    std::vector<std::unique_ptr<TimerWheel::timer_t>> timers;
+    int64_t clock = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        due[i] = delays(rng);
+        timers.push_back(std::make_unique<TimerWheel::timer_t>([&, i]() {
+            fires[i]++;
+            firedAt[i] = clock;
+            return milliseconds(0);
+        }));
+        wheel.Schedule(*timers[i], milliseconds(due[i]));
+    }
+    for (uint32_t i = 0; i < count; i += 10) {
+        wheel.Cancel(*timers[i]);
+    }
+    uint32_t periodic = 0;
+    TimerWheel::timer_t heartbeat([&]() { periodic++; return milliseconds(50); });
+    wheel.Schedule(heartbeat, milliseconds(50));
+
+    for (clock = 1; clock <= 300001; ++clock) {
+        wheel.Advance(start + milliseconds(clock));
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        bool cancelled = i % 10 == 0;
+        if ((cancelled && fires[i] != 0) || (!cancelled && (fires[i] != 1 || firedAt[i] != due[i]))) {
+            spdlog::error(boost::str(boost::format("Timer %1% due at %2% fired %3% times at %4%") %
+                i % due[i] % fires[i] % firedAt[i]));
+            return 1;
+        }
+    }
+    if (periodic != 6000 || wheel.GetSize() != 1) {
+        spdlog::error(boost::str(boost::format("Periodic timer fired %1% times") % periodic));
+        return 1;
+    }
+    spdlog::info(boost::str(boost::format("Timer wheel: %1% timers fired exactly once on their tick") % count));
+
+    /* a million idle connections, each re-armed on activity */
+    const uint32_t connections = 1000000;
+    TimerWheel big(milliseconds(100), start);
+    std::vector<TimerWheel::timer_t> conns(connections);
+    for (auto& timer : conns) {
+        timer.SetCallback([]() { return milliseconds(0); });
+    }
+    auto t0 = steady_clock::now();
+    for (uint32_t i = 0; i < connections; ++i) {
+        big.Schedule(conns[i], milliseconds(30000 + i % 30000));
+    }
+    auto t1 = steady_clock::now();
+    for (uint32_t i = 0; i < connections; ++i) {
+        big.Schedule(conns[i], milliseconds(60000 + i % 30000));
+    }
+    auto t2 = steady_clock::now();
+    /* nothing is due in the first 50 s, a tick costs the same as with no timers */
+    for (uint32_t tickNo = 1; tickNo <= 500; ++tickNo) {
+        big.Advance(start + milliseconds(100 * tickNo));
+    }
+    auto t3 = steady_clock::now();
+    for (uint32_t i = 0; i < connections; ++i) {
+        big.Cancel(conns[i]);
+    }
+    auto t4 = steady_clock::now();
+    auto ns = [](auto d) { return duration_cast<nanoseconds>(d).count(); };
+    spdlog::info(boost::str(boost::format("Timer wheel: %1% timers, schedule %2% ns, re-arm %3% ns, cancel %4% ns, "
+        "idle tick %5% ns") % connections % (ns(t1 - t0) / connections) % (ns(t2 - t1) / connections) %
+        (ns(t4 - t3) / connections) % (ns(t3 - t2) / 500)));
+    if (big.GetSize() != 0) {
+        spdlog::error("Timer wheel didn't cancel all timers");
+        return 1;
+    }
+
+    /* the same with asio timer per connection */
+    boost::asio::io_context io;
+    std::vector<std::unique_ptr<boost::asio::steady_timer>> asioTimers;
+    asioTimers.reserve(connections);
+    t0 = steady_clock::now();
+    for (uint32_t i = 0; i < connections; ++i) {
+        asioTimers.push_back(std::make_unique<boost::asio::steady_timer>(io));
+        asioTimers.back()->expires_after(milliseconds(30000 + i % 30000));
+        asioTimers.back()->async_wait([](const boost::system::error_code&) {});
+    }
+    t1 = steady_clock::now();
+    for (uint32_t i = 0; i < connections; ++i) {
+        asioTimers[i]->expires_after(milliseconds(60000 + i % 30000));
+        asioTimers[i]->async_wait([](const boost::system::error_code&) {});
+    }
+    t2 = steady_clock::now();
+    for (auto& timer : asioTimers) {
+        timer->cancel();
+    }
+    io.run();
+    t3 = steady_clock::now();
+    spdlog::info(boost::str(boost::format("Timer wheel: asio steady_timer each, schedule %1% ns, re-arm %2% ns, "
+        "cancel %3% ns") % (ns(t1 - t0) / connections) % (ns(t2 - t1) / connections) % (ns(t3 - t2) / connections)));
+    return 0;
+}
+#endif // TEST_TIMER_WHEEL
+
+#if TEST_RATE_LIMIT
+#include "../core/RateLimiter.h"
+
+#include <iostream>
+#include <chrono>
+#include <functional>
+
+#include <boost/format.hpp>
+
+/* flooding sender on simulated clock reads again as soon as its pause is over,
+ * accepted frames must follow burst plus rate of the tightest bucket */
+static int test_rate_limit() {
+
+    using namespace std::chrono;
+    using clock_t = RateLimiter::clock_t;
+    const auto& limiter = RateLimiter::GetInstance();
+    const auto start = clock_t::now();
+
+    /* frames accepted within period by senders sharing user, round robin by earliest resume */
+    auto flood = [&](std::vector<RateLimiter::state_t*> senders, RateLimiter::id_t userId,
+        std::size_t frame, seconds period) {
+        std::vector<clock_t::time_point> resume(senders.size(), start);
+        uint32_t accepted = 0;
+        while (true) {
+            auto next = std::min_element(resume.begin(), resume.end());
+            if (*next >= start + period) {
+                break;
+            }
+            auto i = next - resume.begin();
+            accepted++;
+            *next += limiter->Charge(*senders[i], userId, frame, *next);
+        }
+        return accepted;
+    };
+    auto expect = [](const char* name, uint32_t accepted, uint32_t expected) {
+        spdlog::info(boost::str(boost::format("Rate limit: %1% accepted %2% frames, expected %3%") %
+            name % accepted % expected));
+        if (accepted < expected || accepted > expected + 1) {
+            spdlog::error(boost::str(boost::format("Rate limit: %1% is off") % name));
+            return false;
+        }
+        return true;
+    };
+
+    RateLimiter::config_t config;
+    config.maxFrameSize = 1024;
+    config.connMessagesPerSec = 50;
+    config.connBytesPerSec = 64 * 1024;
+    config.userMessagesPerSec = 80;
+    config.userBytesPerSec = 0;
+    config.burstSec = 2;
+    limiter->Configure(config);
+
+    /* message bucket is the tight one for small frames: 100 burst + 50/s */
+    auto guest = limiter->CreateState(start);
+    if (!expect("guest small frames", flood({ &guest }, 0, 100, seconds(10)), 100 + 50 * 10)) {
+        return 1;
+    }
+    /* byte bucket for full frames: 128 KB burst + 64 KB/s */
+    config.connMessagesPerSec = 0;
+    limiter->Configure(config);
+    auto bulk = limiter->CreateState(start);
+    if (!expect("guest full frames", flood({ &bulk }, 0, 1024, seconds(10)), 128 + 64 * 10)) {
+        return 1;
+    }
+    /* two connections of one user share 160 burst + 80/s */
+    config.connMessagesPerSec = 50;
+    limiter->Configure(config);
+    auto first = limiter->CreateState(start), second = limiter->CreateState(start);
+    if (!expect("user over two connections", flood({ &first, &second }, 1, 100, seconds(10)), 160 + 80 * 10)) {
+        return 1;
+    }
+    /* reconnect gets fresh connection buckets, user debt is kept */
+    auto reconnect = limiter->CreateState(start + seconds(10));
+    if (limiter->Charge(reconnect, 1, 100, start + seconds(10)).count() == 0) {
+        spdlog::error("Rate limit: reconnect reset user bucket");
+        return 1;
+    }
+
+    /* disabled limits never pause */
+    config.connMessagesPerSec = config.connBytesPerSec = config.userMessagesPerSec = 0;
+    limiter->Configure(config);
+    auto free = limiter->CreateState(start);
+    for (uint32_t i = 0; i < 100000; ++i) {
+        if (limiter->Charge(free, 1, 1024, start).count() != 0) {
+            spdlog::error("Rate limit: disabled limit paused reading");
+            return 1;
+        }
+    }
+
+    /* defaults keep existing deployments unlimited */
+    RateLimiter::config_t defaults;
+    if (defaults.connMessagesPerSec != 0 || defaults.connBytesPerSec != 0 ||
+        defaults.userMessagesPerSec != 0 || defaults.userBytesPerSec != 0) {
+        spdlog::error("Rate limit: enabled by default");
+        return 1;
+    }
+
+    /* cost on the read path */
+    config.connMessagesPerSec = 50;
+    config.connBytesPerSec = 64 * 1024;
+    config.userMessagesPerSec = 80;
+    limiter->Configure(config);
+    auto state = limiter->CreateState();
+    const uint32_t frames = 1000000;
+    auto t0 = steady_clock::now();
+    for (uint32_t i = 0; i < frames; ++i) {
+        limiter->Charge(state, 1 + i % 2, 100);
+    }
+    auto t1 = steady_clock::now();
+    spdlog::info(boost::str(boost::format("Rate limit: charge %1% ns per frame") %
+        (duration_cast<nanoseconds>(t1 - t0).count() / frames)));
+    limiter->Configure(defaults);
+    return 0;
+}
+#endif // TEST_RATE_LIMIT
+
+#if TEST_ADMISSION_CONTROL
+#include "../data/AdmissionControl.h"
+
+#include <iostream>
+#include <chrono>
+#include <deque>
+#include <vector>
+#include <algorithm>
+
+#include <boost/format.hpp>
+
+/* dispatcher simulated on virtual clock: 400/s chat messages of 1 ms and 200/s
+ * history reads of 4 ms ask for 120% of one thread. Without control queue delay
+ * grows for the whole run, with shedding chat messages keep waiting about the
+ * control interval and acceptor refuses clients only during overload, also when
+ * all traffic stops with it */
+static int test_admission_control() {
+
+    using namespace std::chrono;
+    using clock_t = AdmissionControl::clock_t;
+    const auto& ac = AdmissionControl::GetInstance();
+
+    struct item_t { clock_t::time_point enqueued; bool history; };
+    struct result_t { uint64_t chatP99Ms; uint64_t served; uint64_t shed; bool overloadSeen; bool refusedAfter; };
+
+    auto simulate = [&](bool control, seconds overload, seconds calm, bool quiet = false) {
+        AdmissionControl::config_t config;
+        config.interval = milliseconds(control ? 100 : 1000000000);
+        ac->Configure(config);
+
+        const auto start = clock_t::now();
+        const auto end = start + overload + calm;
+        std::deque<item_t> queue;
+        std::vector<int64_t> chatDelays;
+        result_t result{ 0, 0, 0, false, false };
+        auto nextChat = start, nextHistory = start, now = start;
+        while (now < end) {
+            /* arrivals up to now; history stops after overload phase, chat too if quiet */
+            while (nextChat <= now && (!quiet || nextChat < start + overload)) {
+                queue.push_back({ nextChat, false });
+                nextChat += microseconds(2500);
+            }
+            while (nextHistory <= now && nextHistory < start + overload) {
+                queue.push_back({ nextHistory, true });
+                nextHistory += microseconds(5000);
+            }
+            if (queue.empty()) {
+                if (quiet && now >= start + overload) {
+                    /* nothing is pushed, so dispatcher has no drain task to report idleness */
+                    now = end;
+                    break;
+                }
+                ac->OnIdle(0, now);
+                now = nextHistory < start + overload ? std::min(nextChat, nextHistory) : nextChat;
+                continue;
+            }
+            auto item = queue.front();
+            queue.pop_front();
+            bool shed = ac->OnDequeue(0, now - item.enqueued, now);
+            result.overloadSeen |= ac->IsOverloaded(now);
+            if (!item.history) {
+                chatDelays.push_back(duration_cast<milliseconds>(now - item.enqueued).count());
+                now += milliseconds(1);
+                result.served++;
+            }
+            else if (shed) {
+                now += microseconds(50);
+                result.shed++;
+            }
+            else {
+                now += milliseconds(4);
+                result.served++;
+            }
+        }
+        result.refusedAfter = !ac->AdmitConnection(now);
+        std::sort(chatDelays.begin(), chatDelays.end());
+        result.chatP99Ms = chatDelays[chatDelays.size() * 99 / 100];
+        return result;
+    };
+
+    auto print = [](const char* name, const result_t& r) {
+        spdlog::info(boost::str(boost::format("Admission control: %1%, chat p99 delay %2% ms, served %3%, "
+            "shed %4%, overload seen %5%") % name % r.chatP99Ms % r.served % r.shed % r.overloadSeen));
+    };
+
+    auto uncontrolled = simulate(false, seconds(20), seconds(0));
+    print("no shedding", uncontrolled);
+    auto controlled = simulate(true, seconds(20), seconds(0));
+    print("shedding", controlled);
+    if (uncontrolled.chatP99Ms < 1000 || controlled.chatP99Ms > 200 || controlled.shed == 0) {
+        spdlog::error("Admission control didn't bound chat message delay");
+        return 1;
+    }
+    if (!controlled.overloadSeen) {
+        spdlog::error("Admission control didn't detect sustained overload");
+        return 1;
+    }
+
+    /* overload ends, shedding stops and connections are accepted again */
+    auto recovered = simulate(true, seconds(5), seconds(5));
+    print("recovery", recovered);
+    if (recovered.refusedAfter || ac->IsShedding()) {
+        spdlog::error("Admission control didn't recover after overload");
+        return 1;
+    }
+    auto quiet = simulate(true, seconds(5), seconds(5), true);
+    print("traffic stops", quiet);
+    if (!quiet.overloadSeen || quiet.refusedAfter) {
+        spdlog::error("Admission control keeps refusing connections after traffic stopped");
+        return 1;
+    }
+
+    /* queue limit */
+    AdmissionControl::config_t config;
+    config.maxQueue = 10;
+    ac->Configure(config);
+    if (!ac->AdmitMessage(9) || ac->AdmitMessage(10)) {
+        spdlog::error("Admission control queue limit is off");
+        return 1;
+    }
+    return 0;
+}
+#endif // TEST_ADMISSION_CONTROL
+
+#if TEST_PRIORITY_LANES
+#include "../data/PriorityLanes.h"
+
+#include <iostream>
+#include <chrono>
+#include <queue>
+#include <vector>
+#include <algorithm>
+
+#include <boost/format.hpp>
+
+/* lane shares and order, then login latency of one dispatcher thread
+ * flooded by chat messages at 110% of its capacity */
+static int test_priority_lanes() {
+
+    using namespace std::chrono;
+
+    PriorityLanes<uint32_t> lanes;
+    for (uint32_t i = 0; i < 1300; ++i) {
+        lanes.Push(message_lane_t::control, 0 * 10000 + i);
+        lanes.Push(message_lane_t::interactive, 1 * 10000 + i);
+        lanes.Push(message_lane_t::bulk, 2 * 10000 + i);
+    }
+    uint32_t taken[PriorityLanes<uint32_t>::lanes_count] = { 0, 0, 0 };
+    for (uint32_t i = 0; i < 130; ++i) {
+        uint32_t item = 0;
+        lanes.Pop(item);
+        if (item % 10000 != taken[item / 10000]++) {
+            spdlog::error("Priority lanes: lane order broken");
+            return 1;
+        }
+    }
+    if (taken[0] != 80 || taken[1] != 40 || taken[2] != 10) {
+        spdlog::error(boost::str(boost::format("Priority lanes: shares %1%/%2%/%3%, expected 80/40/10") %
+            taken[0] % taken[1] % taken[2]));
+        return 1;
+    }
+    /* empty lanes don't hold back the rest */
+    PriorityLanes<uint32_t> bulkOnly;
+    bulkOnly.Push(message_lane_t::bulk, 7);
+    uint32_t item = 0;
+    if (!bulkOnly.Pop(item) || item != 7 || bulkOnly.Pop(item)) {
+        spdlog::error("Priority lanes: single lane is not drained");
+        return 1;
+    }
+
+    /* virtual clock: chat every 0.9 ms and login every 100 ms, 1 ms of work each */
+    struct item_t { microseconds enqueued; bool auth; };
+    auto simulate = [](auto push, auto pop, auto empty) {
+        std::vector<int64_t> authDelays;
+        microseconds now{ 0 }, nextChat{ 0 }, nextAuth{ 50000 };
+        const microseconds end = seconds(10);
+        while (now < end) {
+            for (; nextChat <= now; nextChat += microseconds(900)) {
+                push(item_t{ nextChat, false });
+            }
+            for (; nextAuth <= now; nextAuth += milliseconds(100)) {
+                push(item_t{ nextAuth, true });
+            }
+            if (empty()) {
+                now = std::min(nextChat, nextAuth);
+                continue;
+            }
+            auto item = pop();
+            if (item.auth) {
+                authDelays.push_back(duration_cast<microseconds>(now - item.enqueued).count());
+            }
+            now += milliseconds(1);
+        }
+        std::sort(authDelays.begin(), authDelays.end());
+        return std::make_pair(authDelays[authDelays.size() / 2], authDelays[authDelays.size() * 99 / 100]);
+    };
+
+    std::queue<item_t> fifo;
+    auto [fifoP50, fifoP99] = simulate([&](item_t i) { fifo.push(i); },
+        [&]() { auto i = fifo.front(); fifo.pop(); return i; }, [&]() { return fifo.empty(); });
+    PriorityLanes<item_t> prio;
+    auto [laneP50, laneP99] = simulate(
+        [&](item_t i) { prio.Push(i.auth ? message_lane_t::control : message_lane_t::interactive, std::move(i)); },
+        [&]() { item_t i{}; prio.Pop(i); return i; }, [&]() { return prio.Empty(); });
+
+    spdlog::info(boost::str(boost::format("Priority lanes: login delay under chat flood, single FIFO p50 %1% ms "
+        "p99 %2% ms, lanes p50 %3% ms p99 %4% ms") % (fifoP50 / 1000) % (fifoP99 / 1000) %
+        (laneP50 / 1000.0) % (laneP99 / 1000.0)));
+    if (laneP99 > 5000 || fifoP99 < 100000) {
+        spdlog::error("Priority lanes: login waits behind chat messages");
+        return 1;
+    }
+    return 0;
+}
+#endif // TEST_PRIORITY_LANES
+
+#if TEST_SHARDED_DISPATCH
+#include "../data/DispatchShards.h"
+
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <vector>
+
+#include <boost/format.hpp>
+
+/* per key order with many producers and shards, then throughput from
+ * 1 to 32 threads for handlers waiting on I/O and burning CPU */
+static int test_sharded_dispatch() {
+
+    using namespace std::chrono;
+
+    const uint32_t producers = 8, keys = 1000, perKey = 200;
+    struct item_t { uint32_t key; uint32_t seq; };
+    std::vector<uint32_t> next(keys, 0);
+    std::vector<std::size_t> owner(keys, SIZE_MAX);
+    std::atomic_uint32_t broken{ 0 }, handled{ 0 };
+    {
+        /* a key is touched by one drain of its shard at a time, no lock needed */
+        TaskScheduler scheduler(8);
+        DispatchShards<item_t> shards(scheduler, 64, [&](std::size_t shard, item_t&& item) {
+            if (owner[item.key] == SIZE_MAX) {
+                owner[item.key] = shard;
+            }
+            if (owner[item.key] != shard || next[item.key]++ != item.seq) {
+                broken++;
+            }
+            handled++;
+        });
+        std::vector<std::thread> threads;
+        for (uint32_t p = 0; p < producers; ++p) {
+            threads.emplace_back([&shards, p]() {
+                for (uint32_t seq = 0; seq < perKey; ++seq) {
+                    for (uint32_t key = p; key < keys; key += producers) {
+                        shards.Push(key, message_lane_t::interactive, item_t{ key, seq });
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        /* stop drains queued items */
+    }
+    if (broken || handled != keys * perKey) {
+        spdlog::error(boost::str(boost::format("Sharded dispatch: %1% of %2% items out of order or on foreign shard") %
+            broken % handled));
+        return 1;
+    }
+
+    /* 20000 conversations, items spread evenly; waiting handler stands for storage round trip */
+    const uint32_t items = 4000;
+    auto bench = [&](std::size_t threads, auto work) {
+        auto start = steady_clock::now();
+        {
+            TaskScheduler scheduler(threads);
+            DispatchShards<item_t> shards(scheduler, threads * 64, [&work](std::size_t, item_t&& item) { work(item); });
+            for (uint32_t i = 0; i < items; ++i) {
+                shards.Push(i * 7919 % 20000, message_lane_t::interactive, item_t{ i, 0 });
+            }
+        }
+        return items / duration_cast<duration<double>>(steady_clock::now() - start).count();
+    };
+    std::atomic_uint64_t sink{ 0 };
+    auto waiting = [](const item_t&) { std::this_thread::sleep_for(microseconds(500)); };
+    auto burning = [&sink](const item_t& item) {
+        uint64_t h = item.key;
+        for (int i = 0; i < 20000; ++i) {
+            h = h * 6364136223846793005ull + 1442695040888963407ull;
+        }
+        sink += h;
+    };
+    double waiting1 = 0, waiting8 = 0;
+    spdlog::info(boost::str(boost::format("Sharded dispatch: %1% hardware threads") % std::thread::hardware_concurrency()));
+    for (std::size_t threads : { 1, 2, 4, 8, 16, 32 }) {
+        auto io = bench(threads, waiting);
+        auto cpu = bench(threads, burning);
+        spdlog::info(boost::str(boost::format("Sharded dispatch: %1% threads, waiting handler %2% msg/s, "
+            "CPU bound handler %3% msg/s") % threads % static_cast<uint64_t>(io) % static_cast<uint64_t>(cpu)));
+        if (threads == 1) {
+            waiting1 = io;
+        }
+        if (threads == 8) {
+            waiting8 = io;
+        }
+    }
+    if (waiting8 < waiting1 * 4) {
+        spdlog::error("Sharded dispatch: threads don't scale with waiting handler");
+        return 1;
+    }
+    return 0;
+}
+#endif // TEST_SHARDED_DISPATCH
+
+#if TEST_WORK_STEALING
+#include "../core/TaskScheduler.h"
+#include "../data/DispatchShards.h"
+#include "../log/Metrics.h"
+
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+
+#include <boost/asio.hpp>
+#include <boost/format.hpp>
+
+/* stealing, hand-off to asio and stop semantics, then one hot group and
+ * many quiet users on a shard per thread versus many shards per thread */
+static int test_work_stealing() {
+
+    using namespace std::chrono;
+
+    auto& steals = Metrics::GetInstance()->GetCounter("scheduler_steals_total");
+    auto& busy = Metrics::GetInstance()->GetCounter("scheduler_busy_us_total");
+    {
+        /* tasks spawned by one worker land on its deque, the rest take them from there */
+        TaskScheduler scheduler(4);
+        std::atomic_uint32_t done{ 0 };
+        auto stolenBefore = steals.Get();
+        scheduler.Submit([&]() {
+            for (int i = 0; i < 200; ++i) {
+                scheduler.Submit([&]() { std::this_thread::sleep_for(microseconds(200)); done++; });
+            }
+        });
+        while (done < 200) {
+            std::this_thread::sleep_for(milliseconds(1));
+        }
+        if (steals.Get() == stolenBefore) {
+            spdlog::error("Work stealing: idle workers didn't steal");
+            return 1;
+        }
+
+        /* result comes back on the io thread */
+        boost::asio::io_context io;
+        auto guard = boost::asio::make_work_guard(io);
+        std::thread ioThread([&io]() { io.run(); });
+        std::atomic<std::thread::id> computedOn, deliveredOn;
+        std::atomic_int result{ 0 };
+        scheduler.Offload(io.get_executor(), [&computedOn]() {
+            computedOn = std::this_thread::get_id();
+            return 42;
+        }, [&](int value) {
+            deliveredOn = std::this_thread::get_id();
+            result = value;
+        });
+        for (int i = 0; i < 1000 && result == 0; ++i) {
+            std::this_thread::sleep_for(milliseconds(1));
+        }
+        auto ioId = ioThread.get_id();
+        guard.reset();
+        ioThread.join();
+        if (result != 42 || deliveredOn.load() != ioId || computedOn.load() == ioId) {
+            spdlog::error("Work stealing: offloaded result is not delivered on io thread");
+            return 1;
+        }
+
+        /* queued tasks run on stop, a task requeueing itself meanwhile doesn't recurse,
+         * later ones are rejected */
+        for (int i = 0; i < 100; ++i) {
+            scheduler.Submit([&]() { std::this_thread::sleep_for(microseconds(100)); done++; });
+        }
+        const uint32_t chain = 200000;
+        std::atomic_uint32_t chained{ 0 };
+        std::function<void()> requeue = [&]() {
+            if (++chained < chain) {
+                scheduler.Submit([&]() { requeue(); });
+            }
+        };
+        scheduler.Submit([&]() { requeue(); });
+        scheduler.Stop();
+        if (scheduler.Submit([&]() { done++; }) || done != 300 || chained != chain) {
+            spdlog::error(boost::str(boost::format("Work stealing: %1% of 300 tasks and %2% of %3% requeues run by stop") %
+                done % chained % chain));
+            return 1;
+        }
+
+        /* shard whose drain task is rejected gives its items up instead of staying busy forever */
+        auto& dropped = Metrics::GetInstance()->GetCounter("dispatch_dropped_total{reason=\"stopped\"}");
+        auto droppedBefore = dropped.Get();
+        DispatchShards<int> shards(scheduler, 4, [&](std::size_t, int&&) { done++; });
+        for (int i = 0; i < 3; ++i) {
+            shards.Push(7, message_lane_t::interactive, int{ i });
+        }
+        if (!shards.Flush(steady_clock::now() + seconds(1)) || dropped.Get() - droppedBefore != 3 || done != 300) {
+            spdlog::error("Work stealing: dispatch shard hangs on stopped scheduler");
+            return 1;
+        }
+    }
+
+    /* 5000 messages paced over a second, 12% to one group conversation, the rest to 10000
+     * quiet users; handler waits 1 ms like a storage round trip, the sandbox may have a single core */
+    struct item_t { uint32_t key; steady_clock::time_point enqueued; };
+    const std::size_t threads = 8;
+    const uint32_t items = 5000, hotKey = 0;
+    auto run = [&](std::size_t shardsPerThread) {
+        std::vector<int64_t> quietLatency;
+        std::mutex mutex;
+        auto busyBefore = busy.Get();
+        auto start = steady_clock::now();
+        {
+            TaskScheduler scheduler(threads);
+            DispatchShards<item_t> shards(scheduler, threads * shardsPerThread, [&](std::size_t, item_t&& item) {
+                std::this_thread::sleep_for(milliseconds(1));
+                if (item.key != hotKey) {
+                    std::unique_lock lk(mutex);
+                    quietLatency.push_back(duration_cast<microseconds>(steady_clock::now() - item.enqueued).count());
+                }
+            });
+            for (uint32_t i = 0; i < items; ++i) {
+                std::this_thread::sleep_until(start + microseconds(i * 200));
+                uint32_t key = i % 25 < 3 ? hotKey : 1 + i % 10000;
+                shards.Push(key, message_lane_t::interactive, item_t{ key, steady_clock::now() });
+            }
+        }
+        auto elapsed = duration_cast<duration<double>>(steady_clock::now() - start).count();
+        std::sort(quietLatency.begin(), quietLatency.end());
+        struct { double throughput, utilization; int64_t p50, p99; } r{ items / elapsed,
+            (busy.Get() - busyBefore) / (elapsed * 1e6 * threads),
+            quietLatency[quietLatency.size() / 2] / 1000, quietLatency[quietLatency.size() * 99 / 100] / 1000 };
+        return r;
+    };
+    auto single = run(1);
+    auto many = run(64);
+    spdlog::info(boost::str(boost::format("Work stealing: %1% threads, hot group with 12%% of load, 5000 msg/s offered") % threads));
+    spdlog::info(boost::str(boost::format("Work stealing: shard per thread %1% msg/s, utilization %2%%%, "
+        "quiet users p50 %3% ms p99 %4% ms") % static_cast<uint64_t>(single.throughput) %
+        static_cast<int>(single.utilization * 100) % single.p50 % single.p99));
+    spdlog::info(boost::str(boost::format("Work stealing: 64 shards per thread %1% msg/s, utilization %2%%%, "
+        "quiet users p50 %3% ms p99 %4% ms") % static_cast<uint64_t>(many.throughput) %
+        static_cast<int>(many.utilization * 100) % many.p50 % many.p99));
+    if (many.throughput < single.throughput * 1.1 || many.p99 * 4 > single.p99) {
+        spdlog::error("Work stealing: quiet users still wait behind hot group");
+        return 1;
+    }
+    return 0;
+}
+#endif // TEST_WORK_STEALING
+
+#if TEST_TYPED_MESSAGES
+#include "../data/Message.h"
+#include "../data/DispatchShards.h"
+#include "../db/IMessageStorage.h"
+#include "../format/json.h"
+#include "../log/Metrics.h"
+
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <vector>
+
+#include <boost/format.hpp>
+#include <boost/lexical_cast.hpp>
+
+/* validation of every request type, then dispatcher CPU per message and
+ * throughput when dispatcher parses raw frames and when io threads do */
+static int test_typed_messages() {
+
+    using namespace std::chrono;
+    using req_t = JsonHandler::json_req_t;
+
+    auto chat = Message::Parse("{\"message_identifier\":\"3\",\"src_user_id\":\"12\",\"dst_user_id\":7,\"user_message\":\"hi\"}");
+    if (!chat || chat->type != req_t::user_message || chat->src != 12 || chat->dst != 7 || chat->payload != "hi") {
+        spdlog::error("Typed messages: user message is not parsed");
+        return 1;
+    }
+    /* sender comes from the connection, frame can't speak for someone else */
+    if (!chat->SetSender(40, false) || chat->src != 40 || chat->SetSender(0x80000001, true)) {
+        spdlog::error("Typed messages: sender is taken from the frame");
+        return 1;
+    }
+    auto history = Message::Parse("{\"message_identifier\":\"5\",\"dst_user_id\":\"3\",\"before\":\"1000\",\"limit\":\"0\"}");
+    if (!history || history->dst != 3 || history->before != 1000u || history->after || history->limit != 0u) {
+        spdlog::error("Typed messages: history request is not parsed");
+        return 1;
+    }
+    auto auth = Message::Parse("{\"message_identifier\":\"2\",\"session_token\":\"t\"}");
+    if (!auth || auth->type != req_t::authentication_message || !auth->payload.empty()) {
+        spdlog::error("Typed messages: authentication request is not parsed");
+        return 1;
+    }
+    const char* malformed[] = {
+        "{\"message_identifier\":\"1\",\"src_user_id\":\"12\",\"message_timestamp\":\"t\"}",
+        "{\"message_identifier\":\"3\",\"src_user_id\":\"12\",\"user_message\":\"hi\"}",
+        "{\"message_identifier\":\"3\",\"src_user_id\":\"12\",\"dst_user_id\":\"x\",\"user_message\":\"hi\"}",
+        "{\"message_identifier\":\"42\"}",
+        "{\"user_message\":\"message_identifier\"}",
+        "hello server",
+    };
+    for (auto frame : malformed) {
+        if (Message::Parse(frame)) {
+            spdlog::error(boost::str(boost::format("Typed messages: malformed frame accepted %1%") % frame));
+            return 1;
+        }
+    }
+
+    /* 4 io threads feed one dispatcher thread with chat frames */
+    auto& busy = Metrics::GetInstance()->GetCounter("scheduler_busy_us_total");
+    const uint32_t producers = 4, perProducer = 5000, total = producers * perProducer;
+    std::atomic_uint64_t sink{ 0 };
+    auto frame = [](uint32_t src, uint32_t i) {
+        return boost::str(boost::format("{\"message_identifier\":\"3\",\"src_user_id\":\"%1%\",\"dst_user_id\":\"%2%\","
+            "\"user_message\":\"message number %3% of a conversation\",\"message_timestamp\":\"%3%\","
+            "\"message_hash\":\"0123456789abcdef\"}") % src % (src + 1) % i);
+    };
+    auto run = [&](auto item, auto produce, auto route) {
+        using item_t = decltype(item);
+        auto busyBefore = busy.Get();
+        auto start = steady_clock::now();
+        {
+            TaskScheduler dispatcher(1);
+            DispatchShards<item_t> shards(dispatcher, 64, [&](std::size_t, item_t&& it) { route(std::move(it)); });
+            std::vector<std::thread> io;
+            for (uint32_t p = 0; p < producers; ++p) {
+                io.emplace_back([&, p]() {
+                    for (uint32_t i = 0; i < perProducer; ++i) {
+                        auto src = p * 1000 + i % 100;
+                        produce(shards, IMessageStorage::ConversationKey(src, src + 1), frame(src, i));
+                    }
+                });
+            }
+            for (auto& thread : io) {
+                thread.join();
+            }
+        }
+        auto elapsed = duration_cast<duration<double>>(steady_clock::now() - start).count();
+        return std::make_pair(static_cast<double>(busy.Get() - busyBefore) / total, total / elapsed);
+    };
+
+    /* the way dispatcher did it before: tree, string params and lexical casts */
+    JsonHandler json;
+    auto [rawCpu, rawRate] = run(std::string{},
+        [](DispatchShards<std::string>& shards, uint64_t key, std::string&& f) {
+            shards.Push(key, message_lane_t::interactive, std::move(f));
+        },
+        [&](std::string&& f) {
+            auto tree = json.ConstructTree(f);
+            auto type = boost::lexical_cast<uint32_t>(json.ParseTreeParam<std::string>(tree, JsonHandler::msg_identificator_token));
+            auto dst = boost::lexical_cast<uint32_t>(json.ParseTreeParam<std::string>(tree, JsonHandler::dst_user_msg_token));
+            auto src = boost::lexical_cast<uint32_t>(json.ParseTreeParam<std::string>(tree, JsonHandler::src_user_msg_token));
+            auto text = json.ParseTreeParam<std::string>(tree, JsonHandler::user_msg_token);
+            sink += type + dst + src + text.size();
+        });
+    auto [typedCpu, typedRate] = run(Message{},
+        [](DispatchShards<Message>& shards, uint64_t, std::string&& f) {
+            if (auto msg = Message::Parse(f)) {
+                shards.Push(IMessageStorage::ConversationKey(msg->src, msg->dst), message_lane_t::interactive, std::move(*msg));
+            }
+        },
+        [&](Message&& msg) {
+            sink += static_cast<uint32_t>(msg.type) + msg.dst + msg.src + msg.payload.size();
+        });
+
+    spdlog::info(boost::str(boost::format("Typed messages: %1% hardware threads, %2% frames from %3% io threads") %
+        std::thread::hardware_concurrency() % total % producers));
+    spdlog::info(boost::str(boost::format("Typed messages: raw frames, dispatcher %1$.1f us/msg, %2% msg/s") %
+        rawCpu % static_cast<uint64_t>(rawRate)));
+    spdlog::info(boost::str(boost::format("Typed messages: parsed on io threads, dispatcher %1$.1f us/msg, %2% msg/s") %
+        typedCpu % static_cast<uint64_t>(typedRate)));
+    if (typedCpu * 4 > rawCpu) {
+        spdlog::error("Typed messages: dispatcher still spends its time on parsing");
+        return 1;
+    }
+    return 0;
+}
+#endif // TEST_TYPED_MESSAGES
+
+#if TEST_HOT_UPGRADE
+#include "../core/HotUpgrade.h"
+
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <utility>
+
+#include <boost/format.hpp>
+
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/* running process hands its listening socket over, new one accepts on it
+ * and gets messages forwarded while the old one drains */
+static int test_hot_upgrade() {
+
+    using namespace std::chrono;
+    const std::string path = "hot_upgrade_test.sock";
+    ::unlink(path.c_str());
+
+    HotUpgrade::config_t config;
+    config.socketPath = path;
+    config.drainWindow = seconds(0);
+    config.drainGrace = seconds(0);
+
+    /* the first start, nobody to take over from */
+    auto first = std::make_shared<HotUpgrade>();
+    first->Configure(config);
+    if (first->TakeOver(nullptr) >= 0) {
+        spdlog::error("Hot upgrade: listener taken over from nobody");
+        return 1;
+    }
+
+    int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (::bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(listener, 16) != 0 ||
+        ::getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+        spdlog::error("Hot upgrade: can't listen");
+        return 1;
+    }
+
+    boost::asio::io_context io;
+    auto work = boost::asio::make_work_guard(io);
+    std::thread ioThread([&io]() { io.run(); });
+
+    std::atomic_bool released{ false };
+    std::atomic_bool exited{ false };
+    HotUpgrade::handlers_t handlers;
+    handlers.release = [&]() { released = true; };
+    handlers.exit = [&]() { exited = true; };
+    first->Listen(io, listener, std::move(handlers));
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<std::pair<uint32_t, std::string>> forwarded;
+    auto second = std::make_shared<HotUpgrade>();
+    second->Configure(config);
+    auto start = steady_clock::now();
+    int taken = second->TakeOver([&](uint32_t user, std::string&& msg) {
+        std::unique_lock lk(mutex);
+        forwarded.emplace_back(user, std::move(msg));
+        cv.notify_all();
+    });
+    auto handover = duration_cast<microseconds>(steady_clock::now() - start).count();
+
+    int result = 0;
+    if (taken < 0 || !released) {
+        spdlog::error("Hot upgrade: listening socket is not handed over");
+        result = 1;
+    }
+
+    /* client connecting now is accepted by new process on the same port */
+    int client = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (!result && ::connect(client, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        spdlog::error("Hot upgrade: connection refused after handover");
+        result = 1;
+    }
+    if (!result) {
+        int accepted = ::accept(taken, nullptr, nullptr);
+        if (accepted < 0) {
+            spdlog::error("Hot upgrade: new process doesn't accept on taken socket");
+            result = 1;
+        }
+        else {
+            ::close(accepted);
+        }
+    }
+    ::close(client);
+
+    if (!result && (!first->IsDraining() || !first->Forward(7, "message for user 7") || !first->Forward(9, "and 9"))) {
+        spdlog::error("Hot upgrade: draining process doesn't forward");
+        result = 1;
+    }
+    if (!result) {
+        std::unique_lock lk(mutex);
+        if (!cv.wait_for(lk, seconds(5), [&]() { return forwarded.size() == 2; }) ||
+            forwarded[0] != std::make_pair(7u, std::string("message for user 7")) ||
+            forwarded[1] != std::make_pair(9u, std::string("and 9"))) {
+            spdlog::error("Hot upgrade: forwarded messages are lost");
+            result = 1;
+        }
+    }
+    for (int i = 0; i < 50 && !exited; ++i) {
+        std::this_thread::sleep_for(milliseconds(20));
+    }
+    if (!result && !exited) {
+        spdlog::error("Hot upgrade: drain doesn't finish");
+        result = 1;
+    }
+
+    spdlog::info(boost::str(boost::format("Hot upgrade: handover %1% us, %2% messages forwarded") %
+        handover % forwarded.size()));
+
+    first->Close();
+    second->Close();
+    work.reset();
+    io.stop();
+    ioThread.join();
+    if (taken >= 0) {
+        ::close(taken);
+    }
+    ::close(listener);
+    ::unlink(path.c_str());
+    return result;
+}
+#endif // TEST_HOT_UPGRADE
+
+#if TEST_GRACEFUL_SHUTDOWN
+#include "../core/ConnectionManager.h"
+
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+
+#include <boost/format.hpp>
+#include <boost/asio/ssl.hpp>
+
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/* 100k registered connections, as many real loopback ones as descriptors
+ * allow: they are let go and their peers close on EOF, the rest never
+ * answers and is aborted at deadline; closing them all must not deadlock
+ * on the pool lock */
+static int test_graceful_shutdown() {
+
+    using namespace std::chrono;
+    using boost::asio::ip::tcp;
+
+    const std::size_t total = 100000;
+    rlimit limit{};
+    ::getrlimit(RLIMIT_NOFILE, &limit);
+    const std::size_t real = std::min<std::size_t>(2000, (limit.rlim_cur - 64) / 2);
+
+    boost::asio::io_context io;
+    auto work = boost::asio::make_work_guard(io);
+    std::vector<std::thread> ioThreads;
+    for (unsigned i = 0; i < std::max(std::thread::hardware_concurrency(), 2u); ++i) {
+        ioThreads.emplace_back([&io]() { io.run(); });
+    }
+    boost::asio::ssl::context context(boost::asio::ssl::context::tlsv13);
+    tcp::acceptor acceptor(io, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+    auto endpoint = acceptor.local_endpoint();
+
+    auto manager = ConnectionManager::GetInstance();
+    std::vector<pollfd> peers;
+    for (std::size_t i = 0; i < total; ++i) {
+        auto client = manager->CreateNewClient(io, context);
+        if (i < real) {
+            /* fresh connection waiting for TLS hello */
+            int peer = ::socket(AF_INET, SOCK_STREAM, 0);
+            if (::connect(peer, endpoint.data(), endpoint.size()) != 0) {
+                spdlog::error("Graceful shutdown: can't connect");
+                return 1;
+            }
+            acceptor.accept(client->socket());
+            peers.push_back(pollfd{ peer, POLLIN, 0 });
+            manager->AddConnection(client);
+            client->HandleAccept();
+        }
+        else {
+            manager->AddConnection(client);
+        }
+    }
+
+    /* peers close as soon as server lets them go */
+    std::atomic_bool stop{ false };
+    std::atomic_size_t released{ 0 };
+    std::thread peerThread([&]() {
+        while (!stop && released < peers.size()) {
+            if (::poll(peers.data(), peers.size(), 50) <= 0) {
+                continue;
+            }
+            for (auto& peer : peers) {
+                char byte;
+                if (peer.fd >= 0 && peer.revents && ::recv(peer.fd, &byte, 1, MSG_DONTWAIT) <= 0) {
+                    ::close(peer.fd);
+                    peer.fd = -1;
+                    released++;
+                }
+            }
+        }
+    });
+
+    auto start = steady_clock::now();
+    auto left = manager->DrainAllConnections(start + seconds(2));
+    auto elapsed = duration_cast<milliseconds>(steady_clock::now() - start).count();
+    stop = true;
+    peerThread.join();
+
+    spdlog::info(boost::str(boost::format("Graceful shutdown: %1% connections, %2% real, %3% released gracefully, "
+        "%4% aborted at deadline, closed in %5% ms") % total % real % released % left % elapsed));
+
+    int result = 0;
+    if (manager->GetConnectionsAmount() != 0) {
+        spdlog::error("Graceful shutdown: connections left open");
+        result = 1;
+    }
+    if (released != real || left != total - real) {
+        spdlog::error("Graceful shutdown: real connections are not drained before deadline");
+        result = 1;
+    }
+
+    work.reset();
+    io.stop();
+    for (auto& thread : ioThreads) {
+        thread.join();
+    }
+    for (auto& peer : peers) {
+        if (peer.fd >= 0) {
+            ::close(peer.fd);
+        }
+    }
+    return result;
+}
+#endif // TEST_GRACEFUL_SHUTDOWN
+
+#if TEST_STARTUP_STAGES
+#include "../core/Readiness.h"
+
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <stdexcept>
+
+#include <boost/format.hpp>
+
+/* components of one stage start concurrently, failure of one is reported
+ * after the rest has finished, state goes from starting to stopping */
+static int test_startup_stages() {
+
+    using namespace std::chrono;
+    auto readiness = std::make_shared<Readiness>();
+    auto component = [](milliseconds time) {
+        return [time]() { std::this_thread::sleep_for(time); };
+    };
+
+    auto start = steady_clock::now();
+    readiness->RunStage({
+        { "tls", component(milliseconds(100)) },
+        { "message storage", component(milliseconds(300)) },
+        { "postgres", component(milliseconds(200)) },
+    });
+    auto stage = duration_cast<milliseconds>(steady_clock::now() - start);
+    auto timings = readiness->GetTimings();
+    for (auto& [name, time] : timings) {
+        spdlog::info(boost::str(boost::format("Startup stages: %1% %2% ms") % name % time.count()));
+    }
+    spdlog::info(boost::str(boost::format("Startup stages: stage took %1% ms, sequential start 600 ms") % stage.count()));
+    if (stage >= milliseconds(450) || timings.size() != 3 || timings.back().first != "message storage") {
+        spdlog::error("Startup stages: components don't start concurrently");
+        return 1;
+    }
+
+    bool thrown = false;
+    start = steady_clock::now();
+    try {
+        readiness->RunStage({
+            { "wal", []() { throw std::runtime_error("no space left"); } },
+            { "mailbox", component(milliseconds(200)) },
+        });
+    }
+    catch (std::exception& ex) {
+        thrown = std::string(ex.what()) == "no space left";
+    }
+    if (!thrown || steady_clock::now() - start < milliseconds(200) || readiness->GetTimings().size() != 4) {
+        spdlog::error("Startup stages: failure is not reported after the stage");
+        return 1;
+    }
+
+    if (readiness->GetState() != Readiness::state_t::starting || readiness->IsReady()) {
+        spdlog::error("Startup stages: server is ready before start");
+        return 1;
+    }
+    readiness->SetState(Readiness::state_t::ready);
+    if (!readiness->IsReady()) {
+        spdlog::error("Startup stages: server is not ready");
+        return 1;
+    }
+    readiness->SetState(Readiness::state_t::stopping);
+    if (readiness->IsReady() || std::string(Readiness::ToString(readiness->GetState())) != "stopping") {
+        spdlog::error("Startup stages: stopping server is ready");
+        return 1;
+    }
+    return 0;
+}
+#endif // TEST_STARTUP_STAGES
+
+#if TEST_IDLE_CONNECTIONS
+#include "../core/ConnectionManager.h"
+
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+#include <boost/format.hpp>
+#include <boost/asio/ssl.hpp>
+
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static std::size_t ResidentBytes() {
+    std::size_t size = 0, resident = 0;
+    if (auto statm = std::fopen("/proc/self/statm", "r")) {
+        if (std::fscanf(statm, "%zu %zu", &size, &resident) != 2) {
+            resident = 0;
+        }
+        std::fclose(statm);
+    }
+    return resident * ::sysconf(_SC_PAGESIZE);
+}
+
+/* as many idle TLS clients as descriptors allow, up to 100k, are connected by
+ * child process and wait after handshake; growth of server RSS is what they cost */
+static int test_idle_connections() {
+
+    using namespace std::chrono;
+    using boost::asio::ip::tcp;
+
+    rlimit limit{};
+    ::getrlimit(RLIMIT_NOFILE, &limit);
+    const std::size_t total = std::min<std::size_t>(100000, limit.rlim_cur - 64);
+
+    /* self-signed certificate of test server */
+    EVP_PKEY* key = nullptr;
+    auto keyCtx = EVP_PKEY_CTX_new_id(EVP_PKEY_ED25519, nullptr);
+    EVP_PKEY_keygen_init(keyCtx);
+    EVP_PKEY_keygen(keyCtx, &key);
+    EVP_PKEY_CTX_free(keyCtx);
+    auto cert = X509_new();
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME_add_entry_by_txt(X509_get_subject_name(cert), "CN", MBSTRING_ASC,
+        reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(cert, X509_get_subject_name(cert));
+    X509_sign(cert, key, nullptr);
+
+    boost::asio::io_context io;
+    tcp::acceptor acceptor(io, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+    auto endpoint = acceptor.local_endpoint();
+
+    /* forked before any io thread runs: clients do blocking handshakes and wait for parent */
+    int ready[2], done[2];
+    if (::pipe(ready) != 0 || ::pipe(done) != 0) {
+        spdlog::error("Idle connections: can't create pipes");
+        return 1;
+    }
+    auto child = ::fork();
+    if (child == 0) {
+        auto clientCtx = SSL_CTX_new(TLS_client_method());
+        SSL_CTX_set_mode(clientCtx, SSL_MODE_RELEASE_BUFFERS);
+        char status = 1;
+        for (std::size_t i = 0; i < total && status; ++i) {
+            int peer = ::socket(AF_INET, SOCK_STREAM, 0);
+            auto ssl = SSL_new(clientCtx);
+            if (::connect(peer, endpoint.data(), endpoint.size()) != 0 || !SSL_set_fd(ssl, peer) ||
+                SSL_connect(ssl) != 1) {
+                status = 0;
+            }
+        }
+        ::write(ready[1], &status, 1);
+        ::read(done[0], &status, 1);
+        ::_exit(0);
+    }
+
+    boost::asio::ssl::context context(boost::asio::ssl::context::tlsv13);
+    /* as AsyncTcpServer::CreateTlsContext sets it up */
+    SSL_CTX_set_mode(context.native_handle(), SSL_MODE_RELEASE_BUFFERS);
+    SSL_CTX_use_certificate(context.native_handle(), cert);
+    SSL_CTX_use_PrivateKey(context.native_handle(), key);
+
+    auto work = boost::asio::make_work_guard(io);
+    std::vector<std::thread> ioThreads;
+    for (unsigned i = 0; i < std::max(std::thread::hardware_concurrency(), 2u); ++i) {
+        ioThreads.emplace_back([&io]() { io.run(); });
+    }
+    auto manager = ConnectionManager::GetInstance();
+    auto before = ResidentBytes();
+    for (std::size_t i = 0; i < total; ++i) {
+        auto client = manager->CreateNewClient(io, context);
+        acceptor.accept(client->socket());
+        manager->AddConnection(client);
+        client->HandleAccept();
+    }
+    char status = 0;
+    ::read(ready[0], &status, 1);
+    /* the last handshakes are finished by io threads */
+    std::this_thread::sleep_for(milliseconds(500));
+    auto after = ResidentBytes();
+
+    auto perConnection = static_cast<double>(after - before) / total;
+    spdlog::info(boost::str(boost::format("Idle connections: %1% TLS connections, RSS +%2% MB, %3$.1f KB per connection, "
+        "%4$.0f MB per 100k") % total % ((after - before) >> 20) % (perConnection / 1024) %
+        (perConnection * 100000 / (1 << 20))));
+
+    int result = 0;
+    if (!status || manager->GetConnectionsAmount() != total) {
+        spdlog::error("Idle connections: clients are not connected");
+        result = 1;
+    }
+
+    /* peers are reset by child exit, connections close themselves */
+    ::write(done[1], &status, 1);
+    ::waitpid(child, nullptr, 0);
+    auto deadline = steady_clock::now() + seconds(10);
+    while (manager->GetConnectionsAmount() > 0 && steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(milliseconds(10));
+    }
+    work.reset();
+    io.stop();
+    for (auto& thread : ioThreads) {
+        thread.join();
+    }
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    return result;
+}
+#endif // TEST_IDLE_CONNECTIONS
 #endif // UNIT_TEST
\ No newline at end of file
@@ -21,6 +21,30 @@ using unittest_code_t = enum class UnitestCode {
 #define TEST_PARSE_JSON         0
 #define TEST_ASYNC_TASK         1
 #define TEST_MONGO_DB_CONNECT   0
+#define TEST_TRAFFIC_REPLAY     0
+#define TEST_POSTGRES_AUTH      0
+#define TEST_AUTH_CACHE         0
+#define TEST_HASH_WORKER_POOL   0
+#define TEST_SESSION_TOKEN      0
+#define TEST_OFFLINE_MAILBOX    0
+#define TEST_LOG_STORAGE        0
+#define TEST_HISTORY_CACHE      0
+#define TEST_MONGO_BUCKETS      0
+#define TEST_GUARDED_STORAGE    0
+#define TEST_KAFKA_EXPORT       0
+#define TEST_CLUSTER_ROUTING    0
+#define TEST_MESSAGE_WAL        0
+#define TEST_TIMER_WHEEL        0
+#define TEST_RATE_LIMIT         0
+#define TEST_ADMISSION_CONTROL  0
+#define TEST_PRIORITY_LANES     0
+#define TEST_SHARDED_DISPATCH   0
+#define TEST_WORK_STEALING      0
+#define TEST_TYPED_MESSAGES     0
+#define TEST_HOT_UPGRADE        0
+#define TEST_GRACEFUL_SHUTDOWN  0
+#define TEST_STARTUP_STAGES     0
+#define TEST_IDLE_CONNECTIONS   0
 
 extern unittest_code_t init_unit_tests();
 